@@ -369,15 +369,31 @@ run_benchmarks() {
 
     cd "$BUILD_DIR"
 
-    if [ -f "test_integration" ]; then
-        print_status "Running integration benchmarks..."
-        if ./test_integration --benchmark > benchmark_results.txt 2>&1; then
-            print_success "Benchmarks completed"
-            echo "Benchmark results:"
-            cat benchmark_results.txt
-        else
-            print_warning "Benchmarks failed or not supported"
+    # Executables that accept a --benchmark flag
+    local benchmark_executables=(
+        "test_integration"
+        "test_output_handler"
+        "test_midi_device"
+    )
+
+    local found_benchmark=false
+    : > benchmark_results.txt
+
+    for bench_exe in "${benchmark_executables[@]}"; do
+        if [ -f "$bench_exe" ]; then
+            found_benchmark=true
+            print_status "Running $bench_exe benchmarks..."
+            if ./"$bench_exe" --benchmark >> benchmark_results.txt 2>&1; then
+                print_success "$bench_exe benchmarks completed"
+            else
+                print_warning "$bench_exe benchmarks failed or not supported"
+            fi
         fi
+    done
+
+    if [ "$found_benchmark" = true ]; then
+        echo "Benchmark results:"
+        cat benchmark_results.txt
     else
         print_warning "Benchmark executable not found"
     fi
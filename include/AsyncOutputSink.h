@@ -0,0 +1,113 @@
+/**
+ * @file AsyncOutputSink.h
+ * @brief [AI GENERATED] Moves audio writing onto a dedicated I/O thread.
+ */
+
+#pragma once
+#include "AudioSink.h"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Queue and timing statistics of an AsyncOutputSink.
+ */
+struct AsyncSinkStats {
+    uint64_t blocksWritten = 0;         /**< Blocks handed to the downstream sink. */
+    uint64_t framesWritten = 0;         /**< Frames handed to the downstream sink. */
+    uint64_t backpressureWaits = 0;     /**< Times the producer found every buffer in use. */
+    double backpressureSeconds = 0.0;   /**< Total time the producer spent blocked. */
+    size_t maxQueueDepth = 0;           /**< Most filled buffers waiting at once. */
+    double averageQueueDepth = 0.0;     /**< Mean filled buffers, sampled on each submit. */
+    double writeSeconds = 0.0;          /**< Time the I/O thread spent in downstream append(). */
+    double maxWriteSeconds = 0.0;       /**< Slowest single downstream append(). */
+};
+
+/**
+ * @brief [AI GENERATED] Double-buffered sink that writes on a background thread.
+ *
+ * Owns a bounded ring of preallocated buffers. The producer renders into a
+ * free buffer (acquireBlock()/submitBlock(), or append() which copies) and
+ * the I/O thread passes filled buffers to the downstream sink in order, so
+ * rendering overlaps with conversion and disk writes. When every buffer is
+ * filled the producer blocks until the I/O thread frees one; these waits
+ * are counted as backpressure. No memory is allocated after construction.
+ */
+class AsyncOutputSink : public AudioSink {
+public:
+    /**
+     * @brief [AI GENERATED] Start the I/O thread.
+     *
+     * @param downstream Open sink that receives the audio on the I/O thread.
+     * @param blockFrames Frames per buffer.
+     * @param bufferCount Buffers in the ring, at least 2.
+     */
+    explicit AsyncOutputSink(std::unique_ptr<AudioSink> downstream, size_t blockFrames = 16384,
+                             size_t bufferCount = 4);
+    ~AsyncOutputSink() override;
+
+    AsyncOutputSink(const AsyncOutputSink&) = delete;
+    AsyncOutputSink& operator=(const AsyncOutputSink&) = delete;
+
+    /**
+     * @brief [AI GENERATED] Copy frames into the ring, submitting each buffer as it fills.
+     */
+    bool append(const double* samples, size_t frames) override;
+
+    /**
+     * @brief [AI GENERATED] Borrow the next free buffer for rendering in place.
+     *
+     * Waits while all buffers are queued. Any partially appended buffer is
+     * submitted first.
+     *
+     * @return Buffer of blockFrames() * channels() samples, or nullptr after finalize() or a write error.
+     */
+    double* acquireBlock();
+
+    /**
+     * @brief [AI GENERATED] Queue the buffer returned by acquireBlock() for writing.
+     *
+     * @param frames Valid frames in the buffer, at most blockFrames().
+     */
+    bool submitBlock(size_t frames);
+
+    /**
+     * @brief [AI GENERATED] Drain the queue, stop the I/O thread and finalize the downstream sink.
+     */
+    bool finalize() override;
+
+    int channels() const override;
+    size_t blockFrames() const;
+    AsyncSinkStats stats() const;
+
+private:
+    struct Slot {
+        std::vector<double> samples;
+        size_t frames = 0;
+    };
+
+    bool waitForFreeSlot(std::unique_lock<std::mutex>& lock);
+    bool submitLocked(std::unique_lock<std::mutex>& lock, size_t frames);
+    void ioThreadFunction();
+
+    std::unique_ptr<AudioSink> downstream_;
+    const size_t blockFrames_;
+    const int channels_;
+    std::vector<Slot> slots_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable slotFreed_;
+    std::condition_variable slotFilled_;
+    uint64_t produced_ = 0;   // Slots submitted by the producer
+    uint64_t consumed_ = 0;   // Slots fully written by the I/O thread
+    size_t fillFrames_ = 0;   // Frames appended to the slot at produced_
+    bool stopping_ = false;
+    bool failed_ = false;
+    bool finalized_ = false;
+    uint64_t depthSum_ = 0;
+    AsyncSinkStats stats_;
+    std::thread ioThread_;
+};
@@ -0,0 +1,37 @@
+/**
+ * @file AudioSink.h
+ * @brief [AI GENERATED] Common interface of the streaming audio writers.
+ */
+
+#pragma once
+#include <cstddef>
+
+/**
+ * @brief [AI GENERATED] Destination that accepts rendered audio block by block.
+ *
+ * Implemented by the file writers and by wrappers such as AsyncOutputSink,
+ * so a renderer can stream into any of them without knowing the container.
+ */
+class AudioSink {
+public:
+    virtual ~AudioSink() = default;
+
+    /**
+     * @brief [AI GENERATED] Append a block of interleaved frames.
+     *
+     * @param samples Interleaved samples, nominally in the range [-1, 1].
+     * @param frames Number of frames (samples per channel) in the block.
+     * @return True if the block was accepted.
+     */
+    virtual bool append(const double* samples, size_t frames) = 0;
+
+    /**
+     * @brief [AI GENERATED] Flush all pending audio and close the destination.
+     */
+    virtual bool finalize() = 0;
+
+    /**
+     * @brief [AI GENERATED] Interleaved channel count expected by append().
+     */
+    virtual int channels() const = 0;
+};
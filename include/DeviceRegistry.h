@@ -0,0 +1,89 @@
+/**
+ * @file DeviceRegistry.h
+ * @brief [AI GENERATED] Thread-safe cache of known MIDI devices indexed by id and name.
+ */
+
+#pragma once
+#include "MidiDevice.h"
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Set of MidiDeviceInfo kept current by scans and hotplug events.
+ *
+ * Lookups by device id and by normalized name are hash lookups, so code
+ * that resolves a device does not need to rescan the system. If several
+ * devices share a name, the name resolves to the one with the lowest id.
+ * Lookups return a copy; a missing device comes back with deviceId -1.
+ * All methods may be called from any thread.
+ */
+class DeviceRegistry {
+public:
+    /**
+     * @brief [AI GENERATED] Lowercase letters and digits only: "Oxygen Pro 61 MIDI 1" -> "oxygenpro61midi1".
+     */
+    static std::string normalizeName(const std::string& name);
+
+    /**
+     * @brief [AI GENERATED] Insert a device, or replace the entry with the same id.
+     *
+     * @return True if the id was not registered before.
+     */
+    bool update(const MidiDeviceInfo& device);
+
+    /**
+     * @brief [AI GENERATED] Remove a device.
+     *
+     * @param removed Receives the removed entry if not null.
+     * @return False if the id was not registered.
+     */
+    bool remove(int deviceId, MidiDeviceInfo* removed = nullptr);
+
+    /**
+     * @brief [AI GENERATED] Remove every device matching predicate and return them.
+     */
+    std::vector<MidiDeviceInfo> removeIf(const std::function<bool(const MidiDeviceInfo&)>& predicate);
+
+    /**
+     * @brief [AI GENERATED] Replace the contents with a full scan result.
+     *
+     * @param added Receives devices that were not registered before, if not null.
+     * @param removed Receives registered devices missing from the scan, if not null.
+     */
+    void replaceAll(const std::vector<MidiDeviceInfo>& devices,
+                    std::vector<MidiDeviceInfo>* added = nullptr,
+                    std::vector<MidiDeviceInfo>* removed = nullptr);
+
+    MidiDeviceInfo find(int deviceId) const;
+
+    /**
+     * @brief [AI GENERATED] Device whose normalized name equals name's.
+     */
+    MidiDeviceInfo findByName(const std::string& name) const;
+
+    /**
+     * @brief [AI GENERATED] Lowest-id device matching predicate; a linear walk of the cache.
+     */
+    MidiDeviceInfo findFirst(const std::function<bool(const MidiDeviceInfo&)>& predicate) const;
+
+    /**
+     * @brief [AI GENERATED] All devices ordered by id.
+     */
+    std::vector<MidiDeviceInfo> snapshot() const;
+
+    size_t size() const;
+    bool empty() const;
+    void clear();
+
+private:
+    static MidiDeviceInfo notFound();
+    void indexNameLocked(const MidiDeviceInfo& device);
+    void unindexNameLocked(const MidiDeviceInfo& device);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<int, MidiDeviceInfo> byId_;
+    std::unordered_map<std::string, int> byName_;   /**< Normalized name to lowest id with that name. */
+};
@@ -0,0 +1,63 @@
+/**
+ * @file FlacDecoder.h
+ * @brief [AI GENERATED] Reference FLAC decoder used to verify encoded output.
+ */
+
+#pragma once
+#include "FlacFormat.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Subframe types seen while decoding a stream.
+ */
+struct FlacDecodeStats {
+    uint64_t frames = 0;
+    uint64_t constantSubframes = 0;
+    uint64_t verbatimSubframes = 0;
+    uint64_t fixedSubframes = 0;
+    uint64_t lpcSubframes = 0;
+};
+
+/**
+ * @brief [AI GENERATED] Decodes a complete native FLAC stream into interleaved integer samples.
+ *
+ * Implements the full frame syntax of the FLAC format specification
+ * independently of FlacWriter: every block size, sample rate and sample
+ * size code, all channel decorrelation modes, wasted bits, fixed and LPC
+ * subframes and both Rice parameter widths including escaped partitions.
+ * Header CRC-8, frame CRC-16 and the STREAMINFO MD5 are all verified.
+ */
+class FlacDecoder {
+public:
+    /**
+     * @brief [AI GENERATED] Decode a file.
+     *
+     * @return True if the stream decoded and every checksum matched; see error() otherwise.
+     */
+    bool decode(const std::string& file);
+
+    /**
+     * @brief [AI GENERATED] Decode a stream held in memory.
+     */
+    bool decode(const uint8_t* data, size_t size);
+
+    const FlacStreamInfo& info() const;
+    const FlacDecodeStats& stats() const;
+
+    /** @brief [AI GENERATED] Interleaved samples, sign extended to 32 bits. */
+    const std::vector<int32_t>& samples() const;
+
+    const std::string& error() const;
+
+private:
+    bool fail(const std::string& message);
+    bool decodeFrame(const uint8_t* data, size_t size, size_t& offset);
+
+    FlacStreamInfo info_;
+    FlacDecodeStats stats_;
+    std::vector<int32_t> samples_;
+    std::vector<int64_t> channels_[8];
+    std::string error_;
+};
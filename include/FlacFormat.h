@@ -0,0 +1,59 @@
+/**
+ * @file FlacFormat.h
+ * @brief [AI GENERATED] FLAC stream structures shared by the encoder and decoder.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Sample rates addressed by frame header codes 1-11; code 0 defers to STREAMINFO.
+ */
+constexpr int kFlacSampleRates[12] = {0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000};
+
+/**
+ * @brief [AI GENERATED] Sample sizes addressed by frame header codes 0-7; 0 defers to STREAMINFO, 3 is reserved.
+ */
+constexpr int kFlacSampleSizes[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+
+/**
+ * @brief [AI GENERATED] Contents of the mandatory STREAMINFO metadata block.
+ */
+struct FlacStreamInfo {
+    uint32_t minBlockSize = 0;
+    uint32_t maxBlockSize = 0;
+    uint32_t minFrameSize = 0;     /**< Bytes, 0 if unknown. */
+    uint32_t maxFrameSize = 0;     /**< Bytes, 0 if unknown. */
+    uint32_t sampleRate = 0;
+    uint32_t channels = 0;
+    uint32_t bitsPerSample = 0;
+    uint64_t totalFrames = 0;      /**< Samples per channel, 0 if unknown. */
+    uint8_t md5[16] = {};          /**< MD5 of the decoded samples, all zero if unknown. */
+
+    /** @brief [AI GENERATED] Size of the STREAMINFO block body in bytes. */
+    static constexpr size_t kSize = 34;
+
+    /**
+     * @brief [AI GENERATED] Serialize the 34 byte block body (without the metadata block header).
+     */
+    std::vector<uint8_t> serialize() const;
+
+    /**
+     * @brief [AI GENERATED] Parse a 34 byte block body.
+     */
+    static FlacStreamInfo parse(const uint8_t* body);
+};
+
+/**
+ * @brief [AI GENERATED] CRC checks protecting FLAC frame headers and frames.
+ */
+class FlacCrc {
+public:
+    /** @brief [AI GENERATED] CRC-8 (polynomial 0x07) over a frame header. */
+    static uint8_t crc8(const uint8_t* data, size_t size);
+
+    /** @brief [AI GENERATED] CRC-16 (polynomial 0x8005) over a whole frame. */
+    static uint16_t crc16(const uint8_t* data, size_t size);
+};
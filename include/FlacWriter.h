@@ -0,0 +1,113 @@
+/**
+ * @file FlacWriter.h
+ * @brief [AI GENERATED] Self-contained multithreaded FLAC encoder.
+ */
+
+#pragma once
+#include "AudioSink.h"
+#include "FlacFormat.h"
+#include "Md5.h"
+#include "PcmConverter.h"
+#include "WavFormat.h"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Encoder tuning. The defaults match `flac -5` closely.
+ */
+struct FlacSettings {
+    unsigned blockSize = 4096;        /**< Frames per FLAC frame (16-65535). */
+    int maxLpcOrder = 8;              /**< Highest LPC order tried; 0 limits to fixed predictors. */
+    int qlpPrecision = 0;             /**< LPC coefficient precision in bits (5-15), 0 picks by block size. */
+    int maxPartitionOrder = 6;        /**< Highest Rice partition order tried (0-8). */
+    bool stereoDecorrelation = true;  /**< Try left/side, right/side and mid/side for stereo. */
+    unsigned threads = 0;             /**< Encoder threads, 0 uses all hardware threads. */
+};
+
+class FlacFrameEncoder;
+
+/**
+ * @brief [AI GENERATED] Streams interleaved samples into a FLAC file.
+ *
+ * Incoming samples are quantized exactly as the WAV writer would and
+ * buffered until a batch of frames is available. Frames in a batch are
+ * encoded in parallel, one frame per task, and written in stream order.
+ * Each frame picks the cheapest of constant, verbatim, fixed-order (0-4)
+ * and quantized LPC prediction, with partitioned Rice coding of the
+ * residual. finalize() rewrites STREAMINFO with the sample count, frame
+ * size range and the MD5 signature of the decoded audio.
+ */
+class FlacWriter : public AudioSink {
+public:
+    FlacWriter();
+    ~FlacWriter() override;
+
+    FlacWriter(const FlacWriter&) = delete;
+    FlacWriter& operator=(const FlacWriter&) = delete;
+
+    /**
+     * @brief [AI GENERATED] Create the file and write the stream marker and STREAMINFO.
+     *
+     * @param file Destination path.
+     * @param format Sample rate, 1-8 channels and Pcm16 or Pcm24 samples.
+     * @param settings Encoder tuning.
+     * @param dither Apply TPDF dither before quantization.
+     * @return False for unsupported formats or if the file cannot be created.
+     */
+    bool open(const std::string& file, const WavFormat& format, const FlacSettings& settings = FlacSettings(),
+              bool dither = false);
+
+    /**
+     * @brief [AI GENERATED] Quantize and queue a block of interleaved frames.
+     *
+     * @param samples Interleaved samples, nominally in the range [-1, 1].
+     * @param frames Number of frames in the block.
+     * @return False if encoding or writing a completed batch failed.
+     */
+    bool append(const double* samples, size_t frames) override;
+
+    /**
+     * @brief [AI GENERATED] Append an interleaved block whose size is a multiple of the channel count.
+     */
+    bool append(const std::vector<double>& block);
+
+    /**
+     * @brief [AI GENERATED] Encode buffered samples, rewrite STREAMINFO and close the file.
+     */
+    bool finalize() override;
+
+    int channels() const override;
+    bool isOpen() const;
+    const WavFormat& format() const;
+    uint64_t framesWritten() const;
+
+    /** @brief [AI GENERATED] FLAC frames encoded per worker thread and batch. */
+    static constexpr size_t kBlocksPerThread = 4;
+
+private:
+    bool encodeBatch(size_t frames);
+    void updateMd5(const int32_t* samples, size_t count);
+    FlacStreamInfo streamInfo() const;
+
+    std::ofstream out_;
+    WavFormat format_;
+    FlacSettings settings_;
+    unsigned threads_ = 1;
+    std::vector<std::unique_ptr<FlacFrameEncoder>> encoders_;
+    std::vector<std::vector<uint8_t>> encoded_;
+    std::vector<int32_t> pending_;
+    size_t pendingFrames_ = 0;
+    std::vector<double> noise_;
+    TpdfDither ditherSource_;
+    bool dither_ = false;
+    Md5 md5_;
+    std::vector<uint8_t> md5Bytes_;
+    uint64_t framesWritten_ = 0;
+    uint64_t frameNumber_ = 0;
+    uint32_t minFrameBytes_ = 0;
+    uint32_t maxFrameBytes_ = 0;
+    bool failed_ = false;
+};
@@ -0,0 +1,89 @@
+/**
+ * @file KeyEventHistory.h
+ * @brief [AI GENERATED] Fixed-capacity key event ring with lock-free time-window snapshots.
+ */
+
+#pragma once
+#include "MidiInput.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Circular history of the most recent key events.
+ *
+ * One writer thread appends; once full, each append overwrites the oldest
+ * event in constant time. Any number of reader threads can snapshot a time
+ * window concurrently without blocking the writer: every slot carries a
+ * sequence number (a per-slot seqlock), the event itself is stored in
+ * atomic words, and a reader discards any slot that the writer touched
+ * while it was being copied. Timestamps are kept non-decreasing in append
+ * order, which lets snapshot() binary-search for the start of the window.
+ */
+class KeyEventHistory {
+public:
+    /**
+     * @brief [AI GENERATED] Allocate room for capacity events (at least one).
+     */
+    explicit KeyEventHistory(size_t capacity);
+
+    KeyEventHistory(const KeyEventHistory&) = delete;
+    KeyEventHistory& operator=(const KeyEventHistory&) = delete;
+
+    /**
+     * @brief [AI GENERATED] Add an event, overwriting the oldest if full. Writer thread only.
+     *
+     * An event stamped earlier than its predecessor (e.g. interleaved from
+     * two devices) is stored with the predecessor's timestamp.
+     */
+    void append(const KeyEvent& event);
+
+    /**
+     * @brief [AI GENERATED] Copy the events with from <= timestamp <= to, oldest first.
+     *
+     * Safe to call from any thread while the writer appends. Events
+     * overwritten during the copy are left out, so under heavy load the
+     * oldest part of a window that is about to fall off the ring may be
+     * missing.
+     *
+     * @param out Receives the events; cleared first, its capacity is reused.
+     * @return Number of events copied.
+     */
+    size_t snapshot(double from, double to, std::vector<KeyEvent>& out) const;
+
+    /**
+     * @brief [AI GENERATED] Events with timestamp >= from, oldest first.
+     */
+    std::vector<KeyEvent> since(double from) const;
+
+    /**
+     * @brief [AI GENERATED] Hide everything appended so far. Safe from any thread.
+     */
+    void clear();
+
+    /**
+     * @brief [AI GENERATED] Events currently retained.
+     */
+    size_t size() const;
+
+    size_t capacity() const;
+
+private:
+    static constexpr size_t kWords = (sizeof(KeyEvent) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};       /**< 2 * position + 2 once written, odd while writing. */
+        std::atomic<uint64_t> words[kWords];     /**< The event, copied word by word. */
+    };
+
+    bool read(uint64_t position, KeyEvent& out) const;
+    uint64_t oldestPosition(uint64_t end) const;
+
+    const size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> head_{0};    /**< Events ever appended; the next position to write. */
+    std::atomic<uint64_t> floor_{0};   /**< Positions below this were cleared. */
+    double lastTimestamp_;             /**< Writer's most recent timestamp. */
+};
@@ -0,0 +1,88 @@
+/**
+ * @file LatencyHistogram.h
+ * @brief [AI GENERATED] Lock-free log-linear histogram for latency percentiles.
+ */
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief [AI GENERATED] Percentile summary of recorded latencies, in milliseconds.
+ */
+struct LatencySummary {
+    uint64_t count = 0;   /**< Values recorded. */
+    double mean = 0.0;    /**< Arithmetic mean. */
+    double p50 = 0.0;     /**< Median. */
+    double p99 = 0.0;     /**< 99th percentile. */
+    double p999 = 0.0;    /**< 99.9th percentile. */
+    double max = 0.0;     /**< Largest value, exact. */
+};
+
+/**
+ * @brief [AI GENERATED] HDR-style histogram of nanosecond durations.
+ *
+ * Values below 2 * kSubBuckets are counted exactly; above that each power
+ * of two is split into kSubBuckets linear buckets, so a percentile is within
+ * 1/kSubBuckets (0.8%) of the true value from nanoseconds up to about three
+ * days, in a fixed 43 KiB table. record() is a handful of relaxed atomic
+ * increments and never blocks; readers may query while values are being
+ * recorded and see a consistent-enough snapshot for monitoring.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    /**
+     * @brief [AI GENERATED] Add one duration. Values beyond the range land in the last bucket.
+     */
+    void record(uint64_t nanoseconds);
+
+    /**
+     * @brief [AI GENERATED] Smallest value v such that at least percent% of recorded values are <= v.
+     *
+     * Reports the upper edge of the bucket holding that rank, capped at max().
+     *
+     * @param percent Percentile in [0, 100].
+     * @return Nanoseconds; 0 if nothing was recorded.
+     */
+    uint64_t percentile(double percent) const;
+
+    uint64_t count() const;
+    uint64_t max() const;
+    double mean() const;
+
+    /**
+     * @brief [AI GENERATED] count, mean, p50, p99, p99.9 and max converted to milliseconds.
+     */
+    LatencySummary summary() const;
+
+    /**
+     * @brief [AI GENERATED] Forget all values. Not atomic with respect to concurrent record().
+     */
+    void reset();
+
+    /** @brief [AI GENERATED] Linear buckets per power of two. */
+    static constexpr uint64_t kSubBucketBits = 7;
+    static constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;
+
+    /** @brief [AI GENERATED] Largest value tracked without clamping (2^48 - 1 ns). */
+    static constexpr uint64_t kMaxValue = (uint64_t(1) << 48) - 1;
+
+private:
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(size_t index);
+
+    // Exact buckets [0, 2 * kSubBuckets), then kSubBuckets per power of two up to 2^48
+    static constexpr size_t kBucketCount = (48 - kSubBucketBits + 1) * kSubBuckets;
+
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_;
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
@@ -0,0 +1,160 @@
+/**
+ * @file LoopbackMidiInterface.h
+ * @brief [AI GENERATED] In-process virtual MIDI backend for load testing without hardware.
+ */
+
+#pragma once
+#include "MidiDevice.h"
+#include "MidiStreamParser.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Delay applied between sending a message and its arrival on the input side.
+ */
+struct LoopbackTiming {
+    double latency = 0.0;    /**< Fixed delay in seconds. */
+    double jitter = 0.0;     /**< Extra delay drawn uniformly from [0, jitter] seconds. */
+    uint32_t seed = 1;       /**< Jitter random seed, for reproducible runs. */
+};
+
+/**
+ * @brief [AI GENERATED] Synthetic input generated by the loopback device.
+ *
+ * Messages come in bursts of burstSize sent back to back, with bursts
+ * spaced so that the average rate is messagesPerSecond. They alternate
+ * note on and note off over the piano range on channel 1.
+ */
+struct LoopbackLoad {
+    double messagesPerSecond = 100000.0;
+    size_t burstSize = 1;
+    uint64_t totalMessages = 0;   /**< Stop after this many; 0 runs until stopLoad(). */
+};
+
+/**
+ * @brief [AI GENERATED] Virtual device whose output is wired back to its input.
+ *
+ * It exposes one device, kDeviceId, that can be opened for input and
+ * output. Messages sent to it arrive on the input callback after
+ * LoopbackTiming's latency and jitter, in send order, stamped with their
+ * send time so MidiDevice's latency statistics include the simulated
+ * delay. Raw bytes go through MidiStreamParser, so SysEx loops back whole
+ * on the SysEx callback. A load generator can add input at a set rate and
+ * burst size.
+ *
+ * All input is delivered from one internal thread, like a hardware
+ * backend's reader thread, which is what MidiDevice's queue expects.
+ * Input arriving while the device is not open for input is discarded and
+ * counted. Inject into a MidiDevice with initialize(std::unique_ptr).
+ */
+class LoopbackMidiInterface : public MidiDeviceInterface {
+public:
+    static constexpr int kDeviceId = 0;
+
+    explicit LoopbackMidiInterface(const LoopbackTiming& timing = LoopbackTiming());
+    ~LoopbackMidiInterface() override;
+
+    LoopbackMidiInterface(const LoopbackMidiInterface&) = delete;
+    LoopbackMidiInterface& operator=(const LoopbackMidiInterface&) = delete;
+
+    // Device enumeration
+    std::vector<MidiDeviceInfo> getAvailableDevices() override;
+    MidiDeviceInfo getDeviceInfo(int deviceId) override;
+    bool isDeviceConnected(int deviceId) override;
+
+    // Device connection
+    MidiError openInputDevice(int deviceId) override;
+    MidiError openOutputDevice(int deviceId) override;
+    MidiError closeDevice(int deviceId) override;
+    void closeAllDevices() override;
+
+    // Real-time MIDI I/O
+    void setInputCallback(MidiInputCallback callback) override;
+    void setSysExCallback(MidiSysExCallback callback) override;
+    MidiError sendMessage(int deviceId, const RealTimeMidiMessage& message) override;
+    MidiError sendMessages(int deviceId, const RealTimeMidiMessage* messages, size_t count) override;
+    MidiError sendRawMessage(int deviceId, const uint8_t* data, size_t length) override;
+
+    // Device monitoring; the loopback device never appears or disappears
+    void setDeviceConnectionCallback(DeviceConnectionCallback callback) override;
+    void startDeviceMonitoring() override {}
+    void stopDeviceMonitoring() override {}
+
+    // Utility functions
+    std::string getErrorString(MidiError error) override;
+    MidiMessageType getMessageType(uint8_t status) override;
+    bool isValidMidiMessage(const RealTimeMidiMessage& message) override;
+
+    /**
+     * @brief [AI GENERATED] Change latency and jitter for messages sent from now on.
+     */
+    void setTiming(const LoopbackTiming& timing);
+
+    /**
+     * @brief [AI GENERATED] Start generating input; replaces a running load.
+     *
+     * @return False if the rate or burst size is not positive.
+     */
+    bool startLoad(const LoopbackLoad& load);
+    void stopLoad();
+
+    /**
+     * @brief [AI GENERATED] Block until the load has finished and every pending message was delivered.
+     *
+     * @return False on timeout, or at once if an endless load is running.
+     */
+    bool waitUntilIdle(std::chrono::milliseconds timeout);
+
+    uint64_t getMessagesGenerated() const { return generated_; }
+    uint64_t getMessagesDelivered() const { return delivered_; }
+    uint64_t getMessagesDiscarded() const { return discarded_; }
+
+private:
+    struct Pending {
+        RealTimeMidiMessage message;
+        double deliverAt;
+        std::vector<uint8_t> sysEx;   /**< Non-empty for a looped-back SysEx message. */
+    };
+
+    void enqueueLocked(const RealTimeMidiMessage& message, std::vector<uint8_t> sysEx, double sentAt);
+    void generateDueLocked(double now);
+    bool idleLocked() const;
+    void deliveryThreadFunction();
+
+    MidiInputCallback inputCallback_;
+    MidiSysExCallback sysExCallback_;
+    DeviceConnectionCallback connectionCallback_;
+    std::atomic<bool> inputOpen_{false};
+    std::atomic<bool> outputOpen_{false};
+
+    // Delay line and generator state, shared with the delivery thread
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<Pending> pending_;        /**< Ordered by deliverAt. */
+    LoopbackTiming timing_;
+    std::mt19937 random_;
+    double lastDeliverAt_ = 0.0;
+    bool delivering_ = false;
+    bool running_ = true;
+
+    LoopbackLoad load_;
+    bool loadActive_ = false;
+    double nextBurstAt_ = 0.0;
+    uint64_t loadGenerated_ = 0;
+
+    MidiStreamParser rawParser_;         /**< Splits sendRawMessage() bytes; used under mutex_. */
+    std::vector<uint8_t> sysExAssembly_;
+
+    std::atomic<uint64_t> generated_{0};
+    std::atomic<uint64_t> delivered_{0};
+    std::atomic<uint64_t> discarded_{0};
+
+    std::thread deliveryThread_;
+};
@@ -0,0 +1,41 @@
+/**
+ * @file Md5.h
+ * @brief [AI GENERATED] Incremental MD5 digest used for FLAC stream signatures.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief [AI GENERATED] RFC 1321 MD5 over a stream of bytes fed in arbitrary pieces.
+ *
+ * FLAC stores the MD5 of the unencoded interleaved samples in STREAMINFO so
+ * decoders can verify a lossless round trip.
+ */
+class Md5 {
+public:
+    Md5();
+
+    /**
+     * @brief [AI GENERATED] Add bytes to the digest.
+     */
+    void update(const void* data, size_t size);
+
+    /**
+     * @brief [AI GENERATED] Finish the digest. The object must be reset before reuse.
+     *
+     * @param digest Destination for the 16 byte digest.
+     */
+    void finish(uint8_t digest[16]);
+
+    void reset();
+
+private:
+    void transform(const uint8_t block[64]);
+
+    uint32_t state_[4];
+    uint64_t length_;
+    uint8_t buffer_[64];
+    size_t buffered_;
+};
@@ -0,0 +1,119 @@
+/**
+ * @file MidiClock.h
+ * @brief [AI GENERATED] Follows an external MIDI clock (0xF8) and transport with a phase-locked loop.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief [AI GENERATED] Tempo and position of the external clock at one instant.
+ */
+struct MidiClockSnapshot {
+    bool running = false;     /**< From the first clock after Start or Continue until Stop. */
+    bool locked = false;      /**< The loop has tracked a full beat without losing the clock. */
+    double bpm = 0.0;         /**< Quarter notes per minute; 0 until two clocks have arrived. */
+    double beat = 0.0;        /**< Quarter notes since Start at the last clock; while stopped, where the next clock plays. */
+    double time = 0.0;        /**< When the last clock fell, on MidiDevice::timestampNow()'s clock, smoothed by the loop. */
+    double jitter = 0.0;      /**< Average distance of clock arrivals from the loop's prediction, seconds. */
+    uint64_t clocks = 0;      /**< Clocks received since the last reset, running or not. */
+    uint64_t sequence = 0;    /**< Changes with every clock or transport message. */
+
+    /**
+     * @brief [AI GENERATED] Beat position at a time, extrapolated from the last clock while running.
+     */
+    double beatAt(double when) const {
+        return running && bpm > 0.0 ? beat + (when - time) * bpm / 60.0 : beat;
+    }
+
+    /**
+     * @brief [AI GENERATED] When a beat position falls at the current tempo, e.g. for MidiScheduler timestamps.
+     *
+     * @return time while the tempo is unknown.
+     */
+    double timeOfBeat(double position) const {
+        return bpm > 0.0 ? time + (position - beat) * 60.0 / bpm : time;
+    }
+};
+
+/**
+ * @brief [AI GENERATED] Tempo and beat phase estimation from MIDI clock and transport messages.
+ *
+ * Clock arrives 24 times per quarter note, each tick delayed by USB and
+ * driver scheduling by up to a millisecond or so. Rather than deriving the
+ * tempo from the last interval, a second-order phase-locked loop predicts
+ * each tick from the previous estimate and corrects phase and period by a
+ * fraction of the error, which averages the arrival jitter out of both.
+ * The loop starts with wide gains to settle within a beat, then narrows
+ * them; a tick more than half a period off the prediction is taken as a
+ * tempo jump and restarts acquisition, and a gap of several periods as a
+ * dropped clock.
+ *
+ * Position follows the MIDI transport: Start sets it to 0 so the next
+ * clock is beat 0, Continue resumes from where Stop left it, Song Position
+ * Pointer (0xF2) moves it in sixteenths, and it advances one tick per clock
+ * only while running. Tempo is tracked from clocks whether running or not.
+ *
+ * process() is meant for one input thread and takes no locks; a message
+ * arriving while another thread is inside process() or reset() is ignored.
+ * snapshot() is lock-free and may be called from any thread, e.g. once per
+ * audio block.
+ */
+class MidiClock {
+public:
+    static constexpr int kClocksPerBeat = 24;
+    static constexpr int kClocksPerSixteenth = 6;
+
+    MidiClock();
+
+    /**
+     * @brief [AI GENERATED] True for clock, Start, Continue, Stop and Song Position Pointer.
+     */
+    static constexpr bool handles(uint8_t status) {
+        return status == 0xF8 || status == 0xFA || status == 0xFB || status == 0xFC || status == 0xF2;
+    }
+
+    /**
+     * @brief [AI GENERATED] Feed one message; timestamp in timestampNow() seconds.
+     *
+     * @return False if the status is not one handles() accepts, or another
+     *         thread was updating the clock.
+     */
+    bool process(uint8_t status, uint8_t data1, uint8_t data2, double timestamp);
+
+    MidiClockSnapshot snapshot() const;
+
+    /**
+     * @brief [AI GENERATED] Forget tempo and position, as if no clock had been received.
+     */
+    void reset();
+
+private:
+    bool claim();
+    void publish();
+    void clock(double timestamp);
+
+    // Loop state; only the thread that claimed sequence_ touches it
+    double phase_;          /**< Smoothed time of the last tick. */
+    double period_;         /**< Seconds per tick; 0 until known. */
+    double lastArrival_;    /**< Raw time of the last tick. */
+    double jitter_;
+    unsigned tracked_;      /**< Ticks since acquisition started. */
+    bool haveClock_;
+    bool running_;
+    uint64_t position_;     /**< Tick index the last clock had while running. */
+    uint64_t nextPosition_; /**< Tick index the next clock will have. */
+    uint64_t clocks_;
+    bool awaitingClock_;    /**< Start or Continue seen, first clock after it not yet. */
+
+    // Published snapshot, a seqlock: sequence_ is odd while it is written
+    std::atomic<uint64_t> sequence_;
+    std::atomic<bool> snapshotRunning_;
+    std::atomic<bool> snapshotLocked_;
+    std::atomic<double> snapshotBpm_;
+    std::atomic<double> snapshotBeat_;
+    std::atomic<double> snapshotTime_;
+    std::atomic<double> snapshotJitter_;
+    std::atomic<uint64_t> snapshotClocks_;
+};
@@ -4,7 +4,14 @@
  */
 
 #pragma once
+#include "KeyEventHistory.h"
+#include "LatencyHistogram.h"
+#include "MidiClock.h"
 #include "MidiInput.h"
+#include "RealtimeThread.h"
+#include "SpscRing.h"
+#include "VelocityCurve.h"
+#include <array>
 #include <vector>
 #include <string>
 #include <functional>
@@ -12,7 +19,6 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
-#include <queue>
 
 /**
  * @brief [AI GENERATED] MIDI device information structure.
@@ -34,11 +40,24 @@ struct RealTimeMidiMessage {
     uint8_t status;           /**< MIDI status byte. */
     uint8_t data1;            /**< First data byte. */
     uint8_t data2;            /**< Second data byte. */
-    double timestamp;         /**< Message timestamp in seconds. */
+    double timestamp;         /**< Arrival or send time in seconds on MidiDevice::timestampNow()'s clock. */
     int channel;              /**< MIDI channel (1-16). */
     int deviceId;             /**< Source device ID. */
 };
 
+/**
+ * @brief [AI GENERATED] A System Exclusive message, or one fragment of a long one.
+ *
+ * data points into the receiver's buffer and is only valid during the callback.
+ */
+struct MidiSysExMessage {
+    const uint8_t* data;      /**< Bytes; the first fragment starts with 0xF0, the last ends with 0xF7. */
+    size_t length;            /**< Bytes in data. */
+    bool complete;            /**< False if more fragments of the same message follow. */
+    double timestamp;         /**< Arrival time of the fragment's last byte. */
+    int deviceId;             /**< Source device ID. */
+};
+
 /**
  * @brief [AI GENERATED] MIDI message types for easier handling.
  */
@@ -71,11 +90,59 @@ enum class MidiError {
     NotSupported
 };
 
+/**
+ * @brief [AI GENERATED] One failed operation from MidiDevice's error log.
+ */
+struct MidiErrorRecord {
+    MidiError error = MidiError::None;
+    int deviceId = -1;
+    uint8_t status = 0;        /**< Status of the message being sent; 0 for other operations. */
+    double timestamp = 0.0;    /**< MidiDevice::timestampNow() clock; the send time for failed sends. */
+    uint64_t sequence = 0;     /**< Errors recorded before this one plus 1; never reset. */
+};
+
 /**
  * @brief [AI GENERATED] Callback function type for MIDI input events.
  */
 using MidiInputCallback = std::function<void(const RealTimeMidiMessage& message)>;
 
+/**
+ * @brief [AI GENERATED] Callback function type for incoming SysEx, called on the backend's input thread.
+ */
+using MidiSysExCallback = std::function<void(const MidiSysExMessage& message)>;
+
+/**
+ * @brief [AI GENERATED] Receiver of dispatched MIDI input, called on the processing thread.
+ *
+ * Unlike MidiInputCallback the device stores only a pointer, so the
+ * caller owns the listener and keeps it alive while it is subscribed.
+ * Dispatch is one virtual call per listener, with the message passed by
+ * reference and no allocation.
+ */
+class MidiInputListener {
+public:
+    virtual ~MidiInputListener() = default;
+    virtual void onMidiMessage(const RealTimeMidiMessage& message) = 0;
+};
+
+/**
+ * @brief [AI GENERATED] MidiInputListener holding a callable by value, e.g. a lambda.
+ */
+template <typename Function>
+class MidiListenerFunction : public MidiInputListener {
+public:
+    explicit MidiListenerFunction(Function function) : function_(std::move(function)) {}
+    void onMidiMessage(const RealTimeMidiMessage& message) override { function_(message); }
+
+private:
+    Function function_;
+};
+
+template <typename Function>
+MidiListenerFunction<Function> makeMidiListener(Function function) {
+    return MidiListenerFunction<Function>(std::move(function));
+}
+
 /**
  * @brief [AI GENERATED] Callback function type for device connection events.
  */
@@ -101,8 +168,49 @@ public:
     
     // Real-time MIDI I/O
     virtual void setInputCallback(MidiInputCallback callback) = 0;
+
+    /**
+     * @brief [AI GENERATED] Receive SysEx from open input devices. Backends without SysEx input ignore it.
+     */
+    virtual void setSysExCallback(MidiSysExCallback callback) { (void)callback; }
     virtual MidiError sendMessage(int deviceId, const RealTimeMidiMessage& message) = 0;
     virtual MidiError sendRawMessage(int deviceId, const uint8_t* data, size_t length) = 0;
+
+    /**
+     * @brief [AI GENERATED] Send several messages to one device as one burst.
+     *
+     * The default sends them one at a time and stops at the first error.
+     * Backends that can queue events override it to flush once per burst.
+     */
+    virtual MidiError sendMessages(int deviceId, const RealTimeMidiMessage* messages, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            MidiError error = sendMessage(deviceId, messages[i]);
+            if (error != MidiError::None) return error;
+        }
+        return MidiError::None;
+    }
+
+    /**
+     * @brief [AI GENERATED] Have the backend send messages at their timestamps (timestampNow() seconds).
+     *
+     * For backends with a driver or kernel queue, whose timing does not
+     * depend on our threads being scheduled. Messages already due go out
+     * at once. The default returns NotSupported, and MidiScheduler then
+     * times the messages itself.
+     */
+    virtual MidiError scheduleMessages(int deviceId, const RealTimeMidiMessage* messages, size_t count) {
+        (void)deviceId; (void)messages; (void)count;
+        return MidiError::NotSupported;
+    }
+    virtual bool canScheduleMessages() { return false; }
+
+    /**
+     * @brief [AI GENERATED] Drop scheduled messages not yet sent to deviceId, or to every device for -1.
+     */
+    virtual MidiError cancelScheduledMessages(int deviceId) {
+        (void)deviceId;
+        return MidiError::NotSupported;
+    }
     
     // Device monitoring
     virtual void setDeviceConnectionCallback(DeviceConnectionCallback callback) = 0;
@@ -115,25 +223,74 @@ public:
     virtual bool isValidMidiMessage(const RealTimeMidiMessage& message) = 0;
 };
 
+/**
+ * @brief [AI GENERATED] Input counters for one source device, see MidiDevice::getDeviceInputStats().
+ */
+struct MidiInputStats {
+    int deviceId = -1;                 /**< -1 if the device has no input lane. */
+    uint64_t messagesReceived = 0;     /**< Everything the device sent, filtered messages included. */
+    uint64_t messagesDispatched = 0;   /**< Passed to the input callback. */
+    uint64_t droppedMessages = 0;      /**< Lost to a full queue, or because every lane was taken. */
+    size_t queued = 0;                 /**< Waiting for dispatch. */
+    LatencySummary latency;            /**< Arrival to input callback, in milliseconds. */
+};
+
+class DeviceRegistry;
+class MidiRouter;
+
 /**
  * @brief [AI GENERATED] Cross-platform MIDI device manager.
  */
 class MidiDevice {
 private:
     std::unique_ptr<MidiDeviceInterface> interface_;
-    std::vector<MidiDeviceInfo> connectedDevices_;
+    std::unique_ptr<DeviceRegistry> deviceRegistry_;   /**< Last scan plus hotplug updates; serves lookups. */
     MidiInputCallback inputCallback_;
+    MidiSysExCallback sysExCallback_;
     DeviceConnectionCallback connectionCallback_;
     
-    // Real-time processing
+    /**
+     * @brief [AI GENERATED] One source device's input queue and statistics.
+     *
+     * The input thread claims a free lane the first time a device sends. A
+     * lane whose device was disconnected is handed to a new device once
+     * everything it queued has been dispatched.
+     */
+    struct InputLane {
+        explicit InputLane(size_t capacity) : queue(capacity) {}
+        std::atomic<int> deviceId{-1};
+        std::atomic<bool> retired{false};
+        SpscRing<RealTimeMidiMessage> queue;
+        std::atomic<uint64_t> received{0};
+        // Unlike the statistics these are never reset; equal means nothing is in flight
+        std::atomic<uint64_t> queued{0};       /**< Pushes; written by the input thread. */
+        std::atomic<uint64_t> dispatched{0};   /**< Written by the processing thread. */
+        std::atomic<uint64_t> dropped{0};
+        LatencyHistogram latency;
+    };
+    
+    // Real-time processing: each device's input thread pushes to its lane,
+    // processingThread_ merges the lanes by timestamp
     std::atomic<bool> isProcessing_;
     std::thread processingThread_;
-    std::mutex messageQueueMutex_;
-    std::queue<RealTimeMidiMessage> messageQueue_;
+    std::vector<std::unique_ptr<InputLane>> inputLanes_;   /**< kMaxInputDevices lanes, fixed at construction. */
+    WakeSignal messageSignal_;
+    
+    // Subscriber tables: one for all channel messages, then one per channel
+    // message type (status 0x80-0xE0); changed only while processing is stopped
+    static constexpr size_t kChannelMessageTypes = 7;
+    static constexpr size_t kMaxListenersPerTable = 8;
+    struct ListenerTable {
+        std::array<MidiInputListener*, kMaxListenersPerTable> listeners{};
+        size_t count = 0;
+    };
+    std::array<ListenerTable, kChannelMessageTypes + 1> listenerTables_;
+    std::array<std::atomic<uint16_t>, kChannelMessageTypes> inputFilter_;   /**< Channels queued, per type. */
     
-    // M-Audio Oxygen Pro 61 specific
-    int oxygenProDeviceId_;
-    bool oxygenProConnected_;
+    // M-Audio Oxygen Pro 61 specific; hotplug callbacks update these from the backend's thread
+    std::atomic<int> oxygenProDeviceId_;
+    std::atomic<bool> oxygenProConnected_;
+    std::atomic<bool> oxygenProAwaitingReplug_;   /**< Unplugged while connected; reconnect when it returns. */
     
     // Statistics
     std::atomic<uint64_t> messagesReceived_;
@@ -152,11 +309,33 @@ public:
     
     // Initialization
     bool initialize();
+
+    /**
+     * @brief [AI GENERATED] Initialize on a caller-supplied backend instead of the platform one.
+     *
+     * Input callbacks for one device must come from one thread at a time,
+     * since each device feeds its own single-producer ring; different
+     * devices may use different threads.
+     */
+    bool initialize(std::unique_ptr<MidiDeviceInterface> backend);
     void shutdown();
     bool isInitialized() const;
     
     // Device management
+
+    /**
+     * @brief [AI GENERATED] Enumerate devices and refresh the cache used by the find functions.
+     *
+     * Backends with hotplug monitoring keep the cache current themselves,
+     * so this is only needed once, or for backends without monitoring.
+     */
     std::vector<MidiDeviceInfo> scanForDevices();
+
+    /**
+     * @brief [AI GENERATED] Cached lookup: exact name (ignoring case, spaces and punctuation), then substring.
+     *
+     * Scans only if nothing has been scanned yet.
+     */
     MidiDeviceInfo findDevice(const std::string& namePattern);
     MidiDeviceInfo findMAudioOxygenPro();
     bool connectToDevice(int deviceId);
@@ -172,10 +351,79 @@ public:
     
     // Real-time MIDI processing
     void setMidiInputCallback(MidiInputCallback callback);
+
+    /**
+     * @brief [AI GENERATED] Subscribe to every dispatched message, after the input callback.
+     *
+     * @return False while real-time processing is running, if listener is
+     *         null or already subscribed to all messages, or if 8
+     *         listeners are subscribed already.
+     */
+    bool addMidiListener(MidiInputListener* listener);
+
+    /**
+     * @brief [AI GENERATED] Subscribe to one channel message type, e.g. MidiMessageType::NoteOn.
+     *
+     * Typed listeners run after those subscribed to all messages. Channel
+     * messages are the only ones dispatched, so other types are rejected.
+     *
+     * @return False in the cases listed for addMidiListener(listener), for
+     *         this type's table, or if type is not a channel message type.
+     */
+    bool addMidiListener(MidiMessageType type, MidiInputListener* listener);
+
+    /**
+     * @brief [AI GENERATED] Remove listener from every table; false while processing or if not subscribed.
+     */
+    bool removeMidiListener(MidiInputListener* listener);
+
+    /**
+     * @brief [AI GENERATED] Queue messages of a channel message type only on the given channels.
+     *
+     * Bit n-1 of channelMask stands for channel n. Filtered messages are
+     * discarded on the input thread before they are queued; they count as
+     * received, but not as dropped. May be changed while processing.
+     *
+     * @return False if type is not a channel message type.
+     */
+    bool setInputFilter(MidiMessageType type, uint16_t channelMask);
+
+    /**
+     * @brief [AI GENERATED] Queue only the type and channel pairs some route of router wants.
+     */
+    void setInputFilter(const MidiRouter& router);
+    void clearInputFilter();
+    uint16_t getInputFilter(MidiMessageType type) const;
     void setDeviceConnectionCallback(DeviceConnectionCallback callback);
+
+    /**
+     * @brief [AI GENERATED] Receive SysEx (e.g. Oxygen Pro replies), bypassing the real-time queue.
+     *
+     * Set it before connecting devices: it is called directly on the
+     * backend's input thread.
+     */
+    void setSysExCallback(MidiSysExCallback callback);
     void startRealTimeProcessing();
     void stopRealTimeProcessing();
     bool isProcessingRealTime() const;
+
+    /**
+     * @brief [AI GENERATED] Scheduling, CPU mask and memory setup for the processing thread.
+     *
+     * Applied by every startRealTimeProcessing(). A setting the process lacks
+     * the privilege for is skipped: processing still starts, getLastError()
+     * is SystemError and getRealtimeStatus() says what was missing.
+     *
+     * @return False while real-time processing is running, or if the
+     *         priority or a CPU number is out of range.
+     */
+    bool setRealtimeConfig(const RealtimeConfig& config);
+    RealtimeConfig getRealtimeConfig() const;
+
+    /**
+     * @brief [AI GENERATED] What the last startRealTimeProcessing() applied.
+     */
+    RealtimeStatus getRealtimeStatus() const;
     
     // MIDI I/O
     MidiError sendNoteOn(int deviceId, int channel, int note, int velocity);
@@ -183,15 +431,66 @@ public:
     MidiError sendControlChange(int deviceId, int channel, int controller, int value);
     MidiError sendProgramChange(int deviceId, int channel, int program);
     MidiError sendPitchBend(int deviceId, int channel, int value);
+
+    /**
+     * @brief [AI GENERATED] Send a burst (a chord, a controller setup) with one flush to the driver.
+     *
+     * All messages are validated before any is sent.
+     */
+    MidiError sendMessages(int deviceId, const RealTimeMidiMessage* messages, size_t count);
+    MidiError sendMessages(int deviceId, const std::vector<RealTimeMidiMessage>& messages);
+
+    /**
+     * @brief [AI GENERATED] Queue messages in the backend to go out at their timestamps.
+     *
+     * See MidiDeviceInterface::scheduleMessages(); NotSupported when the
+     * backend has no queue. MidiScheduler uses this, with a fallback, to
+     * play long sequences.
+     */
+    MidiError scheduleMessages(int deviceId, const RealTimeMidiMessage* messages, size_t count);
+    MidiError cancelScheduledMessages(int deviceId);
+    bool canScheduleMessages();
     
     // Convenience functions for piano synthesis
     MidiError sendKeyEvent(int deviceId, const KeyEvent& keyEvent);
     std::vector<KeyEvent> getRecentKeyEvents(double timeWindow = 1.0);
+
+    /**
+     * @brief [AI GENERATED] Key events with from <= timestamp <= to (timestampNow() seconds), oldest first.
+     *
+     * Never blocks the input path; see KeyEventHistory::snapshot().
+     */
+    std::vector<KeyEvent> getKeyEventsBetween(double from, double to);
     void clearKeyEventHistory();
+
+    /**
+     * @brief [AI GENERATED] Resize the key event history, discarding its contents.
+     *
+     * @return False while real-time processing is running.
+     */
+    bool setKeyEventHistoryCapacity(size_t capacity);
+    size_t getKeyEventHistoryCapacity() const;
     
     // Utility functions
+
+    /**
+     * @brief [AI GENERATED] Current time in seconds on the steady clock used for all message timestamps.
+     *
+     * The clock is monotonic and unaffected by wall-clock changes; its epoch
+     * is unspecified, so only differences are meaningful.
+     */
+    static double timestampNow();
+
+    /**
+     * @brief [AI GENERATED] Decode one complete channel message; use MidiStreamParser for byte streams.
+     */
     static RealTimeMidiMessage parseRawMidiMessage(const uint8_t* data, size_t length, double timestamp, int deviceId);
     static std::vector<uint8_t> serializeMidiMessage(const RealTimeMidiMessage& message);
+
+    /**
+     * @brief [AI GENERATED] Note on for a key down, note off with velocity 64 for a key up, as sendKeyEvent() sends.
+     */
+    static RealTimeMidiMessage keyEventToMessage(const KeyEvent& keyEvent, int deviceId);
     static bool isNoteOnMessage(const RealTimeMidiMessage& message);
     static bool isNoteOffMessage(const RealTimeMidiMessage& message);
     static bool isDrumPadMessage(const RealTimeMidiMessage& message);
@@ -201,19 +500,112 @@ public:
     uint64_t getMessagesReceived() const;
     uint64_t getMessagesSent() const;
     uint64_t getDroppedMessages() const;
+
+    /**
+     * @brief [AI GENERATED] Counters for one source device; deviceId is -1 if it has no input lane.
+     *
+     * A disconnected device's counters remain until its lane is reused.
+     */
+    MidiInputStats getDeviceInputStats(int deviceId) const;
+
+    /**
+     * @brief [AI GENERATED] Counters for every device holding an input lane, ordered by id.
+     */
+    std::vector<MidiInputStats> getAllDeviceInputStats() const;
+
+    /**
+     * @brief [AI GENERATED] Mean time from message arrival to input callback, in milliseconds.
+     */
     double getInputLatency() const;
+
+    /**
+     * @brief [AI GENERATED] Percentiles of the arrival-to-callback latency, in milliseconds.
+     */
+    LatencySummary getInputLatencyStats() const;
+
     double getOutputLatency() const;
     void resetStatistics();
     
     // Configuration
+
+    /**
+     * @brief [AI GENERATED] Limit the number of undispatched input messages.
+     *
+     * Messages arriving while this many from the same device are queued are
+     * dropped and counted by getDroppedMessages(). Clamped to
+     * kMessageQueueCapacity.
+     */
     void setBufferSize(size_t bufferSize);
     void setLatencyTarget(double milliseconds);
+
+    /**
+     * @brief [AI GENERATED] Apply or bypass the velocity curve; the curve itself is kept.
+     */
     void enableVelocityCurve(bool enabled);
+
+    /**
+     * @brief [AI GENERATED] Reshape note-on velocities with a curve through evenly spaced points.
+     *
+     * See VelocityCurve::fromPoints(). The curve is compiled to a table and
+     * enabled; an empty curve disables it. Note-on velocities are mapped on
+     * the input thread before queueing, so callbacks, listeners and the key
+     * history all see the shaped value. Safe to call while playing: the new
+     * table is published atomically and the input path takes no lock.
+     */
     void setVelocityCurve(const std::vector<float>& curve);
+    void setVelocityCurve(VelocityCurve::Preset preset);
+    void setVelocityTable(const VelocityTable& table);
+
+    /**
+     * @brief [AI GENERATED] The table applied to note-on velocities; identity while disabled.
+     */
+    VelocityTable getVelocityTable() const;
+    
+    // External MIDI clock
+    /**
+     * @brief [AI GENERATED] Tempo and position of the followed MIDI clock; lock-free, from any thread.
+     *
+     * Clock, Start, Continue, Stop and Song Position Pointer are consumed on
+     * the input thread by a MidiClock and never reach the message queue.
+     */
+    MidiClockSnapshot getClockSnapshot() const;
+
+    /**
+     * @brief [AI GENERATED] Follow clock from one device only, and forget the current estimate.
+     *
+     * -1, the default, follows the first device that sends clock or
+     * transport, so two sequencers cannot both steer the estimate.
+     */
+    void setClockSource(int deviceId);
+
+    /**
+     * @brief [AI GENERATED] Device whose clock is followed; -1 until one has sent any.
+     */
+    int getClockSource() const;
+    void resetClock();
     
     // Error handling
+    static constexpr size_t kErrorLogCapacity = 64;
+
+    /**
+     * @brief [AI GENERATED] Text for the last error, looked up from its code when called.
+     *
+     * Failures are recorded lock-free and without allocating, as a code and
+     * a MidiErrorRecord, so a failing send costs about as much as a
+     * successful one; only this query builds a string.
+     */
     std::string getLastErrorString() const;
     MidiError getLastError() const;
+
+    /**
+     * @brief [AI GENERATED] Up to maxRecords of the latest errors, oldest first.
+     *
+     * The log keeps the last kErrorLogCapacity errors and is not emptied by
+     * clearErrors(). A record overwritten while being copied is left out,
+     * so sequence numbers can have gaps under a burst of failures.
+     */
+    std::vector<MidiErrorRecord> getRecentErrors(size_t maxRecords = kErrorLogCapacity) const;
+    uint64_t getErrorCount() const;
     void clearErrors();
     
 private:
@@ -228,34 +620,81 @@ private:
     
     // M-Audio Oxygen Pro 61 helpers
     bool identifyOxygenPro(const MidiDeviceInfo& device);
+    bool connectToOxygenPro(const MidiDeviceInfo& device);
     void setupOxygenProPads();
     void setupOxygenProKnobs();
     
     // Message processing helpers
     KeyEvent convertMidiToKeyEvent(const RealTimeMidiMessage& message);
     bool shouldProcessMessage(const RealTimeMidiMessage& message);
-    void updateLatencyStatistics(const RealTimeMidiMessage& message);
+    void updateLatencyStatistics(const RealTimeMidiMessage& message, InputLane& lane);
+    void dispatchMessage(const RealTimeMidiMessage& message);
+    bool addListenerToTable(ListenerTable& table, MidiInputListener* listener);
+    InputLane* inputLaneFor(int deviceId);
+    void retireInputLanes(int deviceId);
+    void retireAllInputLanes();
+    bool inputPending() const;
+    static MidiInputStats inputLaneStats(const InputLane& lane, int deviceId);
     
     // Error handling
-    MidiError lastError_;
-    std::string lastErrorString_;
-    std::mutex errorMutex_;
+    uint64_t recordError(MidiError error, int deviceId, uint8_t status, double timestamp);
+    bool readErrorRecord(uint64_t sequence, MidiErrorRecord& record) const;
+
+    // Seqlock slot: sequence is kErrorSlotBusy while a writer owns it
+    struct ErrorSlot {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<MidiError> error{MidiError::None};
+        std::atomic<int> deviceId{-1};
+        std::atomic<uint8_t> status{0};
+        std::atomic<double> timestamp{0.0};
+    };
+    static constexpr uint64_t kErrorSlotBusy = ~uint64_t(0);
+
+    std::array<ErrorSlot, kErrorLogCapacity> errorLog_;
+    std::atomic<uint64_t> errorCount_;
+    std::atomic<uint64_t> lastError_;     /**< sequence << 8 | code; 0 when cleared. */
+    std::string errorDetail_;             /**< Text that replaces the generic one for errorDetailSequence_. */
+    uint64_t errorDetailSequence_;
+    mutable std::mutex errorMutex_;       /**< Guards the detail text only; never taken when sending. */
     
     // Configuration
-    size_t bufferSize_;
+    std::atomic<size_t> bufferSize_;
     double latencyTarget_;
-    bool velocityCurveEnabled_;
-    std::vector<float> velocityCurve_;
+
+    // Velocity curve: setters fill the buffer not in use and publish it;
+    // the input thread reads one entry per note on. A reader still holding
+    // the previous buffer when it is refilled sees the old or the new
+    // value of its entry, both valid, so entries are relaxed atomics.
+    using VelocityBuffer = std::array<std::atomic<uint8_t>, 128>;
+    VelocityBuffer velocityBuffers_[2];
+    std::atomic<const VelocityBuffer*> velocityTable_;   /**< nullptr while the curve is disabled. */
+    const VelocityBuffer* velocityCurrent_;              /**< Last buffer filled; guarded by velocityMutex_. */
+    std::mutex velocityMutex_;
+
+    // External clock, fed only from the clock source's input thread
+    MidiClock clock_;
+    std::atomic<int> clockSource_;
     
     // Timing and latency
-    std::atomic<double> avgInputLatency_;
+    LatencyHistogram inputLatency_;
     std::atomic<double> avgOutputLatency_;
-    std::chrono::high_resolution_clock::time_point lastMessageTime_;
+    std::chrono::steady_clock::time_point lastMessageTime_;
+    
+    // Processing thread setup; written only while processing is stopped
+    RealtimeConfig realtimeConfig_;
+    RealtimeStatus realtimeStatus_;
+    mutable std::mutex realtimeMutex_;
     
     // Key event history for piano synthesis
-    std::mutex keyEventHistoryMutex_;
-    std::vector<KeyEvent> keyEventHistory_;
-    static constexpr size_t MAX_KEY_EVENT_HISTORY = 1000;
+    std::unique_ptr<KeyEventHistory> keyEventHistory_;
+    static constexpr size_t MAX_KEY_EVENT_HISTORY = 1000;   /**< Default history capacity. */
+
+public:
+    /** @brief [AI GENERATED] Slots in each device's input ring; the upper bound for setBufferSize(). */
+    static constexpr size_t kMessageQueueCapacity = 8192;
+
+    /** @brief [AI GENERATED] Devices whose input can be queued at the same time; more are dropped. */
+    static constexpr size_t kMaxInputDevices = 8;
 };
 
 /**
@@ -0,0 +1,80 @@
+/**
+ * @file MidiRouter.h
+ * @brief [AI GENERATED] Fans channel messages out to handlers by channel and message type.
+ */
+
+#pragma once
+#include "MidiDevice.h"
+#include "MidiStatusTable.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief [AI GENERATED] Routing table from (message type, channel) to a set of handlers.
+ *
+ * Each route pairs a handler with a mask of channel message types (see
+ * typeBit()) and a mask of channels (bit n-1 for channel n). Adding or
+ * removing a route precomputes, for each of the 7 x 16 type and channel
+ * pairs, a bitmask of the routes that want it; routing a message is then
+ * one table lookup for the status byte, one for the mask, and a call per
+ * set bit. Routes with the same handler are independent, so a handler
+ * listed twice for a message is called twice.
+ *
+ * It is a MidiInputListener, so it can be subscribed to a MidiDevice
+ * directly, and MidiDevice::setInputFilter(router) drops traffic no route
+ * wants before it is queued. Like device subscriptions, routes may only
+ * change while nothing is being routed.
+ */
+class MidiRouter : public MidiInputListener {
+public:
+    static constexpr size_t kMaxRoutes = 32;
+    static constexpr uint16_t kAllChannels = 0xFFFF;
+    static constexpr uint8_t kAllTypes = 0x7F;
+
+    static constexpr uint16_t channelBit(int channel) {
+        return channel >= 1 && channel <= 16 ? static_cast<uint16_t>(1u << (channel - 1)) : 0;
+    }
+
+    static constexpr uint8_t typeBit(MidiMessageType type) {
+        return MidiStatusTable::channelTypeBit(type);
+    }
+
+    /**
+     * @brief [AI GENERATED] Send matching messages to handler.
+     *
+     * @return Route id for removeRoute(), or -1 if handler is null, either
+     *         mask is empty, or kMaxRoutes routes exist.
+     */
+    int addRoute(MidiInputListener* handler, uint8_t typeMask, uint16_t channelMask = kAllChannels);
+    bool removeRoute(int routeId);
+    void clear();
+
+    /**
+     * @brief [AI GENERATED] Call every handler routed for the message's type and channel.
+     */
+    void route(const RealTimeMidiMessage& message) const;
+    void onMidiMessage(const RealTimeMidiMessage& message) override { route(message); }
+
+    /**
+     * @brief [AI GENERATED] Bitmask of route ids that want this status byte on channel (1-16).
+     */
+    uint32_t routesFor(uint8_t status, int channel) const;
+
+    /**
+     * @brief [AI GENERATED] Channels on which some route wants type; 0 for non-channel types.
+     */
+    uint16_t channelMask(MidiMessageType type) const;
+
+private:
+    void rebuild();
+
+    struct Route {
+        MidiInputListener* handler = nullptr;
+        uint8_t typeMask = 0;
+        uint16_t channelMask = 0;
+    };
+
+    std::array<Route, kMaxRoutes> routes_{};
+    std::array<uint32_t, MidiStatusTable::kChannelTypeCount * 16> masks_{};   /**< [channelType * 16 + channel - 1]. */
+};
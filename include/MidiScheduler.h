@@ -0,0 +1,187 @@
+/**
+ * @file MidiScheduler.h
+ * @brief [AI GENERATED] Timestamped MIDI output: messages go out at their timestamps, not when queued.
+ */
+
+#pragma once
+#include "LatencyHistogram.h"
+#include "MidiDevice.h"
+#include "MidiInput.h"
+#include "RealtimeThread.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Counters and timing accuracy of a MidiScheduler.
+ */
+struct MidiScheduleStats {
+    uint64_t scheduled = 0;    /**< Messages accepted by schedule(). */
+    uint64_t sent = 0;         /**< Sent, or handed to the backend queue. */
+    uint64_t failed = 0;       /**< Refused by the device when their time came. */
+    uint64_t cancelled = 0;    /**< Dropped by cancel() or stop() before their time. */
+    uint64_t late = 0;         /**< Went out more than MidiScheduler::kLateThreshold after their timestamp. */
+    size_t pending = 0;        /**< Waiting in the scheduler. */
+    LatencySummary lateness;   /**< Time sent minus timestamp, in milliseconds; its spread is the jitter. */
+};
+
+/**
+ * @brief [AI GENERATED] Sends messages with future timestamps when they fall due.
+ *
+ * Messages wait in a min-heap ordered by timestamp (MidiDevice::timestampNow()
+ * seconds), ties in the order they were scheduled. One thread delivers
+ * them in one of two ways:
+ *
+ * - BackendQueue: messages are handed to the backend's own timer queue,
+ *   the ALSA sequencer's real-time queue on Linux, about lookahead seconds
+ *   before they are due. The kernel sends them, so timing does not depend
+ *   on this process being scheduled; lateness only records messages that
+ *   reached the backend after their time.
+ * - Dispatcher: the thread sleeps until the earliest message is due, on a
+ *   timerfd with minimal timer slack on Linux, and sends every message
+ *   that is due as one burst per device. Sub-millisecond accuracy under
+ *   load needs a realtime policy, see setRealtimeConfig().
+ *
+ * stop() and cancel() drop what has not gone out and send All Notes Off on
+ * every channel notes were sent on, so nothing keeps sounding.
+ */
+class MidiScheduler {
+public:
+    enum class Delivery {
+        Auto,           /**< BackendQueue if the device's backend has a queue, otherwise Dispatcher. */
+        BackendQueue,   /**< Hand messages to the backend queue ahead of time. */
+        Dispatcher      /**< Send each message from our thread at its time. */
+    };
+
+    static constexpr double kLateThreshold = 0.001;      /**< Seconds. */
+    static constexpr double kDefaultLookahead = 0.05;    /**< Seconds. */
+
+    explicit MidiScheduler(MidiDevice& device);
+    ~MidiScheduler();
+
+    MidiScheduler(const MidiScheduler&) = delete;
+    MidiScheduler& operator=(const MidiScheduler&) = delete;
+
+    // Configuration; each returns false while running
+    bool setDelivery(Delivery delivery);
+    Delivery getDelivery() const;
+    bool setLookahead(double seconds);
+    double getLookahead() const;
+
+    /**
+     * @brief [AI GENERATED] Scheduling for the delivery thread, applied by start(); see RealtimeThread.
+     */
+    bool setRealtimeConfig(const RealtimeConfig& config);
+    RealtimeStatus getRealtimeStatus() const;
+
+    /**
+     * @brief [AI GENERATED] Start delivering; messages scheduled earlier go out at their times.
+     *
+     * @return False if already running, BackendQueue was requested and the
+     *         backend has no queue, or the thread's timer could not be made.
+     */
+    bool start();
+    void stop();
+    bool isRunning() const;
+
+    /**
+     * @brief [AI GENERATED] True while running with BackendQueue delivery, also when chosen by Auto.
+     */
+    bool usesBackendQueue() const;
+
+    /**
+     * @brief [AI GENERATED] Send messages at their timestamps; any in the past go out at once.
+     *
+     * May be called from any thread, before or after start().
+     */
+    void schedule(int deviceId, const RealTimeMidiMessage& message);
+    void schedule(int deviceId, const RealTimeMidiMessage* messages, size_t count);
+
+    /**
+     * @brief [AI GENERATED] Play key events, such as MidiInput::generateFurEliseKeys(), from startTime on.
+     *
+     * Event timestamps are offsets from startTime, in seconds; see
+     * MidiDevice::keyEventToMessage() for the messages sent.
+     */
+    void schedule(int deviceId, const std::vector<KeyEvent>& events, double startTime);
+
+    /**
+     * @brief [AI GENERATED] Drop everything not yet sent and silence the channels that were played.
+     */
+    void cancel();
+    size_t pending() const;
+
+    MidiScheduleStats getStats() const;
+    void resetStats();
+
+private:
+    struct Entry {
+        RealTimeMidiMessage message;   /**< deviceId holds the destination. */
+        uint64_t order;
+    };
+    struct Later {
+        bool operator()(const Entry& a, const Entry& b) const {
+            return a.message.timestamp > b.message.timestamp ||
+                   (a.message.timestamp == b.message.timestamp && a.order > b.order);
+        }
+    };
+
+    void push(const RealTimeMidiMessage& message);
+    void run();
+    void waitUntil(std::unique_lock<std::mutex>& lock, double time);
+    void wake();
+    void deliver(const std::vector<RealTimeMidiMessage>& batch, uint64_t generation);
+    void silence();
+
+    static constexpr size_t kBatchReserve = 256;
+
+    MidiDevice& device_;
+
+    // Heap and configuration, guarded by mutex_
+    mutable std::mutex mutex_;
+    std::vector<Entry> heap_;
+    uint64_t nextOrder_ = 0;
+    Delivery delivery_ = Delivery::Auto;
+    double lookahead_ = kDefaultLookahead;
+    RealtimeConfig realtimeConfig_;
+    RealtimeStatus realtimeStatus_;
+    std::vector<RealTimeMidiMessage> batch_;   /**< Due messages; used only by the thread. */
+
+    // Held while a batch is sent, so silence() runs after any batch popped
+    // before a cancel(); batches popped before generation_ changed are dropped
+    std::mutex deliverMutex_;
+    std::atomic<uint64_t> generation_{0};
+
+    // Devices sent to since the last silence(), with the channels notes
+    // went out on; guarded by deliverMutex_. Fixed size so delivery never
+    // allocates; past kMaxPlayedDevices, silence() cancels every device's
+    // queued events but cannot send All Notes Off to the untracked ones.
+    static constexpr size_t kMaxPlayedDevices = 32;
+    struct PlayedDevice {
+        int deviceId = -1;
+        uint16_t channels = 0;
+    };
+    std::array<PlayedDevice, kMaxPlayedDevices> playedDevices_;
+    size_t playedCount_ = 0;
+    bool playedOverflow_ = false;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> useQueue_{false};
+    std::condition_variable wakeCondition_;   /**< Wakes the thread where there is no timerfd. */
+    bool wakeRequested_ = false;
+    int timerFd_ = -1;
+    int wakeFd_ = -1;
+
+    std::atomic<uint64_t> scheduled_{0};
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> cancelled_{0};
+    std::atomic<uint64_t> late_{0};
+    LatencyHistogram lateness_;
+};
@@ -0,0 +1,98 @@
+/**
+ * @file MidiStatusTable.h
+ * @brief [AI GENERATED] Compile-time classification of all 256 MIDI status byte values.
+ */
+
+#pragma once
+#include "MidiDevice.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief [AI GENERATED] Everything derived from one status byte.
+ */
+struct MidiStatusInfo {
+    MidiMessageType type = MidiMessageType::Unknown;
+    int8_t dataBytes = -1;      /**< Data bytes that follow; -1 for data bytes, SysEx start/end and undefined. */
+    uint8_t flags = 0;          /**< MidiStatusTable::k* bits. */
+    uint8_t channelType = 0xFF; /**< 0-6 for NoteOff..PitchBend, MidiStatusTable::kNoChannelType otherwise. */
+};
+
+namespace midi_status_detail {
+
+constexpr std::array<MidiStatusInfo, 256> buildTable() {
+    std::array<MidiStatusInfo, 256> table{};
+    for (int status = 0x80; status < 0xF0; ++status) {
+        MidiStatusInfo& info = table[status];
+        const int nibble = status & 0xF0;
+        info.type = static_cast<MidiMessageType>(nibble);
+        info.dataBytes = nibble == 0xC0 || nibble == 0xD0 ? 1 : 2;
+        info.flags = 0x01 | (nibble == 0x80 || nibble == 0x90 ? 0x02 : 0);
+        info.channelType = static_cast<uint8_t>((nibble >> 4) - 0x8);
+    }
+
+    table[0xF0].type = MidiMessageType::SystemExclusive;
+    table[0xF0].flags = 0x10;
+    for (int status = 0xF1; status < 0xF8; ++status) {
+        table[status].type = MidiMessageType::SystemCommon;
+        table[status].flags = 0x04;
+    }
+    table[0xF1].dataBytes = 1;   // MTC quarter frame
+    table[0xF2].dataBytes = 2;   // Song position
+    table[0xF3].dataBytes = 1;   // Song select
+    table[0xF6].dataBytes = 0;   // Tune request
+    table[0xF7].flags |= 0x10;   // End of SysEx
+    for (int status = 0xF8; status <= 0xFF; ++status) {
+        table[status].type = MidiMessageType::SystemRealtime;
+        table[status].flags = 0x08;
+        table[status].dataBytes = status == 0xF9 || status == 0xFD ? -1 : 0;
+    }
+    return table;
+}
+
+} // namespace midi_status_detail
+
+/**
+ * @brief [AI GENERATED] 256-entry constexpr table replacing per-message switch statements.
+ *
+ * Channel message entries cover all 16 channels of a status nibble, so the
+ * table gives the same answer whether status holds the full byte (0x99) or
+ * only the nibble with the channel stored separately (0x90), as
+ * RealTimeMidiMessage does. Bytes below 0x80 are data bytes and classify as
+ * Unknown.
+ */
+class MidiStatusTable {
+public:
+    static constexpr uint8_t kChannel = 0x01;        /**< 0x80-0xEF. */
+    static constexpr uint8_t kNote = 0x02;           /**< Note on or note off. */
+    static constexpr uint8_t kSystemCommon = 0x04;   /**< 0xF1-0xF7. */
+    static constexpr uint8_t kRealtime = 0x08;       /**< 0xF8-0xFF. */
+    static constexpr uint8_t kSysEx = 0x10;          /**< 0xF0 and 0xF7. */
+
+    static constexpr uint8_t kNoChannelType = 0xFF;
+    static constexpr size_t kChannelTypeCount = 7;
+
+    static constexpr const MidiStatusInfo& lookup(uint8_t status) { return kTable[status]; }
+    static constexpr MidiMessageType type(uint8_t status) { return kTable[status].type; }
+    static constexpr bool isChannelMessage(uint8_t status) { return (kTable[status].flags & kChannel) != 0; }
+    static constexpr bool isNote(uint8_t status) { return (kTable[status].flags & kNote) != 0; }
+
+    /**
+     * @brief [AI GENERATED] Bit (1 << channelType) for a channel message type, 0 for any other type.
+     */
+    static constexpr uint8_t channelTypeBit(MidiMessageType type) {
+        const uint8_t channelType = kTable[static_cast<uint8_t>(type)].channelType;
+        return channelType == kNoChannelType || (static_cast<int>(type) & 0x0F) != 0
+                   ? 0 : static_cast<uint8_t>(1u << channelType);
+    }
+
+private:
+    static constexpr std::array<MidiStatusInfo, 256> kTable = midi_status_detail::buildTable();
+};
+
+static_assert(MidiStatusTable::type(0x99) == MidiMessageType::NoteOn, "channel nibble ignored");
+static_assert(MidiStatusTable::lookup(0xC5).dataBytes == 1, "program change takes one data byte");
+static_assert(MidiStatusTable::type(0xF8) == MidiMessageType::SystemRealtime, "clock is realtime");
+static_assert(MidiStatusTable::channelTypeBit(MidiMessageType::PitchBend) == 0x40, "pitch bend is the last type");
+static_assert(MidiStatusTable::channelTypeBit(MidiMessageType::SystemExclusive) == 0, "SysEx has no channel");
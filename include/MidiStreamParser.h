@@ -0,0 +1,88 @@
+/**
+ * @file MidiStreamParser.h
+ * @brief [AI GENERATED] Incremental parser turning a raw MIDI byte stream into messages.
+ */
+
+#pragma once
+#include "MidiDevice.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief [AI GENERATED] MIDI 1.0 byte-stream state machine.
+ *
+ * Bytes can be fed in chunks of any size, split at any point: a message
+ * spanning two chunks is emitted when its last byte arrives. The parser
+ * handles running status, interleaved realtime bytes (0xF8-0xFF), which
+ * are emitted immediately without disturbing a message in progress, and
+ * SysEx of any length. Channel messages are reported the way
+ * parseRawMidiMessage() reports them: status nibble in status, channel
+ * 1-16 in channel. System messages keep the full status byte on channel 1.
+ *
+ * SysEx bytes collect in a buffer allocated once at construction. A SysEx
+ * message longer than the buffer is delivered in several fragments, with
+ * complete set only on the last one. A SysEx message cut short by a
+ * status byte is discarded and counted in errors(); if fragments of it were
+ * already delivered, the next fragment starting with 0xF0 tells the
+ * receiver to drop them. Data bytes with no status to apply them to are
+ * also counted in errors(). feed() never allocates.
+ */
+class MidiStreamParser {
+public:
+    /**
+     * @param onMessage Receives channel, system common and realtime messages.
+     * @param onSysEx Receives SysEx fragments; may be empty to ignore SysEx.
+     * @param deviceId Stored in every emitted message.
+     * @param sysExBufferSize Largest SysEx fragment delivered in one call.
+     */
+    MidiStreamParser(MidiInputCallback onMessage, MidiSysExCallback onSysEx, int deviceId = 0,
+                     size_t sysExBufferSize = kDefaultSysExBufferSize);
+
+    MidiStreamParser(const MidiStreamParser&) = delete;
+    MidiStreamParser& operator=(const MidiStreamParser&) = delete;
+
+    /**
+     * @brief [AI GENERATED] Parse a chunk; messages completed by it carry timestamp.
+     */
+    void feed(const uint8_t* data, size_t length, double timestamp);
+
+    /**
+     * @brief [AI GENERATED] Forget running status and any partial message, e.g. after a reconnect.
+     */
+    void reset();
+
+    uint64_t messageCount() const { return messages_; }
+    uint64_t sysExCount() const { return sysExMessages_; }
+    uint64_t errors() const { return errors_; }
+
+    static constexpr size_t kDefaultSysExBufferSize = 1024;
+
+    /**
+     * @brief [AI GENERATED] Data bytes that follow status, or -1 for realtime/undefined/SysEx bytes.
+     */
+    static int dataLength(uint8_t status);
+
+private:
+    void emit(double timestamp);
+    void emitRealtime(uint8_t status, double timestamp);
+    void flushSysEx(bool complete, double timestamp);
+
+    MidiInputCallback onMessage_;
+    MidiSysExCallback onSysEx_;
+    const int deviceId_;
+
+    uint8_t status_ = 0;      /**< Status being assembled; kept between channel messages for running status. */
+    uint8_t data_[2] = {0, 0};
+    int expected_ = 0;        /**< Data bytes the current status takes. */
+    int received_ = 0;        /**< Data bytes collected so far. */
+
+    bool inSysEx_ = false;
+    std::unique_ptr<uint8_t[]> sysEx_;
+    const size_t sysExCapacity_;
+    size_t sysExLength_ = 0;
+
+    uint64_t messages_ = 0;
+    uint64_t sysExMessages_ = 0;
+    uint64_t errors_ = 0;
+};
@@ -1,6 +1,7 @@
 
 
 #pragma once
+#include <cstddef>
 #include <vector>
 #include "Abstractor.h"
 
@@ -21,4 +22,72 @@ public:
 
     std::vector<double> synthesize(const std::vector<NoteEvent>& events,
                                    int sampleRate = 44100) const;
+
+    /**
+     * @brief [AI GENERATED] Number of samples synthesize() returns for the events.
+     */
+    static size_t frameCount(const std::vector<NoteEvent>& events, int sampleRate = 44100);
+
+    /**
+     * @brief [AI GENERATED] Render one block of the mix without normalization.
+     *
+     * Rendering consecutive blocks and concatenating them yields exactly the
+     * samples synthesize() computes before its peak normalization, so long
+     * pieces can be streamed with constant memory.
+     *
+     * @param events Notes to mix.
+     * @param sampleRate Output sample rate.
+     * @param firstFrame Index of the first sample of the block.
+     * @param frames Block length; out is overwritten.
+     * @param out Destination buffer.
+     * @param gain Scale applied to the mixed block.
+     *
+     * Each call sorts the events again; use BlockRenderer to stream a piece.
+     */
+    void renderBlock(const std::vector<NoteEvent>& events, int sampleRate, size_t firstFrame,
+                     size_t frames, double* out, double gain = 1.0) const;
+
+    /**
+     * @brief [AI GENERATED] Renders consecutive blocks of one piece, touching only the notes sounding in each.
+     *
+     * Events are sorted by start once; a cursor admits notes as their start
+     * is reached and an active list drops them after their release, so a
+     * piece costs O(events + blocks x sounding notes) rather than
+     * O(events x blocks). Output is identical to renderBlock(). The events
+     * must outlive the renderer; a block before the previous one restarts
+     * from the beginning.
+     */
+    class BlockRenderer {
+    public:
+        BlockRenderer(const std::vector<NoteEvent>& events, int sampleRate);
+        void render(size_t firstFrame, size_t frames, double* out, double gain = 1.0);
+
+    private:
+        const std::vector<NoteEvent>& events_;
+        int sampleRate_;
+        std::vector<long long> starts_;   /**< First sample of each event. */
+        std::vector<long long> ends_;     /**< One past the last sample, release included. */
+        std::vector<size_t> byStart_;     /**< Event indices in start order. */
+        size_t nextStart_ = 0;            /**< Next entry of byStart_ to admit. */
+        std::vector<size_t> active_;      /**< Admitted, unfinished events in event order. */
+        size_t nextFrame_ = 0;
+    };
+
+    /**
+     * @brief [AI GENERATED] Upper bound of the absolute mix value over the whole piece.
+     *
+     * Sums per-note harmonic amplitudes of overlapping notes without
+     * rendering any audio.
+     */
+    double peakBound(const std::vector<NoteEvent>& events, int sampleRate = 44100) const;
+
+    /**
+     * @brief [AI GENERATED] Gain for block rendering that guarantees the same 0.95 ceiling as synthesize().
+     *
+     * A streamed render cannot look ahead for the true peak, so it scales
+     * by the peak bound instead. The result never clips and matches
+     * synthesize() whenever no normalization is needed, but dense passages
+     * can come out somewhat quieter than the peak-normalized batch render.
+     */
+    double streamingGain(const std::vector<NoteEvent>& events, int sampleRate = 44100) const;
 };
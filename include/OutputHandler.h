@@ -4,6 +4,12 @@
  */
 
 #pragma once
+#include "AudioSink.h"
+#include "DirectWavWriter.h"
+#include "FlacWriter.h"
+#include "PipeSink.h"
+#include "WavFormat.h"
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -12,5 +18,120 @@
  */
 class OutputHandler {
 public:
-    void writeWav(const std::vector<double>& samples, const std::string& file, int sampleRate = 44100) const;
+    /**
+     * @brief [AI GENERATED] Write mono samples as a 16-bit PCM WAV file.
+     *
+     * Samples are converted in blocks by WavStreamWriter and written in large
+     * chunks. Values outside [-1, 1] saturate rather than wrap.
+     *
+     * @param samples Samples in the range [-1, 1].
+     * @param file Destination path.
+     * @param sampleRate Sample rate in Hz.
+     * @param dither Apply TPDF dither before quantization.
+     */
+    void writeWav(const std::vector<double>& samples, const std::string& file, int sampleRate = 44100,
+                  bool dither = false) const;
+
+    /**
+     * @brief [AI GENERATED] Write interleaved samples in any supported WAV format.
+     *
+     * Since the data size is known up front, Rf64Mode::Auto resolves to a
+     * plain RIFF header unless the file exceeds 4 GiB.
+     *
+     * @param samples Interleaved samples; size must be a multiple of format.channels.
+     * @param file Destination path.
+     * @param format Sample encoding, channel count and sample rate.
+     * @param dither Apply TPDF dither before integer quantization.
+     * @return True if the complete file was written.
+     */
+    bool writeWav(const std::vector<double>& samples, const std::string& file, const WavFormat& format,
+                  bool dither = false) const;
+
+    /**
+     * @brief [AI GENERATED] Write a WAV file through a preallocated memory mapping.
+     *
+     * Produces the same bytes as writeWav() but converts straight into the
+     * mapped file with MappedWavWriter, avoiding stream buffering.
+     *
+     * @param samples Interleaved samples; size must be a multiple of format.channels.
+     * @param file Destination path.
+     * @param format Sample encoding, channel count and sample rate.
+     * @param dither Apply TPDF dither before integer quantization.
+     * @return True if the complete file was written.
+     */
+    bool writeWavMapped(const std::vector<double>& samples, const std::string& file, const WavFormat& format,
+                        bool dither = false) const;
+
+    /**
+     * @brief [AI GENERATED] Losslessly compress interleaved samples into a FLAC file.
+     *
+     * Samples are quantized exactly as writeWav() would, so decoding the
+     * FLAC file yields the same integers as the equivalent WAV file.
+     *
+     * @param samples Interleaved samples; size must be a multiple of format.channels.
+     * @param file Destination path.
+     * @param format Sample rate, channel count and Pcm16 or Pcm24 samples.
+     * @param settings Encoder tuning, including the number of threads.
+     * @param dither Apply TPDF dither before quantization.
+     * @return True if the complete file was written.
+     */
+    bool writeFlac(const std::vector<double>& samples, const std::string& file, const WavFormat& format,
+                   const FlacSettings& settings = FlacSettings(), bool dither = false) const;
+
+    /**
+     * @brief [AI GENERATED] Open a streaming file writer, choosing the container from the extension.
+     *
+     * Files ending in ".flac" get a FlacWriter, anything else a
+     * WavStreamWriter. Wrap the result in an AsyncOutputSink to move the
+     * conversion and writes off the rendering thread.
+     *
+     * @param file Destination path.
+     * @param format Sample encoding, channel count and sample rate.
+     * @param frames Expected length if known, so WAV output can use a plain RIFF header; 0 if unknown.
+     * @param dither Apply TPDF dither before integer quantization.
+     * @return Open sink, or nullptr if the file cannot be created or the format is unsupported.
+     */
+    std::unique_ptr<AudioSink> openSink(const std::string& file, const WavFormat& format, uint64_t frames = 0,
+                                        bool dither = false) const;
+
+    /**
+     * @brief [AI GENERATED] Open a memory-mapped WAV writer for a render of known length.
+     *
+     * @param file Destination path.
+     * @param format Sample encoding, channel count and sample rate.
+     * @param frames Exact number of frames that will be appended.
+     * @param dither Apply TPDF dither before integer quantization.
+     * @return Open sink, or nullptr if the file cannot be allocated or mapped.
+     */
+    std::unique_ptr<AudioSink> openMappedSink(const std::string& file, const WavFormat& format, uint64_t frames,
+                                              bool dither = false) const;
+
+    /**
+     * @brief [AI GENERATED] Open a WAV writer that bypasses the page cache with io_uring or O_DIRECT.
+     *
+     * @param file Destination path.
+     * @param format Sample encoding, channel count and sample rate.
+     * @param frames Expected length if known, so Rf64Mode::Auto can be resolved; 0 if unknown.
+     * @param settings Queue depth, buffer size and backend selection.
+     * @param dither Apply TPDF dither before integer quantization.
+     * @return Open DirectWavWriter, or nullptr if the file cannot be created.
+     */
+    std::unique_ptr<DirectWavWriter> openDirectSink(const std::string& file, const WavFormat& format,
+                                                    uint64_t frames = 0,
+                                                    const DirectWriterSettings& settings = DirectWriterSettings(),
+                                                    bool dither = false) const;
+
+    /**
+     * @brief [AI GENERATED] Open a sink that streams raw PCM or WAV to a pipe or stdout.
+     *
+     * @param fd Writable descriptor, e.g. STDOUT_FILENO; left open.
+     * @param format Sample encoding, channel count and sample rate.
+     * @param container Raw samples or a WAV stream.
+     * @param frames Exact length if known, so the WAV header carries real sizes; 0 if unknown.
+     * @param dither Apply TPDF dither before integer quantization.
+     * @return Open sink, or nullptr if the descriptor is invalid or the header could not be written.
+     */
+    std::unique_ptr<AudioSink> openPipe(int fd, const WavFormat& format,
+                                        PipeContainer container = PipeContainer::Wav, uint64_t frames = 0,
+                                        bool dither = false) const;
 };
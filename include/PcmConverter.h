@@ -0,0 +1,137 @@
+/**
+ * @file PcmConverter.h
+ * @brief [AI GENERATED] Block conversion of floating point samples to PCM bytes.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief [AI GENERATED] Sample encodings supported by the output writers.
+ */
+enum class SampleFormat {
+    Pcm16,      /**< 16-bit signed integer PCM. */
+    Pcm24,      /**< 24-bit signed integer PCM, packed in 3 bytes. */
+    Float32     /**< 32-bit IEEE float, written without clipping. */
+};
+
+/**
+ * @brief [AI GENERATED] Triangular probability density (TPDF) dither source.
+ *
+ * Produces the sum of two independent uniform variables, giving noise in
+ * the range [-1, +1) LSB that decorrelates quantization error from the signal.
+ */
+class TpdfDither {
+public:
+    explicit TpdfDither(uint32_t seed = 0x9E3779B9u);
+
+    /**
+     * @brief [AI GENERATED] Fill a buffer with dither noise scaled to one LSB.
+     *
+     * @param out Destination buffer.
+     * @param count Number of values to generate.
+     * @param lsb Size of one quantization step in the target scale.
+     */
+    void fill(double* out, size_t count, double lsb = 1.0);
+
+private:
+    uint32_t state_;
+};
+
+/**
+ * @brief [AI GENERATED] Vectorized sample format conversion kernels.
+ *
+ * All kernels write little-endian bytes ready to be copied into a WAV data
+ * chunk. Integer kernels saturate out-of-range input instead of wrapping and
+ * round to nearest. The SIMD and scalar paths produce bit-identical output.
+ */
+class PcmConverter {
+public:
+    /**
+     * @brief [AI GENERATED] Convert samples to any supported format.
+     *
+     * @param format Target encoding.
+     * @param in Source samples.
+     * @param out Destination buffer of at least bytesPerSample(format) * count bytes.
+     * @param count Number of samples to convert.
+     * @param noise Optional dither in LSB units, ignored for Float32.
+     */
+    static void convert(SampleFormat format, const double* in, uint8_t* out, size_t count,
+                        const double* noise = nullptr);
+
+    /**
+     * @brief [AI GENERATED] Storage size of one sample in the given format.
+     */
+    static int bytesPerSample(SampleFormat format);
+
+    /**
+     * @brief [AI GENERATED] Convert samples in [-1, 1] to 16-bit PCM.
+     *
+     * @param in Source samples.
+     * @param out Destination buffer of at least 2 * count bytes.
+     * @param count Number of samples to convert.
+     * @param noise Optional per-sample dither in LSB units (may be nullptr).
+     */
+    static void toPcm16(const double* in, uint8_t* out, size_t count,
+                        const double* noise = nullptr);
+
+    /**
+     * @brief [AI GENERATED] Portable reference implementation of toPcm16.
+     */
+    static void toPcm16Scalar(const double* in, uint8_t* out, size_t count,
+                              const double* noise = nullptr);
+
+    /**
+     * @brief [AI GENERATED] Convert samples in [-1, 1] to packed 24-bit PCM.
+     *
+     * @param out Destination buffer of at least 3 * count bytes.
+     */
+    static void toPcm24(const double* in, uint8_t* out, size_t count,
+                        const double* noise = nullptr);
+    static void toPcm24Scalar(const double* in, uint8_t* out, size_t count,
+                              const double* noise = nullptr);
+
+    /**
+     * @brief [AI GENERATED] Convert samples to 32-bit IEEE float.
+     *
+     * Values are narrowed but not clipped, so headroom above full scale
+     * survives for later processing.
+     *
+     * @param out Destination buffer of at least 4 * count bytes.
+     */
+    static void toFloat32(const double* in, uint8_t* out, size_t count);
+    static void toFloat32Scalar(const double* in, uint8_t* out, size_t count);
+
+    /**
+     * @brief [AI GENERATED] Quantize samples to integers for an integer format.
+     *
+     * Produces the same values that toPcm16/toPcm24 pack into bytes, so
+     * encoders working on integer samples stay bit-exact with the WAV path.
+     *
+     * @param format Pcm16 or Pcm24; Float32 is not an integer format and leaves out untouched.
+     * @param out Destination buffer of at least count values.
+     */
+    static void toInt32(SampleFormat format, const double* in, int32_t* out, size_t count,
+                        const double* noise = nullptr);
+
+    /**
+     * @brief [AI GENERATED] Decode little-endian samples back to doubles.
+     *
+     * Inverse of convert(): integer samples are divided by the same full
+     * scale the encoders multiply by, so re-encoding a decoded sample yields
+     * the original integer.
+     *
+     * @param format Source encoding.
+     * @param in Source bytes, at least bytesPerSample(format) * count.
+     * @param out Destination samples.
+     * @param count Number of samples to decode.
+     */
+    static void toDouble(SampleFormat format, const uint8_t* in, double* out, size_t count);
+
+    static void fromPcm16(const uint8_t* in, double* out, size_t count);
+    static void fromPcm16Scalar(const uint8_t* in, double* out, size_t count);
+    static void fromPcm24(const uint8_t* in, double* out, size_t count);
+    static void fromFloat32(const uint8_t* in, double* out, size_t count);
+    static void fromFloat32Scalar(const uint8_t* in, double* out, size_t count);
+};
@@ -0,0 +1,106 @@
+/**
+ * @file PipeSink.h
+ * @brief [AI GENERATED] Streams raw PCM or WAV to a pipe, socket or stdout.
+ */
+
+#pragma once
+#include "AudioSink.h"
+#include "PcmConverter.h"
+#include "WavFormat.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Byte layout written by a PipeSink.
+ */
+enum class PipeContainer {
+    Raw,    /**< Headerless interleaved little-endian samples. */
+    Wav     /**< WAV header followed by the samples. */
+};
+
+/**
+ * @brief [AI GENERATED] Write counters of a PipeSink.
+ */
+struct PipeSinkStats {
+    uint64_t bytesWritten = 0;   /**< Bytes accepted by the descriptor, header included. */
+    uint64_t writeCalls = 0;     /**< write() system calls issued. */
+    uint64_t partialWrites = 0;  /**< write() calls that accepted only part of the request. */
+    uint64_t pollWaits = 0;      /**< Times a non-blocking descriptor was full and had to be polled. */
+};
+
+/**
+ * @brief [AI GENERATED] Sink that emits each appended block to a file descriptor immediately.
+ *
+ * Unlike WavStreamWriter the destination is never seeked, so it works on
+ * pipes and sockets and a downstream tool such as ffmpeg can start decoding
+ * while the render is still running. Every append() is converted in large
+ * chunks and written before returning; short writes are resumed, EINTR is
+ * retried and a non-blocking descriptor is polled until it drains.
+ *
+ * A WAV header carries the exact sizes when the length is passed to open(),
+ * otherwise 0xFFFFFFFF placeholders, which streaming readers treat as
+ * "read until end of stream". Writing to a closed pipe fails with EPIPE;
+ * callers should ignore SIGPIPE so that surfaces as a false return instead
+ * of terminating the process.
+ */
+class PipeSink : public AudioSink {
+public:
+    PipeSink() = default;
+    ~PipeSink() override;
+
+    PipeSink(const PipeSink&) = delete;
+    PipeSink& operator=(const PipeSink&) = delete;
+
+    /**
+     * @brief [AI GENERATED] Start a stream on an open descriptor and write the WAV header.
+     *
+     * @param fd Writable descriptor; not closed by the sink.
+     * @param format Sample encoding, channel count and sample rate.
+     * @param container Raw samples or a WAV stream.
+     * @param frames Total frames that will be appended, or 0 if unknown.
+     * @param dither Apply TPDF dither before integer quantization.
+     * @return True if the descriptor is valid and the header was written.
+     */
+    bool open(int fd, const WavFormat& format, PipeContainer container = PipeContainer::Wav, uint64_t frames = 0,
+              bool dither = false);
+
+    /**
+     * @brief [AI GENERATED] Convert and write a block of interleaved frames.
+     *
+     * @return False once a write has failed, e.g. because the reader went away.
+     */
+    bool append(const double* samples, size_t frames) override;
+
+    /**
+     * @brief [AI GENERATED] Write the RIFF pad byte if needed and end the stream.
+     *
+     * @return False if any write failed or, when a length was announced, a
+     *         different number of frames was appended.
+     */
+    bool finalize() override;
+
+    int channels() const override;
+    bool isOpen() const;
+    uint64_t framesWritten() const;
+    PipeSinkStats stats() const;
+
+    /** @brief [AI GENERATED] Samples converted per write() call. */
+    static constexpr size_t kWriteBlockSamples = 65536;
+    /** @brief [AI GENERATED] Pipe buffer size requested from the kernel on open(). */
+    static constexpr int kPipeBufferBytes = 1 << 20;
+
+private:
+    bool writeAll(const uint8_t* data, size_t size);
+
+    int fd_ = -1;
+    WavFormat format_;
+    PipeContainer container_ = PipeContainer::Wav;
+    uint64_t expectedFrames_ = 0;
+    std::vector<uint8_t> pcm_;
+    std::vector<double> noise_;
+    TpdfDither ditherSource_;
+    bool dither_ = false;
+    bool failed_ = false;
+    uint64_t samplesWritten_ = 0;
+    PipeSinkStats stats_;
+};
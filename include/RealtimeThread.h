@@ -0,0 +1,78 @@
+/**
+ * @file RealtimeThread.h
+ * @brief [AI GENERATED] Realtime scheduling, CPU pinning and memory locking for latency-critical threads.
+ */
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Requested scheduling and memory setup; the defaults change nothing.
+ */
+struct RealtimeConfig {
+    enum class Policy {
+        Default,      /**< Keep the normal time-sharing scheduler. */
+        Fifo,         /**< SCHED_FIFO: runs until it blocks or a higher priority thread wakes. */
+        RoundRobin    /**< SCHED_RR: like Fifo, but time-sliced against equal priorities. */
+    };
+
+    Policy policy = Policy::Default;
+    int priority = 0;            /**< 1-99 for Fifo and RoundRobin; ignored for Default. */
+    std::vector<int> cpus;       /**< CPUs the thread may run on; empty for any. */
+    bool lockMemory = false;     /**< mlockall() current and future pages of the whole process. */
+    bool prefault = false;       /**< Touch queue memory before the thread starts. */
+};
+
+/**
+ * @brief [AI GENERATED] What a RealtimeConfig actually achieved.
+ */
+struct RealtimeStatus {
+    bool scheduling = false;     /**< Policy and priority applied (also true for Policy::Default). */
+    bool affinity = false;       /**< CPU mask applied (also true when cpus was empty). */
+    bool memoryLocked = false;   /**< mlockall() succeeded. */
+    bool prefaulted = false;     /**< Every prefault() call succeeded. */
+    std::string error;           /**< Why a requested setting was not applied; empty if all were. */
+};
+
+/**
+ * @brief [AI GENERATED] Applies a RealtimeConfig to a running thread and the process.
+ *
+ * Each step that fails leaves that setting as it was and appends a line to
+ * RealtimeStatus::error naming the setting, the system error and the
+ * privilege that is missing, so callers can keep running without it.
+ * Realtime policies need root, CAP_SYS_NICE or a high enough RLIMIT_RTPRIO;
+ * locking memory needs CAP_IPC_LOCK or an RLIMIT_MEMLOCK covering the process.
+ */
+class RealtimeThread {
+public:
+    /**
+     * @brief [AI GENERATED] Check ranges: priority within the policy's limits, CPU numbers non-negative.
+     */
+    static bool isValid(const RealtimeConfig& config);
+
+    /**
+     * @brief [AI GENERATED] Apply policy, priority and CPU mask to thread.
+     *
+     * @return True if everything requested was applied.
+     */
+    static bool configure(std::thread& thread, const RealtimeConfig& config, RealtimeStatus& status);
+
+    /**
+     * @brief [AI GENERATED] Lock all current and future pages of the process in memory.
+     *
+     * Process-wide and not undone later, since other code may rely on it.
+     */
+    static bool lockMemory(RealtimeStatus& status);
+
+    /**
+     * @brief [AI GENERATED] Make every page of a buffer resident without changing its contents.
+     *
+     * Safe while other threads use the buffer, so queues can be prefaulted
+     * while input is already arriving. On kernels before 5.14 the range is
+     * locked and unlocked again, so call it before lockMemory().
+     */
+    static bool prefault(const void* data, size_t bytes);
+};
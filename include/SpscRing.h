@@ -0,0 +1,241 @@
+/**
+ * @file SpscRing.h
+ * @brief [AI GENERATED] Lock-free single-producer/single-consumer ring buffer and a blocking wake signal.
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#define SPSC_RING_FUTEX 1
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+/**
+ * @brief [AI GENERATED] Fixed-capacity ring for exactly one producer thread and one consumer thread.
+ *
+ * The producer owns tail_ and the consumer owns head_; each index sits on its
+ * own cache line next to a private copy of the other side's index, so a push
+ * or pop only touches the shared line of the opposite thread when its cached
+ * view says the ring is full or empty. No operation takes a lock or performs
+ * a read-modify-write. Capacity is rounded up to a power of two.
+ *
+ * @tparam T Copyable element type.
+ */
+template <typename T>
+class SpscRing {
+public:
+    /**
+     * @brief [AI GENERATED] Allocate storage for at least minCapacity elements.
+     */
+    explicit SpscRing(size_t minCapacity)
+        : capacity_(roundUpPow2(minCapacity < 2 ? 2 : minCapacity))
+        , mask_(capacity_ - 1)
+        , slots_(new T[capacity_]) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief [AI GENERATED] Append one element. Producer thread only.
+     *
+     * @return False if the ring is full; the element is not stored.
+     */
+    bool tryPush(const T& value) {
+        return tryPush(value, capacity_);
+    }
+
+    /**
+     * @brief [AI GENERATED] Append one element unless limit elements are already stored. Producer thread only.
+     *
+     * Checked against the producer's cached view of head first, like the
+     * full check, so the consumer's line is only read near the limit.
+     *
+     * @return False if the ring holds min(limit, capacity()) elements.
+     */
+    bool tryPush(const T& value, size_t limit) {
+        limit = limit < capacity_ ? limit : capacity_;
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ >= limit) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ >= limit) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief [AI GENERATED] Remove the oldest element. Consumer thread only.
+     *
+     * @return False if the ring is empty.
+     */
+    bool tryPop(T& out) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_) {
+                return false;
+            }
+        }
+        out = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief [AI GENERATED] Elements currently stored.
+     *
+     * From the producer it can only overstate, and from the consumer only
+     * understate, the true count; from any other thread it is a snapshot.
+     */
+    size_t size() const {
+        const size_t head = head_.load(std::memory_order_acquire);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    /**
+     * @brief [AI GENERATED] Slot storage, e.g. for prefaulting; not for element access.
+     */
+    const void* storage() const {
+        return slots_.get();
+    }
+
+    size_t storageBytes() const {
+        return capacity_ * sizeof(T);
+    }
+
+private:
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 1;
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    static constexpr size_t kCacheLine = 64;
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    alignas(kCacheLine) std::atomic<size_t> head_{0};   /**< Next slot to read; written by the consumer. */
+    size_t cachedTail_ = 0;                             /**< Consumer's last view of tail_. */
+
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};   /**< Next slot to write; written by the producer. */
+    size_t cachedHead_ = 0;                             /**< Producer's last view of head_. */
+
+    char padding_[kCacheLine - sizeof(size_t)];         /**< Keeps neighbouring objects off tail_'s line. */
+};
+
+/**
+ * @brief [AI GENERATED] Event count that lets a consumer sleep until a producer signals.
+ *
+ * A waiter announces itself with prepareWait(), re-checks its condition, and
+ * then either calls cancelWait() or wait(). notify() costs one fence and a
+ * load when nobody is waiting, so producers may call it after every push.
+ * On Linux the wait is a futex on the epoch word; elsewhere a mutex and
+ * condition variable are used only by the sleeping side and by notifications
+ * that find a waiter.
+ */
+class WakeSignal {
+public:
+    /**
+     * @brief [AI GENERATED] Register as a waiter and return the epoch to pass to wait().
+     */
+    uint32_t prepareWait() {
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return epoch_.load(std::memory_order_seq_cst);
+    }
+
+    /**
+     * @brief [AI GENERATED] Withdraw after prepareWait() when the condition already holds.
+     */
+    void cancelWait() {
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief [AI GENERATED] Sleep until notified after prepareWait() returned epoch, or until timeout.
+     */
+    void wait(uint32_t epoch, std::chrono::nanoseconds timeout) {
+#if defined(SPSC_RING_FUTEX)
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+        ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAIT_PRIVATE, epoch, &ts, nullptr, 0);
+#else
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, timeout, [&] { return epoch_.load(std::memory_order_relaxed) != epoch; });
+#endif
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief [AI GENERATED] Wake all waiters if there are any.
+     *
+     * Must be called after the state change the waiters check for has been
+     * published (e.g. after SpscRing::tryPush()).
+     */
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) != 0) {
+            wake();
+        }
+    }
+
+    /**
+     * @brief [AI GENERATED] Wake all waiters unconditionally, e.g. on shutdown.
+     */
+    void notifyAll() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wake();
+    }
+
+private:
+    void wake() {
+#if defined(SPSC_RING_FUTEX)
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+        }
+        cv_.notify_all();
+#endif
+    }
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit integer");
+
+    std::atomic<uint32_t> epoch_{0};
+    std::atomic<uint32_t> waiters_{0};
+#if !defined(SPSC_RING_FUTEX)
+    std::mutex mutex_;
+    std::condition_variable cv_;
+#endif
+};
@@ -0,0 +1,47 @@
+/**
+ * @file VelocityCurve.h
+ * @brief [AI GENERATED] Velocity response curves compiled to 128-entry lookup tables.
+ */
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Output velocity for every input velocity 0-127.
+ */
+using VelocityTable = std::array<uint8_t, 128>;
+
+/**
+ * @brief [AI GENERATED] Builds velocity tables from presets or control points.
+ *
+ * Every table maps 0 to 0, so a note on with velocity 0 still means note
+ * off, and maps every other velocity to 1-127, so a played note is never
+ * silenced. Outputs are rounded to the nearest integer.
+ */
+class VelocityCurve {
+public:
+    enum class Preset {
+        Linear,        /**< Output equals input. */
+        Soft,          /**< sqrt response: light playing comes out louder. */
+        Hard,          /**< Square response: full velocity needs a hard strike. */
+        Exponential    /**< (e^(4x) - 1) / (e^4 - 1): very quiet until the top of the range. */
+    };
+
+    static VelocityTable fromPreset(Preset preset);
+
+    /**
+     * @brief [AI GENERATED] Piecewise-linear curve through evenly spaced control points.
+     *
+     * points[i] is the output, 0.0-1.0, for input i / (points.size() - 1)
+     * of full scale; values outside that range are clamped. A single point
+     * gives a constant output, and no points give the linear curve.
+     */
+    static VelocityTable fromPoints(const std::vector<float>& points);
+
+private:
+    template <typename Function>
+    static VelocityTable build(Function shape);
+};
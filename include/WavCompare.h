@@ -0,0 +1,75 @@
+/**
+ * @file WavCompare.h
+ * @brief [AI GENERATED] Error metrics between two renders for golden-file regression tests.
+ */
+
+#pragma once
+#include "WavReader.h"
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief [AI GENERATED] Running sums of a sample-by-sample comparison.
+ */
+struct ErrorAccumulator {
+    double errorEnergy = 0.0;       /**< Sum of squared differences. */
+    double referenceEnergy = 0.0;   /**< Sum of squared reference samples. */
+    double maxAbsError = 0.0;       /**< Largest absolute difference. */
+    uint64_t maxErrorIndex = 0;     /**< Sample index of maxAbsError. */
+    uint64_t count = 0;             /**< Samples accumulated. */
+};
+
+/**
+ * @brief [AI GENERATED] Result of comparing a test render against a reference.
+ */
+struct WavDifference {
+    bool comparable = false;        /**< Both files opened with equal rate and channel count. */
+    bool identical = false;         /**< Same format, same length and bit-identical data. */
+    uint64_t samples = 0;           /**< Samples compared (the shorter of the two files). */
+    int64_t frameDifference = 0;    /**< Test frames minus reference frames. */
+    double maxAbsError = 0.0;       /**< Largest absolute difference, full scale = 1.0. */
+    uint64_t maxErrorFrame = 0;     /**< Frame where maxAbsError occurs. */
+    double rmsError = 0.0;          /**< Root mean square of the difference. */
+    double snrDb = 0.0;             /**< Reference energy over error energy; infinity if the error is zero. */
+    std::string error;              /**< Why the files are not comparable. */
+};
+
+/**
+ * @brief [AI GENERATED] Compares two WAV files sample by sample.
+ *
+ * Both files are mapped with WavReader and decoded in blocks, so memory use
+ * is constant regardless of length. Files in different sample encodings
+ * (e.g. a pcm16 golden file and a float32 render) are compared after
+ * decoding to the common [-1, 1] scale. Bit-identical data is detected with
+ * a direct memory comparison before any decoding.
+ */
+class WavCompare {
+public:
+    /**
+     * @brief [AI GENERATED] Compare two open readers over their common length.
+     */
+    static WavDifference compare(const WavReader& reference, const WavReader& test);
+
+    /**
+     * @brief [AI GENERATED] Open and compare two files.
+     */
+    static WavDifference compareFiles(const std::string& reference, const std::string& test);
+
+    /**
+     * @brief [AI GENERATED] Add a block of sample pairs to the running sums.
+     *
+     * @param reference Reference samples.
+     * @param test Samples to compare.
+     * @param count Number of sample pairs.
+     * @param acc Sums to update; indices continue from acc.count.
+     */
+    static void accumulate(const double* reference, const double* test, size_t count, ErrorAccumulator& acc);
+
+    /**
+     * @brief [AI GENERATED] Portable reference implementation of accumulate().
+     */
+    static void accumulateScalar(const double* reference, const double* test, size_t count, ErrorAccumulator& acc);
+
+    /** @brief [AI GENERATED] Samples decoded per block. */
+    static constexpr size_t kBlockSamples = 16384;
+};
@@ -0,0 +1,75 @@
+/**
+ * @file WavFormat.h
+ * @brief [AI GENERATED] WAV stream description and RIFF/RF64 header construction.
+ */
+
+#pragma once
+#include "PcmConverter.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] How a writer handles data that outgrows the 32-bit RIFF sizes.
+ */
+enum class Rf64Mode {
+    Never,      /**< Classic RIFF only; finalizing more than 4 GiB fails. */
+    Auto,       /**< Reserve a JUNK chunk that is promoted to ds64 if needed. */
+    Always      /**< Always write an RF64/BW64 header. */
+};
+
+/**
+ * @brief [AI GENERATED] Layout of the audio stored in a WAV file.
+ */
+struct WavFormat {
+    int sampleRate = 44100;                          /**< Frames per second. */
+    int channels = 1;                                /**< Interleaved channel count. */
+    SampleFormat sampleFormat = SampleFormat::Pcm16; /**< Sample encoding. */
+    Rf64Mode rf64 = Rf64Mode::Auto;                  /**< Large file handling. */
+
+    int bytesPerSample() const;
+    int blockAlign() const;
+    uint32_t byteRate() const;
+    bool isFloat() const;
+
+    /**
+     * @brief [AI GENERATED] Replace Rf64Mode::Auto with a plain RIFF or an RF64 header for a known length.
+     *
+     * @param frames Total frames the file will hold.
+     */
+    WavFormat resolveRf64(uint64_t frames) const;
+};
+
+/**
+ * @brief [AI GENERATED] Builds WAV headers for a format and data size.
+ *
+ * The header length depends only on the format and its Rf64Mode, never on
+ * the data size, so a writer can emit a placeholder header on open and
+ * overwrite it in place once the size is known.
+ */
+class WavHeader {
+public:
+    /** @brief [AI GENERATED] Data size used while the final size is still unknown. */
+    static constexpr uint64_t kUnknownSize = ~0ull;
+    /** @brief [AI GENERATED] 32-bit size value marking a field as superseded or unknown. */
+    static constexpr uint32_t kPlaceholderSize = 0xFFFFFFFFu;
+
+    /**
+     * @brief [AI GENERATED] Build a complete header up to and including the data chunk tag and size.
+     *
+     * @param format Stream layout.
+     * @param dataBytes Size of the sample data, or kUnknownSize for placeholders.
+     * @return Header bytes, or an empty vector if the size does not fit
+     *         the container allowed by format.rf64.
+     */
+    static std::vector<uint8_t> build(const WavFormat& format, uint64_t dataBytes);
+
+    /**
+     * @brief [AI GENERATED] Whether the data size exceeds what 32-bit RIFF fields can describe.
+     */
+    static bool needsRf64(const WavFormat& format, uint64_t dataBytes);
+
+    /**
+     * @brief [AI GENERATED] Header length in bytes for the given format.
+     */
+    static size_t size(const WavFormat& format);
+};
@@ -0,0 +1,88 @@
+/**
+ * @file WavReader.h
+ * @brief [AI GENERATED] Zero-copy WAV reader backed by a read-only memory mapping.
+ */
+
+#pragma once
+#include "WavFormat.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Maps a WAV file and exposes its sample data in place.
+ *
+ * Reads every layout the writers produce: 16/24-bit PCM and 32-bit float,
+ * plain and WAVE_FORMAT_EXTENSIBLE fmt chunks, RIFF and RF64 (ds64)
+ * headers, and files whose sizes are still 0xFFFFFFFF placeholders because
+ * they were streamed or never finalized; those are read to the end of the
+ * file. data() points into the mapping, so nothing is copied until samples
+ * are converted with read().
+ */
+class WavReader {
+public:
+    WavReader() = default;
+    ~WavReader();
+
+    WavReader(const WavReader&) = delete;
+    WavReader& operator=(const WavReader&) = delete;
+
+    /**
+     * @brief [AI GENERATED] Map a file and parse its header.
+     *
+     * @param file Path to a WAV file.
+     * @return True if the file is a supported WAV file; see error() otherwise.
+     */
+    bool open(const std::string& file);
+
+    /**
+     * @brief [AI GENERATED] Unmap the file.
+     */
+    void close();
+
+    bool isOpen() const;
+
+    /**
+     * @brief [AI GENERATED] Layout of the samples; rf64 is Always for RF64 files and Never otherwise.
+     */
+    const WavFormat& format() const;
+
+    uint64_t frames() const;
+    uint64_t samples() const;
+
+    /**
+     * @brief [AI GENERATED] Raw little-endian sample bytes inside the mapping.
+     */
+    const uint8_t* data() const;
+    uint64_t dataBytes() const;
+
+    /**
+     * @brief [AI GENERATED] Convert interleaved samples to doubles.
+     *
+     * @param firstSample Index of the first sample (not frame) to convert.
+     * @param count Number of samples requested.
+     * @param out Destination of at least count values.
+     * @return Number of samples converted, less than count at the end of the data.
+     */
+    size_t read(uint64_t firstSample, size_t count, double* out) const;
+
+    /**
+     * @brief [AI GENERATED] Convert the whole file to interleaved doubles.
+     */
+    std::vector<double> readAll() const;
+
+    /**
+     * @brief [AI GENERATED] Reason the last open() failed.
+     */
+    const std::string& error() const;
+
+private:
+    bool fail(const std::string& message);
+
+    uint8_t* map_ = nullptr;
+    uint64_t mapSize_ = 0;
+    const uint8_t* data_ = nullptr;
+    uint64_t dataBytes_ = 0;
+    WavFormat format_;
+    std::string error_;
+};
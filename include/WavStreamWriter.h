@@ -0,0 +1,113 @@
+/**
+ * @file WavStreamWriter.h
+ * @brief [AI GENERATED] Incremental WAV writer with deferred header finalization.
+ */
+
+#pragma once
+#include "AudioSink.h"
+#include "PcmConverter.h"
+#include "WavFormat.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief [AI GENERATED] Streams blocks of samples to a WAV file with constant memory.
+ *
+ * The header is written with placeholder sizes on open() and rewritten by
+ * finalize(). The placeholders are 0xFFFFFFFF, which common readers treat as
+ * "read data until end of file", so an unfinalized file is still playable.
+ * With Rf64Mode::Auto the header reserves room for a ds64 chunk and is
+ * promoted to RF64 if the data grows past the 4 GiB RIFF limit.
+ * The destructor finalizes an open stream, and recover() repairs the sizes
+ * of a file left behind by a process that never reached finalize().
+ */
+class WavStreamWriter : public AudioSink {
+public:
+    WavStreamWriter() = default;
+    ~WavStreamWriter() override;
+
+    WavStreamWriter(const WavStreamWriter&) = delete;
+    WavStreamWriter& operator=(const WavStreamWriter&) = delete;
+
+    /**
+     * @brief [AI GENERATED] Create the file and write a header with placeholder sizes.
+     *
+     * @param file Destination path.
+     * @param format Sample encoding, channel count and large file handling.
+     * @param dither Apply TPDF dither before integer quantization.
+     * @return True if the file was created and the header written.
+     */
+    bool open(const std::string& file, const WavFormat& format, bool dither = false);
+
+    /**
+     * @brief [AI GENERATED] Open a 16-bit mono stream.
+     */
+    bool open(const std::string& file, int sampleRate = 44100, bool dither = false);
+
+    /**
+     * @brief [AI GENERATED] Convert and append a block of interleaved frames.
+     *
+     * @param samples Interleaved samples, nominally in the range [-1, 1].
+     * @param frames Number of frames (samples per channel) in the block.
+     * @return True if the block was written.
+     */
+    bool append(const double* samples, size_t frames) override;
+
+    /**
+     * @brief [AI GENERATED] Append an interleaved block whose size is a multiple of the channel count.
+     */
+    bool append(const std::vector<double>& block);
+
+    /**
+     * @brief [AI GENERATED] Interleave and append one buffer per channel.
+     *
+     * @param channels Array of format().channels pointers, each holding frames samples.
+     * @param frames Number of frames to append.
+     */
+    bool appendPlanar(const double* const* channels, size_t frames);
+
+    /**
+     * @brief [AI GENERATED] Rewrite the header with the final sizes and close the file.
+     *
+     * @return True if the header was written and the file closed cleanly.
+     *         Fails when more than 4 GiB were written with Rf64Mode::Never.
+     */
+    bool finalize() override;
+
+    int channels() const override;
+    bool isOpen() const;
+    const WavFormat& format() const;
+    uint64_t framesWritten() const;
+    uint64_t samplesWritten() const;
+
+    /**
+     * @brief [AI GENERATED] Rewrite the RIFF, fact and data sizes of a WAV file from its length.
+     *
+     * Used to repair files from interrupted renders. Trailing bytes that do
+     * not form a complete sample frame are excluded from the data size, and
+     * a reserved JUNK chunk is promoted to ds64 when the data exceeds 4 GiB.
+     *
+     * @param file Path to a WAV file with stale or placeholder sizes.
+     * @return True if the file was recognised and patched.
+     */
+    static bool recover(const std::string& file);
+
+    /** @brief [AI GENERATED] Samples converted per write call. */
+    static constexpr size_t kWriteBlockSamples = 32768;
+    /** @brief [AI GENERATED] Size written in place of unknown chunk sizes. */
+    static constexpr uint32_t kPlaceholderSize = WavHeader::kPlaceholderSize;
+
+private:
+    bool writeSamples(const double* samples, size_t count);
+
+    std::ofstream out_;
+    WavFormat format_;
+    std::vector<uint8_t> pcm_;
+    std::vector<double> noise_;
+    std::vector<double> interleaved_;
+    TpdfDither ditherSource_;
+    bool dither_ = false;
+    uint64_t samplesWritten_ = 0;
+};
@@ -0,0 +1,165 @@
+#include "../include/AsyncOutputSink.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+AsyncOutputSink::AsyncOutputSink(std::unique_ptr<AudioSink> downstream, size_t blockFrames, size_t bufferCount)
+    : downstream_(std::move(downstream)),
+      blockFrames_(std::max<size_t>(1, blockFrames)),
+      channels_(downstream_ ? downstream_->channels() : 1),
+      slots_(std::max<size_t>(2, bufferCount)) {
+    for (auto& slot : slots_) {
+        slot.samples.resize(blockFrames_ * channels_);
+    }
+    failed_ = !downstream_;
+    ioThread_ = std::thread(&AsyncOutputSink::ioThreadFunction, this);
+}
+
+AsyncOutputSink::~AsyncOutputSink() {
+    finalize();
+}
+
+bool AsyncOutputSink::waitForFreeSlot(std::unique_lock<std::mutex>& lock) {
+    if (produced_ - consumed_ >= slots_.size()) {
+        const auto start = std::chrono::steady_clock::now();
+        slotFreed_.wait(lock, [this] { return produced_ - consumed_ < slots_.size(); });
+        stats_.backpressureWaits++;
+        stats_.backpressureSeconds += secondsSince(start);
+    }
+    return !failed_ && !finalized_;
+}
+
+bool AsyncOutputSink::submitLocked(std::unique_lock<std::mutex>& lock, size_t frames) {
+    slots_[produced_ % slots_.size()].frames = frames;
+    ++produced_;
+    fillFrames_ = 0;
+
+    const size_t depth = static_cast<size_t>(produced_ - consumed_);
+    stats_.maxQueueDepth = std::max(stats_.maxQueueDepth, depth);
+    depthSum_ += depth;
+    lock.unlock();
+    slotFilled_.notify_one();
+    return true;
+}
+
+bool AsyncOutputSink::append(const double* samples, size_t frames) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (frames > 0) {
+        if (!waitForFreeSlot(lock)) {
+            return false;
+        }
+        // Only the producer touches the slot at produced_, so the copy runs unlocked
+        Slot& slot = slots_[produced_ % slots_.size()];
+        const size_t n = std::min(blockFrames_ - fillFrames_, frames);
+        lock.unlock();
+        std::memcpy(slot.samples.data() + fillFrames_ * channels_, samples, n * channels_ * sizeof(double));
+        lock.lock();
+
+        fillFrames_ += n;
+        samples += n * channels_;
+        frames -= n;
+        if (fillFrames_ == blockFrames_) {
+            submitLocked(lock, blockFrames_);
+            lock.lock();
+        }
+    }
+    return !failed_;
+}
+
+double* AsyncOutputSink::acquireBlock() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (fillFrames_ > 0) {
+        submitLocked(lock, fillFrames_);
+        lock.lock();
+    }
+    if (!waitForFreeSlot(lock)) {
+        return nullptr;
+    }
+    return slots_[produced_ % slots_.size()].samples.data();
+}
+
+bool AsyncOutputSink::submitBlock(size_t frames) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (failed_ || finalized_ || frames > blockFrames_ || produced_ - consumed_ >= slots_.size()) {
+        return false;
+    }
+    return submitLocked(lock, frames);
+}
+
+void AsyncOutputSink::ioThreadFunction() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        slotFilled_.wait(lock, [this] { return produced_ > consumed_ || stopping_; });
+        if (produced_ == consumed_) {
+            return; // Stopping with an empty queue
+        }
+
+        Slot& slot = slots_[consumed_ % slots_.size()];
+        const bool skip = failed_;
+        lock.unlock();
+
+        bool ok = true;
+        double seconds = 0.0;
+        if (!skip && slot.frames > 0) {
+            const auto start = std::chrono::steady_clock::now();
+            ok = downstream_->append(slot.samples.data(), slot.frames);
+            seconds = secondsSince(start);
+        }
+
+        lock.lock();
+        if (!skip) {
+            failed_ = failed_ || !ok;
+            stats_.blocksWritten++;
+            stats_.framesWritten += slot.frames;
+            stats_.writeSeconds += seconds;
+            stats_.maxWriteSeconds = std::max(stats_.maxWriteSeconds, seconds);
+        }
+        ++consumed_;
+        slotFreed_.notify_one();
+    }
+}
+
+bool AsyncOutputSink::finalize() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (finalized_) {
+        return false;
+    }
+    if (fillFrames_ > 0) {
+        submitLocked(lock, fillFrames_);
+        lock.lock();
+    }
+    finalized_ = true;
+    stopping_ = true;
+    lock.unlock();
+    slotFilled_.notify_one();
+    ioThread_.join();
+
+    bool ok = !failed_;
+    if (downstream_) {
+        ok = downstream_->finalize() && ok;
+    }
+    return ok;
+}
+
+int AsyncOutputSink::channels() const {
+    return channels_;
+}
+
+size_t AsyncOutputSink::blockFrames() const {
+    return blockFrames_;
+}
+
+AsyncSinkStats AsyncOutputSink::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AsyncSinkStats stats = stats_;
+    stats.averageQueueDepth = produced_ ? static_cast<double>(depthSum_) / produced_ : 0.0;
+    return stats;
+}
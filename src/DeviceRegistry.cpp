@@ -0,0 +1,175 @@
+#include "../include/DeviceRegistry.h"
+#include <algorithm>
+#include <cctype>
+
+std::string DeviceRegistry::normalizeName(const std::string& name) {
+    std::string normalized;
+    normalized.reserve(name.size());
+    for (unsigned char c : name) {
+        if (std::isalnum(c)) {
+            normalized.push_back(static_cast<char>(std::tolower(c)));
+        }
+    }
+    return normalized;
+}
+
+MidiDeviceInfo DeviceRegistry::notFound() {
+    return MidiDeviceInfo{-1, "Unknown", "Unknown", false, false, false, 0};
+}
+
+void DeviceRegistry::indexNameLocked(const MidiDeviceInfo& device) {
+    auto result = byName_.emplace(normalizeName(device.name), device.deviceId);
+    if (!result.second && device.deviceId < result.first->second) {
+        result.first->second = device.deviceId;
+    }
+}
+
+void DeviceRegistry::unindexNameLocked(const MidiDeviceInfo& device) {
+    const std::string key = normalizeName(device.name);
+    auto it = byName_.find(key);
+    if (it == byName_.end() || it->second != device.deviceId) {
+        return;
+    }
+    // Fall back to another device with the same name; rare, so a walk is fine
+    int replacement = -1;
+    for (const auto& entry : byId_) {
+        if (entry.first != device.deviceId && (replacement == -1 || entry.first < replacement) &&
+            normalizeName(entry.second.name) == key) {
+            replacement = entry.first;
+        }
+    }
+    if (replacement == -1) {
+        byName_.erase(it);
+    } else {
+        it->second = replacement;
+    }
+}
+
+bool DeviceRegistry::update(const MidiDeviceInfo& device) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byId_.find(device.deviceId);
+    const bool added = it == byId_.end();
+    if (!added) {
+        unindexNameLocked(it->second);
+        it->second = device;
+    } else {
+        byId_.emplace(device.deviceId, device);
+    }
+    indexNameLocked(device);
+    return added;
+}
+
+bool DeviceRegistry::remove(int deviceId, MidiDeviceInfo* removed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byId_.find(deviceId);
+    if (it == byId_.end()) {
+        return false;
+    }
+    if (removed) {
+        *removed = it->second;
+    }
+    const MidiDeviceInfo device = it->second;
+    byId_.erase(it);
+    unindexNameLocked(device);
+    return true;
+}
+
+std::vector<MidiDeviceInfo> DeviceRegistry::removeIf(const std::function<bool(const MidiDeviceInfo&)>& predicate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<MidiDeviceInfo> removed;
+    for (auto it = byId_.begin(); it != byId_.end();) {
+        if (predicate(it->second)) {
+            removed.push_back(it->second);
+            it = byId_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (const auto& device : removed) {
+        unindexNameLocked(device);
+    }
+    std::sort(removed.begin(), removed.end(),
+              [](const MidiDeviceInfo& a, const MidiDeviceInfo& b) { return a.deviceId < b.deviceId; });
+    return removed;
+}
+
+void DeviceRegistry::replaceAll(const std::vector<MidiDeviceInfo>& devices,
+                                std::vector<MidiDeviceInfo>* added,
+                                std::vector<MidiDeviceInfo>* removed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_map<int, MidiDeviceInfo> next;
+    next.reserve(devices.size());
+    for (const auto& device : devices) {
+        next[device.deviceId] = device;
+        if (added && byId_.find(device.deviceId) == byId_.end()) {
+            added->push_back(device);
+        }
+    }
+    if (removed) {
+        for (const auto& entry : byId_) {
+            if (next.find(entry.first) == next.end()) {
+                removed->push_back(entry.second);
+            }
+        }
+    }
+    byId_.swap(next);
+    byName_.clear();
+    for (const auto& entry : byId_) {
+        indexNameLocked(entry.second);
+    }
+}
+
+MidiDeviceInfo DeviceRegistry::find(int deviceId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byId_.find(deviceId);
+    return it != byId_.end() ? it->second : notFound();
+}
+
+MidiDeviceInfo DeviceRegistry::findByName(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byName_.find(normalizeName(name));
+    if (it == byName_.end()) {
+        return notFound();
+    }
+    return byId_.at(it->second);
+}
+
+MidiDeviceInfo DeviceRegistry::findFirst(const std::function<bool(const MidiDeviceInfo&)>& predicate) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const MidiDeviceInfo* best = nullptr;
+    for (const auto& entry : byId_) {
+        if ((!best || entry.first < best->deviceId) && predicate(entry.second)) {
+            best = &entry.second;
+        }
+    }
+    return best ? *best : notFound();
+}
+
+std::vector<MidiDeviceInfo> DeviceRegistry::snapshot() const {
+    std::vector<MidiDeviceInfo> devices;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        devices.reserve(byId_.size());
+        for (const auto& entry : byId_) {
+            devices.push_back(entry.second);
+        }
+    }
+    std::sort(devices.begin(), devices.end(),
+              [](const MidiDeviceInfo& a, const MidiDeviceInfo& b) { return a.deviceId < b.deviceId; });
+    return devices;
+}
+
+size_t DeviceRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return byId_.size();
+}
+
+bool DeviceRegistry::empty() const {
+    return size() == 0;
+}
+
+void DeviceRegistry::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    byId_.clear();
+    byName_.clear();
+}
@@ -0,0 +1,503 @@
+#include "../include/DirectWavWriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define DIRECT_WAV_WRITER_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief [AI GENERATED] pwrite() until the whole range is written, counting short writes.
+ */
+bool pwriteAll(int fd, const uint8_t* data, size_t length, uint64_t offset, uint64_t& shortWrites) {
+    while (length > 0) {
+        const ssize_t n = pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (static_cast<size_t>(n) < length) {
+            shortWrites++;
+        }
+        data += n;
+        length -= n;
+        offset += n;
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief [AI GENERATED] One aligned write buffer and the request it is part of.
+ */
+struct DirectWavWriter::Buffer {
+    uint8_t* data = nullptr;
+    size_t index = 0;
+    size_t used = 0;      // Bytes of audio filled in
+    size_t length = 0;    // Bytes submitted, padded to the alignment
+    uint64_t offset = 0;  // File offset of data[0]
+    std::chrono::steady_clock::time_point submitted;
+};
+
+/**
+ * @brief [AI GENERATED] Minimal io_uring submission and completion queue driven by raw system calls.
+ */
+class DirectWavWriter::Ring {
+public:
+    ~Ring() {
+#ifdef DIRECT_WAV_WRITER_IO_URING
+        if (sqes_ != MAP_FAILED) {
+            munmap(sqes_, sqesSize_);
+        }
+        if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+            munmap(cqRing_, cqRingSize_);
+        }
+        if (sqRing_ != MAP_FAILED) {
+            munmap(sqRing_, sqRingSize_);
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+#endif
+    }
+
+    bool init(unsigned entries) {
+#ifdef DIRECT_WAV_WRITER_IO_URING
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        // IORING_OP_WRITE arrived in 5.6 together with RW_CUR_POS
+        if (fd_ < 0 || !(params.features & IORING_FEAT_RW_CUR_POS)) {
+            return false;
+        }
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap) {
+            sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+        }
+        sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                       IORING_OFF_SQ_RING);
+        if (sqRing_ == MAP_FAILED) {
+            return false;
+        }
+        cqRing_ = singleMmap ? sqRing_
+                             : mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                                    IORING_OFF_CQ_RING);
+        sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                          IORING_OFF_SQES);
+        if (cqRing_ == MAP_FAILED || sqes == MAP_FAILED) {
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sqRing_);
+        sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(cqRing_);
+        cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+#else
+        (void)entries;
+        return false;
+#endif
+    }
+
+    bool submitWrite(int fd, const uint8_t* data, size_t length, uint64_t offset, uint64_t tag) {
+#ifdef DIRECT_WAV_WRITER_IO_URING
+        // Only this thread touches the SQ tail, so a plain read is enough
+        const unsigned tail = *sqTail_;
+        const unsigned index = tail & sqMask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(data);
+        sqe.len = static_cast<uint32_t>(length);
+        sqe.off = offset;
+        sqe.user_data = tag;
+        sqArray_[index] = index;
+        __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+
+        long submitted;
+        do {
+            submitted = syscall(__NR_io_uring_enter, fd_, 1, 0, 0, nullptr, 0);
+        } while (submitted < 0 && errno == EINTR);
+        return submitted == 1;
+#else
+        (void)fd, (void)data, (void)length, (void)offset, (void)tag;
+        return false;
+#endif
+    }
+
+    bool wait(uint64_t& tag, int64_t& result) {
+#ifdef DIRECT_WAV_WRITER_IO_URING
+        while (true) {
+            const unsigned head = *cqHead_;
+            if (head != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+                const io_uring_cqe& cqe = cqes_[head & cqMask_];
+                tag = cqe.user_data;
+                result = cqe.res;
+                __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+            if (syscall(__NR_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+                return false;
+            }
+        }
+#else
+        (void)tag, (void)result;
+        return false;
+#endif
+    }
+
+private:
+#ifdef DIRECT_WAV_WRITER_IO_URING
+    int fd_ = -1;
+    void* sqRing_ = MAP_FAILED;
+    void* cqRing_ = MAP_FAILED;
+    size_t sqRingSize_ = 0;
+    size_t cqRingSize_ = 0;
+    io_uring_sqe* sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize_ = 0;
+    unsigned* sqTail_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned* sqArray_ = nullptr;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+#endif
+};
+
+double DirectWriterStats::averageLatencySeconds() const {
+    return writes ? totalLatencySeconds / writes : 0.0;
+}
+
+double DirectWriterStats::throughput() const {
+    return elapsedSeconds > 0.0 ? bytesWritten / elapsedSeconds : 0.0;
+}
+
+DirectWavWriter::DirectWavWriter() = default;
+
+DirectWavWriter::~DirectWavWriter() {
+    if (isOpen()) {
+        finalize();
+    }
+    release();
+}
+
+void DirectWavWriter::release() {
+    // The kernel may still be reading from buffers of an abandoned stream
+    while (inFlight_ > 0 && reapOne()) {
+    }
+    inFlight_ = 0;
+    ring_.reset();
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    for (auto& buffer : buffers_) {
+        std::free(buffer.data);
+    }
+    buffers_.clear();
+    freeBuffers_.clear();
+    std::free(firstBlock_);
+    firstBlock_ = nullptr;
+    current_ = nullptr;
+}
+
+bool DirectWavWriter::open(const std::string& file, const WavFormat& format, uint64_t frames,
+                           const DirectWriterSettings& settings, bool dither) {
+    if (isOpen()) {
+        finalize();
+    }
+    if (format.channels < 1 || format.sampleRate < 1) {
+        return false;
+    }
+
+    format_ = frames ? format.resolveRf64(frames) : format;
+    settings_ = settings;
+    settings_.queueDepth = std::max(1u, settings.queueDepth);
+    settings_.bufferBytes = alignUp(std::max(settings.bufferBytes, kAlignment), kAlignment);
+    stats_ = DirectWriterStats();
+    openTime_ = std::chrono::steady_clock::now();
+
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+    if (settings_.directIo) {
+        fd_ = ::open(file.c_str(), flags | O_DIRECT, 0644);
+        stats_.directIo = fd_ >= 0;
+    }
+#endif
+    if (fd_ < 0) {
+        // tmpfs and some network filesystems refuse O_DIRECT
+        fd_ = ::open(file.c_str(), flags, 0644);
+    }
+    if (fd_ < 0) {
+        return false;
+    }
+
+    buffers_.resize(settings_.queueDepth);
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+        buffers_[i].index = i;
+        buffers_[i].data = static_cast<uint8_t*>(std::aligned_alloc(kAlignment, settings_.bufferBytes));
+        if (!buffers_[i].data) {
+            release();
+            return false;
+        }
+        freeBuffers_.push_back(buffers_.size() - 1 - i);
+    }
+    firstBlock_ = static_cast<uint8_t*>(std::aligned_alloc(kAlignment, kAlignment));
+    if (!firstBlock_) {
+        release();
+        return false;
+    }
+
+    if (settings_.useIoUring) {
+        ring_ = std::make_unique<Ring>();
+        if (!ring_->init(settings_.queueDepth)) {
+            ring_.reset(); // No io_uring here; pwrite() below
+        }
+    }
+    stats_.backend = ring_ ? IoBackend::IoUring : IoBackend::Pwrite;
+
+    failed_ = false;
+    firstBlockSaved_ = false;
+    fileOffset_ = 0;
+    inFlight_ = 0;
+    samplesWritten_ = 0;
+    droppedBytes_ = 0;
+    dither_ = dither && !format_.isFloat();
+    pcm_.resize(kConvertBlockSamples * format_.bytesPerSample());
+    noise_.resize(dither_ ? kConvertBlockSamples : 0);
+
+    current_ = &buffers_[freeBuffers_.back()];
+    freeBuffers_.pop_back();
+    current_->offset = 0;
+    current_->used = 0;
+
+    const auto header = WavHeader::build(format_, WavHeader::kUnknownSize);
+    return appendBytes(header.data(), header.size());
+}
+
+bool DirectWavWriter::appendBytes(const uint8_t* data, size_t size) {
+    while (size > 0) {
+        const size_t n = std::min(settings_.bufferBytes - current_->used, size);
+        std::memcpy(current_->data + current_->used, data, n);
+        current_->used += n;
+        data += n;
+        size -= n;
+        if (current_->used == settings_.bufferBytes && !submitCurrent()) {
+            return false;
+        }
+    }
+    return !failed_;
+}
+
+bool DirectWavWriter::submitCurrent() {
+    Buffer& buffer = *current_;
+    if (buffer.offset == 0) {
+        // Keep the block holding the header so finalize() can patch it without a read
+        std::memcpy(firstBlock_, buffer.data, kAlignment);
+        firstBlockSaved_ = true;
+    }
+    buffer.length = buffer.used;
+    fileOffset_ += buffer.used;
+    submit(buffer);
+
+    while (freeBuffers_.empty()) {
+        stats_.queueFullWaits++;
+        if (!reapOne()) {
+            failed_ = true;
+            return false;
+        }
+    }
+    current_ = &buffers_[freeBuffers_.back()];
+    freeBuffers_.pop_back();
+    current_->offset = fileOffset_;
+    current_->used = 0;
+    return !failed_;
+}
+
+bool DirectWavWriter::submit(Buffer& buffer) {
+    buffer.submitted = std::chrono::steady_clock::now();
+    if (ring_ && ring_->submitWrite(fd_, buffer.data, buffer.length, buffer.offset, buffer.index)) {
+        inFlight_++;
+        stats_.maxInFlight = std::max(stats_.maxInFlight, inFlight_);
+        return true;
+    }
+    if (ring_) {
+        failed_ = true;
+        freeBuffers_.push_back(buffer.index);
+        return false;
+    }
+
+    uint64_t shortWrites = 0;
+    const bool ok = pwriteAll(fd_, buffer.data, buffer.length, buffer.offset, shortWrites);
+    stats_.shortWrites += shortWrites;
+    stats_.maxInFlight = std::max(stats_.maxInFlight, 1u);
+    completed(buffer, ok ? static_cast<int64_t>(buffer.length) : -1);
+    return ok;
+}
+
+bool DirectWavWriter::reapOne() {
+    uint64_t tag = 0;
+    int64_t result = 0;
+    if (!ring_ || inFlight_ == 0 || !ring_->wait(tag, result) || tag >= buffers_.size()) {
+        return false;
+    }
+    inFlight_--;
+    completed(buffers_[tag], result);
+    return true;
+}
+
+void DirectWavWriter::completed(Buffer& buffer, int64_t result) {
+    const double latency = secondsSince(buffer.submitted);
+    if (result < 0) {
+        failed_ = true;
+    } else if (static_cast<size_t>(result) < buffer.length) {
+        // Rare for regular files, but finish the request synchronously
+        stats_.shortWrites++;
+        failed_ = !pwriteAll(fd_, buffer.data + result, buffer.length - result, buffer.offset + result,
+                             stats_.shortWrites) ||
+                  failed_;
+    }
+    if (!failed_) {
+        stats_.writes++;
+        stats_.bytesWritten += buffer.length;
+        stats_.totalLatencySeconds += latency;
+        stats_.maxLatencySeconds = std::max(stats_.maxLatencySeconds, latency);
+        if (!stats_.directIo) {
+            dropCache(buffer.offset, buffer.length);
+        }
+    }
+    freeBuffers_.push_back(buffer.index);
+}
+
+void DirectWavWriter::dropCache(uint64_t offset, uint64_t length) {
+#ifdef SYNC_FILE_RANGE_WRITE
+    // Start writeback of this range, then wait for and evict everything before it
+    sync_file_range(fd_, static_cast<off_t>(offset), static_cast<off_t>(length), SYNC_FILE_RANGE_WRITE);
+    if (offset > droppedBytes_) {
+        sync_file_range(fd_, static_cast<off_t>(droppedBytes_), static_cast<off_t>(offset - droppedBytes_),
+                        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        posix_fadvise(fd_, static_cast<off_t>(droppedBytes_), static_cast<off_t>(offset - droppedBytes_),
+                      POSIX_FADV_DONTNEED);
+        droppedBytes_ = offset;
+    }
+#else
+    posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+#endif
+}
+
+bool DirectWavWriter::append(const double* samples, size_t frames) {
+    if (!isOpen() || failed_) {
+        return false;
+    }
+
+    const size_t count = frames * format_.channels;
+    const size_t bytesPerSample = format_.bytesPerSample();
+    for (size_t offset = 0; offset < count; offset += kConvertBlockSamples) {
+        const size_t n = std::min(kConvertBlockSamples, count - offset);
+        if (dither_) {
+            ditherSource_.fill(noise_.data(), n);
+        }
+        PcmConverter::convert(format_.sampleFormat, samples + offset, pcm_.data(), n,
+                              dither_ ? noise_.data() : nullptr);
+        if (!appendBytes(pcm_.data(), n * bytesPerSample)) {
+            return false;
+        }
+        samplesWritten_ += n;
+    }
+    return true;
+}
+
+bool DirectWavWriter::finalize() {
+    if (!isOpen()) {
+        return false;
+    }
+
+    const uint64_t dataSize = samplesWritten_ * format_.bytesPerSample();
+    if (dataSize & 1) {
+        // RIFF chunks are word aligned; odd 24-bit payloads need a pad byte
+        const uint8_t pad = 0;
+        appendBytes(&pad, 1);
+    }
+    const uint64_t fileSize = fileOffset_ + current_->used;
+    const auto header = WavHeader::build(format_, dataSize);
+    bool ok = !header.empty();
+
+    // The final buffer goes out zero-padded to the alignment and is cut back by ftruncate
+    if (ok && current_->offset == 0) {
+        std::memcpy(current_->data, header.data(), header.size());
+    }
+    if (current_->used > 0 && !failed_) {
+        current_->length = alignUp(current_->used, kAlignment);
+        std::memset(current_->data + current_->used, 0, current_->length - current_->used);
+        submit(*current_);
+    }
+    while (inFlight_ > 0) {
+        if (!reapOne()) {
+            failed_ = true;
+            break;
+        }
+    }
+
+    if (ok && firstBlockSaved_ && !failed_) {
+        std::memcpy(firstBlock_, header.data(), header.size());
+        uint64_t shortWrites = 0;
+        ok = pwriteAll(fd_, firstBlock_, kAlignment, 0, shortWrites);
+    }
+    ok = ftruncate(fd_, static_cast<off_t>(fileSize)) == 0 && ok;
+    if (!stats_.directIo) {
+        dropCache(fileSize, 0);
+    }
+    ok = close(fd_) == 0 && ok && !failed_;
+    fd_ = -1;
+    stats_.elapsedSeconds = secondsSince(openTime_);
+    release();
+    return ok;
+}
+
+int DirectWavWriter::channels() const {
+    return format_.channels;
+}
+
+bool DirectWavWriter::isOpen() const {
+    return fd_ >= 0;
+}
+
+uint64_t DirectWavWriter::framesWritten() const {
+    return samplesWritten_ / format_.channels;
+}
+
+DirectWriterStats DirectWavWriter::stats() const {
+    return stats_;
+}
@@ -0,0 +1,407 @@
+#include "../include/FlacDecoder.h"
+#include "../include/Md5.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+/**
+ * @brief [AI GENERATED] MSB-first bit reader that flags reads past the end instead of faulting.
+ */
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    uint64_t read(int bits) {
+        uint64_t value = 0;
+        while (bits > 0) {
+            const size_t byte = pos_ >> 3;
+            if (byte >= size_) {
+                overrun_ = true;
+                return 0;
+            }
+            const int available = 8 - static_cast<int>(pos_ & 7);
+            const int take = bits < available ? bits : available;
+            const uint32_t chunk = (data_[byte] >> (available - take)) & ((1u << take) - 1);
+            value = (value << take) | chunk;
+            pos_ += take;
+            bits -= take;
+        }
+        return value;
+    }
+
+    int64_t readSigned(int bits) {
+        if (bits == 0) {
+            return 0;
+        }
+        const uint64_t value = read(bits);
+        const uint64_t sign = 1ull << (bits - 1);
+        return static_cast<int64_t>((value ^ sign) - sign);
+    }
+
+    uint32_t readUnary() {
+        uint32_t zeros = 0;
+        while (!overrun_) {
+            const size_t byte = pos_ >> 3;
+            if (byte >= size_) {
+                overrun_ = true;
+                break;
+            }
+            const int offset = static_cast<int>(pos_ & 7);
+            const uint8_t rest = static_cast<uint8_t>(data_[byte] << offset);
+            if (rest == 0) {
+                zeros += 8 - offset;
+                pos_ += 8 - offset;
+                continue;
+            }
+            int lead = 0;
+            while (!(rest & (0x80 >> lead))) {
+                ++lead;
+            }
+            zeros += lead;
+            pos_ += lead + 1;
+            break;
+        }
+        return zeros;
+    }
+
+    void align() {
+        pos_ = (pos_ + 7) & ~static_cast<size_t>(7);
+    }
+
+    size_t bytePosition() const {
+        return pos_ >> 3;
+    }
+
+    bool overrun() const {
+        return overrun_;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    bool overrun_ = false;
+};
+
+bool decodeResidual(BitReader& bits, unsigned n, int order, int64_t* out) {
+    const uint32_t method = static_cast<uint32_t>(bits.read(2));
+    if (method > 1) {
+        return false;
+    }
+    const int paramBits = method == 0 ? 4 : 5;
+    const uint32_t escape = (1u << paramBits) - 1;
+    const int partitionOrder = static_cast<int>(bits.read(4));
+    const unsigned partitions = 1u << partitionOrder;
+    const unsigned size = n >> partitionOrder;
+    if ((n & (partitions - 1)) != 0 || size < static_cast<unsigned>(order)) {
+        return false;
+    }
+
+    for (unsigned p = 0; p < partitions && !bits.overrun(); ++p) {
+        const uint32_t k = static_cast<uint32_t>(bits.read(paramBits));
+        const unsigned count = p == 0 ? size - order : size;
+        if (k == escape) {
+            const int raw = static_cast<int>(bits.read(5));
+            for (unsigned i = 0; i < count; ++i) {
+                *out++ = bits.readSigned(raw);
+            }
+            continue;
+        }
+        for (unsigned i = 0; i < count; ++i) {
+            const uint64_t folded = (static_cast<uint64_t>(bits.readUnary()) << k) | bits.read(k);
+            *out++ = static_cast<int64_t>(folded >> 1) ^ -static_cast<int64_t>(folded & 1);
+        }
+    }
+    return !bits.overrun();
+}
+
+bool decodeSubframe(BitReader& bits, unsigned n, int bps, int64_t* out, FlacDecodeStats& stats) {
+    if (bits.read(1) != 0) {
+        return false;
+    }
+    const uint32_t type = static_cast<uint32_t>(bits.read(6));
+    int wasted = 0;
+    if (bits.read(1)) {
+        wasted = static_cast<int>(bits.readUnary()) + 1;
+    }
+    bps -= wasted;
+    if (bps <= 0) {
+        return false;
+    }
+
+    if (type == 0) {
+        const int64_t value = bits.readSigned(bps);
+        std::fill(out, out + n, value);
+        ++stats.constantSubframes;
+    } else if (type == 1) {
+        for (unsigned i = 0; i < n; ++i) {
+            out[i] = bits.readSigned(bps);
+        }
+        ++stats.verbatimSubframes;
+    } else if (type >= 8 && type <= 12) {
+        const int order = static_cast<int>(type - 8);
+        if (static_cast<unsigned>(order) > n) {
+            return false;
+        }
+        for (int i = 0; i < order; ++i) {
+            out[i] = bits.readSigned(bps);
+        }
+        if (!decodeResidual(bits, n, order, out + order)) {
+            return false;
+        }
+        for (unsigned i = order; i < n; ++i) {
+            switch (order) {
+                case 1: out[i] += out[i - 1]; break;
+                case 2: out[i] += 2 * out[i - 1] - out[i - 2]; break;
+                case 3: out[i] += 3 * out[i - 1] - 3 * out[i - 2] + out[i - 3]; break;
+                case 4: out[i] += 4 * out[i - 1] - 6 * out[i - 2] + 4 * out[i - 3] - out[i - 4]; break;
+                default: break;
+            }
+        }
+        ++stats.fixedSubframes;
+    } else if (type >= 32) {
+        const int order = static_cast<int>(type - 31);
+        if (static_cast<unsigned>(order) > n) {
+            return false;
+        }
+        for (int i = 0; i < order; ++i) {
+            out[i] = bits.readSigned(bps);
+        }
+        const int precision = static_cast<int>(bits.read(4)) + 1;
+        const int shift = static_cast<int>(bits.readSigned(5));
+        if (precision == 16 || shift < 0) {
+            return false;
+        }
+        int64_t coefs[32];
+        for (int i = 0; i < order; ++i) {
+            coefs[i] = bits.readSigned(precision);
+        }
+        if (!decodeResidual(bits, n, order, out + order)) {
+            return false;
+        }
+        for (unsigned i = order; i < n; ++i) {
+            int64_t sum = 0;
+            for (int j = 0; j < order; ++j) {
+                sum += coefs[j] * out[i - j - 1];
+            }
+            out[i] += sum >> shift;
+        }
+        ++stats.lpcSubframes;
+    } else {
+        return false;
+    }
+
+    if (wasted > 0) {
+        for (unsigned i = 0; i < n; ++i) {
+            out[i] *= int64_t(1) << wasted;
+        }
+    }
+    return !bits.overrun();
+}
+
+} // namespace
+
+bool FlacDecoder::fail(const std::string& message) {
+    error_ = message;
+    return false;
+}
+
+bool FlacDecoder::decode(const std::string& file) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        return fail("Cannot open " + file);
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return decode(data.data(), data.size());
+}
+
+bool FlacDecoder::decode(const uint8_t* data, size_t size) {
+    info_ = FlacStreamInfo();
+    stats_ = FlacDecodeStats();
+    samples_.clear();
+    error_.clear();
+
+    if (size < 4 || std::memcmp(data, "fLaC", 4) != 0) {
+        return fail("Missing fLaC stream marker");
+    }
+
+    size_t offset = 4;
+    bool haveInfo = false;
+    for (bool last = false; !last;) {
+        if (offset + 4 > size) {
+            return fail("Truncated metadata block header");
+        }
+        last = (data[offset] & 0x80) != 0;
+        const int type = data[offset] & 0x7F;
+        const size_t length = (data[offset + 1] << 16) | (data[offset + 2] << 8) | data[offset + 3];
+        offset += 4;
+        if (offset + length > size || type == 127) {
+            return fail("Invalid metadata block");
+        }
+        if (type == 0) {
+            if (length < FlacStreamInfo::kSize) {
+                return fail("Short STREAMINFO block");
+            }
+            info_ = FlacStreamInfo::parse(data + offset);
+            haveInfo = true;
+        }
+        offset += length;
+    }
+    if (!haveInfo) {
+        return fail("Missing STREAMINFO block");
+    }
+
+    samples_.reserve(info_.totalFrames * info_.channels);
+    while (offset < size) {
+        if (!decodeFrame(data, size, offset)) {
+            return false;
+        }
+    }
+
+    if (info_.totalFrames != 0 && samples_.size() != info_.totalFrames * info_.channels) {
+        return fail("Decoded sample count does not match STREAMINFO");
+    }
+
+    static const uint8_t kNoMd5[16] = {};
+    if (std::memcmp(info_.md5, kNoMd5, sizeof(kNoMd5)) != 0) {
+        const int bytes = (info_.bitsPerSample + 7) / 8;
+        Md5 md5;
+        uint8_t buffer[4 * 1024];
+        size_t used = 0;
+        for (int32_t sample : samples_) {
+            for (int b = 0; b < bytes; ++b) {
+                buffer[used++] = static_cast<uint8_t>(static_cast<uint32_t>(sample) >> (8 * b));
+            }
+            if (used + 4 > sizeof(buffer)) {
+                md5.update(buffer, used);
+                used = 0;
+            }
+        }
+        md5.update(buffer, used);
+        uint8_t digest[16];
+        md5.finish(digest);
+        if (std::memcmp(digest, info_.md5, sizeof(digest)) != 0) {
+            return fail("MD5 signature mismatch");
+        }
+    }
+    return true;
+}
+
+bool FlacDecoder::decodeFrame(const uint8_t* data, size_t size, size_t& offset) {
+    const uint8_t* frame = data + offset;
+    BitReader bits(frame, size - offset);
+
+    if (bits.read(15) != 0x7FFC) {
+        return fail("Lost frame sync");
+    }
+    bits.read(1); // Blocking strategy; the frame header is self-describing either way
+    const int blockCode = static_cast<int>(bits.read(4));
+    const int rateCode = static_cast<int>(bits.read(4));
+    const int assignment = static_cast<int>(bits.read(4));
+    const int sizeCode = static_cast<int>(bits.read(3));
+    if (bits.read(1) != 0 || blockCode == 0 || rateCode == 15 || assignment > 10 || sizeCode == 3) {
+        return fail("Invalid frame header");
+    }
+
+    // UTF-8 style coded frame or sample number
+    const uint32_t lead = static_cast<uint32_t>(bits.read(8));
+    int extra = 0;
+    while (extra < 7 && (lead & (0x80 >> extra))) {
+        ++extra;
+    }
+    if (extra == 1 || (extra == 7 && lead != 0xFE)) {
+        return fail("Invalid coded frame number");
+    }
+    for (int i = 1; i < extra; ++i) {
+        if ((bits.read(8) & 0xC0) != 0x80) {
+            return fail("Invalid coded frame number");
+        }
+    }
+
+    unsigned n;
+    if (blockCode == 1) {
+        n = 192;
+    } else if (blockCode <= 5) {
+        n = 576u << (blockCode - 2);
+    } else if (blockCode == 6) {
+        n = static_cast<unsigned>(bits.read(8)) + 1;
+    } else if (blockCode == 7) {
+        n = static_cast<unsigned>(bits.read(16)) + 1;
+    } else {
+        n = 256u << (blockCode - 8);
+    }
+    if (rateCode == 12 || rateCode == 13 || rateCode == 14) {
+        bits.read(rateCode == 12 ? 8 : 16);
+    }
+
+    const size_t headerSize = bits.bytePosition();
+    const uint8_t crc8 = static_cast<uint8_t>(bits.read(8));
+    if (bits.overrun() || crc8 != FlacCrc::crc8(frame, headerSize)) {
+        return fail("Frame header CRC mismatch");
+    }
+
+    const int bps = sizeCode == 0 ? static_cast<int>(info_.bitsPerSample) : kFlacSampleSizes[sizeCode];
+    const unsigned channels = assignment < 8 ? assignment + 1 : 2;
+    if (channels != info_.channels || bps == 0) {
+        return fail("Frame layout does not match STREAMINFO");
+    }
+
+    for (unsigned c = 0; c < channels; ++c) {
+        const bool side = (assignment == 8 || assignment == 10) ? c == 1 : (assignment == 9 && c == 0);
+        channels_[c].resize(n);
+        if (!decodeSubframe(bits, n, bps + (side ? 1 : 0), channels_[c].data(), stats_)) {
+            return fail("Corrupt subframe");
+        }
+    }
+
+    bits.align();
+    const size_t frameSize = bits.bytePosition();
+    const uint16_t crc16 = static_cast<uint16_t>(bits.read(16));
+    if (bits.overrun() || crc16 != FlacCrc::crc16(frame, frameSize)) {
+        return fail("Frame CRC mismatch");
+    }
+
+    int64_t* a = channels_[0].data();
+    int64_t* b = channels_[1 % channels].data();
+    for (unsigned i = 0; i < n; ++i) {
+        switch (assignment) {
+            case 8: b[i] = a[i] - b[i]; break;              // left, side
+            case 9: a[i] += b[i]; break;                    // side, right
+            case 10: {                                      // mid, side
+                const int64_t mid = a[i] * 2 + (b[i] & 1);
+                a[i] = (mid + b[i]) >> 1;
+                b[i] = (mid - b[i]) >> 1;
+                break;
+            }
+            default: break;
+        }
+    }
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned c = 0; c < channels; ++c) {
+            samples_.push_back(static_cast<int32_t>(channels_[c][i]));
+        }
+    }
+
+    ++stats_.frames;
+    offset += frameSize + 2;
+    return true;
+}
+
+const FlacStreamInfo& FlacDecoder::info() const {
+    return info_;
+}
+
+const FlacDecodeStats& FlacDecoder::stats() const {
+    return stats_;
+}
+
+const std::vector<int32_t>& FlacDecoder::samples() const {
+    return samples_;
+}
+
+const std::string& FlacDecoder::error() const {
+    return error_;
+}
@@ -0,0 +1,94 @@
+#include "../include/FlacFormat.h"
+
+namespace {
+
+struct CrcTables {
+    uint8_t crc8[256];
+    uint16_t crc16[256];
+
+    CrcTables() {
+        for (int i = 0; i < 256; ++i) {
+            uint8_t c8 = static_cast<uint8_t>(i);
+            uint16_t c16 = static_cast<uint16_t>(i << 8);
+            for (int bit = 0; bit < 8; ++bit) {
+                c8 = static_cast<uint8_t>((c8 & 0x80) ? (c8 << 1) ^ 0x07 : c8 << 1);
+                c16 = static_cast<uint16_t>((c16 & 0x8000) ? (c16 << 1) ^ 0x8005 : c16 << 1);
+            }
+            crc8[i] = c8;
+            crc16[i] = c16;
+        }
+    }
+};
+
+const CrcTables& tables() {
+    static const CrcTables instance;
+    return instance;
+}
+
+void putBE(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint64_t getBE(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+} // namespace
+
+std::vector<uint8_t> FlacStreamInfo::serialize() const {
+    std::vector<uint8_t> out;
+    out.reserve(kSize);
+    putBE(out, minBlockSize, 2);
+    putBE(out, maxBlockSize, 2);
+    putBE(out, minFrameSize, 3);
+    putBE(out, maxFrameSize, 3);
+    // 20 bits rate, 3 bits channels - 1, 5 bits bps - 1, 36 bits total samples
+    const uint64_t packed = (static_cast<uint64_t>(sampleRate & 0xFFFFF) << 44) |
+                            (static_cast<uint64_t>((channels - 1) & 0x7) << 41) |
+                            (static_cast<uint64_t>((bitsPerSample - 1) & 0x1F) << 36) |
+                            (totalFrames & 0xFFFFFFFFFull);
+    putBE(out, packed, 8);
+    out.insert(out.end(), md5, md5 + 16);
+    return out;
+}
+
+FlacStreamInfo FlacStreamInfo::parse(const uint8_t* body) {
+    FlacStreamInfo info;
+    info.minBlockSize = static_cast<uint32_t>(getBE(body, 2));
+    info.maxBlockSize = static_cast<uint32_t>(getBE(body + 2, 2));
+    info.minFrameSize = static_cast<uint32_t>(getBE(body + 4, 3));
+    info.maxFrameSize = static_cast<uint32_t>(getBE(body + 7, 3));
+    const uint64_t packed = getBE(body + 10, 8);
+    info.sampleRate = static_cast<uint32_t>(packed >> 44);
+    info.channels = static_cast<uint32_t>((packed >> 41) & 0x7) + 1;
+    info.bitsPerSample = static_cast<uint32_t>((packed >> 36) & 0x1F) + 1;
+    info.totalFrames = packed & 0xFFFFFFFFFull;
+    for (int i = 0; i < 16; ++i) {
+        info.md5[i] = body[18 + i];
+    }
+    return info;
+}
+
+uint8_t FlacCrc::crc8(const uint8_t* data, size_t size) {
+    const auto& t = tables();
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc = t.crc8[crc ^ data[i]];
+    }
+    return crc;
+}
+
+uint16_t FlacCrc::crc16(const uint8_t* data, size_t size) {
+    const auto& t = tables();
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc = static_cast<uint16_t>((crc << 8) ^ t.crc16[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
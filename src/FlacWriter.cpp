@@ -0,0 +1,825 @@
+#include "../include/FlacWriter.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+
+namespace {
+
+constexpr int kMaxLpcOrder = 32;
+constexpr int kMaxFixedOrder = 4;
+constexpr int kMaxPartitionOrder = 8;
+constexpr int kMaxRiceParam = 30;
+constexpr int kMaxRice4Param = 14; // 15 is the escape code of 4-bit parameters
+
+/**
+ * @brief [AI GENERATED] MSB-first bit packer appending to a byte vector.
+ */
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put(uint32_t value, int bits) {
+        if (bits == 0) {
+            return;
+        }
+        const uint64_t mask = (1ull << bits) - 1;
+        acc_ = (acc_ << bits) | (value & mask);
+        count_ += bits;
+        while (count_ >= 8) {
+            count_ -= 8;
+            out_.push_back(static_cast<uint8_t>(acc_ >> count_));
+        }
+    }
+
+    void putSigned(int32_t value, int bits) {
+        put(static_cast<uint32_t>(value), bits);
+    }
+
+    void putRice(uint32_t folded, int k) {
+        uint32_t q = folded >> k;
+        while (q >= 31) {
+            put(0, 31);
+            q -= 31;
+        }
+        put(1, static_cast<int>(q) + 1);
+        put(folded, k);
+    }
+
+    void align() {
+        if (count_ > 0) {
+            put(0, 8 - count_);
+        }
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_ = 0;
+    int count_ = 0;
+};
+
+inline uint32_t fold(int32_t r) {
+    return (static_cast<uint32_t>(r) << 1) ^ static_cast<uint32_t>(r >> 31);
+}
+
+void putUtf8(std::vector<uint8_t>& out, uint64_t value) {
+    if (value < 0x80) {
+        out.push_back(static_cast<uint8_t>(value));
+        return;
+    }
+    int bytes = 2;
+    while (bytes < 7 && value >= (1ull << (5 * bytes + 1))) {
+        ++bytes;
+    }
+    out.push_back(static_cast<uint8_t>(((0xFF00u >> bytes) & 0xFF) | (value >> (6 * (bytes - 1)))));
+    for (int i = bytes - 2; i >= 0; --i) {
+        out.push_back(static_cast<uint8_t>(0x80 | ((value >> (6 * i)) & 0x3F)));
+    }
+}
+
+/**
+ * @brief [AI GENERATED] Coefficient precision libFLAC uses for a block size and sample depth.
+ */
+int defaultPrecision(unsigned blockSize, int bps) {
+    if (bps < 16) {
+        return std::max(5, 2 + bps / 2);
+    }
+    if (bps > 16) {
+        return blockSize <= 384 ? 13 : 15;
+    }
+    static const unsigned kLimits[] = {192, 384, 576, 1152, 2304, 4608};
+    int precision = 7;
+    for (unsigned limit : kLimits) {
+        if (blockSize <= limit) {
+            return precision;
+        }
+        ++precision;
+    }
+    return 13;
+}
+
+} // namespace
+
+/**
+ * @brief [AI GENERATED] Predictor and entropy coder choice for one subframe.
+ */
+struct SubframePlan {
+    enum class Type { Constant, Verbatim, Fixed, Lpc };
+
+    Type type = Type::Verbatim;
+    const int32_t* samples = nullptr; // After removing wasted bits
+    int bps = 0;
+    int wastedBits = 0;
+    int order = 0;
+    int precision = 0;
+    int shift = 0;
+    int32_t coefs[kMaxLpcOrder] = {};
+    int partitionOrder = 0;
+    bool rice5 = false;
+    uint8_t params[1 << kMaxPartitionOrder] = {};
+    std::vector<int32_t> residual;
+    std::vector<int32_t> shifted;
+    uint64_t bits = 0;
+};
+
+/**
+ * @brief [AI GENERATED] Encodes single FLAC frames; one instance per worker thread owns all scratch memory.
+ */
+class FlacFrameEncoder {
+public:
+    FlacFrameEncoder(const WavFormat& format, const FlacSettings& settings)
+        : format_(format), settings_(settings), bps_(format.bytesPerSample() * 8) {
+        for (auto& buffer : channels_) {
+            buffer.resize(settings.blockSize);
+        }
+        candidate_.resize(settings.blockSize);
+        windowed_.resize(settings.blockSize);
+    }
+
+    void encode(const int32_t* interleaved, unsigned n, uint64_t frameNumber, std::vector<uint8_t>& out);
+
+private:
+    void analyze(const int32_t* x, unsigned n, int bps, SubframePlan& plan);
+    void tryFixed(unsigned n, SubframePlan& plan);
+    void tryLpc(unsigned n, SubframePlan& plan);
+    uint64_t planResidual(const int32_t* residual, unsigned n, int order, int& partitionOrder, uint8_t* params,
+                          bool& rice5);
+    void write(BitWriter& bits, const SubframePlan& plan, unsigned n) const;
+    const std::vector<double>& window(unsigned n);
+
+    WavFormat format_;
+    FlacSettings settings_;
+    int bps_;
+    std::vector<int32_t> channels_[8 + 2]; // Input channels plus mid and side
+    SubframePlan plans_[8 + 2];
+    std::vector<int32_t> candidate_;
+    std::vector<double> windowed_;
+    std::vector<double> window_;
+    uint64_t sums_[1 << kMaxPartitionOrder];
+};
+
+const std::vector<double>& FlacFrameEncoder::window(unsigned n) {
+    if (window_.size() != n) {
+        // Tukey(0.5), the libFLAC default apodization
+        window_.assign(n, 1.0);
+        const int np = static_cast<int>(0.25 * n) - 1;
+        if (np > 0) {
+            for (int i = 0; i <= np; ++i) {
+                window_[i] = 0.5 - 0.5 * std::cos(M_PI * i / np);
+                window_[n - np - 1 + i] = 0.5 - 0.5 * std::cos(M_PI * (i + np) / np);
+            }
+        }
+    }
+    return window_;
+}
+
+uint64_t FlacFrameEncoder::planResidual(const int32_t* residual, unsigned n, int order, int& partitionOrder,
+                                        uint8_t* params, bool& rice5) {
+    int maxOrder = std::min(settings_.maxPartitionOrder, kMaxPartitionOrder);
+    while (maxOrder > 0 && ((n & ((1u << maxOrder) - 1)) != 0 || (n >> maxOrder) <= static_cast<unsigned>(order))) {
+        --maxOrder;
+    }
+
+    // Folded residual sums per partition at the finest order, merged pairwise for coarser ones
+    const unsigned partitions = 1u << maxOrder;
+    const unsigned partitionSize = n >> maxOrder;
+    for (unsigned p = 0, i = 0; p < partitions; ++p) {
+        const unsigned end = (p + 1) * partitionSize - order;
+        uint64_t sum = 0;
+        for (; i < end; ++i) {
+            sum += fold(residual[i]);
+        }
+        sums_[p] = sum;
+    }
+
+    uint64_t bestBits = ~0ull;
+    uint8_t trial[1 << kMaxPartitionOrder];
+    for (int porder = maxOrder; porder >= 0; --porder) {
+        const unsigned count = 1u << porder;
+        const unsigned size = n >> porder;
+        uint64_t bits = 6;
+        int maxParam = 0;
+        for (unsigned p = 0; p < count; ++p) {
+            const uint64_t samples = p == 0 ? size - order : size;
+            const uint64_t sum = sums_[p];
+            int k = 0;
+            if (samples > 0 && sum > samples) {
+                k = std::min(kMaxRiceParam, static_cast<int>(std::log2(static_cast<double>(sum) / samples)));
+            }
+            // The estimate is rough, so check the neighbouring parameter too
+            uint64_t cost = samples * (k + 1) + (sum >> k);
+            if (k < kMaxRiceParam) {
+                const uint64_t up = samples * (k + 2) + (sum >> (k + 1));
+                if (up < cost) {
+                    cost = up;
+                    ++k;
+                }
+            }
+            trial[p] = static_cast<uint8_t>(k);
+            maxParam = std::max(maxParam, k);
+            bits += cost;
+        }
+        bits += count * (maxParam > kMaxRice4Param ? 5 : 4);
+        if (bits < bestBits) {
+            bestBits = bits;
+            partitionOrder = porder;
+            rice5 = maxParam > kMaxRice4Param;
+            std::copy(trial, trial + count, params);
+        }
+        for (unsigned p = 0; p < count / 2; ++p) {
+            sums_[p] = sums_[2 * p] + sums_[2 * p + 1];
+        }
+    }
+    return bestBits;
+}
+
+void FlacFrameEncoder::tryFixed(unsigned n, SubframePlan& plan) {
+    const int32_t* x = plan.samples;
+    const int maxOrder = std::min<int>(kMaxFixedOrder, n - 1);
+
+    // Pick the order with the smallest absolute residual sum, as libFLAC does
+    uint64_t error[kMaxFixedOrder + 1] = {};
+    for (unsigned i = maxOrder; i < n; ++i) {
+        const int64_t e0 = x[i];
+        const int64_t e1 = e0 - x[i - 1];
+        const int64_t e2 = maxOrder >= 2 ? e1 - (static_cast<int64_t>(x[i - 1]) - x[i - 2]) : 0;
+        const int64_t e3 = maxOrder >= 3 ? e2 - (static_cast<int64_t>(x[i - 1]) - 2 * static_cast<int64_t>(x[i - 2]) + x[i - 3]) : 0;
+        const int64_t e4 = maxOrder >= 4 ? e3 - (static_cast<int64_t>(x[i - 1]) - 3 * static_cast<int64_t>(x[i - 2]) +
+                                                 3 * static_cast<int64_t>(x[i - 3]) - x[i - 4]) : 0;
+        error[0] += std::llabs(e0);
+        error[1] += std::llabs(e1);
+        error[2] += std::llabs(e2);
+        error[3] += std::llabs(e3);
+        error[4] += std::llabs(e4);
+    }
+    int order = 0;
+    for (int o = 1; o <= maxOrder; ++o) {
+        if (error[o] < error[order]) {
+            order = o;
+        }
+    }
+
+    for (unsigned i = order; i < n; ++i) {
+        int64_t prediction = 0;
+        switch (order) {
+            case 1: prediction = x[i - 1]; break;
+            case 2: prediction = 2 * static_cast<int64_t>(x[i - 1]) - x[i - 2]; break;
+            case 3: prediction = 3 * static_cast<int64_t>(x[i - 1]) - 3 * static_cast<int64_t>(x[i - 2]) + x[i - 3]; break;
+            case 4: prediction = 4 * static_cast<int64_t>(x[i - 1]) - 6 * static_cast<int64_t>(x[i - 2]) +
+                                 4 * static_cast<int64_t>(x[i - 3]) - x[i - 4]; break;
+            default: break;
+        }
+        const int64_t r = x[i] - prediction;
+        if (r < INT32_MIN || r > INT32_MAX) {
+            return;
+        }
+        candidate_[i - order] = static_cast<int32_t>(r);
+    }
+
+    int partitionOrder = 0;
+    bool rice5 = false;
+    uint8_t params[1 << kMaxPartitionOrder];
+    const uint64_t bits = 8 + plan.wastedBits + static_cast<uint64_t>(order) * plan.bps +
+                          planResidual(candidate_.data(), n, order, partitionOrder, params, rice5);
+    if (bits < plan.bits) {
+        plan.type = SubframePlan::Type::Fixed;
+        plan.order = order;
+        plan.partitionOrder = partitionOrder;
+        plan.rice5 = rice5;
+        std::copy(params, params + (1 << partitionOrder), plan.params);
+        plan.bits = bits;
+        plan.residual.swap(candidate_);
+        candidate_.resize(plan.residual.size());
+    }
+}
+
+void FlacFrameEncoder::tryLpc(unsigned n, SubframePlan& plan) {
+    const int maxOrder = std::min<int>({settings_.maxLpcOrder, kMaxLpcOrder, static_cast<int>(n) - 1});
+    if (maxOrder < 1 || n < 2u * maxOrder) {
+        return;
+    }
+
+    const int32_t* x = plan.samples;
+    const auto& w = window(n);
+    for (unsigned i = 0; i < n; ++i) {
+        windowed_[i] = x[i] * w[i];
+    }
+    double autoc[kMaxLpcOrder + 1];
+    for (int lag = 0; lag <= maxOrder; ++lag) {
+        double sum = 0.0;
+        for (unsigned i = lag; i < n; ++i) {
+            sum += windowed_[i] * windowed_[i - lag];
+        }
+        autoc[lag] = sum;
+    }
+    if (autoc[0] <= 0.0) {
+        return;
+    }
+
+    // Levinson-Durbin recursion, keeping the coefficients and error of every order
+    double lpc[kMaxLpcOrder];
+    double coefs[kMaxLpcOrder][kMaxLpcOrder];
+    double error[kMaxLpcOrder];
+    double err = autoc[0];
+    int orders = maxOrder;
+    for (int i = 0; i < maxOrder; ++i) {
+        double r = -autoc[i + 1];
+        for (int j = 0; j < i; ++j) {
+            r -= lpc[j] * autoc[i - j];
+        }
+        r /= err;
+        lpc[i] = r;
+        int j = 0;
+        for (; j < (i >> 1); ++j) {
+            const double tmp = lpc[j];
+            lpc[j] += r * lpc[i - 1 - j];
+            lpc[i - 1 - j] += r * tmp;
+        }
+        if (i & 1) {
+            lpc[j] += lpc[j] * r;
+        }
+        err *= 1.0 - r * r;
+        for (j = 0; j <= i; ++j) {
+            coefs[i][j] = -lpc[j];
+        }
+        error[i] = err;
+        if (err <= 0.0) {
+            orders = i + 1;
+            break;
+        }
+    }
+
+    const int precision = settings_.qlpPrecision > 0 ? settings_.qlpPrecision : defaultPrecision(n, plan.bps);
+    int order = 1;
+    double bestEstimate = 1e300;
+    for (int o = 1; o <= orders; ++o) {
+        const double bitsPerResidual = error[o - 1] > 0.0 ? std::max(0.0, 0.5 * std::log2(0.5 / n * error[o - 1])) : 0.0;
+        const double estimate = (n - o) * bitsPerResidual + o * (plan.bps + precision);
+        if (estimate < bestEstimate) {
+            bestEstimate = estimate;
+            order = o;
+        }
+    }
+
+    // Quantize with error feedback so rounding errors do not accumulate
+    const double* lp = coefs[order - 1];
+    double cmax = 0.0;
+    for (int i = 0; i < order; ++i) {
+        cmax = std::max(cmax, std::fabs(lp[i]));
+    }
+    if (cmax <= 0.0) {
+        return;
+    }
+    int log2cmax;
+    std::frexp(cmax, &log2cmax);
+    const int shift = std::min(15, precision - 1 - log2cmax);
+    if (shift < 0) {
+        return;
+    }
+    const int32_t qmax = (1 << (precision - 1)) - 1;
+    const int32_t qmin = -(1 << (precision - 1));
+    int32_t qlp[kMaxLpcOrder];
+    double carry = 0.0;
+    for (int i = 0; i < order; ++i) {
+        carry += lp[i] * (1 << shift);
+        const int32_t q = static_cast<int32_t>(std::clamp<long>(std::lround(carry), qmin, qmax));
+        carry -= q;
+        qlp[i] = q;
+    }
+
+    for (unsigned i = order; i < n; ++i) {
+        int64_t sum = 0;
+        for (int j = 0; j < order; ++j) {
+            sum += static_cast<int64_t>(qlp[j]) * x[i - j - 1];
+        }
+        const int64_t r = x[i] - (sum >> shift);
+        if (r < INT32_MIN || r > INT32_MAX) {
+            return;
+        }
+        candidate_[i - order] = static_cast<int32_t>(r);
+    }
+
+    int partitionOrder = 0;
+    bool rice5 = false;
+    uint8_t params[1 << kMaxPartitionOrder];
+    const uint64_t bits = 8 + plan.wastedBits + static_cast<uint64_t>(order) * (plan.bps + precision) + 4 + 5 +
+                          planResidual(candidate_.data(), n, order, partitionOrder, params, rice5);
+    if (bits < plan.bits) {
+        plan.type = SubframePlan::Type::Lpc;
+        plan.order = order;
+        plan.precision = precision;
+        plan.shift = shift;
+        std::copy(qlp, qlp + order, plan.coefs);
+        plan.partitionOrder = partitionOrder;
+        plan.rice5 = rice5;
+        std::copy(params, params + (1 << partitionOrder), plan.params);
+        plan.bits = bits;
+        plan.residual.swap(candidate_);
+        candidate_.resize(plan.residual.size());
+    }
+}
+
+void FlacFrameEncoder::analyze(const int32_t* x, unsigned n, int bps, SubframePlan& plan) {
+    plan.samples = x;
+    plan.bps = bps;
+    plan.wastedBits = 0;
+    plan.residual.resize(settings_.blockSize);
+
+    if (std::all_of(x + 1, x + n, [&](int32_t v) { return v == x[0]; })) {
+        plan.type = SubframePlan::Type::Constant;
+        plan.bits = 8 + bps;
+        return;
+    }
+
+    // Trailing zero bits shared by every sample are stored once in the header
+    uint32_t bitsUsed = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        bitsUsed |= static_cast<uint32_t>(x[i]);
+    }
+    int wasted = 0;
+    while (!(bitsUsed & 1)) {
+        bitsUsed >>= 1;
+        ++wasted;
+    }
+    if (wasted > 0) {
+        plan.shifted.resize(settings_.blockSize);
+        for (unsigned i = 0; i < n; ++i) {
+            plan.shifted[i] = x[i] >> wasted;
+        }
+        plan.samples = plan.shifted.data();
+        plan.bps = bps - wasted;
+        plan.wastedBits = wasted;
+    }
+
+    plan.type = SubframePlan::Type::Verbatim;
+    plan.bits = 8 + wasted + static_cast<uint64_t>(n) * plan.bps;
+    tryFixed(n, plan);
+    tryLpc(n, plan);
+}
+
+void FlacFrameEncoder::write(BitWriter& bits, const SubframePlan& plan, unsigned n) const {
+    const int32_t* x = plan.samples;
+    if (plan.type == SubframePlan::Type::Constant) {
+        bits.put(0, 8);
+        bits.putSigned(x[0], plan.bps);
+        return;
+    }
+
+    // Zero pad bit, 6 bit type, wasted bits flag, then the wasted bit count - 1 in unary
+    uint32_t type = 0x01;
+    if (plan.type == SubframePlan::Type::Fixed) {
+        type = 0x08 | plan.order;
+    } else if (plan.type == SubframePlan::Type::Lpc) {
+        type = 0x20 | (plan.order - 1);
+    }
+    bits.put((type << 1) | (plan.wastedBits > 0 ? 1 : 0), 8);
+    if (plan.wastedBits > 0) {
+        bits.put(1, plan.wastedBits);
+    }
+
+    if (plan.type == SubframePlan::Type::Verbatim) {
+        for (unsigned i = 0; i < n; ++i) {
+            bits.putSigned(x[i], plan.bps);
+        }
+        return;
+    }
+
+    for (int i = 0; i < plan.order; ++i) {
+        bits.putSigned(x[i], plan.bps);
+    }
+    if (plan.type == SubframePlan::Type::Lpc) {
+        bits.put(plan.precision - 1, 4);
+        bits.putSigned(plan.shift, 5);
+        for (int i = 0; i < plan.order; ++i) {
+            bits.putSigned(plan.coefs[i], plan.precision);
+        }
+    }
+
+    const int paramBits = plan.rice5 ? 5 : 4;
+    bits.put(plan.rice5 ? 1 : 0, 2);
+    bits.put(plan.partitionOrder, 4);
+    const unsigned partitions = 1u << plan.partitionOrder;
+    const unsigned size = n >> plan.partitionOrder;
+    const int32_t* r = plan.residual.data();
+    for (unsigned p = 0; p < partitions; ++p) {
+        const int k = plan.params[p];
+        bits.put(k, paramBits);
+        const unsigned count = p == 0 ? size - plan.order : size;
+        for (unsigned i = 0; i < count; ++i) {
+            bits.putRice(fold(*r++), k);
+        }
+    }
+}
+
+void FlacFrameEncoder::encode(const int32_t* interleaved, unsigned n, uint64_t frameNumber,
+                              std::vector<uint8_t>& out) {
+    const int channels = format_.channels;
+    for (int c = 0; c < channels; ++c) {
+        int32_t* dst = channels_[c].data();
+        for (unsigned i = 0; i < n; ++i) {
+            dst[i] = interleaved[i * channels + c];
+        }
+    }
+
+    // Channel assignment: 0-7 independent, 8 left/side, 9 side/right, 10 mid/side
+    int assignment = channels - 1;
+    const SubframePlan* order[8];
+    for (int c = 0; c < channels; ++c) {
+        analyze(channels_[c].data(), n, bps_, plans_[c]);
+        order[c] = &plans_[c];
+    }
+    if (channels == 2 && settings_.stereoDecorrelation) {
+        int32_t* mid = channels_[8].data();
+        int32_t* side = channels_[9].data();
+        for (unsigned i = 0; i < n; ++i) {
+            const int32_t l = channels_[0][i];
+            const int32_t r = channels_[1][i];
+            mid[i] = (l + r) >> 1;
+            side[i] = l - r;
+        }
+        analyze(mid, n, bps_, plans_[8]);
+        analyze(side, n, bps_ + 1, plans_[9]);
+
+        const SubframePlan& l = plans_[0];
+        const SubframePlan& r = plans_[1];
+        const SubframePlan& m = plans_[8];
+        const SubframePlan& s = plans_[9];
+        uint64_t best = l.bits + r.bits;
+        if (l.bits + s.bits < best) {
+            best = l.bits + s.bits;
+            assignment = 8;
+            order[0] = &l;
+            order[1] = &s;
+        }
+        if (s.bits + r.bits < best) {
+            best = s.bits + r.bits;
+            assignment = 9;
+            order[0] = &s;
+            order[1] = &r;
+        }
+        if (m.bits + s.bits < best) {
+            assignment = 10;
+            order[0] = &m;
+            order[1] = &s;
+        }
+    }
+
+    out.clear();
+    out.push_back(0xFF);
+    out.push_back(0xF8); // Sync code, fixed block size stream
+
+    int blockCode;
+    int blockExtra = 0;
+    if (n == 192) {
+        blockCode = 1;
+    } else if (n % 576 == 0 && n / 576 <= 8 && ((n / 576) & (n / 576 - 1)) == 0) {
+        blockCode = 2 + static_cast<int>(std::log2(n / 576));
+    } else if (n % 256 == 0 && n / 256 <= 128 && ((n / 256) & (n / 256 - 1)) == 0) {
+        blockCode = 8 + static_cast<int>(std::log2(n / 256));
+    } else {
+        blockCode = n <= 256 ? 6 : 7;
+        blockExtra = blockCode == 6 ? 1 : 2;
+    }
+
+    const int rate = format_.sampleRate;
+    int rateCode = 0;
+    int rateExtra = 0;
+    int rateValue = 0;
+    const int* known = std::find(kFlacSampleRates + 1, std::end(kFlacSampleRates), rate);
+    if (known != std::end(kFlacSampleRates)) {
+        rateCode = static_cast<int>(known - kFlacSampleRates);
+    } else if (rate % 1000 == 0 && rate / 1000 <= 255) {
+        rateCode = 12;
+        rateExtra = 1;
+        rateValue = rate / 1000;
+    } else if (rate <= 65535) {
+        rateCode = 13;
+        rateExtra = 2;
+        rateValue = rate;
+    } else if (rate % 10 == 0 && rate / 10 <= 65535) {
+        rateCode = 14;
+        rateExtra = 2;
+        rateValue = rate / 10;
+    }
+
+    const int sizeCode = static_cast<int>(std::find(kFlacSampleSizes, std::end(kFlacSampleSizes), bps_) - kFlacSampleSizes);
+    out.push_back(static_cast<uint8_t>((blockCode << 4) | rateCode));
+    out.push_back(static_cast<uint8_t>((assignment << 4) | (sizeCode << 1)));
+    putUtf8(out, frameNumber);
+    for (int i = blockExtra - 1; i >= 0; --i) {
+        out.push_back(static_cast<uint8_t>((n - 1) >> (8 * i)));
+    }
+    for (int i = rateExtra - 1; i >= 0; --i) {
+        out.push_back(static_cast<uint8_t>(rateValue >> (8 * i)));
+    }
+    out.push_back(FlacCrc::crc8(out.data(), out.size()));
+
+    BitWriter bits(out);
+    for (int c = 0; c < channels; ++c) {
+        write(bits, *order[c], n);
+    }
+    bits.align();
+
+    const uint16_t crc = FlacCrc::crc16(out.data(), out.size());
+    out.push_back(static_cast<uint8_t>(crc >> 8));
+    out.push_back(static_cast<uint8_t>(crc & 0xFF));
+}
+
+FlacWriter::FlacWriter() = default;
+
+FlacWriter::~FlacWriter() {
+    if (isOpen()) {
+        finalize();
+    }
+}
+
+bool FlacWriter::open(const std::string& file, const WavFormat& format, const FlacSettings& settings, bool dither) {
+    if (isOpen()) {
+        finalize();
+    }
+    if (format.channels < 1 || format.channels > 8 || format.sampleRate < 1 || format.sampleRate > 655350 ||
+        format.isFloat()) {
+        return false;
+    }
+
+    out_.open(file, std::ios::binary | std::ios::trunc);
+    if (!out_) {
+        return false;
+    }
+
+    format_ = format;
+    settings_ = settings;
+    settings_.blockSize = std::clamp(settings.blockSize, 16u, 65535u);
+    settings_.maxLpcOrder = std::clamp(settings.maxLpcOrder, 0, kMaxLpcOrder);
+    settings_.maxPartitionOrder = std::clamp(settings.maxPartitionOrder, 0, kMaxPartitionOrder);
+    if (settings_.qlpPrecision != 0) {
+        settings_.qlpPrecision = std::clamp(settings.qlpPrecision, 5, 15);
+    }
+    threads_ = settings.threads ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    encoders_.clear();
+    for (unsigned i = 0; i < threads_; ++i) {
+        encoders_.push_back(std::make_unique<FlacFrameEncoder>(format_, settings_));
+    }
+    const size_t batchBlocks = threads_ * kBlocksPerThread;
+    encoded_.resize(batchBlocks);
+    pending_.resize(batchBlocks * settings_.blockSize * format_.channels);
+    pendingFrames_ = 0;
+    dither_ = dither;
+    noise_.resize(dither_ ? pending_.size() : 0);
+    md5_.reset();
+    framesWritten_ = 0;
+    frameNumber_ = 0;
+    minFrameBytes_ = 0;
+    maxFrameBytes_ = 0;
+    failed_ = false;
+
+    const auto info = streamInfo().serialize();
+    const uint8_t marker[8] = {'f', 'L', 'a', 'C', 0x80, 0, 0, static_cast<uint8_t>(FlacStreamInfo::kSize)};
+    out_.write(reinterpret_cast<const char*>(marker), sizeof(marker));
+    out_.write(reinterpret_cast<const char*>(info.data()), info.size());
+    return static_cast<bool>(out_);
+}
+
+bool FlacWriter::append(const double* samples, size_t frames) {
+    if (!isOpen() || failed_) {
+        return false;
+    }
+
+    const size_t channels = format_.channels;
+    const size_t capacity = pending_.size() / channels;
+    while (frames > 0) {
+        const size_t n = std::min(capacity - pendingFrames_, frames);
+        const size_t count = n * channels;
+        int32_t* dst = pending_.data() + pendingFrames_ * channels;
+        if (dither_) {
+            ditherSource_.fill(noise_.data(), count);
+        }
+        PcmConverter::toInt32(format_.sampleFormat, samples, dst, count, dither_ ? noise_.data() : nullptr);
+
+        pendingFrames_ += n;
+        framesWritten_ += n;
+        samples += count;
+        frames -= n;
+        if (pendingFrames_ == capacity) {
+            if (!encodeBatch(pendingFrames_)) {
+                failed_ = true;
+                return false;
+            }
+            pendingFrames_ = 0;
+        }
+    }
+    return true;
+}
+
+bool FlacWriter::append(const std::vector<double>& block) {
+    if (block.size() % format_.channels != 0) {
+        return false;
+    }
+    return append(block.data(), block.size() / format_.channels);
+}
+
+bool FlacWriter::encodeBatch(size_t frames) {
+    const size_t blockSize = settings_.blockSize;
+    const size_t channels = format_.channels;
+    const size_t blocks = (frames + blockSize - 1) / blockSize;
+
+    std::atomic<size_t> next{0};
+    auto work = [&](FlacFrameEncoder& encoder) {
+        for (size_t b; (b = next.fetch_add(1, std::memory_order_relaxed)) < blocks;) {
+            const size_t start = b * blockSize;
+            const unsigned n = static_cast<unsigned>(std::min(blockSize, frames - start));
+            encoder.encode(pending_.data() + start * channels, n, frameNumber_ + b, encoded_[b]);
+        }
+    };
+
+    // The calling thread hashes the batch while the workers encode, then helps with the remaining frames
+    std::vector<std::thread> workers;
+    const size_t spawn = std::min<size_t>(threads_, blocks) - 1;
+    for (size_t w = 1; w <= spawn; ++w) {
+        workers.emplace_back([&, w] { work(*encoders_[w]); });
+    }
+    updateMd5(pending_.data(), frames * channels);
+    work(*encoders_[0]);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (size_t b = 0; b < blocks; ++b) {
+        const auto& frame = encoded_[b];
+        const uint32_t size = static_cast<uint32_t>(frame.size());
+        minFrameBytes_ = minFrameBytes_ ? std::min(minFrameBytes_, size) : size;
+        maxFrameBytes_ = std::max(maxFrameBytes_, size);
+        out_.write(reinterpret_cast<const char*>(frame.data()), frame.size());
+    }
+    frameNumber_ += blocks;
+    return static_cast<bool>(out_);
+}
+
+void FlacWriter::updateMd5(const int32_t* samples, size_t count) {
+    // The signature covers little-endian samples of bitsPerSample / 8 bytes each
+    constexpr size_t kChunk = 4096;
+    const int bytes = format_.bytesPerSample();
+    md5Bytes_.resize(kChunk * bytes);
+    for (size_t offset = 0; offset < count; offset += kChunk) {
+        const size_t n = std::min(kChunk, count - offset);
+        uint8_t* dst = md5Bytes_.data();
+        for (size_t i = 0; i < n; ++i) {
+            const uint32_t v = static_cast<uint32_t>(samples[offset + i]);
+            for (int b = 0; b < bytes; ++b) {
+                *dst++ = static_cast<uint8_t>(v >> (8 * b));
+            }
+        }
+        md5_.update(md5Bytes_.data(), n * bytes);
+    }
+}
+
+FlacStreamInfo FlacWriter::streamInfo() const {
+    FlacStreamInfo info;
+    info.minBlockSize = settings_.blockSize;
+    info.maxBlockSize = settings_.blockSize;
+    info.minFrameSize = minFrameBytes_;
+    info.maxFrameSize = maxFrameBytes_;
+    info.sampleRate = format_.sampleRate;
+    info.channels = format_.channels;
+    info.bitsPerSample = format_.bytesPerSample() * 8;
+    info.totalFrames = framesWritten_;
+    return info;
+}
+
+bool FlacWriter::finalize() {
+    if (!isOpen()) {
+        return false;
+    }
+
+    bool ok = !failed_ && (pendingFrames_ == 0 || encodeBatch(pendingFrames_));
+    pendingFrames_ = 0;
+
+    FlacStreamInfo info = streamInfo();
+    md5_.finish(info.md5);
+    const auto body = info.serialize();
+    out_.seekp(8);
+    out_.write(reinterpret_cast<const char*>(body.data()), body.size());
+    ok = ok && static_cast<bool>(out_);
+
+    out_.close();
+    encoders_.clear();
+    return ok && !out_.fail();
+}
+
+int FlacWriter::channels() const {
+    return format_.channels;
+}
+
+bool FlacWriter::isOpen() const {
+    return out_.is_open();
+}
+
+const WavFormat& FlacWriter::format() const {
+    return format_;
+}
+
+uint64_t FlacWriter::framesWritten() const {
+    return framesWritten_;
+}
@@ -0,0 +1,106 @@
+#include "../include/KeyEventHistory.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+KeyEventHistory::KeyEventHistory(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1))
+    , slots_(new Slot[capacity_])
+    , lastTimestamp_(-std::numeric_limits<double>::infinity()) {
+    for (size_t i = 0; i < capacity_; ++i) {
+        for (auto& word : slots_[i].words) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void KeyEventHistory::append(const KeyEvent& event) {
+    KeyEvent stored = event;
+    stored.timestamp = std::max(stored.timestamp, lastTimestamp_);
+    lastTimestamp_ = stored.timestamp;
+    uint64_t words[kWords] = {};
+    std::memcpy(words, &stored, sizeof(KeyEvent));
+
+    const uint64_t position = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[position % capacity_];
+    slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kWords; ++i) {
+        slot.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.sequence.store(2 * position + 2, std::memory_order_release);
+    head_.store(position + 1, std::memory_order_release);
+}
+
+bool KeyEventHistory::read(uint64_t position, KeyEvent& out) const {
+    const Slot& slot = slots_[position % capacity_];
+    const uint64_t expected = 2 * position + 2;
+    if (slot.sequence.load(std::memory_order_acquire) != expected) {
+        return false; // Being written, or already holds a newer position
+    }
+    uint64_t words[kWords];
+    for (size_t i = 0; i < kWords; ++i) {
+        words[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+        return false; // Overwritten while copying
+    }
+    std::memcpy(&out, words, sizeof(KeyEvent));
+    return true;
+}
+
+uint64_t KeyEventHistory::oldestPosition(uint64_t end) const {
+    const uint64_t wrapped = end > capacity_ ? end - capacity_ : 0;
+    return std::max(wrapped, floor_.load(std::memory_order_acquire));
+}
+
+size_t KeyEventHistory::snapshot(double from, double to, std::vector<KeyEvent>& out) const {
+    out.clear();
+    const uint64_t end = head_.load(std::memory_order_acquire);
+    uint64_t low = oldestPosition(end);
+    uint64_t high = end;
+
+    // First position whose timestamp is >= from. A slot that fails to read
+    // has been overwritten, which only happens to the oldest positions, so
+    // it is treated as lying before the window.
+    KeyEvent event;
+    while (low < high) {
+        const uint64_t mid = low + (high - low) / 2;
+        if (!read(mid, event) || event.timestamp < from) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    for (uint64_t position = low; position < end; ++position) {
+        if (!read(position, event)) {
+            continue;
+        }
+        if (event.timestamp > to) {
+            break;
+        }
+        out.push_back(event);
+    }
+    return out.size();
+}
+
+std::vector<KeyEvent> KeyEventHistory::since(double from) const {
+    std::vector<KeyEvent> events;
+    snapshot(from, std::numeric_limits<double>::infinity(), events);
+    return events;
+}
+
+void KeyEventHistory::clear() {
+    floor_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+size_t KeyEventHistory::size() const {
+    const uint64_t end = head_.load(std::memory_order_acquire);
+    return static_cast<size_t>(end - std::min(end, oldestPosition(end)));
+}
+
+size_t KeyEventHistory::capacity() const {
+    return capacity_;
+}
@@ -0,0 +1,109 @@
+#include "../include/LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+int highestBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < 2 * kSubBuckets) {
+        return static_cast<size_t>(value);
+    }
+    // Keep the top kSubBucketBits + 1 bits: the leading one selects the
+    // power of two, the rest the linear bucket inside it
+    const int shift = highestBit(value) - static_cast<int>(kSubBucketBits);
+    return static_cast<size_t>(shift) * kSubBuckets + static_cast<size_t>(value >> shift);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < 2 * kSubBuckets) {
+        return index;
+    }
+    const uint64_t shift = index / kSubBuckets - 1;
+    const uint64_t mantissa = index - shift * kSubBuckets;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    const uint64_t value = std::min(nanoseconds, kMaxValue);
+    buckets_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (value > seen && !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+    count_.fetch_add(1, std::memory_order_release);
+}
+
+uint64_t LatencyHistogram::percentile(double percent) const {
+    // Rank against the bucket totals rather than count_, so a concurrent
+    // record() cannot push the rank past the end of the scan
+    uint64_t total = 0;
+    for (const auto& bucket : buckets_) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const double clamped = std::max(0.0, std::min(100.0, percent));
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * total)));
+
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        cumulative += buckets_[i].load(std::memory_order_relaxed);
+        if (cumulative >= rank) {
+            return std::min(bucketUpperBound(i), max());
+        }
+    }
+    return max();
+}
+
+uint64_t LatencyHistogram::count() const {
+    return count_.load(std::memory_order_acquire);
+}
+
+uint64_t LatencyHistogram::max() const {
+    return max_.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const {
+    const uint64_t n = count();
+    return n ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / n : 0.0;
+}
+
+LatencySummary LatencyHistogram::summary() const {
+    constexpr double kNsToMs = 1e-6;
+    LatencySummary result;
+    result.count = count();
+    result.mean = mean() * kNsToMs;
+    result.p50 = percentile(50.0) * kNsToMs;
+    result.p99 = percentile(99.0) * kNsToMs;
+    result.p999 = percentile(99.9) * kNsToMs;
+    result.max = max() * kNsToMs;
+    return result;
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_release);
+}
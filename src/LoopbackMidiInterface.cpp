@@ -0,0 +1,296 @@
+#include "../include/LoopbackMidiInterface.h"
+#include "../include/MidiStatusTable.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+std::chrono::steady_clock::time_point toTimePoint(double seconds) {
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds)));
+}
+
+} // namespace
+
+LoopbackMidiInterface::LoopbackMidiInterface(const LoopbackTiming& timing)
+    : timing_(timing)
+    , random_(timing.seed)
+    , rawParser_(
+          [this](const RealTimeMidiMessage& message) {
+              enqueueLocked(message, {}, message.timestamp);
+          },
+          [this](const MidiSysExMessage& message) {
+              sysExAssembly_.insert(sysExAssembly_.end(), message.data, message.data + message.length);
+              if (message.complete) {
+                  RealTimeMidiMessage header = {0xF0, 0, 0, message.timestamp, 1, kDeviceId};
+                  enqueueLocked(header, std::move(sysExAssembly_), message.timestamp);
+                  sysExAssembly_.clear();
+              }
+          },
+          kDeviceId) {
+    deliveryThread_ = std::thread(&LoopbackMidiInterface::deliveryThreadFunction, this);
+}
+
+LoopbackMidiInterface::~LoopbackMidiInterface() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wake_.notify_all();
+    deliveryThread_.join();
+}
+
+std::vector<MidiDeviceInfo> LoopbackMidiInterface::getAvailableDevices() {
+    return {getDeviceInfo(kDeviceId)};
+}
+
+MidiDeviceInfo LoopbackMidiInterface::getDeviceInfo(int deviceId) {
+    MidiDeviceInfo info;
+    info.deviceId = -1;
+    info.isInput = false;
+    info.isOutput = false;
+    info.isConnected = false;
+    info.portCount = 0;
+    if (deviceId == kDeviceId) {
+        info.deviceId = kDeviceId;
+        info.name = "Loopback MIDI";
+        info.manufacturer = "PianoSynth";
+        info.isInput = true;
+        info.isOutput = true;
+        info.isConnected = true;
+        info.portCount = 1;
+    }
+    return info;
+}
+
+bool LoopbackMidiInterface::isDeviceConnected(int deviceId) {
+    return deviceId == kDeviceId;
+}
+
+MidiError LoopbackMidiInterface::openInputDevice(int deviceId) {
+    if (deviceId != kDeviceId) return MidiError::DeviceNotFound;
+    if (inputOpen_.exchange(true)) return MidiError::DeviceAlreadyOpen;
+    return MidiError::None;
+}
+
+MidiError LoopbackMidiInterface::openOutputDevice(int deviceId) {
+    if (deviceId != kDeviceId) return MidiError::DeviceNotFound;
+    if (outputOpen_.exchange(true)) return MidiError::DeviceAlreadyOpen;
+    return MidiError::None;
+}
+
+MidiError LoopbackMidiInterface::closeDevice(int deviceId) {
+    if (deviceId != kDeviceId) return MidiError::DeviceNotFound;
+    inputOpen_ = false;
+    outputOpen_ = false;
+    return MidiError::None;
+}
+
+void LoopbackMidiInterface::closeAllDevices() {
+    closeDevice(kDeviceId);
+}
+
+void LoopbackMidiInterface::setInputCallback(MidiInputCallback callback) {
+    inputCallback_ = callback;
+}
+
+void LoopbackMidiInterface::setSysExCallback(MidiSysExCallback callback) {
+    sysExCallback_ = callback;
+}
+
+MidiError LoopbackMidiInterface::sendMessage(int deviceId, const RealTimeMidiMessage& message) {
+    return sendMessages(deviceId, &message, 1);
+}
+
+MidiError LoopbackMidiInterface::sendMessages(int deviceId, const RealTimeMidiMessage* messages, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (!isValidMidiMessage(messages[i])) return MidiError::InvalidMessage;
+    }
+    if (deviceId != kDeviceId) return MidiError::DeviceNotFound;
+    if (!outputOpen_) return MidiError::DeviceNotConnected;
+
+    const double now = MidiDevice::timestampNow();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < count; ++i) {
+            RealTimeMidiMessage message = messages[i];
+            message.deviceId = kDeviceId;
+            message.timestamp = now;
+            enqueueLocked(message, {}, now);
+        }
+    }
+    wake_.notify_one();
+    return MidiError::None;
+}
+
+MidiError LoopbackMidiInterface::sendRawMessage(int deviceId, const uint8_t* data, size_t length) {
+    if (!data || length == 0) return MidiError::InvalidMessage;
+    if (deviceId != kDeviceId) return MidiError::DeviceNotFound;
+    if (!outputOpen_) return MidiError::DeviceNotConnected;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rawParser_.feed(data, length, MidiDevice::timestampNow());
+    }
+    wake_.notify_one();
+    return MidiError::None;
+}
+
+void LoopbackMidiInterface::setDeviceConnectionCallback(DeviceConnectionCallback callback) {
+    connectionCallback_ = callback;
+}
+
+std::string LoopbackMidiInterface::getErrorString(MidiError error) {
+    switch (error) {
+        case MidiError::None: return "No error";
+        case MidiError::DeviceNotFound: return "Device not found";
+        case MidiError::DeviceNotConnected: return "Device not connected";
+        case MidiError::DeviceAlreadyOpen: return "Device already open";
+        case MidiError::DeviceBusy: return "Device busy";
+        case MidiError::InvalidMessage: return "Invalid MIDI message";
+        case MidiError::BufferOverflow: return "Buffer overflow";
+        case MidiError::SystemError: return "System error";
+        case MidiError::NotSupported: return "Operation not supported";
+        default: return "Unknown error";
+    }
+}
+
+MidiMessageType LoopbackMidiInterface::getMessageType(uint8_t status) {
+    return MidiStatusTable::type(status);
+}
+
+bool LoopbackMidiInterface::isValidMidiMessage(const RealTimeMidiMessage& message) {
+    if (message.status < 0x80) return false;
+    if (message.status < 0xF0 && (message.channel < 1 || message.channel > 16)) return false;
+    return message.data1 < 128 && message.data2 < 128;
+}
+
+void LoopbackMidiInterface::setTiming(const LoopbackTiming& timing) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timing_ = timing;
+    random_.seed(timing.seed);
+}
+
+bool LoopbackMidiInterface::startLoad(const LoopbackLoad& load) {
+    if (!(load.messagesPerSecond > 0.0) || load.burstSize == 0) return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        load_ = load;
+        loadGenerated_ = 0;
+        loadActive_ = true;
+        nextBurstAt_ = MidiDevice::timestampNow();
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void LoopbackMidiInterface::stopLoad() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    loadActive_ = false;
+    if (idleLocked()) {
+        idle_.notify_all();
+    }
+}
+
+bool LoopbackMidiInterface::waitUntilIdle(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (loadActive_ && load_.totalMessages == 0) return false;
+    return idle_.wait_for(lock, timeout, [this] { return idleLocked(); });
+}
+
+bool LoopbackMidiInterface::idleLocked() const {
+    return pending_.empty() && !loadActive_ && !delivering_;
+}
+
+void LoopbackMidiInterface::enqueueLocked(const RealTimeMidiMessage& message, std::vector<uint8_t> sysEx,
+                                          double sentAt) {
+    double delay = timing_.latency;
+    if (timing_.jitter > 0.0) {
+        delay += std::uniform_real_distribution<double>(0.0, timing_.jitter)(random_);
+    }
+    // A link delivers in order, so a message never overtakes the one before it
+    lastDeliverAt_ = std::max(lastDeliverAt_, sentAt + delay);
+    pending_.push_back(Pending{message, lastDeliverAt_, std::move(sysEx)});
+}
+
+void LoopbackMidiInterface::generateDueLocked(double now) {
+    const double burstInterval = static_cast<double>(load_.burstSize) / load_.messagesPerSecond;
+    // After a stall every overdue burst is sent at once, so the average rate holds
+    while (loadActive_ && nextBurstAt_ <= now) {
+        for (size_t i = 0; i < load_.burstSize; ++i) {
+            if (load_.totalMessages != 0 && loadGenerated_ >= load_.totalMessages) {
+                break;
+            }
+            const uint64_t n = loadGenerated_++;
+            RealTimeMidiMessage message;
+            message.status = (n & 1) ? 0x80 : 0x90;
+            message.data1 = static_cast<uint8_t>(21 + (n / 2) % 88);
+            message.data2 = (n & 1) ? 64 : static_cast<uint8_t>(1 + (n / 2) % 127);
+            message.channel = 1;
+            message.deviceId = kDeviceId;
+            message.timestamp = now;
+            enqueueLocked(message, {}, now);
+            generated_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (load_.totalMessages != 0 && loadGenerated_ >= load_.totalMessages) {
+            loadActive_ = false;
+        }
+        nextBurstAt_ += burstInterval;
+    }
+}
+
+void LoopbackMidiInterface::deliveryThreadFunction() {
+    std::vector<Pending> batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        const double now = MidiDevice::timestampNow();
+        if (loadActive_) {
+            generateDueLocked(now);
+        }
+
+        while (!pending_.empty() && pending_.front().deliverAt <= now) {
+            batch.push_back(std::move(pending_.front()));
+            pending_.pop_front();
+        }
+        if (!batch.empty()) {
+            delivering_ = true;
+            lock.unlock();
+            for (const Pending& item : batch) {
+                if (!inputOpen_) {
+                    ++discarded_;
+                    continue;
+                }
+                if (!item.sysEx.empty()) {
+                    if (sysExCallback_) {
+                        MidiSysExMessage message = {item.sysEx.data(), item.sysEx.size(), true,
+                                                    item.message.timestamp, kDeviceId};
+                        sysExCallback_(message);
+                    }
+                } else if (inputCallback_) {
+                    inputCallback_(item.message);
+                }
+                ++delivered_;
+            }
+            batch.clear();
+            lock.lock();
+            delivering_ = false;
+            if (idleLocked()) {
+                idle_.notify_all();
+            }
+            continue;
+        }
+
+        double next = std::numeric_limits<double>::infinity();
+        if (!pending_.empty()) {
+            next = pending_.front().deliverAt;
+        }
+        if (loadActive_) {
+            next = std::min(next, nextBurstAt_);
+        }
+        if (next == std::numeric_limits<double>::infinity()) {
+            wake_.wait(lock);
+        } else {
+            wake_.wait_until(lock, toTimePoint(next));
+        }
+    }
+}
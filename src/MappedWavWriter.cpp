@@ -0,0 +1,165 @@
+#include "../include/MappedWavWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+uint64_t pageAlignDown(uint64_t offset) {
+    static const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    return offset - offset % pageSize;
+}
+
+} // namespace
+
+MappedWavWriter::~MappedWavWriter() {
+    if (isOpen()) {
+        finalize();
+    }
+}
+
+bool MappedWavWriter::fail() {
+    if (map_) {
+        munmap(map_, mapSize_);
+        map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    return false;
+}
+
+bool MappedWavWriter::open(const std::string& file, const WavFormat& format, uint64_t frames, bool dither) {
+    if (isOpen()) {
+        finalize();
+    }
+    if (format.channels < 1 || format.sampleRate < 1) {
+        return false;
+    }
+
+    format_ = format.resolveRf64(frames);
+    const uint64_t dataBytes = frames * format_.blockAlign();
+    const auto header = WavHeader::build(format_, dataBytes);
+    if (header.empty()) {
+        return false;
+    }
+    headerSize_ = header.size();
+    mapSize_ = headerSize_ + dataBytes + (dataBytes & 1);
+    capacitySamples_ = frames * format_.channels;
+    samplesWritten_ = 0;
+    syncedBytes_ = 0;
+    prefaultedBytes_ = 0;
+    prefault_ = true;
+    dither_ = dither && !format_.isFloat();
+    noise_.resize(dither_ ? kConvertBlockSamples : 0);
+
+    fd_ = ::open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+    // Reserving the blocks up front means a full disk fails here rather than
+    // as SIGBUS on a page fault in the middle of the render
+    if (posix_fallocate(fd_, 0, static_cast<off_t>(mapSize_)) != 0) {
+        return fail();
+    }
+    void* map = mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        return fail();
+    }
+    map_ = static_cast<uint8_t*>(map);
+    madvise(map_, mapSize_, MADV_SEQUENTIAL);
+
+    std::memcpy(map_, header.data(), headerSize_);
+    return true;
+}
+
+void MappedWavWriter::prefault(uint64_t end) {
+#ifdef MADV_POPULATE_WRITE
+    // One madvise per window replaces a write fault per page
+    while (prefault_ && prefaultedBytes_ < end) {
+        const uint64_t length = std::min<uint64_t>(kPrefaultBytes, mapSize_ - prefaultedBytes_);
+        if (madvise(map_ + prefaultedBytes_, length, MADV_POPULATE_WRITE) != 0) {
+            prefault_ = false; // Kernel older than 5.14; fall back to demand faults
+        }
+        prefaultedBytes_ += length;
+    }
+#else
+    (void)end;
+#endif
+}
+
+bool MappedWavWriter::append(const double* samples, size_t frames) {
+    if (!isOpen()) {
+        return false;
+    }
+    const uint64_t count = static_cast<uint64_t>(frames) * format_.channels;
+    if (count > capacitySamples_ - samplesWritten_) {
+        return false;
+    }
+
+    const size_t bytesPerSample = format_.bytesPerSample();
+    uint8_t* dst = map_ + headerSize_ + samplesWritten_ * bytesPerSample;
+    prefault(headerSize_ + (samplesWritten_ + count) * bytesPerSample);
+    for (uint64_t offset = 0; offset < count; offset += kConvertBlockSamples) {
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(kConvertBlockSamples, count - offset));
+        if (dither_) {
+            ditherSource_.fill(noise_.data(), n);
+        }
+        PcmConverter::convert(format_.sampleFormat, samples + offset, dst, n, dither_ ? noise_.data() : nullptr);
+        dst += n * bytesPerSample;
+    }
+    samplesWritten_ += count;
+
+    // Start writeback of completed pages so dirty memory stays bounded
+    const uint64_t writtenBytes = headerSize_ + samplesWritten_ * bytesPerSample;
+    if (writtenBytes - syncedBytes_ >= kSyncBytes) {
+        const uint64_t end = pageAlignDown(writtenBytes);
+        msync(map_ + syncedBytes_, end - syncedBytes_, MS_ASYNC);
+        syncedBytes_ = end;
+    }
+    return true;
+}
+
+bool MappedWavWriter::finalize() {
+    if (!isOpen()) {
+        return false;
+    }
+
+    bool ok = true;
+    uint64_t fileSize = mapSize_;
+    if (samplesWritten_ < capacitySamples_) {
+        // Fewer frames than announced: rewrite the sizes and drop the unused tail
+        const uint64_t dataBytes = samplesWritten_ * format_.bytesPerSample();
+        const auto header = WavHeader::build(format_, dataBytes);
+        std::memcpy(map_, header.data(), headerSize_);
+        fileSize = headerSize_ + dataBytes;
+        if (dataBytes & 1) {
+            map_[fileSize++] = 0;
+        }
+    }
+
+    ok = msync(map_, mapSize_, MS_ASYNC) == 0 && ok;
+    ok = munmap(map_, mapSize_) == 0 && ok;
+    map_ = nullptr;
+    if (fileSize < mapSize_) {
+        ok = ftruncate(fd_, static_cast<off_t>(fileSize)) == 0 && ok;
+    }
+    ok = close(fd_) == 0 && ok;
+    fd_ = -1;
+    return ok;
+}
+
+int MappedWavWriter::channels() const {
+    return format_.channels;
+}
+
+bool MappedWavWriter::isOpen() const {
+    return map_ != nullptr;
+}
+
+uint64_t MappedWavWriter::framesWritten() const {
+    return samplesWritten_ / format_.channels;
+}
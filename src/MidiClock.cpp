@@ -0,0 +1,178 @@
+#include "../include/MidiClock.h"
+#include <cmath>
+
+namespace {
+
+// Loop gains as fractions of the phase error applied to phase and period.
+// Wide gains (poles at 0.71) settle within a beat from one measured
+// interval; narrow ones (poles at 0.95, near critical damping) average
+// arrival jitter over about a beat while still following tempo ramps.
+constexpr double kAcquirePhaseGain = 0.5;
+constexpr double kAcquirePeriodGain = 0.1;
+constexpr double kTrackPhaseGain = 0.1;
+constexpr double kTrackPeriodGain = 0.005;
+
+// A gap this many periods long means clocks were lost, not a tempo change
+constexpr double kDropoutPeriods = 4.0;
+constexpr double kJitterSmoothing = 1.0 / 16.0;
+
+} // namespace
+
+MidiClock::MidiClock()
+    : phase_(0.0)
+    , period_(0.0)
+    , lastArrival_(0.0)
+    , jitter_(0.0)
+    , tracked_(0)
+    , haveClock_(false)
+    , running_(false)
+    , position_(0)
+    , nextPosition_(0)
+    , clocks_(0)
+    , awaitingClock_(false)
+    , sequence_(0)
+    , snapshotRunning_(false)
+    , snapshotLocked_(false)
+    , snapshotBpm_(0.0)
+    , snapshotBeat_(0.0)
+    , snapshotTime_(0.0)
+    , snapshotJitter_(0.0)
+    , snapshotClocks_(0) {
+}
+
+bool MidiClock::process(uint8_t status, uint8_t data1, uint8_t data2, double timestamp) {
+    if (!handles(status) || !claim()) {
+        return false;
+    }
+    switch (status) {
+        case 0xF8:
+            clock(timestamp);
+            break;
+        case 0xFA:
+            nextPosition_ = 0;
+            running_ = true;
+            awaitingClock_ = true;
+            break;
+        case 0xFB:
+            running_ = true;
+            awaitingClock_ = true;
+            break;
+        case 0xFC:
+            running_ = false;
+            break;
+        case 0xF2:
+            // Sixteenths as a 14-bit value, LSB first; ignored while running
+            if (!running_) {
+                nextPosition_ = static_cast<uint64_t>((data1 & 0x7F) | (data2 & 0x7F) << 7) * kClocksPerSixteenth;
+            }
+            break;
+    }
+    publish();
+    return true;
+}
+
+MidiClockSnapshot MidiClock::snapshot() const {
+    MidiClockSnapshot snapshot;
+    uint64_t before;
+    do {
+        before = sequence_.load(std::memory_order_acquire);
+        snapshot.running = snapshotRunning_.load(std::memory_order_relaxed);
+        snapshot.locked = snapshotLocked_.load(std::memory_order_relaxed);
+        snapshot.bpm = snapshotBpm_.load(std::memory_order_relaxed);
+        snapshot.beat = snapshotBeat_.load(std::memory_order_relaxed);
+        snapshot.time = snapshotTime_.load(std::memory_order_relaxed);
+        snapshot.jitter = snapshotJitter_.load(std::memory_order_relaxed);
+        snapshot.clocks = snapshotClocks_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) || sequence_.load(std::memory_order_relaxed) != before);
+    snapshot.sequence = before >> 1;
+    return snapshot;
+}
+
+void MidiClock::reset() {
+    // Not realtime; waits out a process() call in progress
+    while (!claim()) {
+    }
+    phase_ = 0.0;
+    period_ = 0.0;
+    lastArrival_ = 0.0;
+    jitter_ = 0.0;
+    tracked_ = 0;
+    haveClock_ = false;
+    running_ = false;
+    position_ = 0;
+    nextPosition_ = 0;
+    clocks_ = 0;
+    awaitingClock_ = false;
+    publish();
+}
+
+// Private methods
+
+bool MidiClock::claim() {
+    uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+    return !(sequence & 1) &&
+           sequence_.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire);
+}
+
+void MidiClock::publish() {
+    // Called with sequence_ claimed (odd); the release fence keeps the
+    // snapshot stores after it, the final store makes it even again
+    std::atomic_thread_fence(std::memory_order_release);
+    const bool running = running_ && !awaitingClock_;
+    snapshotRunning_.store(running, std::memory_order_relaxed);
+    snapshotLocked_.store(tracked_ >= kClocksPerBeat, std::memory_order_relaxed);
+    snapshotBpm_.store(period_ > 0.0 ? 60.0 / (kClocksPerBeat * period_) : 0.0, std::memory_order_relaxed);
+    snapshotBeat_.store(static_cast<double>(running ? position_ : nextPosition_) / kClocksPerBeat,
+                        std::memory_order_relaxed);
+    snapshotTime_.store(phase_, std::memory_order_relaxed);
+    snapshotJitter_.store(jitter_, std::memory_order_relaxed);
+    snapshotClocks_.store(clocks_, std::memory_order_relaxed);
+    sequence_.fetch_add(1, std::memory_order_release);
+}
+
+void MidiClock::clock(double timestamp) {
+    clocks_++;
+    if (running_) {
+        position_ = nextPosition_++;
+        awaitingClock_ = false;
+    }
+
+    if (!haveClock_) {
+        haveClock_ = true;
+        phase_ = lastArrival_ = timestamp;
+        return;
+    }
+    const double interval = timestamp - lastArrival_;
+    if (!(interval > 0.0)) {
+        return;   // Same or earlier timestamp: counted, but says nothing about timing
+    }
+    lastArrival_ = timestamp;
+
+    if (period_ <= 0.0) {
+        period_ = interval;
+        phase_ = timestamp;
+        return;
+    }
+    if (interval > kDropoutPeriods * period_) {
+        phase_ = timestamp;
+        tracked_ = 0;
+        return;
+    }
+
+    const double predicted = phase_ + period_;
+    const double error = timestamp - predicted;
+    if (std::fabs(error) > 0.5 * period_) {
+        // Tempo jumped too far for the loop to pull in; start over from it
+        period_ = interval;
+        phase_ = timestamp;
+        tracked_ = 0;
+        return;
+    }
+
+    const bool acquiring = tracked_ < kClocksPerBeat;
+    phase_ = predicted + (acquiring ? kAcquirePhaseGain : kTrackPhaseGain) * error;
+    period_ += (acquiring ? kAcquirePeriodGain : kTrackPeriodGain) * error;
+    jitter_ += (std::fabs(error) - jitter_) * kJitterSmoothing;
+    tracked_++;
+}
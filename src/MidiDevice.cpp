@@ -1,4 +1,8 @@
 #include "../include/MidiDevice.h"
+#include "../include/DeviceRegistry.h"
+#include "../include/MidiRouter.h"
+#include "../include/MidiStatusTable.h"
+#include "../include/MidiStreamParser.h"
 #include <iostream>
 #include <algorithm>
 #include <chrono>
@@ -12,10 +16,16 @@
 #elif __APPLE__
 #include <CoreMIDI/CoreMIDI.h>
 #include <CoreFoundation/CoreFoundation.h>
+#include <map>
 #elif __linux__
 #include <alsa/asoundlib.h>
 #include <alsa/seq.h>
 #include <alsa/seq_midi_event.h>
+#include <cerrno>
+#include <map>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #endif
 
 /**
@@ -24,22 +34,59 @@
 class CrossPlatformMidiInterface : public MidiDeviceInterface {
 private:
     MidiInputCallback inputCallback_;
+    MidiSysExCallback sysExCallback_;
     DeviceConnectionCallback connectionCallback_;
-    std::vector<MidiDeviceInfo> availableDevices_;
+    DeviceRegistry devices_;
+    
+    // Open lists are also pruned by the input thread when a device unplugs
+    std::mutex openDevicesMutex_;
     std::vector<int> openInputDevices_;
     std::vector<int> openOutputDevices_;
+    std::atomic<bool> monitoring_{false};
     
 #ifdef _WIN32
-    std::vector<HMIDIIN> midiInHandles_;
+    // Passed to midiInOpen() as the callback instance, so each message
+    // carries the id of the device it came from
+    struct WinMidiInput {
+        CrossPlatformMidiInterface* owner;
+        int deviceId;
+        HMIDIIN handle;
+    };
+    std::vector<std::unique_ptr<WinMidiInput>> midiInputs_;
     std::vector<HMIDIOUT> midiOutHandles_;
 #elif __APPLE__
     MIDIClientRef midiClient_;
     MIDIPortRef inputPort_;
     MIDIPortRef outputPort_;
+    // One parser per connected source, passed to MIDIPortConnectSource() as
+    // its refCon so the read callback knows the source without a lookup
+    std::map<int, std::unique_ptr<MidiStreamParser>> sourceParsers_;
 #elif __linux__
-    snd_seq_t* seq_;
-    int inputPort_;
-    int outputPort_;
+    snd_seq_t* seq_ = nullptr;
+    int inputPort_ = -1;
+    int outputPort_ = -1;
+    
+    // Output: events are queued in the library's buffer and flushed with
+    // one snd_seq_drain_output() per call; encoder_ turns raw bytes (SysEx)
+    // into events
+    std::mutex outputMutex_;
+    snd_midi_event_t* encoder_ = nullptr;
+    static constexpr size_t kEncoderBufferSize = 1024;
+    
+    // Sequencer reader: blocks in poll() on the sequencer descriptors plus
+    // wakeFd_, which stopInputThread() signals
+    std::thread inputThread_;
+    std::atomic<bool> inputRunning_{false};
+    int wakeFd_ = -1;
+    
+    // Queue whose real-time clock stamps events as they reach the Input
+    // port; queueEpoch_ is its time zero on MidiDevice::timestampNow()'s clock
+    int queue_ = -1;
+    double queueEpoch_ = 0.0;
+    
+    // SysEx arrives as byte chunks that may split one message over several
+    // events; one parser per source device, used only by the reader thread
+    std::map<int, std::unique_ptr<MidiStreamParser>> sysExParsers_;
 #endif
 
 public:
@@ -53,19 +100,15 @@ public:
     }
     
     std::vector<MidiDeviceInfo> getAvailableDevices() override {
-        scanDevices();
-        return availableDevices_;
+        // While monitoring, hotplug events keep the registry current
+        if (!monitoring_) {
+            scanDevices();
+        }
+        return devices_.snapshot();
     }
     
     MidiDeviceInfo getDeviceInfo(int deviceId) override {
-        auto it = std::find_if(availableDevices_.begin(), availableDevices_.end(),
-                              [deviceId](const MidiDeviceInfo& device) {
-                                  return device.deviceId == deviceId;
-                              });
-        if (it != availableDevices_.end()) {
-            return *it;
-        }
-        return MidiDeviceInfo{-1, "Unknown", "Unknown", false, false, false, 0};
+        return devices_.find(deviceId);
     }
     
     bool isDeviceConnected(int deviceId) override {
@@ -74,6 +117,7 @@ public:
     }
     
     MidiError openInputDevice(int deviceId) override {
+        std::lock_guard<std::mutex> lock(openDevicesMutex_);
         if (std::find(openInputDevices_.begin(), openInputDevices_.end(), deviceId) != openInputDevices_.end()) {
             return MidiError::DeviceAlreadyOpen;
         }
@@ -86,6 +130,7 @@ public:
     }
     
     MidiError openOutputDevice(int deviceId) override {
+        std::lock_guard<std::mutex> lock(openDevicesMutex_);
         if (std::find(openOutputDevices_.begin(), openOutputDevices_.end(), deviceId) != openOutputDevices_.end()) {
             return MidiError::DeviceAlreadyOpen;
         }
@@ -100,14 +145,12 @@ public:
     MidiError closeDevice(int deviceId) override {
         closeInputDevicePlatform(deviceId);
         closeOutputDevicePlatform(deviceId);
-        
-        openInputDevices_.erase(std::remove(openInputDevices_.begin(), openInputDevices_.end(), deviceId), openInputDevices_.end());
-        openOutputDevices_.erase(std::remove(openOutputDevices_.begin(), openOutputDevices_.end(), deviceId), openOutputDevices_.end());
-        
+        forgetOpenDevice(deviceId);
         return MidiError::None;
     }
     
     void closeAllDevices() override {
+        std::lock_guard<std::mutex> lock(openDevicesMutex_);
         for (int deviceId : openInputDevices_) {
             closeInputDevicePlatform(deviceId);
         }
@@ -122,23 +165,91 @@ public:
         inputCallback_ = callback;
     }
     
+    void setSysExCallback(MidiSysExCallback callback) override {
+        sysExCallback_ = callback;
+    }
+    
     MidiError sendMessage(int deviceId, const RealTimeMidiMessage& message) override {
-        if (!isValidMidiMessage(message)) {
-            return MidiError::InvalidMessage;
+        return sendMessages(deviceId, &message, 1);
+    }
+    
+    MidiError sendMessages(int deviceId, const RealTimeMidiMessage* messages, size_t count) override {
+        MidiError error = checkOutput(deviceId, messages, count);
+        if (error != MidiError::None) {
+            return error;
         }
         
-        // Check if device exists first
-        auto device = getDeviceInfo(deviceId);
-        if (device.deviceId == -1) {
-            return MidiError::DeviceNotFound;
+#ifdef __linux__
+        return sendSequencerEvents(deviceId, messages, count);
+#else
+        for (size_t i = 0; i < count; ++i) {
+            auto data = serializeMidiMessage(messages[i]);
+            MidiError error = sendRawMessagePlatform(deviceId, data.data(), data.size());
+            if (error != MidiError::None) return error;
         }
-        
-        auto data = serializeMidiMessage(message);
-        return sendRawMessage(deviceId, data.data(), data.size());
+        return MidiError::None;
+#endif
+    }
+    
+    MidiError scheduleMessages(int deviceId, const RealTimeMidiMessage* messages, size_t count) override {
+#ifdef __linux__
+        // Real-time events on the queue that stamps input, so timestamps on
+        // both directions share one epoch
+        if (queue_ < 0) {
+            return MidiError::NotSupported;
+        }
+        MidiError error = checkOutput(deviceId, messages, count);
+        if (error != MidiError::None) {
+            return error;
+        }
+        return sendSequencerEvents(deviceId, messages, count, true);
+#else
+        return MidiDeviceInterface::scheduleMessages(deviceId, messages, count);
+#endif
+    }
+    
+    bool canScheduleMessages() override {
+#ifdef __linux__
+        return seq_ && queue_ >= 0;
+#else
+        return false;
+#endif
+    }
+    
+    MidiError cancelScheduledMessages(int deviceId) override {
+#ifdef __linux__
+        if (queue_ < 0) {
+            return MidiError::NotSupported;
+        }
+        std::lock_guard<std::mutex> lock(outputMutex_);
+        if (!seq_) {
+            return MidiError::DeviceNotConnected;
+        }
+        // Unsent output is shared by every destination, so it is only
+        // dropped wholesale when cancelling all of them
+        if (deviceId < 0) {
+            snd_seq_drop_output(seq_);
+        }
+        snd_seq_remove_events_t* remove;
+        snd_seq_remove_events_alloca(&remove);
+        unsigned int condition = SND_SEQ_REMOVE_OUTPUT;
+        if (deviceId >= 0) {
+            snd_seq_addr_t dest;
+            dest.client = static_cast<unsigned char>(deviceId / 1000);
+            dest.port = static_cast<unsigned char>(deviceId % 1000);
+            snd_seq_remove_events_set_dest(remove, &dest);
+            condition |= SND_SEQ_REMOVE_DEST;
+        }
+        snd_seq_remove_events_set_condition(remove, condition);
+        snd_seq_remove_events_set_queue(remove, queue_);
+        return snd_seq_remove_events(seq_, remove) < 0 ? MidiError::SystemError : MidiError::None;
+#else
+        return MidiDeviceInterface::cancelScheduledMessages(deviceId);
+#endif
     }
     
     MidiError sendRawMessage(int deviceId, const uint8_t* data, size_t length) override {
-        if (std::find(openOutputDevices_.begin(), openOutputDevices_.end(), deviceId) == openOutputDevices_.end()) {
+        if (!isOpenForOutput(deviceId)) {
             return MidiError::DeviceNotConnected;
         }
         
@@ -150,11 +261,32 @@ public:
     }
     
     void startDeviceMonitoring() override {
-        // Platform-specific device monitoring would go here
+#ifdef __linux__
+        // The System:Announce port reports every client and port that starts
+        // or exits; the input thread applies them to the registry
+        if (monitoring_ || !seq_ || inputPort_ < 0) {
+            return;
+        }
+        if (snd_seq_connect_from(seq_, inputPort_, SND_SEQ_CLIENT_SYSTEM, SND_SEQ_PORT_SYSTEM_ANNOUNCE) < 0) {
+            return;
+        }
+        if (!startInputThread()) {
+            snd_seq_disconnect_from(seq_, inputPort_, SND_SEQ_CLIENT_SYSTEM, SND_SEQ_PORT_SYSTEM_ANNOUNCE);
+            return;
+        }
+        scanDevices();
+        monitoring_ = true;
+#endif
     }
     
     void stopDeviceMonitoring() override {
-        // Platform-specific device monitoring stop would go here
+#ifdef __linux__
+        if (!monitoring_) {
+            return;
+        }
+        monitoring_ = false;
+        snd_seq_disconnect_from(seq_, inputPort_, SND_SEQ_CLIENT_SYSTEM, SND_SEQ_PORT_SYSTEM_ANNOUNCE);
+#endif
     }
     
     std::string getErrorString(MidiError error) override {
@@ -173,18 +305,7 @@ public:
     }
     
     MidiMessageType getMessageType(uint8_t status) override {
-        uint8_t messageType = status & 0xF0;
-        switch (messageType) {
-            case 0x80: return MidiMessageType::NoteOff;
-            case 0x90: return MidiMessageType::NoteOn;
-            case 0xA0: return MidiMessageType::PolyphonicAftertouch;
-            case 0xB0: return MidiMessageType::ControlChange;
-            case 0xC0: return MidiMessageType::ProgramChange;
-            case 0xD0: return MidiMessageType::ChannelAftertouch;
-            case 0xE0: return MidiMessageType::PitchBend;
-            case 0xF0: return MidiMessageType::SystemExclusive;
-            default: return MidiMessageType::Unknown;
-        }
+        return MidiStatusTable::type(status);
     }
     
     bool isValidMidiMessage(const RealTimeMidiMessage& message) override {
@@ -207,6 +328,35 @@ public:
     }
 
 private:
+    bool isOpenForOutput(int deviceId) {
+        std::lock_guard<std::mutex> lock(openDevicesMutex_);
+        return std::find(openOutputDevices_.begin(), openOutputDevices_.end(), deviceId) != openOutputDevices_.end();
+    }
+    
+    MidiError checkOutput(int deviceId, const RealTimeMidiMessage* messages, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!isValidMidiMessage(messages[i])) {
+                return MidiError::InvalidMessage;
+            }
+        }
+        
+        // Check if device exists first
+        auto device = getDeviceInfo(deviceId);
+        if (device.deviceId == -1) {
+            return MidiError::DeviceNotFound;
+        }
+        if (!isOpenForOutput(deviceId)) {
+            return MidiError::DeviceNotConnected;
+        }
+        return MidiError::None;
+    }
+    
+    void forgetOpenDevice(int deviceId) {
+        std::lock_guard<std::mutex> lock(openDevicesMutex_);
+        openInputDevices_.erase(std::remove(openInputDevices_.begin(), openInputDevices_.end(), deviceId), openInputDevices_.end());
+        openOutputDevices_.erase(std::remove(openOutputDevices_.begin(), openOutputDevices_.end(), deviceId), openOutputDevices_.end());
+    }
+    
     void initializePlatform() {
 #ifdef _WIN32
         // Windows MIDI initialization
@@ -216,13 +366,18 @@ private:
         MIDIInputPortCreate(midiClient_, CFSTR("Input"), midiInputCallback, this, &inputPort_);
         MIDIOutputPortCreate(midiClient_, CFSTR("Output"), &outputPort_);
 #elif __linux__
-        // Linux ALSA MIDI initialization
-        if (snd_seq_open(&seq_, "default", SND_SEQ_OPEN_DUPLEX, 0) >= 0) {
+        // Linux ALSA MIDI initialization. Non-blocking, because the reader
+        // thread waits in poll() and then drains until EAGAIN.
+        if (snd_seq_open(&seq_, "default", SND_SEQ_OPEN_DUPLEX, SND_SEQ_NONBLOCK) < 0) {
+            seq_ = nullptr;
+        } else {
             snd_seq_set_client_name(seq_, "PianoSynth");
-            inputPort_ = snd_seq_create_simple_port(seq_, "Input", 
-                SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE, SND_SEQ_PORT_TYPE_APPLICATION);
+            inputPort_ = createInputPort();
             outputPort_ = snd_seq_create_simple_port(seq_, "Output",
                 SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ, SND_SEQ_PORT_TYPE_APPLICATION);
+            if (snd_midi_event_new(kEncoderBufferSize, &encoder_) < 0) {
+                encoder_ = nullptr;
+            }
         }
 #endif
     }
@@ -235,14 +390,24 @@ private:
             MIDIClientDispose(midiClient_);
         }
 #elif __linux__
+        stopInputThread();
+        if (encoder_) {
+            snd_midi_event_free(encoder_);
+            encoder_ = nullptr;
+        }
         if (seq_) {
+            if (queue_ >= 0) {
+                snd_seq_free_queue(seq_, queue_);
+                queue_ = -1;
+            }
             snd_seq_close(seq_);
+            seq_ = nullptr;
         }
 #endif
     }
     
     void scanDevices() {
-        availableDevices_.clear();
+        std::vector<MidiDeviceInfo> found;
         
 #ifdef _WIN32
         // Windows MIDI device enumeration
@@ -258,7 +423,7 @@ private:
                 device.isOutput = false;
                 device.isConnected = true;
                 device.portCount = 1;
-                availableDevices_.push_back(device);
+                found.push_back(device);
             }
         }
         
@@ -274,7 +439,7 @@ private:
                 device.isOutput = true;
                 device.isConnected = true;
                 device.portCount = 1;
-                availableDevices_.push_back(device);
+                found.push_back(device);
             }
         }
 #elif __APPLE__
@@ -302,7 +467,7 @@ private:
             device.isOutput = false;
             device.isConnected = true;
             device.portCount = 1;
-            availableDevices_.push_back(device);
+            found.push_back(device);
         }
 #elif __linux__
         // Linux ALSA MIDI device enumeration
@@ -313,24 +478,18 @@ private:
             snd_seq_client_info_alloca(&clientInfo);
             snd_seq_port_info_alloca(&portInfo);
             
+            const int ownClient = snd_seq_client_id(seq_);
             snd_seq_client_info_set_client(clientInfo, -1);
             while (snd_seq_query_next_client(seq_, clientInfo) >= 0) {
                 int clientId = snd_seq_client_info_get_client(clientInfo);
+                if (clientId == ownClient) continue;
                 
                 snd_seq_port_info_set_client(portInfo, clientId);
                 snd_seq_port_info_set_port(portInfo, -1);
                 while (snd_seq_query_next_port(seq_, portInfo) >= 0) {
-                    unsigned int caps = snd_seq_port_info_get_capability(portInfo);
-                    if (caps & (SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_WRITE)) {
-                        MidiDeviceInfo device;
-                        device.deviceId = clientId * 1000 + snd_seq_port_info_get_port(portInfo);
-                        device.name = snd_seq_port_info_get_name(portInfo);
-                        device.manufacturer = snd_seq_client_info_get_name(clientInfo);
-                        device.isInput = caps & SND_SEQ_PORT_CAP_WRITE;
-                        device.isOutput = caps & SND_SEQ_PORT_CAP_READ;
-                        device.isConnected = true;
-                        device.portCount = 1;
-                        availableDevices_.push_back(device);
+                    MidiDeviceInfo device;
+                    if (describePort(clientInfo, portInfo, device)) {
+                        found.push_back(device);
                     }
                 }
             }
@@ -345,26 +504,47 @@ private:
         mockDevice.isOutput = true;
         mockDevice.isConnected = true;
         mockDevice.portCount = 1;
-        availableDevices_.push_back(mockDevice);
+        found.push_back(mockDevice);
 #endif
+        devices_.replaceAll(found);
     }
     
     bool openInputDevicePlatform(int deviceId) {
 #ifdef _WIN32
-        HMIDIIN handle;
-        MMRESULT result = midiInOpen(&handle, deviceId, reinterpret_cast<DWORD_PTR>(midiInputCallback), 
-                                    reinterpret_cast<DWORD_PTR>(this), CALLBACK_FUNCTION);
+        std::unique_ptr<WinMidiInput> input(new WinMidiInput{this, deviceId, nullptr});
+        MMRESULT result = midiInOpen(&input->handle, deviceId, reinterpret_cast<DWORD_PTR>(midiInputCallback), 
+                                    reinterpret_cast<DWORD_PTR>(input.get()), CALLBACK_FUNCTION);
         if (result == MMSYSERR_NOERROR) {
-            midiInStart(handle);
-            midiInHandles_.push_back(handle);
+            midiInStart(input->handle);
+            midiInputs_.push_back(std::move(input));
             return true;
         }
 #elif __APPLE__
-        // macOS implementation would go here
+        if (deviceId < 0 || static_cast<ItemCount>(deviceId) >= MIDIGetNumberOfSources()) {
+            return false;
+        }
+        std::unique_ptr<MidiStreamParser> parser(new MidiStreamParser(
+            [this](const RealTimeMidiMessage& message) {
+                if (inputCallback_) inputCallback_(message);
+            },
+            [this](const MidiSysExMessage& message) {
+                if (sysExCallback_) sysExCallback_(message);
+            },
+            deviceId));
+        if (MIDIPortConnectSource(inputPort_, MIDIGetSource(deviceId), parser.get()) != noErr) {
+            return false;
+        }
+        sourceParsers_[deviceId] = std::move(parser);
         return true;
 #elif __linux__
-        // Linux implementation would go here
-        return true;
+        // Subscribe our Input port to the device's client:port
+        if (!seq_ || inputPort_ < 0) {
+            return false;
+        }
+        if (snd_seq_connect_from(seq_, inputPort_, deviceId / 1000, deviceId % 1000) < 0) {
+            return false;
+        }
+        return startInputThread();
 #endif
         return false;
     }
@@ -381,20 +561,34 @@ private:
         // macOS implementation would go here
         return true;
 #elif __linux__
-        // Linux implementation would go here
-        return true;
+        if (!seq_ || outputPort_ < 0) {
+            return false;
+        }
+        return snd_seq_connect_to(seq_, outputPort_, deviceId / 1000, deviceId % 1000) >= 0;
 #endif
         return false;
     }
     
     void closeInputDevicePlatform(int deviceId) {
 #ifdef _WIN32
-        // Find and close the corresponding handle
-        for (auto it = midiInHandles_.begin(); it != midiInHandles_.end(); ++it) {
-            midiInStop(*it);
-            midiInClose(*it);
+        for (auto it = midiInputs_.begin(); it != midiInputs_.end(); ++it) {
+            if ((*it)->deviceId == deviceId) {
+                midiInStop((*it)->handle);
+                midiInClose((*it)->handle);
+                midiInputs_.erase(it);
+                break;
+            }
+        }
+#elif __APPLE__
+        auto parser = sourceParsers_.find(deviceId);
+        if (parser != sourceParsers_.end()) {
+            MIDIPortDisconnectSource(inputPort_, MIDIGetSource(deviceId));
+            sourceParsers_.erase(parser);
+        }
+#elif __linux__
+        if (seq_ && inputPort_ >= 0) {
+            snd_seq_disconnect_from(seq_, inputPort_, deviceId / 1000, deviceId % 1000);
         }
-        midiInHandles_.clear();
 #endif
     }
     
@@ -404,6 +598,10 @@ private:
             midiOutClose(*it);
         }
         midiOutHandles_.clear();
+#elif __linux__
+        if (seq_ && outputPort_ >= 0) {
+            snd_seq_disconnect_to(seq_, outputPort_, deviceId / 1000, deviceId % 1000);
+        }
 #endif
     }
     
@@ -417,36 +615,30 @@ private:
             MMRESULT result = midiOutShortMsg(midiOutHandles_[0], message);
             return (result == MMSYSERR_NOERROR) ? MidiError::None : MidiError::SystemError;
         }
+#elif __linux__
+        std::lock_guard<std::mutex> lock(outputMutex_);
+        if (!seq_ || outputPort_ < 0) {
+            return MidiError::DeviceNotConnected;
+        }
+        MidiError error = queueRawBytes(deviceId, data, length);
+        if (error != MidiError::None) {
+            snd_seq_drop_output(seq_);
+            return error;
+        }
+        return drainOutput();
 #endif
         return MidiError::DeviceNotConnected;
     }
     
     std::vector<uint8_t> serializeMidiMessage(const RealTimeMidiMessage& message) {
-        std::vector<uint8_t> data;
-        data.push_back(message.status | (message.channel - 1));
-        
-        MidiMessageType type = getMessageType(message.status);
-        switch (type) {
-            case MidiMessageType::NoteOn:
-            case MidiMessageType::NoteOff:
-            case MidiMessageType::ControlChange:
-                data.push_back(message.data1);
-                data.push_back(message.data2);
-                break;
-            case MidiMessageType::ProgramChange:
-            case MidiMessageType::ChannelAftertouch:
-                data.push_back(message.data1);
-                break;
-            default:
-                break;
-        }
-        return data;
+        return MidiDevice::serializeMidiMessage(message);
     }
 
 #ifdef _WIN32
     static void CALLBACK midiInputCallback(HMIDIIN hMidiIn, UINT wMsg, DWORD_PTR dwInstance, DWORD_PTR dwParam1, DWORD_PTR dwParam2) {
         if (wMsg == MIM_DATA) {
-            CrossPlatformMidiInterface* interface = reinterpret_cast<CrossPlatformMidiInterface*>(dwInstance);
+            WinMidiInput* input = reinterpret_cast<WinMidiInput*>(dwInstance);
+            CrossPlatformMidiInterface* interface = input ? input->owner : nullptr;
             if (interface && interface->inputCallback_) {
                 // Parse the MIDI message
                 DWORD midiMessage = static_cast<DWORD>(dwParam1);
@@ -455,8 +647,8 @@ private:
                 msg.data1 = (midiMessage >> 8) & 0xFF;
                 msg.data2 = (midiMessage >> 16) & 0xFF;
                 msg.channel = (msg.status & 0x0F) + 1;
-                msg.timestamp = std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-                msg.deviceId = 0; // Would need to map handle to device ID
+                msg.timestamp = MidiDevice::timestampNow();
+                msg.deviceId = input->deviceId;
                 
                 interface->inputCallback_(msg);
             }
@@ -464,23 +656,393 @@ private:
     }
 #elif __APPLE__
     static void midiInputCallback(const MIDIPacketList* packetList, void* readProcRefCon, void* srcConnRefCon) {
-        CrossPlatformMidiInterface* interface = reinterpret_cast<CrossPlatformMidiInterface*>(readProcRefCon);
-        if (interface && interface->inputCallback_) {
-            const MIDIPacket* packet = &packetList->packet[0];
-            for (UInt32 i = 0; i < packetList->numPackets; ++i) {
-                if (packet->length >= 2) {
-                    RealTimeMidiMessage msg;
-                    msg.status = packet->data[0];
-                    msg.data1 = packet->length > 1 ? packet->data[1] : 0;
-                    msg.data2 = packet->length > 2 ? packet->data[2] : 0;
-                    msg.channel = (msg.status & 0x0F) + 1;
-                    msg.timestamp = std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-                    msg.deviceId = 0;
-                    
-                    interface->inputCallback_(msg);
-                }
-                packet = MIDIPacketNext(packet);
+        (void)readProcRefCon;
+        MidiStreamParser* parser = reinterpret_cast<MidiStreamParser*>(srcConnRefCon);
+        if (!parser) return;
+        // A packet may hold several messages, use running status, or carry
+        // part of a SysEx message that continues in the next packet
+        const double now = MidiDevice::timestampNow();
+        const MIDIPacket* packet = &packetList->packet[0];
+        for (UInt32 i = 0; i < packetList->numPackets; ++i) {
+            parser->feed(packet->data, packet->length, now);
+            packet = MIDIPacketNext(packet);
+        }
+    }
+#elif __linux__
+    int createInputPort() {
+        // Ask the kernel to stamp arriving events with our queue's real time,
+        // so timestamps exclude the reader thread's wakeup delay
+        queue_ = snd_seq_alloc_named_queue(seq_, "PianoSynth");
+        
+        snd_seq_port_info_t* info;
+        snd_seq_port_info_alloca(&info);
+        snd_seq_port_info_set_name(info, "Input");
+        snd_seq_port_info_set_capability(info, SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE);
+        snd_seq_port_info_set_type(info, SND_SEQ_PORT_TYPE_APPLICATION);
+        if (queue_ >= 0) {
+            snd_seq_port_info_set_timestamping(info, 1);
+            snd_seq_port_info_set_timestamp_real(info, 1);
+            snd_seq_port_info_set_timestamp_queue(info, queue_);
+        }
+        if (snd_seq_create_port(seq_, info) < 0) {
+            return -1;
+        }
+        
+        if (queue_ >= 0) {
+            // The start is processed while the drain writes it, so the
+            // midpoint bounds the epoch error by half the call's duration
+            const double before = MidiDevice::timestampNow();
+            snd_seq_start_queue(seq_, queue_, nullptr);
+            const int drained = snd_seq_drain_output(seq_);
+            const double after = MidiDevice::timestampNow();
+            queueEpoch_ = 0.5 * (before + after);
+            if (drained < 0) {
+                snd_seq_free_queue(seq_, queue_);
+                queue_ = -1;
+            }
+        }
+        return snd_seq_port_info_get_port(info);
+    }
+    
+    snd_seq_real_time_t queueTime(double timestamp) const {
+        // Times before the queue started (or already past) are due at once
+        const double offset = std::max(0.0, timestamp - queueEpoch_);
+        snd_seq_real_time_t time;
+        time.tv_sec = static_cast<unsigned int>(offset);
+        time.tv_nsec = static_cast<unsigned int>((offset - time.tv_sec) * 1e9);
+        return time;
+    }
+    
+    double sequencerTimestamp(const snd_seq_event_t& event) const {
+        const double now = MidiDevice::timestampNow();
+        if (queue_ < 0 || event.queue != queue_ ||
+            (event.flags & SND_SEQ_TIME_STAMP_MASK) != SND_SEQ_TIME_STAMP_REAL) {
+            return now;
+        }
+        const double stamped = queueEpoch_ + event.time.time.tv_sec + event.time.time.tv_nsec * 1e-9;
+        // The queue timer is not the steady clock; never report an arrival from the future
+        return std::min(stamped, now);
+    }
+    
+    MidiError sendSequencerEvents(int deviceId, const RealTimeMidiMessage* messages, size_t count, bool scheduled = false) {
+        std::lock_guard<std::mutex> lock(outputMutex_);
+        if (!seq_ || outputPort_ < 0) {
+            return MidiError::DeviceNotConnected;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            snd_seq_event_t event;
+            snd_seq_ev_clear(&event);
+            const snd_seq_real_time_t at = scheduled ? queueTime(messages[i].timestamp) : snd_seq_real_time_t();
+            MidiError error;
+            if (fillSequencerEvent(messages[i], event)) {
+                error = queueEvent(deviceId, event, scheduled ? &at : nullptr);
+            } else {
+                // System messages have no direct event fill; go through the encoder
+                auto data = serializeMidiMessage(messages[i]);
+                error = queueRawBytes(deviceId, data.data(), data.size(), scheduled ? &at : nullptr);
+            }
+            if (error != MidiError::None) {
+                snd_seq_drop_output(seq_);
+                return error;
+            }
+        }
+        return drainOutput();
+    }
+    
+    static bool fillSequencerEvent(const RealTimeMidiMessage& message, snd_seq_event_t& event) {
+        const int channel = (message.channel - 1) & 0x0F;
+        switch (message.status & 0xF0) {
+            case 0x80: snd_seq_ev_set_noteoff(&event, channel, message.data1, message.data2); break;
+            case 0x90: snd_seq_ev_set_noteon(&event, channel, message.data1, message.data2); break;
+            case 0xA0: snd_seq_ev_set_keypress(&event, channel, message.data1, message.data2); break;
+            case 0xB0: snd_seq_ev_set_controller(&event, channel, message.data1, message.data2); break;
+            case 0xC0: snd_seq_ev_set_pgmchange(&event, channel, message.data1); break;
+            case 0xD0: snd_seq_ev_set_chanpress(&event, channel, message.data1); break;
+            case 0xE0: snd_seq_ev_set_pitchbend(&event, channel, ((message.data2 << 7) | message.data1) - 8192); break;
+            default: return false;
+        }
+        return true;
+    }
+    
+    MidiError queueRawBytes(int deviceId, const uint8_t* data, size_t length, const snd_seq_real_time_t* at = nullptr) {
+        if (!encoder_) {
+            return MidiError::NotSupported;
+        }
+        snd_midi_event_reset_encode(encoder_);
+        while (length > 0) {
+            snd_seq_event_t event;
+            snd_seq_ev_clear(&event);
+            const long used = snd_midi_event_encode(encoder_, data, static_cast<long>(length), &event);
+            if (used <= 0) {
+                return MidiError::InvalidMessage;
+            }
+            data += used;
+            length -= static_cast<size_t>(used);
+            if (event.type != SND_SEQ_EVENT_NONE) {
+                MidiError error = queueEvent(deviceId, event, at);
+                if (error != MidiError::None) return error;
+            }
+        }
+        return MidiError::None;
+    }
+    
+    // at: absolute queue time to deliver at, or nullptr to send now
+    MidiError queueEvent(int deviceId, snd_seq_event_t& event, const snd_seq_real_time_t* at = nullptr) {
+        snd_seq_ev_set_source(&event, outputPort_);
+        snd_seq_ev_set_dest(&event, deviceId / 1000, deviceId % 1000);
+        if (at) {
+            snd_seq_ev_schedule_real(&event, queue_, 0, at);
+        } else {
+            snd_seq_ev_set_direct(&event);
+        }
+        int result;
+        while ((result = snd_seq_event_output_buffer(seq_, &event)) == -EAGAIN) {
+            // Library buffer full: hand what is queued to the kernel and retry
+            MidiError error = drainOutput();
+            if (error != MidiError::None) return error;
+        }
+        return result < 0 ? MidiError::SystemError : MidiError::None;
+    }
+    
+    MidiError drainOutput() {
+        // The handle is non-blocking, so a full kernel pool shows up as a
+        // positive remainder or -EAGAIN; wait for room and continue
+        while (true) {
+            const int result = snd_seq_drain_output(seq_);
+            if (result == 0) {
+                return MidiError::None;
+            }
+            if (result != -EAGAIN && result < 0) {
+                return MidiError::SystemError;
+            }
+            if (!waitWritable()) {
+                snd_seq_drop_output(seq_);
+                return MidiError::DeviceBusy;
+            }
+        }
+    }
+    
+    bool waitWritable() {
+        constexpr int kTimeoutMs = 100;
+        const int count = snd_seq_poll_descriptors_count(seq_, POLLOUT);
+        if (count <= 0) {
+            return false;
+        }
+        std::vector<pollfd> fds(count);
+        snd_seq_poll_descriptors(seq_, fds.data(), count, POLLOUT);
+        return poll(fds.data(), fds.size(), kTimeoutMs) > 0;
+    }
+    
+    bool startInputThread() {
+        if (inputThread_.joinable()) {
+            return true;
+        }
+        wakeFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (wakeFd_ < 0) {
+            return false;
+        }
+        inputRunning_ = true;
+        inputThread_ = std::thread(&CrossPlatformMidiInterface::inputThreadFunction, this);
+        return true;
+    }
+    
+    void stopInputThread() {
+        if (!inputThread_.joinable()) {
+            return;
+        }
+        inputRunning_ = false;
+        const uint64_t one = 1;
+        const ssize_t written = ::write(wakeFd_, &one, sizeof(one));
+        (void)written;
+        inputThread_.join();
+        ::close(wakeFd_);
+        wakeFd_ = -1;
+        sysExParsers_.clear();
+    }
+    
+    void inputThreadFunction() {
+        const int count = snd_seq_poll_descriptors_count(seq_, POLLIN);
+        std::vector<pollfd> fds(1 + std::max(count, 0));
+        fds[0].fd = wakeFd_;
+        fds[0].events = POLLIN;
+        if (count > 0) {
+            snd_seq_poll_descriptors(seq_, fds.data() + 1, count, POLLIN);
+        }
+        
+        while (inputRunning_) {
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            drainSequencerInput();
+        }
+    }
+    
+    void drainSequencerInput() {
+        // Empties both the library's input buffer and the kernel queue, so
+        // a burst such as a chord costs one wakeup
+        snd_seq_event_t* event = nullptr;
+        while (true) {
+            const int result = snd_seq_event_input(seq_, &event);
+            if (result == -ENOSPC) {
+                continue; // Kernel queue overran and lost events; keep reading what is left
+            }
+            if (result < 0) {
+                break; // -EAGAIN once empty
             }
+            if (event) {
+                deliverSequencerEvent(*event);
+            }
+        }
+    }
+    
+    bool describePort(snd_seq_client_info_t* clientInfo, const snd_seq_port_info_t* portInfo, MidiDeviceInfo& device) {
+        const unsigned int caps = snd_seq_port_info_get_capability(portInfo);
+        if (!(caps & (SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_WRITE))) {
+            return false;
+        }
+        device.deviceId = snd_seq_client_info_get_client(clientInfo) * 1000 + snd_seq_port_info_get_port(portInfo);
+        device.name = snd_seq_port_info_get_name(portInfo);
+        device.manufacturer = snd_seq_client_info_get_name(clientInfo);
+        // Directions are ours: we receive from readable ports
+        // (keyboards) and send to writable ones (synths)
+        device.isInput = caps & SND_SEQ_PORT_CAP_READ;
+        device.isOutput = caps & SND_SEQ_PORT_CAP_WRITE;
+        device.isConnected = true;
+        device.portCount = 1;
+        return true;
+    }
+    
+    void notifyConnection(const MidiDeviceInfo& device, bool connected) {
+        if (connectionCallback_) {
+            connectionCallback_(device, connected);
+        }
+    }
+    
+    void handlePortAnnounce(int client, int port) {
+        if (client == snd_seq_client_id(seq_)) {
+            return;
+        }
+        snd_seq_client_info_t* clientInfo;
+        snd_seq_port_info_t* portInfo;
+        snd_seq_client_info_alloca(&clientInfo);
+        snd_seq_port_info_alloca(&portInfo);
+        MidiDeviceInfo device;
+        if (snd_seq_get_any_client_info(seq_, client, clientInfo) < 0 ||
+            snd_seq_get_any_port_info(seq_, client, port, portInfo) < 0 ||
+            !describePort(clientInfo, portInfo, device)) {
+            handlePortExit(client, port); // Gone already, or no longer usable
+            return;
+        }
+        if (devices_.update(device)) {
+            notifyConnection(device, true);
+        }
+    }
+    
+    void handlePortExit(int client, int port) {
+        MidiDeviceInfo device;
+        if (devices_.remove(client * 1000 + port, &device)) {
+            // The kernel already dropped our subscriptions to it
+            forgetOpenDevice(device.deviceId);
+            sysExParsers_.erase(device.deviceId);
+            device.isConnected = false;
+            notifyConnection(device, false);
+        }
+    }
+    
+    void handleClientExit(int client) {
+        auto removed = devices_.removeIf([client](const MidiDeviceInfo& device) {
+            return device.deviceId / 1000 == client;
+        });
+        for (auto& device : removed) {
+            forgetOpenDevice(device.deviceId);
+            sysExParsers_.erase(device.deviceId);
+            device.isConnected = false;
+            notifyConnection(device, false);
+        }
+    }
+    
+    void deliverSequencerSysEx(const snd_seq_event_t& event) {
+        const int deviceId = event.source.client * 1000 + event.source.port;
+        std::unique_ptr<MidiStreamParser>& parser = sysExParsers_[deviceId];
+        if (!parser) {
+            parser.reset(new MidiStreamParser(
+                [this](const RealTimeMidiMessage& message) {
+                    if (inputCallback_) inputCallback_(message);
+                },
+                [this](const MidiSysExMessage& message) {
+                    if (sysExCallback_) sysExCallback_(message);
+                },
+                deviceId));
+        }
+        parser->feed(static_cast<const uint8_t*>(event.data.ext.ptr), event.data.ext.len, sequencerTimestamp(event));
+    }
+    
+    void deliverSequencerEvent(const snd_seq_event_t& event) {
+        RealTimeMidiMessage msg;
+        msg.data1 = 0;
+        msg.data2 = 0;
+        msg.channel = 1;
+        switch (event.type) {
+            case SND_SEQ_EVENT_NOTEON:
+            case SND_SEQ_EVENT_NOTEOFF:
+            case SND_SEQ_EVENT_KEYPRESS:
+                msg.status = event.type == SND_SEQ_EVENT_NOTEON ? 0x90 : event.type == SND_SEQ_EVENT_NOTEOFF ? 0x80 : 0xA0;
+                msg.channel = (event.data.note.channel & 0x0F) + 1;
+                msg.data1 = event.data.note.note & 0x7F;
+                msg.data2 = event.data.note.velocity & 0x7F;
+                break;
+            case SND_SEQ_EVENT_CONTROLLER:
+                msg.status = 0xB0;
+                msg.channel = (event.data.control.channel & 0x0F) + 1;
+                msg.data1 = event.data.control.param & 0x7F;
+                msg.data2 = event.data.control.value & 0x7F;
+                break;
+            case SND_SEQ_EVENT_PGMCHANGE:
+            case SND_SEQ_EVENT_CHANPRESS:
+                msg.status = event.type == SND_SEQ_EVENT_PGMCHANGE ? 0xC0 : 0xD0;
+                msg.channel = (event.data.control.channel & 0x0F) + 1;
+                msg.data1 = event.data.control.value & 0x7F;
+                break;
+            case SND_SEQ_EVENT_PITCHBEND: {
+                // ALSA reports -8192..8191; MIDI carries 0..16383 as two 7-bit bytes
+                const int value = std::max(0, std::min(16383, event.data.control.value + 8192));
+                msg.status = 0xE0;
+                msg.channel = (event.data.control.channel & 0x0F) + 1;
+                msg.data1 = value & 0x7F;
+                msg.data2 = (value >> 7) & 0x7F;
+                break;
+            }
+            case SND_SEQ_EVENT_SONGPOS:
+                msg.status = 0xF2;
+                msg.data1 = event.data.control.value & 0x7F;
+                msg.data2 = (event.data.control.value >> 7) & 0x7F;
+                break;
+            case SND_SEQ_EVENT_CLOCK: msg.status = 0xF8; break;
+            case SND_SEQ_EVENT_START: msg.status = 0xFA; break;
+            case SND_SEQ_EVENT_CONTINUE: msg.status = 0xFB; break;
+            case SND_SEQ_EVENT_STOP: msg.status = 0xFC; break;
+            case SND_SEQ_EVENT_SYSEX:
+                deliverSequencerSysEx(event);
+                return;
+            case SND_SEQ_EVENT_PORT_START:
+            case SND_SEQ_EVENT_PORT_CHANGE:
+                handlePortAnnounce(event.data.addr.client, event.data.addr.port);
+                return;
+            case SND_SEQ_EVENT_PORT_EXIT:
+                handlePortExit(event.data.addr.client, event.data.addr.port);
+                return;
+            case SND_SEQ_EVENT_CLIENT_EXIT:
+                handleClientExit(event.data.addr.client);
+                return;
+            default:
+                return; // Subscription and other sequencer notices
+        }
+        msg.timestamp = sequencerTimestamp(event);
+        msg.deviceId = event.source.client * 1000 + event.source.port;
+        
+        if (inputCallback_) {
+            inputCallback_(msg);
         }
     }
 #endif
@@ -489,18 +1051,36 @@ private:
 // MidiDevice implementation
 MidiDevice::MidiDevice() 
     : interface_(nullptr)
+    , deviceRegistry_(new DeviceRegistry())
+    , isProcessing_(false)
     , oxygenProDeviceId_(-1)
     , oxygenProConnected_(false)
-    , isProcessing_(false)
+    , oxygenProAwaitingReplug_(false)
     , messagesReceived_(0)
     , messagesSent_(0)
     , droppedMessages_(0)
-    , lastError_(MidiError::None)
+    , errorCount_(0)
+    , lastError_(0)
+    , errorDetailSequence_(0)
     , bufferSize_(1024)
     , latencyTarget_(10.0)
-    , velocityCurveEnabled_(false)
-    , avgInputLatency_(0.0)
-    , avgOutputLatency_(0.0) {
+    , velocityTable_(nullptr)
+    , velocityCurrent_(nullptr)
+    , clockSource_(-1)
+    , avgOutputLatency_(0.0)
+    , keyEventHistory_(new KeyEventHistory(MAX_KEY_EVENT_HISTORY)) {
+    clearInputFilter();
+    const VelocityTable linear = VelocityCurve::fromPreset(VelocityCurve::Preset::Linear);
+    for (auto& buffer : velocityBuffers_) {
+        for (size_t i = 0; i < buffer.size(); ++i) {
+            buffer[i].store(linear[i], std::memory_order_relaxed);
+        }
+    }
+    velocityCurrent_ = &velocityBuffers_[0];
+    inputLanes_.reserve(kMaxInputDevices);
+    for (size_t i = 0; i < kMaxInputDevices; ++i) {
+        inputLanes_.emplace_back(new InputLane(kMessageQueueCapacity));
+    }
 }
 
 MidiDevice::~MidiDevice() {
@@ -508,13 +1088,28 @@ MidiDevice::~MidiDevice() {
 }
 
 bool MidiDevice::initialize() {
-    interface_ = std::make_unique<CrossPlatformMidiInterface>();
+    return initialize(std::make_unique<CrossPlatformMidiInterface>());
+}
+
+bool MidiDevice::initialize(std::unique_ptr<MidiDeviceInterface> backend) {
+    if (!backend) return false;
+    if (interface_) {
+        interface_->stopDeviceMonitoring();
+        interface_->closeAllDevices();
+    }
+    interface_ = std::move(backend);
     
     // Set up callbacks
     interface_->setInputCallback([this](const RealTimeMidiMessage& message) {
         handleMidiMessage(message);
     });
     
+    interface_->setSysExCallback([this](const MidiSysExMessage& message) {
+        if (sysExCallback_) {
+            sysExCallback_(message);
+        }
+    });
+    
     interface_->setDeviceConnectionCallback([this](const MidiDeviceInfo& device, bool connected) {
         handleDeviceConnection(device, connected);
     });
@@ -543,32 +1138,35 @@ std::vector<MidiDeviceInfo> MidiDevice::scanForDevices() {
     if (!interface_) return {};
     
     auto devices = interface_->getAvailableDevices();
-    connectedDevices_ = devices;
+    deviceRegistry_->replaceAll(devices);
     return devices;
 }
 
 MidiDeviceInfo MidiDevice::findDevice(const std::string& namePattern) {
-    auto devices = scanForDevices();
-    auto it = std::find_if(devices.begin(), devices.end(),
-                          [&namePattern](const MidiDeviceInfo& device) {
-                              return device.name.find(namePattern) != std::string::npos;
-                          });
-    
-    if (it != devices.end()) {
-        return *it;
+    if (deviceRegistry_->empty()) {
+        scanForDevices();
+    }
+    MidiDeviceInfo device = deviceRegistry_->findByName(namePattern);
+    if (device.deviceId == -1) {
+        device = deviceRegistry_->findFirst([&namePattern](const MidiDeviceInfo& candidate) {
+            return candidate.name.find(namePattern) != std::string::npos;
+        });
+    }
+    if (device.deviceId != -1) {
+        return device;
     }
     return MidiDeviceInfo{-1, "Not Found", "Unknown", false, false, false, 0};
 }
 
 MidiDeviceInfo MidiDevice::findMAudioOxygenPro() {
-    auto devices = scanForDevices();
-    auto it = std::find_if(devices.begin(), devices.end(),
-                          [this](const MidiDeviceInfo& device) {
-                              return identifyOxygenPro(device);
-                          });
-    
-    if (it != devices.end()) {
-        return *it;
+    if (deviceRegistry_->empty()) {
+        scanForDevices();
+    }
+    MidiDeviceInfo device = deviceRegistry_->findFirst([this](const MidiDeviceInfo& candidate) {
+        return identifyOxygenPro(candidate);
+    });
+    if (device.deviceId != -1) {
+        return device;
     }
     return MidiDeviceInfo{-1, "Oxygen Pro Not Found", "M-Audio", false, false, false, 0};
 }
@@ -577,7 +1175,10 @@ bool MidiDevice::connectToDevice(int deviceId) {
     if (!interface_) return false;
     
     auto device = interface_->getDeviceInfo(deviceId);
-    if (device.deviceId == -1) return false;
+    if (device.deviceId == -1) {
+        recordError(MidiError::DeviceNotFound, deviceId, 0, timestampNow());
+        return false;
+    }
     
     MidiError error = MidiError::None;
     if (device.isInput) {
@@ -592,8 +1193,7 @@ bool MidiDevice::connectToDevice(int deviceId) {
         return true;
     }
     
-    lastError_ = error;
-    lastErrorString_ = interface_->getErrorString(error);
+    recordError(error, deviceId, 0, timestampNow());
     return false;
 }
 
@@ -613,6 +1213,7 @@ void MidiDevice::disconnectDevice(int deviceId) {
             oxygenProDeviceId_ = -1;
             oxygenProConnected_ = false;
         }
+        retireInputLanes(deviceId);
         
         updateDeviceList();
     }
@@ -623,6 +1224,8 @@ void MidiDevice::disconnectAllDevices() {
         interface_->closeAllDevices();
         oxygenProDeviceId_ = -1;
         oxygenProConnected_ = false;
+        oxygenProAwaitingReplug_ = false;
+        retireAllInputLanes();
         updateDeviceList();
     }
 }
@@ -630,16 +1233,22 @@ void MidiDevice::disconnectAllDevices() {
 bool MidiDevice::connectToOxygenPro() {
     auto device = findMAudioOxygenPro();
     if (device.deviceId != -1) {
-        if (connectToDevice(device.deviceId)) {
-            oxygenProDeviceId_ = device.deviceId;
-            oxygenProConnected_ = true;
-            configureOxygenPro();
-            return true;
-        }
+        return connectToOxygenPro(device);
     }
     return false;
 }
 
+bool MidiDevice::connectToOxygenPro(const MidiDeviceInfo& device) {
+    if (!connectToDevice(device.deviceId)) {
+        return false;
+    }
+    oxygenProDeviceId_ = device.deviceId;
+    oxygenProConnected_ = true;
+    oxygenProAwaitingReplug_ = false;
+    configureOxygenPro();
+    return true;
+}
+
 bool MidiDevice::isOxygenProConnected() const {
     return oxygenProConnected_;
 }
@@ -663,21 +1272,123 @@ void MidiDevice::setMidiInputCallback(MidiInputCallback callback) {
     inputCallback_ = callback;
 }
 
+bool MidiDevice::addMidiListener(MidiInputListener* listener) {
+    return addListenerToTable(listenerTables_[0], listener);
+}
+
+bool MidiDevice::addMidiListener(MidiMessageType type, MidiInputListener* listener) {
+    if (MidiStatusTable::channelTypeBit(type) == 0) {
+        return false;
+    }
+    return addListenerToTable(listenerTables_[1 + MidiStatusTable::lookup(static_cast<uint8_t>(type)).channelType],
+                              listener);
+}
+
+bool MidiDevice::removeMidiListener(MidiInputListener* listener) {
+    if (isProcessing_) return false;
+    
+    bool removed = false;
+    for (auto& table : listenerTables_) {
+        auto end = table.listeners.begin() + table.count;
+        auto it = std::find(table.listeners.begin(), end, listener);
+        if (it != end) {
+            // Keep subscription order for the remaining listeners
+            std::copy(it + 1, end, it);
+            table.listeners[--table.count] = nullptr;
+            removed = true;
+        }
+    }
+    return removed;
+}
+
+bool MidiDevice::setInputFilter(MidiMessageType type, uint16_t channelMask) {
+    if (MidiStatusTable::channelTypeBit(type) == 0) {
+        return false;
+    }
+    inputFilter_[MidiStatusTable::lookup(static_cast<uint8_t>(type)).channelType] = channelMask;
+    return true;
+}
+
+void MidiDevice::setInputFilter(const MidiRouter& router) {
+    for (int status = 0x80; status < 0xF0; status += 0x10) {
+        const MidiMessageType type = static_cast<MidiMessageType>(status);
+        setInputFilter(type, router.channelMask(type));
+    }
+}
+
+void MidiDevice::clearInputFilter() {
+    for (auto& channels : inputFilter_) {
+        channels = MidiRouter::kAllChannels;
+    }
+}
+
+uint16_t MidiDevice::getInputFilter(MidiMessageType type) const {
+    if (MidiStatusTable::channelTypeBit(type) == 0) {
+        return 0;
+    }
+    return inputFilter_[MidiStatusTable::lookup(static_cast<uint8_t>(type)).channelType];
+}
+
+bool MidiDevice::addListenerToTable(ListenerTable& table, MidiInputListener* listener) {
+    if (isProcessing_ || !listener || table.count == table.listeners.size()) {
+        return false;
+    }
+    auto end = table.listeners.begin() + table.count;
+    if (std::find(table.listeners.begin(), end, listener) != end) {
+        return false;
+    }
+    table.listeners[table.count++] = listener;
+    return true;
+}
+
 void MidiDevice::setDeviceConnectionCallback(DeviceConnectionCallback callback) {
     connectionCallback_ = callback;
 }
 
+void MidiDevice::setSysExCallback(MidiSysExCallback callback) {
+    sysExCallback_ = callback;
+}
+
 void MidiDevice::startRealTimeProcessing() {
     if (isProcessing_) return;
     
+    const RealtimeConfig config = getRealtimeConfig();
+    RealtimeStatus status;
+    if (config.prefault) {
+        // The key history and latency histograms are zero-filled when
+        // created; the rings are the only buffers not yet touched
+        status.prefaulted = true;
+        for (const auto& lane : inputLanes_) {
+            status.prefaulted = RealtimeThread::prefault(lane->queue.storage(), lane->queue.storageBytes()) &&
+                                status.prefaulted;
+        }
+        if (!status.prefaulted) {
+            status.error = "Prefaulting input queues failed; first use of each page will fault";
+        }
+    }
+    if (config.lockMemory) {
+        RealtimeThread::lockMemory(status);
+    }
+    
     isProcessing_ = true;
     processingThread_ = std::thread(&MidiDevice::processingThreadFunction, this);
+    RealtimeThread::configure(processingThread_, config, status);
+    
+    if (!status.error.empty()) {
+        const uint64_t sequence = recordError(MidiError::SystemError, -1, 0, timestampNow());
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        errorDetail_ = status.error;
+        errorDetailSequence_ = sequence;
+    }
+    std::lock_guard<std::mutex> lock(realtimeMutex_);
+    realtimeStatus_ = status;
 }
 
 void MidiDevice::stopRealTimeProcessing() {
     if (!isProcessing_) return;
     
     isProcessing_ = false;
+    messageSignal_.notifyAll();
     if (processingThread_.joinable()) {
         processingThread_.join();
     }
@@ -687,6 +1398,25 @@ bool MidiDevice::isProcessingRealTime() const {
     return isProcessing_;
 }
 
+bool MidiDevice::setRealtimeConfig(const RealtimeConfig& config) {
+    if (isProcessing_ || !RealtimeThread::isValid(config)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(realtimeMutex_);
+    realtimeConfig_ = config;
+    return true;
+}
+
+RealtimeConfig MidiDevice::getRealtimeConfig() const {
+    std::lock_guard<std::mutex> lock(realtimeMutex_);
+    return realtimeConfig_;
+}
+
+RealtimeStatus MidiDevice::getRealtimeStatus() const {
+    std::lock_guard<std::mutex> lock(realtimeMutex_);
+    return realtimeStatus_;
+}
+
 MidiError MidiDevice::sendNoteOn(int deviceId, int channel, int note, int velocity) {
     RealTimeMidiMessage message;
     message.status = 0x90;
@@ -694,23 +1424,19 @@ MidiError MidiDevice::sendNoteOn(int deviceId, int channel, int note, int veloci
     message.data2 = velocity;
     message.channel = channel;
     message.deviceId = deviceId;
-    message.timestamp = std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+    message.timestamp = timestampNow();
     
     if (interface_) {
         MidiError error = interface_->sendMessage(deviceId, message);
         if (error == MidiError::None) {
             messagesSent_++;
         } else {
-            std::lock_guard<std::mutex> lock(errorMutex_);
-            lastError_ = error;
-            lastErrorString_ = interface_->getErrorString(error);
+            recordError(error, deviceId, message.status, message.timestamp);
         }
         return error;
     }
     
-    std::lock_guard<std::mutex> lock(errorMutex_);
-    lastError_ = MidiError::DeviceNotConnected;
-    lastErrorString_ = "Device not connected";
+    recordError(MidiError::DeviceNotConnected, deviceId, message.status, message.timestamp);
     return MidiError::DeviceNotConnected;
 }
 
@@ -721,23 +1447,19 @@ MidiError MidiDevice::sendNoteOff(int deviceId, int channel, int note, int veloc
     message.data2 = velocity;
     message.channel = channel;
     message.deviceId = deviceId;
-    message.timestamp = std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+    message.timestamp = timestampNow();
     
     if (interface_) {
         MidiError error = interface_->sendMessage(deviceId, message);
         if (error == MidiError::None) {
             messagesSent_++;
         } else {
-            std::lock_guard<std::mutex> lock(errorMutex_);
-            lastError_ = error;
-            lastErrorString_ = interface_->getErrorString(error);
+            recordError(error, deviceId, message.status, message.timestamp);
         }
         return error;
     }
     
-    std::lock_guard<std::mutex> lock(errorMutex_);
-    lastError_ = MidiError::DeviceNotConnected;
-    lastErrorString_ = "Device not connected";
+    recordError(MidiError::DeviceNotConnected, deviceId, message.status, message.timestamp);
     return MidiError::DeviceNotConnected;
 }
 
@@ -748,23 +1470,19 @@ MidiError MidiDevice::sendControlChange(int deviceId, int channel, int controlle
     message.data2 = value;
     message.channel = channel;
     message.deviceId = deviceId;
-    message.timestamp = std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+    message.timestamp = timestampNow();
     
     if (interface_) {
         MidiError error = interface_->sendMessage(deviceId, message);
         if (error == MidiError::None) {
             messagesSent_++;
         } else {
-            std::lock_guard<std::mutex> lock(errorMutex_);
-            lastError_ = error;
-            lastErrorString_ = interface_->getErrorString(error);
+            recordError(error, deviceId, message.status, message.timestamp);
         }
         return error;
     }
     
-    std::lock_guard<std::mutex> lock(errorMutex_);
-    lastError_ = MidiError::DeviceNotConnected;
-    lastErrorString_ = "Device not connected";
+    recordError(MidiError::DeviceNotConnected, deviceId, message.status, message.timestamp);
     return MidiError::DeviceNotConnected;
 }
 
@@ -775,23 +1493,19 @@ MidiError MidiDevice::sendProgramChange(int deviceId, int channel, int program)
     message.data2 = 0;
     message.channel = channel;
     message.deviceId = deviceId;
-    message.timestamp = std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+    message.timestamp = timestampNow();
     
     if (interface_) {
         MidiError error = interface_->sendMessage(deviceId, message);
         if (error == MidiError::None) {
             messagesSent_++;
         } else {
-            std::lock_guard<std::mutex> lock(errorMutex_);
-            lastError_ = error;
-            lastErrorString_ = interface_->getErrorString(error);
+            recordError(error, deviceId, message.status, message.timestamp);
         }
         return error;
     }
     
-    std::lock_guard<std::mutex> lock(errorMutex_);
-    lastError_ = MidiError::DeviceNotConnected;
-    lastErrorString_ = "Device not connected";
+    recordError(MidiError::DeviceNotConnected, deviceId, message.status, message.timestamp);
     return MidiError::DeviceNotConnected;
 }
 
@@ -802,26 +1516,79 @@ MidiError MidiDevice::sendPitchBend(int deviceId, int channel, int value) {
     message.data2 = (value >> 7) & 0x7F;
     message.channel = channel;
     message.deviceId = deviceId;
-    message.timestamp = std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+    message.timestamp = timestampNow();
     
     if (interface_) {
         MidiError error = interface_->sendMessage(deviceId, message);
         if (error == MidiError::None) {
             messagesSent_++;
         } else {
-            std::lock_guard<std::mutex> lock(errorMutex_);
-            lastError_ = error;
-            lastErrorString_ = interface_->getErrorString(error);
+            recordError(error, deviceId, message.status, message.timestamp);
+        }
+        return error;
+    }
+    
+    recordError(MidiError::DeviceNotConnected, deviceId, message.status, message.timestamp);
+    return MidiError::DeviceNotConnected;
+}
+
+MidiError MidiDevice::sendMessages(int deviceId, const RealTimeMidiMessage* messages, size_t count) {
+    if (interface_) {
+        MidiError error = interface_->sendMessages(deviceId, messages, count);
+        if (error == MidiError::None) {
+            messagesSent_ += count;
+        } else {
+            recordError(error, deviceId, count ? messages[0].status : 0, timestampNow());
         }
         return error;
     }
     
-    std::lock_guard<std::mutex> lock(errorMutex_);
-    lastError_ = MidiError::DeviceNotConnected;
-    lastErrorString_ = "Device not connected";
+    recordError(MidiError::DeviceNotConnected, deviceId, count ? messages[0].status : 0, timestampNow());
     return MidiError::DeviceNotConnected;
 }
 
+MidiError MidiDevice::sendMessages(int deviceId, const std::vector<RealTimeMidiMessage>& messages) {
+    return sendMessages(deviceId, messages.data(), messages.size());
+}
+
+MidiError MidiDevice::scheduleMessages(int deviceId, const RealTimeMidiMessage* messages, size_t count) {
+    if (interface_) {
+        MidiError error = interface_->scheduleMessages(deviceId, messages, count);
+        if (error == MidiError::None) {
+            messagesSent_ += count;
+        } else if (error != MidiError::NotSupported) {
+            recordError(error, deviceId, count ? messages[0].status : 0, timestampNow());
+        }
+        return error;
+    }
+    
+    recordError(MidiError::DeviceNotConnected, deviceId, count ? messages[0].status : 0, timestampNow());
+    return MidiError::DeviceNotConnected;
+}
+
+bool MidiDevice::canScheduleMessages() {
+    return interface_ && interface_->canScheduleMessages();
+}
+
+MidiError MidiDevice::cancelScheduledMessages(int deviceId) {
+    if (!interface_) {
+        return MidiError::DeviceNotConnected;
+    }
+    return interface_->cancelScheduledMessages(deviceId);
+}
+
+RealTimeMidiMessage MidiDevice::keyEventToMessage(const KeyEvent& keyEvent, int deviceId) {
+    RealTimeMidiMessage message;
+    const bool down = keyEvent.state == KeyState::KeyDown;
+    message.status = down ? 0x90 : 0x80;
+    message.data1 = static_cast<uint8_t>(keyEvent.note & 0x7F);
+    message.data2 = static_cast<uint8_t>(down ? keyEvent.velocity & 0x7F : 64);
+    message.channel = keyEvent.channel;
+    message.timestamp = keyEvent.timestamp;
+    message.deviceId = deviceId;
+    return message;
+}
+
 MidiError MidiDevice::sendKeyEvent(int deviceId, const KeyEvent& keyEvent) {
     if (keyEvent.state == KeyState::KeyDown) {
         return sendNoteOn(deviceId, keyEvent.channel, keyEvent.note, keyEvent.velocity);
@@ -831,27 +1598,36 @@ MidiError MidiDevice::sendKeyEvent(int deviceId, const KeyEvent& keyEvent) {
 }
 
 std::vector<KeyEvent> MidiDevice::getRecentKeyEvents(double timeWindow) {
-    std::lock_guard<std::mutex> lock(keyEventHistoryMutex_);
-    std::vector<KeyEvent> recentEvents;
-    
-    double currentTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-    double cutoffTime = currentTime - timeWindow;
-    
-    for (const auto& event : keyEventHistory_) {
-        if (event.timestamp >= cutoffTime) {
-            recentEvents.push_back(event);
-        }
-    }
-    
-    return recentEvents;
+    return keyEventHistory_->since(timestampNow() - timeWindow);
+}
+
+std::vector<KeyEvent> MidiDevice::getKeyEventsBetween(double from, double to) {
+    std::vector<KeyEvent> events;
+    keyEventHistory_->snapshot(from, to, events);
+    return events;
 }
 
 void MidiDevice::clearKeyEventHistory() {
-    std::lock_guard<std::mutex> lock(keyEventHistoryMutex_);
-    keyEventHistory_.clear();
+    keyEventHistory_->clear();
+}
+
+bool MidiDevice::setKeyEventHistoryCapacity(size_t capacity) {
+    if (isProcessing_ || capacity == 0) {
+        return false;
+    }
+    keyEventHistory_.reset(new KeyEventHistory(capacity));
+    return true;
+}
+
+size_t MidiDevice::getKeyEventHistoryCapacity() const {
+    return keyEventHistory_->capacity();
 }
 
 // Static utility methods
+double MidiDevice::timestampNow() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 RealTimeMidiMessage MidiDevice::parseRawMidiMessage(const uint8_t* data, size_t length, double timestamp, int deviceId) {
     RealTimeMidiMessage message;
     message.timestamp = timestamp;
@@ -871,38 +1647,30 @@ std::vector<uint8_t> MidiDevice::serializeMidiMessage(const RealTimeMidiMessage&
     std::vector<uint8_t> data;
     data.push_back(message.status | (message.channel - 1));
     
-    uint8_t messageType = message.status & 0xF0;
-    switch (messageType) {
-        case 0x80: // Note Off
-        case 0x90: // Note On
-        case 0xA0: // Polyphonic Aftertouch
-        case 0xB0: // Control Change
-        case 0xE0: // Pitch Bend
-            data.push_back(message.data1);
+    const MidiStatusInfo& info = MidiStatusTable::lookup(message.status);
+    if (info.flags & MidiStatusTable::kChannel) {
+        data.push_back(message.data1);
+        if (info.dataBytes == 2) {
             data.push_back(message.data2);
-            break;
-        case 0xC0: // Program Change
-        case 0xD0: // Channel Aftertouch
-            data.push_back(message.data1);
-            break;
+        }
     }
     
     return data;
 }
 
 bool MidiDevice::isNoteOnMessage(const RealTimeMidiMessage& message) {
-    return (message.status & 0xF0) == 0x90 && message.data2 > 0;
+    return MidiStatusTable::type(message.status) == MidiMessageType::NoteOn && message.data2 > 0;
 }
 
 bool MidiDevice::isNoteOffMessage(const RealTimeMidiMessage& message) {
-    return ((message.status & 0xF0) == 0x80) || 
-           ((message.status & 0xF0) == 0x90 && message.data2 == 0);
+    const MidiMessageType type = MidiStatusTable::type(message.status);
+    return type == MidiMessageType::NoteOff || (type == MidiMessageType::NoteOn && message.data2 == 0);
 }
 
 bool MidiDevice::isDrumPadMessage(const RealTimeMidiMessage& message) {
-    return message.channel == 10 && 
-           (isNoteOnMessage(message) || isNoteOffMessage(message)) &&
-           message.data1 >= 36 && message.data1 <= 51;
+    // Pads send notes 36-51 on channel 10
+    return message.channel == 10 && MidiStatusTable::isNote(message.status) &&
+           static_cast<unsigned>(message.data1 - 36) <= 15u;
 }
 
 DeviceType MidiDevice::getDeviceTypeFromMessage(const RealTimeMidiMessage& message) {
@@ -926,24 +1694,66 @@ uint64_t MidiDevice::getDroppedMessages() const {
 }
 
 double MidiDevice::getInputLatency() const {
-    return avgInputLatency_;
+    return inputLatency_.mean() * 1e-6;
+}
+
+LatencySummary MidiDevice::getInputLatencyStats() const {
+    return inputLatency_.summary();
 }
 
 double MidiDevice::getOutputLatency() const {
     return avgOutputLatency_;
 }
 
+MidiInputStats MidiDevice::getDeviceInputStats(int deviceId) const {
+    for (const auto& lane : inputLanes_) {
+        if (lane->deviceId.load(std::memory_order_acquire) == deviceId && deviceId != -1) {
+            return inputLaneStats(*lane, deviceId);
+        }
+    }
+    return MidiInputStats();
+}
+
+std::vector<MidiInputStats> MidiDevice::getAllDeviceInputStats() const {
+    std::vector<MidiInputStats> stats;
+    for (const auto& lane : inputLanes_) {
+        const int deviceId = lane->deviceId.load(std::memory_order_acquire);
+        if (deviceId != -1) {
+            stats.push_back(inputLaneStats(*lane, deviceId));
+        }
+    }
+    std::sort(stats.begin(), stats.end(),
+              [](const MidiInputStats& a, const MidiInputStats& b) { return a.deviceId < b.deviceId; });
+    return stats;
+}
+
+MidiInputStats MidiDevice::inputLaneStats(const InputLane& lane, int deviceId) {
+    MidiInputStats stats;
+    stats.deviceId = deviceId;
+    stats.messagesReceived = lane.received.load(std::memory_order_relaxed);
+    stats.droppedMessages = lane.dropped.load(std::memory_order_relaxed);
+    stats.queued = lane.queue.size();
+    stats.latency = lane.latency.summary();
+    stats.messagesDispatched = stats.latency.count;   // One latency sample per dispatch
+    return stats;
+}
+
 void MidiDevice::resetStatistics() {
     messagesReceived_ = 0;
     messagesSent_ = 0;
     droppedMessages_ = 0;
-    avgInputLatency_ = 0.0;
+    inputLatency_.reset();
+    for (auto& lane : inputLanes_) {
+        lane->received = 0;
+        lane->dropped = 0;
+        lane->latency.reset();
+    }
     avgOutputLatency_ = 0.0;
 }
 
 // Configuration methods
 void MidiDevice::setBufferSize(size_t bufferSize) {
-    bufferSize_ = bufferSize;
+    bufferSize_ = std::min(bufferSize, kMessageQueueCapacity);
 }
 
 void MidiDevice::setLatencyTarget(double milliseconds) {
@@ -951,91 +1761,356 @@ void MidiDevice::setLatencyTarget(double milliseconds) {
 }
 
 void MidiDevice::enableVelocityCurve(bool enabled) {
-    velocityCurveEnabled_ = enabled;
+    std::lock_guard<std::mutex> lock(velocityMutex_);
+    velocityTable_.store(enabled ? velocityCurrent_ : nullptr, std::memory_order_release);
 }
 
 void MidiDevice::setVelocityCurve(const std::vector<float>& curve) {
-    velocityCurve_ = curve;
-    velocityCurveEnabled_ = !curve.empty();
+    if (curve.empty()) {
+        enableVelocityCurve(false);
+        return;
+    }
+    setVelocityTable(VelocityCurve::fromPoints(curve));
+}
+
+void MidiDevice::setVelocityCurve(VelocityCurve::Preset preset) {
+    setVelocityTable(VelocityCurve::fromPreset(preset));
+}
+
+void MidiDevice::setVelocityTable(const VelocityTable& table) {
+    std::lock_guard<std::mutex> lock(velocityMutex_);
+    VelocityBuffer* next = velocityCurrent_ == &velocityBuffers_[0] ? &velocityBuffers_[1] : &velocityBuffers_[0];
+    for (size_t i = 0; i < table.size(); ++i) {
+        next->at(i).store(table[i], std::memory_order_relaxed);
+    }
+    velocityCurrent_ = next;
+    velocityTable_.store(next, std::memory_order_release);
+}
+
+VelocityTable MidiDevice::getVelocityTable() const {
+    VelocityTable table;
+    const VelocityBuffer* active = velocityTable_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < table.size(); ++i) {
+        table[i] = active ? (*active)[i].load(std::memory_order_relaxed) : static_cast<uint8_t>(i);
+    }
+    return table;
+}
+
+// External MIDI clock
+MidiClockSnapshot MidiDevice::getClockSnapshot() const {
+    return clock_.snapshot();
+}
+
+void MidiDevice::setClockSource(int deviceId) {
+    clockSource_.store(deviceId < 0 ? -1 : deviceId, std::memory_order_relaxed);
+    clock_.reset();
+}
+
+int MidiDevice::getClockSource() const {
+    return clockSource_.load(std::memory_order_relaxed);
+}
+
+void MidiDevice::resetClock() {
+    clock_.reset();
 }
 
 // Error handling
 std::string MidiDevice::getLastErrorString() const {
-    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(errorMutex_));
-    return lastErrorString_;
+    const uint64_t last = lastError_.load(std::memory_order_acquire);
+    if (last == 0) {
+        return std::string();
+    }
+    {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        if (errorDetailSequence_ == last >> 8) {
+            return errorDetail_;
+        }
+    }
+    const MidiError error = static_cast<MidiError>(last & 0xFF);
+    if (interface_) {
+        return interface_->getErrorString(error);
+    }
+    return error == MidiError::DeviceNotConnected ? "Device not connected" : "MIDI error";
 }
 
 MidiError MidiDevice::getLastError() const {
-    return lastError_;
+    return static_cast<MidiError>(lastError_.load(std::memory_order_acquire) & 0xFF);
+}
+
+std::vector<MidiErrorRecord> MidiDevice::getRecentErrors(size_t maxRecords) const {
+    const uint64_t newest = errorCount_.load(std::memory_order_acquire);
+    const uint64_t available = std::min<uint64_t>({newest, maxRecords, kErrorLogCapacity});
+    std::vector<MidiErrorRecord> records;
+    records.reserve(available);
+    for (uint64_t sequence = newest - available + 1; sequence <= newest; ++sequence) {
+        MidiErrorRecord record;
+        if (readErrorRecord(sequence, record)) {
+            records.push_back(record);
+        }
+    }
+    return records;
+}
+
+uint64_t MidiDevice::getErrorCount() const {
+    return errorCount_.load(std::memory_order_acquire);
 }
 
 void MidiDevice::clearErrors() {
-    std::lock_guard<std::mutex> lock(errorMutex_);
-    lastError_ = MidiError::None;
-    lastErrorString_.clear();
+    lastError_.store(0, std::memory_order_release);
+}
+
+uint64_t MidiDevice::recordError(MidiError error, int deviceId, uint8_t status, double timestamp) {
+    const uint64_t sequence = errorCount_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    lastError_.store(sequence << 8 | static_cast<uint8_t>(error), std::memory_order_release);
+    
+    // A writer that finds its slot busy or already holding a newer record
+    // has been lapped by kErrorLogCapacity errors; its record would be
+    // overwritten anyway, so it is dropped rather than waited for.
+    ErrorSlot& slot = errorLog_[sequence % kErrorLogCapacity];
+    uint64_t previous = slot.sequence.load(std::memory_order_relaxed);
+    if (previous == kErrorSlotBusy || previous > sequence ||
+        !slot.sequence.compare_exchange_strong(previous, kErrorSlotBusy, std::memory_order_relaxed)) {
+        return sequence;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.error.store(error, std::memory_order_relaxed);
+    slot.deviceId.store(deviceId, std::memory_order_relaxed);
+    slot.status.store(status, std::memory_order_relaxed);
+    slot.timestamp.store(timestamp, std::memory_order_relaxed);
+    slot.sequence.store(sequence, std::memory_order_release);
+    return sequence;
+}
+
+bool MidiDevice::readErrorRecord(uint64_t sequence, MidiErrorRecord& record) const {
+    const ErrorSlot& slot = errorLog_[sequence % kErrorLogCapacity];
+    if (slot.sequence.load(std::memory_order_acquire) != sequence) {
+        return false;
+    }
+    record.error = slot.error.load(std::memory_order_relaxed);
+    record.deviceId = slot.deviceId.load(std::memory_order_relaxed);
+    record.status = slot.status.load(std::memory_order_relaxed);
+    record.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+    record.sequence = sequence;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == sequence;
 }
 
 // Private methods
 void MidiDevice::processingThreadFunction() {
-    while (isProcessing_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        
-        // Process queued messages
-        std::lock_guard<std::mutex> lock(messageQueueMutex_);
-        while (!messageQueue_.empty()) {
-            auto message = messageQueue_.front();
-            messageQueue_.pop();
+    // Upper bound on one sleep; wakeups normally come from handleMidiMessage()
+    // or stopRealTimeProcessing(), so this only limits the cost of a bug
+    constexpr auto kMaxWait = std::chrono::milliseconds(100);
+    // Lanes that were empty are checked again after this many dispatches,
+    // so a busy device cannot hold back a quiet one indefinitely
+    constexpr int kRescanInterval = 64;
+    
+    // Min-heap of each non-empty lane's oldest message, so picking the
+    // earliest message across devices costs O(log devices)
+    struct Head {
+        RealTimeMidiMessage message;
+        size_t lane;
+    };
+    const auto later = [](const Head& a, const Head& b) {
+        return a.message.timestamp > b.message.timestamp ||
+               (a.message.timestamp == b.message.timestamp && a.lane > b.lane);
+    };
+    std::vector<Head> heap;
+    heap.reserve(inputLanes_.size());
+    std::vector<bool> inHeap(inputLanes_.size(), false);
+    
+    while (true) {
+        int untilRescan = 0;
+        while (true) {
+            if (untilRescan-- == 0) {
+                for (size_t i = 0; i < inputLanes_.size(); ++i) {
+                    Head head;
+                    if (!inHeap[i] && inputLanes_[i]->queue.tryPop(head.message)) {
+                        head.lane = i;
+                        heap.push_back(head);
+                        std::push_heap(heap.begin(), heap.end(), later);
+                        inHeap[i] = true;
+                    }
+                }
+                untilRescan = kRescanInterval;
+            }
+            if (heap.empty()) {
+                break;
+            }
+            
+            std::pop_heap(heap.begin(), heap.end(), later);
+            Head& head = heap.back();
+            InputLane& lane = *inputLanes_[head.lane];
+            updateLatencyStatistics(head.message, lane);
             
-            if (inputCallback_) {
-                inputCallback_(message);
+            dispatchMessage(head.message);
+            lane.dispatched.fetch_add(1, std::memory_order_release);
+            
+            if (lane.queue.tryPop(head.message)) {
+                std::push_heap(heap.begin(), heap.end(), later);
+            } else {
+                inHeap[head.lane] = false;
+                heap.pop_back();
             }
         }
+        
+        // Announce the sleep before the final emptiness check so a push that
+        // lands in between either is seen here or bumps the epoch
+        const uint32_t epoch = messageSignal_.prepareWait();
+        if (!isProcessing_) {
+            messageSignal_.cancelWait();
+            break;
+        }
+        if (inputPending()) {
+            messageSignal_.cancelWait();
+            continue;
+        }
+        messageSignal_.wait(epoch, kMaxWait);
+    }
+}
+
+void MidiDevice::dispatchMessage(const RealTimeMidiMessage& message) {
+    // Convert to key event and store
+    keyEventHistory_->append(convertMidiToKeyEvent(message));
+    
+    if (inputCallback_) {
+        inputCallback_(message);
+    }
+    
+    const ListenerTable& all = listenerTables_[0];
+    for (size_t i = 0; i < all.count; ++i) {
+        all.listeners[i]->onMidiMessage(message);
+    }
+    // Only channel messages are queued, so the type index is in range
+    const ListenerTable& typed = listenerTables_[1 + MidiStatusTable::lookup(message.status).channelType];
+    for (size_t i = 0; i < typed.count; ++i) {
+        typed.listeners[i]->onMidiMessage(message);
+    }
+}
+
+bool MidiDevice::inputPending() const {
+    for (const auto& lane : inputLanes_) {
+        if (!lane->queue.empty()) {
+            return true;
+        }
     }
+    return false;
 }
 
 void MidiDevice::handleMidiMessage(const RealTimeMidiMessage& message) {
     messagesReceived_++;
     
+    InputLane* lane = inputLaneFor(message.deviceId);
+    if (lane) {
+        lane->received.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // Clock and transport are not queued; the first device to send any
+    // becomes the clock source unless one was set
+    if (MidiClock::handles(message.status)) {
+        int source = clockSource_.load(std::memory_order_relaxed);
+        if (source == -1 && clockSource_.compare_exchange_strong(source, message.deviceId, std::memory_order_relaxed)) {
+            source = message.deviceId;
+        }
+        if (source == message.deviceId) {
+            clock_.process(message.status, message.data1, message.data2, message.timestamp);
+        }
+        return;
+    }
+    
     if (shouldProcessMessage(message)) {
-        updateLatencyStatistics(message);
-        
-        // Convert to key event and store
-        KeyEvent keyEvent = convertMidiToKeyEvent(message);
-        
-        std::lock_guard<std::mutex> lock(keyEventHistoryMutex_);
-        keyEventHistory_.push_back(keyEvent);
-        
-        // Limit history size
-        if (keyEventHistory_.size() > MAX_KEY_EVENT_HISTORY) {
-            keyEventHistory_.erase(keyEventHistory_.begin());
+        RealTimeMidiMessage shaped = message;
+        if ((shaped.status & 0xF0) == 0x90) {
+            const VelocityBuffer* curve = velocityTable_.load(std::memory_order_acquire);
+            if (curve) {
+                shaped.data2 = (*curve)[shaped.data2 & 0x7F].load(std::memory_order_relaxed);
+            }
         }
-        
-        // Queue for processing
-        std::lock_guard<std::mutex> queueLock(messageQueueMutex_);
-        if (messageQueue_.size() < bufferSize_) {
-            messageQueue_.push(message);
+
+        // Called only from the device's input thread, its lane's single
+        // producer. Everything else (history, statistics, callback) happens
+        // on the processing thread so this path takes no locks.
+        if (lane && lane->queue.tryPush(shaped, bufferSize_.load(std::memory_order_relaxed))) {
+            lane->queued.fetch_add(1, std::memory_order_release);
+            messageSignal_.notify();
         } else {
             droppedMessages_++;
+            if (lane) {
+                lane->dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+MidiDevice::InputLane* MidiDevice::inputLaneFor(int deviceId) {
+    for (auto& lane : inputLanes_) {
+        if (lane->deviceId.load(std::memory_order_acquire) == deviceId) {
+            // A device that sends again after being disconnected keeps its lane
+            lane->retired.store(false, std::memory_order_relaxed);
+            return lane.get();
+        }
+    }
+    
+    // First message from this device: take a free lane, or a retired one
+    // with nothing left to dispatch, whose counters then start over
+    for (auto& lane : inputLanes_) {
+        int owner = lane->deviceId.load(std::memory_order_acquire);
+        const bool reusable = owner == -1 ||
+            (lane->retired.load(std::memory_order_relaxed) &&
+             lane->dispatched.load(std::memory_order_acquire) == lane->queued.load(std::memory_order_relaxed));
+        if (reusable && lane->deviceId.compare_exchange_strong(owner, deviceId, std::memory_order_acq_rel)) {
+            lane->retired.store(false, std::memory_order_relaxed);
+            lane->received = 0;
+            lane->queued = 0;
+            lane->dispatched = 0;
+            lane->dropped = 0;
+            lane->latency.reset();
+            return lane.get();
         }
     }
+    return nullptr;
+}
+
+void MidiDevice::retireInputLanes(int deviceId) {
+    for (auto& lane : inputLanes_) {
+        if (lane->deviceId.load(std::memory_order_acquire) == deviceId) {
+            lane->retired.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+void MidiDevice::retireAllInputLanes() {
+    for (auto& lane : inputLanes_) {
+        lane->retired.store(true, std::memory_order_relaxed);
+    }
 }
 
 void MidiDevice::handleDeviceConnection(const MidiDeviceInfo& device, bool connected) {
+    if (connected) {
+        deviceRegistry_->update(device);
+    } else {
+        deviceRegistry_->remove(device.deviceId);
+        retireInputLanes(device.deviceId);
+    }
+    
     if (connectionCallback_) {
         connectionCallback_(device, connected);
     }
     
-    // Check if it's the Oxygen Pro
+    // A connected Oxygen Pro that is unplugged is reconnected as soon as
+    // it reappears, whatever id the system gives it
     if (identifyOxygenPro(device)) {
-        oxygenProConnected_ = connected;
-        if (!connected) {
+        if (!connected && device.deviceId == oxygenProDeviceId_) {
+            oxygenProConnected_ = false;
             oxygenProDeviceId_ = -1;
+            oxygenProAwaitingReplug_ = true;
+        } else if (connected && oxygenProAwaitingReplug_ && device.isInput) {
+            connectToOxygenPro(device);
         }
     }
 }
 
 void MidiDevice::updateDeviceList() {
-    connectedDevices_ = scanForDevices();
+    scanForDevices();
 }
 
 bool MidiDevice::identifyOxygenPro(const MidiDeviceInfo& device) {
@@ -1057,10 +2132,20 @@ void MidiDevice::setupOxygenProPads() {
 void MidiDevice::setupOxygenProKnobs() {
     if (!oxygenProConnected_) return;
     
-    // Configure knobs for control changes
+    // Configure knobs for control changes, sent as one burst
+    const double now = timestampNow();
+    std::vector<RealTimeMidiMessage> knobs;
     for (int knob = 0; knob < 8; ++knob) {
-        sendControlChange(oxygenProDeviceId_, 1, 70 + knob, 64);
+        RealTimeMidiMessage message;
+        message.status = 0xB0;
+        message.data1 = 70 + knob;
+        message.data2 = 64;
+        message.channel = 1;
+        message.deviceId = oxygenProDeviceId_;
+        message.timestamp = now;
+        knobs.push_back(message);
     }
+    sendMessages(oxygenProDeviceId_, knobs);
 }
 
 KeyEvent MidiDevice::convertMidiToKeyEvent(const RealTimeMidiMessage& message) {
@@ -1076,18 +2161,25 @@ KeyEvent MidiDevice::convertMidiToKeyEvent(const RealTimeMidiMessage& message) {
 }
 
 bool MidiDevice::shouldProcessMessage(const RealTimeMidiMessage& message) {
-    // Filter out system messages and focus on note/control messages
-    uint8_t messageType = message.status & 0xF0;
-    return messageType >= 0x80 && messageType <= 0xE0;
+    // Channel messages on channels the filter lets through; system messages never
+    const unsigned channelType = MidiStatusTable::lookup(message.status).channelType;
+    const unsigned channel = static_cast<unsigned>(message.channel - 1);
+    if (channelType == MidiStatusTable::kNoChannelType || channel > 15) {
+        return false;
+    }
+    return (inputFilter_[channelType].load(std::memory_order_relaxed) >> channel) & 1;
 }
 
-void MidiDevice::updateLatencyStatistics(const RealTimeMidiMessage& message) {
-    double currentTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-    double latency = (currentTime - message.timestamp) * 1000.0; // Convert to milliseconds
+void MidiDevice::updateLatencyStatistics(const RealTimeMidiMessage& message, InputLane& lane) {
+    lastMessageTime_ = std::chrono::steady_clock::now();
+    const double now = std::chrono::duration<double>(lastMessageTime_.time_since_epoch()).count();
     
-    // Simple moving average
-    avgInputLatency_ = (avgInputLatency_ * 0.9) + (latency * 0.1);
-    lastMessageTime_ = std::chrono::high_resolution_clock::now();
+    // A sequencer queue timestamp carries the small error of the queue epoch
+    // estimate and can land just after now
+    const double latency = std::max(0.0, now - message.timestamp);
+    const uint64_t nanoseconds = static_cast<uint64_t>(latency * 1e9);
+    inputLatency_.record(nanoseconds);
+    lane.latency.record(nanoseconds);
 }
 
 // Factory implementation
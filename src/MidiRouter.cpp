@@ -0,0 +1,96 @@
+#include "../include/MidiRouter.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+int lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+} // namespace
+
+int MidiRouter::addRoute(MidiInputListener* handler, uint8_t typeMask, uint16_t channelMask) {
+    typeMask &= kAllTypes;
+    if (!handler || typeMask == 0 || channelMask == 0) {
+        return -1;
+    }
+    for (size_t id = 0; id < routes_.size(); ++id) {
+        if (!routes_[id].handler) {
+            routes_[id] = Route{handler, typeMask, channelMask};
+            rebuild();
+            return static_cast<int>(id);
+        }
+    }
+    return -1;
+}
+
+bool MidiRouter::removeRoute(int routeId) {
+    if (routeId < 0 || routeId >= static_cast<int>(routes_.size()) || !routes_[routeId].handler) {
+        return false;
+    }
+    routes_[routeId] = Route();
+    rebuild();
+    return true;
+}
+
+void MidiRouter::clear() {
+    routes_.fill(Route());
+    masks_.fill(0);
+}
+
+void MidiRouter::route(const RealTimeMidiMessage& message) const {
+    uint32_t mask = routesFor(message.status, message.channel);
+    while (mask) {
+        routes_[lowestBit(mask)].handler->onMidiMessage(message);
+        mask &= mask - 1;
+    }
+}
+
+uint32_t MidiRouter::routesFor(uint8_t status, int channel) const {
+    const unsigned channelType = MidiStatusTable::lookup(status).channelType;
+    const unsigned channelIndex = static_cast<unsigned>(channel - 1);
+    if (channelType == MidiStatusTable::kNoChannelType || channelIndex > 15) {
+        return 0;
+    }
+    return masks_[channelType * 16 + channelIndex];
+}
+
+uint16_t MidiRouter::channelMask(MidiMessageType type) const {
+    const uint8_t bit = typeBit(type);
+    uint16_t channels = 0;
+    for (const Route& route : routes_) {
+        if (route.handler && (route.typeMask & bit)) {
+            channels |= route.channelMask;
+        }
+    }
+    return channels;
+}
+
+void MidiRouter::rebuild() {
+    masks_.fill(0);
+    for (size_t id = 0; id < routes_.size(); ++id) {
+        const Route& route = routes_[id];
+        if (!route.handler) {
+            continue;
+        }
+        for (size_t type = 0; type < MidiStatusTable::kChannelTypeCount; ++type) {
+            if (!(route.typeMask & (1u << type))) {
+                continue;
+            }
+            for (int channel = 0; channel < 16; ++channel) {
+                if (route.channelMask & (1u << channel)) {
+                    masks_[type * 16 + channel] |= uint32_t(1) << id;
+                }
+            }
+        }
+    }
+}
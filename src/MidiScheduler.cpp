@@ -0,0 +1,392 @@
+#include "../include/MidiScheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+MidiScheduler::MidiScheduler(MidiDevice& device)
+    : device_(device) {
+}
+
+MidiScheduler::~MidiScheduler() {
+    stop();
+}
+
+bool MidiScheduler::setDelivery(Delivery delivery) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return false;
+    }
+    delivery_ = delivery;
+    return true;
+}
+
+MidiScheduler::Delivery MidiScheduler::getDelivery() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return delivery_;
+}
+
+bool MidiScheduler::setLookahead(double seconds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_ || !(seconds > 0.0)) {
+        return false;
+    }
+    lookahead_ = seconds;
+    return true;
+}
+
+double MidiScheduler::getLookahead() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lookahead_;
+}
+
+bool MidiScheduler::setRealtimeConfig(const RealtimeConfig& config) {
+    if (!RealtimeThread::isValid(config)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return false;
+    }
+    realtimeConfig_ = config;
+    return true;
+}
+
+RealtimeStatus MidiScheduler::getRealtimeStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return realtimeStatus_;
+}
+
+bool MidiScheduler::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return false;
+    }
+    const bool queue = delivery_ != Delivery::Dispatcher && device_.canScheduleMessages();
+    if (delivery_ == Delivery::BackendQueue && !queue) {
+        return false;
+    }
+#ifdef __linux__
+    timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    wakeFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (timerFd_ < 0 || wakeFd_ < 0) {
+        if (timerFd_ >= 0) ::close(timerFd_);
+        if (wakeFd_ >= 0) ::close(wakeFd_);
+        timerFd_ = wakeFd_ = -1;
+        return false;
+    }
+#endif
+
+    RealtimeStatus status;
+    batch_.reserve(kBatchReserve);
+    if (realtimeConfig_.prefault) {
+        status.prefaulted = RealtimeThread::prefault(batch_.data(), batch_.capacity() * sizeof(RealTimeMidiMessage));
+        if (heap_.capacity() > 0) {
+            status.prefaulted = RealtimeThread::prefault(heap_.data(), heap_.capacity() * sizeof(Entry)) &&
+                                status.prefaulted;
+        }
+        if (!status.prefaulted) {
+            status.error = "Prefaulting scheduler queues failed; first use of each page will fault";
+        }
+    }
+    if (realtimeConfig_.lockMemory) {
+        RealtimeThread::lockMemory(status);
+    }
+
+    useQueue_ = queue;
+    wakeRequested_ = false;
+    running_ = true;
+    thread_ = std::thread(&MidiScheduler::run, this);
+    RealtimeThread::configure(thread_, realtimeConfig_, status);
+    realtimeStatus_ = status;
+    return true;
+}
+
+void MidiScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) {
+            running_ = false;
+            wake();
+        }
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+#ifdef __linux__
+    {
+        // schedule() may still call wake() from another thread
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (timerFd_ >= 0) {
+            ::close(timerFd_);
+            ::close(wakeFd_);
+            timerFd_ = wakeFd_ = -1;
+        }
+    }
+#endif
+    cancel();
+    useQueue_ = false;
+}
+
+bool MidiScheduler::isRunning() const {
+    return running_;
+}
+
+bool MidiScheduler::usesBackendQueue() const {
+    return running_ && useQueue_;
+}
+
+void MidiScheduler::schedule(int deviceId, const RealTimeMidiMessage& message) {
+    schedule(deviceId, &message, 1);
+}
+
+void MidiScheduler::schedule(int deviceId, const RealTimeMidiMessage* messages, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const double earliest = heap_.empty() ? std::numeric_limits<double>::infinity() : heap_.front().message.timestamp;
+    for (size_t i = 0; i < count; ++i) {
+        RealTimeMidiMessage message = messages[i];
+        message.deviceId = deviceId;
+        push(message);
+    }
+    if (heap_.front().message.timestamp < earliest) {
+        wake();
+    }
+}
+
+void MidiScheduler::schedule(int deviceId, const std::vector<KeyEvent>& events, double startTime) {
+    if (events.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const double earliest = heap_.empty() ? std::numeric_limits<double>::infinity() : heap_.front().message.timestamp;
+    heap_.reserve(heap_.size() + events.size());
+    for (const KeyEvent& event : events) {
+        RealTimeMidiMessage message = MidiDevice::keyEventToMessage(event, deviceId);
+        message.timestamp = startTime + event.timestamp;
+        push(message);
+    }
+    if (heap_.front().message.timestamp < earliest) {
+        wake();
+    }
+}
+
+void MidiScheduler::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ += heap_.size();
+        heap_.clear();
+        generation_++;
+    }
+    std::lock_guard<std::mutex> lock(deliverMutex_);
+    silence();
+}
+
+size_t MidiScheduler::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return heap_.size();
+}
+
+MidiScheduleStats MidiScheduler::getStats() const {
+    MidiScheduleStats stats;
+    stats.scheduled = scheduled_;
+    stats.sent = sent_;
+    stats.failed = failed_;
+    stats.cancelled = cancelled_;
+    stats.late = late_;
+    stats.pending = pending();
+    stats.lateness = lateness_.summary();
+    return stats;
+}
+
+void MidiScheduler::resetStats() {
+    scheduled_ = 0;
+    sent_ = 0;
+    failed_ = 0;
+    cancelled_ = 0;
+    late_ = 0;
+    lateness_.reset();
+}
+
+// Private methods
+
+void MidiScheduler::push(const RealTimeMidiMessage& message) {
+    heap_.push_back(Entry{message, nextOrder_++});
+    std::push_heap(heap_.begin(), heap_.end(), Later());
+    scheduled_++;
+}
+
+void MidiScheduler::run() {
+#ifdef __linux__
+    // Timer expiries are otherwise deferred by up to the default 50 us slack
+    prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+#endif
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        // With a backend queue, hand over everything due within the
+        // lookahead and let the backend do the timing
+        const double lead = useQueue_ ? lookahead_ : 0.0;
+        const double horizon = MidiDevice::timestampNow() + lead;
+        // Capped at the capacity reserved by start(); the rest go next round
+        while (!heap_.empty() && batch_.size() < batch_.capacity() && heap_.front().message.timestamp <= horizon) {
+            std::pop_heap(heap_.begin(), heap_.end(), Later());
+            batch_.push_back(heap_.back().message);
+            heap_.pop_back();
+        }
+        if (batch_.empty()) {
+            waitUntil(lock, heap_.empty() ? std::numeric_limits<double>::infinity()
+                                          : heap_.front().message.timestamp - lead);
+            continue;
+        }
+
+        const uint64_t generation = generation_;
+        lock.unlock();
+        deliver(batch_, generation);
+        batch_.clear();
+        lock.lock();
+    }
+}
+
+void MidiScheduler::waitUntil(std::unique_lock<std::mutex>& lock, double time) {
+#ifdef __linux__
+    // timestampNow() reads steady_clock, which is CLOCK_MONOTONIC here, so
+    // timestamps are absolute timer expiries; a zero expiry disarms
+    itimerspec expiry{};
+    if (std::isfinite(time)) {
+        const double at = std::max(time, 1e-9);
+        expiry.it_value.tv_sec = static_cast<time_t>(at);
+        expiry.it_value.tv_nsec = static_cast<long>((at - static_cast<double>(expiry.it_value.tv_sec)) * 1e9);
+    }
+    timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &expiry, nullptr);
+    lock.unlock();
+
+    // A wake() after the unlock leaves the eventfd readable, so it is not lost
+    pollfd fds[2] = {{timerFd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+    if (poll(fds, 2, -1) > 0) {
+        uint64_t count;
+        if (fds[0].revents & POLLIN) {
+            (void)::read(timerFd_, &count, sizeof(count));
+        }
+        if (fds[1].revents & POLLIN) {
+            (void)::read(wakeFd_, &count, sizeof(count));
+        }
+    }
+    lock.lock();
+#else
+    auto woken = [this]() { return wakeRequested_; };
+    if (std::isfinite(time)) {
+        const auto at = std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(time)));
+        wakeCondition_.wait_until(lock, at, woken);
+    } else {
+        wakeCondition_.wait(lock, woken);
+    }
+    wakeRequested_ = false;
+#endif
+}
+
+void MidiScheduler::wake() {
+    // Called with mutex_ held
+#ifdef __linux__
+    if (wakeFd_ >= 0) {
+        const uint64_t one = 1;
+        (void)::write(wakeFd_, &one, sizeof(one));
+    }
+#else
+    wakeRequested_ = true;
+    wakeCondition_.notify_one();
+#endif
+}
+
+void MidiScheduler::deliver(const std::vector<RealTimeMidiMessage>& batch, uint64_t generation) {
+    std::lock_guard<std::mutex> lock(deliverMutex_);
+    if (generation != generation_) {
+        cancelled_ += batch.size();
+        return;
+    }
+
+    // The batch is in time order; send each run for one device as a burst
+    const bool queue = useQueue_;
+    size_t begin = 0;
+    while (begin < batch.size()) {
+        const int deviceId = batch[begin].deviceId;
+        size_t end = begin + 1;
+        while (end < batch.size() && batch[end].deviceId == deviceId) {
+            ++end;
+        }
+
+        PlayedDevice* played = nullptr;
+        for (size_t i = 0; i < playedCount_ && !played; ++i) {
+            if (playedDevices_[i].deviceId == deviceId) {
+                played = &playedDevices_[i];
+            }
+        }
+        if (!played && playedCount_ < kMaxPlayedDevices) {
+            played = &playedDevices_[playedCount_++];
+            played->deviceId = deviceId;
+            played->channels = 0;
+        }
+        playedOverflow_ |= !played;
+        for (size_t i = begin; played && i < end; ++i) {
+            if ((batch[i].status & 0xF0) == 0x90 && batch[i].channel >= 1 && batch[i].channel <= 16) {
+                played->channels |= static_cast<uint16_t>(1u << (batch[i].channel - 1));
+            }
+        }
+
+        const double now = MidiDevice::timestampNow();
+        const MidiError error = queue ? device_.scheduleMessages(deviceId, &batch[begin], end - begin)
+                                      : device_.sendMessages(deviceId, &batch[begin], end - begin);
+        if (error == MidiError::None) {
+            sent_ += end - begin;
+            for (size_t i = begin; i < end; ++i) {
+                const double lateness = std::max(0.0, now - batch[i].timestamp);
+                lateness_.record(static_cast<uint64_t>(lateness * 1e9));
+                if (lateness > kLateThreshold) {
+                    late_++;
+                }
+            }
+        } else {
+            failed_ += end - begin;
+        }
+        begin = end;
+    }
+}
+
+void MidiScheduler::silence() {
+    // Called with deliverMutex_ held
+    if (playedOverflow_) {
+        device_.cancelScheduledMessages(-1);
+    }
+    for (size_t i = 0; i < playedCount_; ++i) {
+        const PlayedDevice& played = playedDevices_[i];
+        device_.cancelScheduledMessages(played.deviceId);
+        RealTimeMidiMessage allNotesOff[16];
+        size_t count = 0;
+        for (int channel = 1; channel <= 16; ++channel) {
+            if (played.channels & (1u << (channel - 1))) {
+                RealTimeMidiMessage& message = allNotesOff[count++];
+                message.status = 0xB0;
+                message.data1 = 123;
+                message.data2 = 0;
+                message.channel = channel;
+                message.deviceId = played.deviceId;
+                message.timestamp = MidiDevice::timestampNow();
+            }
+        }
+        if (count > 0) {
+            device_.sendMessages(played.deviceId, allNotesOff, count);
+        }
+    }
+    playedCount_ = 0;
+    playedOverflow_ = false;
+}
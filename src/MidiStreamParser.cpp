@@ -0,0 +1,144 @@
+#include "../include/MidiStreamParser.h"
+#include "../include/MidiStatusTable.h"
+#include <algorithm>
+
+MidiStreamParser::MidiStreamParser(MidiInputCallback onMessage, MidiSysExCallback onSysEx, int deviceId,
+                                   size_t sysExBufferSize)
+    : onMessage_(std::move(onMessage))
+    , onSysEx_(std::move(onSysEx))
+    , deviceId_(deviceId)
+    , sysEx_(new uint8_t[std::max<size_t>(sysExBufferSize, 2)])
+    , sysExCapacity_(std::max<size_t>(sysExBufferSize, 2)) {
+}
+
+int MidiStreamParser::dataLength(uint8_t status) {
+    // Realtime bytes never start a message, so they report -1 here
+    const MidiStatusInfo& info = MidiStatusTable::lookup(status);
+    return (info.flags & MidiStatusTable::kRealtime) ? -1 : info.dataBytes;
+}
+
+void MidiStreamParser::feed(const uint8_t* data, size_t length, double timestamp) {
+    for (size_t i = 0; i < length; ++i) {
+        const uint8_t byte = data[i];
+
+        if (byte < 0x80) {
+            if (inSysEx_) {
+                if (sysExLength_ == sysExCapacity_) {
+                    flushSysEx(false, timestamp);
+                }
+                sysEx_[sysExLength_++] = byte;
+            } else if (status_ == 0) {
+                ++errors_; // No running status to apply it to
+            } else {
+                data_[received_++] = byte;
+                if (received_ == expected_) {
+                    emit(timestamp);
+                }
+            }
+            continue;
+        }
+
+        if (byte >= 0xF8) {
+            emitRealtime(byte, timestamp);
+            continue;
+        }
+
+        // Any other status byte ends a SysEx message
+        if (inSysEx_) {
+            if (byte == 0xF7) {
+                if (sysExLength_ == sysExCapacity_) {
+                    flushSysEx(false, timestamp);
+                }
+                sysEx_[sysExLength_++] = byte;
+                flushSysEx(true, timestamp);
+                ++sysExMessages_;
+                inSysEx_ = false;
+                continue;
+            }
+            ++errors_;
+            inSysEx_ = false;
+            sysExLength_ = 0;
+        }
+
+        received_ = 0;
+        if (byte == 0xF0) {
+            status_ = 0;
+            inSysEx_ = true;
+            sysEx_[sysExLength_++] = byte;
+            continue;
+        }
+
+        const int expected = dataLength(byte);
+        if (expected < 0) {
+            status_ = 0; // 0xF7 outside SysEx, or undefined 0xF4/0xF5
+            continue;
+        }
+        status_ = byte;
+        expected_ = expected;
+        if (expected_ == 0) {
+            emit(timestamp);
+        }
+    }
+}
+
+void MidiStreamParser::emit(double timestamp) {
+    RealTimeMidiMessage message;
+    if (status_ < 0xF0) {
+        message.status = status_ & 0xF0;
+        message.channel = (status_ & 0x0F) + 1;
+    } else {
+        message.status = status_;
+        message.channel = 1;
+    }
+    message.data1 = expected_ > 0 ? data_[0] : 0;
+    message.data2 = expected_ > 1 ? data_[1] : 0;
+    message.timestamp = timestamp;
+    message.deviceId = deviceId_;
+
+    received_ = 0;
+    if (status_ >= 0xF0) {
+        status_ = 0; // System common messages cancel running status
+    }
+    ++messages_;
+    if (onMessage_) {
+        onMessage_(message);
+    }
+}
+
+void MidiStreamParser::emitRealtime(uint8_t status, double timestamp) {
+    if (status == 0xF9 || status == 0xFD) {
+        return; // Undefined
+    }
+    RealTimeMidiMessage message;
+    message.status = status;
+    message.data1 = 0;
+    message.data2 = 0;
+    message.channel = 1;
+    message.timestamp = timestamp;
+    message.deviceId = deviceId_;
+    ++messages_;
+    if (onMessage_) {
+        onMessage_(message);
+    }
+}
+
+void MidiStreamParser::flushSysEx(bool complete, double timestamp) {
+    if (onSysEx_) {
+        MidiSysExMessage message;
+        message.data = sysEx_.get();
+        message.length = sysExLength_;
+        message.complete = complete;
+        message.timestamp = timestamp;
+        message.deviceId = deviceId_;
+        onSysEx_(message);
+    }
+    sysExLength_ = 0;
+}
+
+void MidiStreamParser::reset() {
+    status_ = 0;
+    received_ = 0;
+    expected_ = 0;
+    inSysEx_ = false;
+    sysExLength_ = 0;
+}
@@ -3,123 +3,279 @@
 #include <cmath>
 #include <cstdlib>
 #include <algorithm>
+#include <utility>
+
+namespace {
+
+const double kReleaseTime = 0.3;
+
+// Envelope timing (ADSR) - natural piano with proper sustain
+const double kAttackTime = 0.01; // Attack time for test compatibility
+const double kDecayTime = 0.4;    // Moderate decay for natural sound
+const double kSustainLevel = 0.35; // Natural sustain level
 
 /**
- * @brief [AI GENERATED] Generate realistic piano samples with inharmonicity,
- *        velocity-dependent brightness, and proper harmonic decay.
+ * @brief [AI GENERATED] Per-note values that stay constant across the note's samples.
  */
-std::vector<double> NoteSynth::synthesize(const std::vector<NoteEvent>& events,
-                                          int sampleRate) const {
+struct Voice {
+    double frequency;
+    double dVelocity;
+    int iStart;
+    int iHold;
+    int iRelease;
+    int iCount;
+    int iAttackSamples;
+    int iDecaySamples;
+    int iActiveHarmonics;
+};
+
+Voice makeVoice(const NoteEvent& e, int sampleRate) {
+    Voice v;
+    v.frequency = e.frequency;
+    v.iStart = static_cast<int>(e.startTime * sampleRate);
+    v.iHold = static_cast<int>(e.duration * sampleRate);
+    v.iRelease = static_cast<int>(kReleaseTime * sampleRate);
+    v.iCount = v.iHold + v.iRelease;
+    v.iAttackSamples = static_cast<int>(kAttackTime * sampleRate);
+    v.iDecaySamples = static_cast<int>(kDecayTime * sampleRate);
+
+    // Determine number of harmonics based on frequency (natural piano brightness)
+    int iMaxHarmonics;
+    if (e.frequency < 130.0) {
+        iMaxHarmonics = 15; // Bass: rich harmonic content for warmth
+    } else if (e.frequency < 520.0) {
+        iMaxHarmonics = 12; // Mid: good harmonic content for brightness
+    } else {
+        iMaxHarmonics = 8;  // Treble: moderate harmonics for clarity
+    }
+
+    // Velocity-dependent brightness (simulate hammer-string interaction)
+    // Use actual velocity from key press event
+    v.dVelocity = std::min(1.0, std::max(0.1, e.velocity)); // Clamp velocity to reasonable range
+    v.iActiveHarmonics = static_cast<int>(iMaxHarmonics * (0.3 + 0.7 * v.dVelocity));
+    return v;
+}
+
+/**
+ * @brief [AI GENERATED] Harmonic amplitude before time decay.
+ */
+double harmonicAmplitude(int h, double dVelocity) {
+    double dHarmonicAmp = 1.0 / h; // Basic 1/n falloff
+
+    // Velocity-dependent harmonic amplitude scaling
+    if (h > 1) {
+        // Higher harmonics affected by velocity (harder strikes = more upper harmonics)
+        dHarmonicAmp *= (0.4 + 0.6 * dVelocity) * std::exp(-0.15 * (h - 1));
+    }
+    return dHarmonicAmp;
+}
+
+/**
+ * @brief [AI GENERATED] Add note-relative samples [from, to) of a voice to out, where out[0] is note sample from.
+ */
+void renderVoice(const Voice& v, int from, int to, int sampleRate, double* out) {
+    // Minimal inharmonicity for natural sound
+    const double B = 0.0; // Remove inharmonicity to eliminate beating
+
+    // No hammer noise - clean sine waves only
+
+    for (int i = from; i < to; ++i) {
+        const double t = static_cast<double>(i) / sampleRate;
+
+        // ADSR Envelope
+        double dEnvelope = 1.0;
+        if (i < v.iAttackSamples) {
+            // Attack
+            dEnvelope = static_cast<double>(i) / v.iAttackSamples;
+        } else if (i < v.iAttackSamples + v.iDecaySamples) {
+            // Decay
+            double dDecayProgress = static_cast<double>(i - v.iAttackSamples) / v.iDecaySamples;
+            dEnvelope = 1.0 - (1.0 - kSustainLevel) * dDecayProgress;
+        } else if (i < v.iHold) {
+            // Sustain
+            dEnvelope = kSustainLevel;
+        } else {
+            // Release
+            double dReleaseProgress = static_cast<double>(i - v.iHold) / v.iRelease;
+            dEnvelope = kSustainLevel * std::exp(-3.0 * dReleaseProgress);
+        }
+
+        double dValue = 0.0;
+
+        // Generate harmonics with inharmonicity and realistic decay
+        for (int h = 1; h <= v.iActiveHarmonics; ++h) {
+            // Inharmonic frequency: f_n = f_0 * n * sqrt(1 + B * n^2)
+            const double dInharmonicFreq = v.frequency * h * std::sqrt(1.0 + B * h * h);
+
+            // Phase for this harmonic
+            const double dPhase = 2.0 * M_PI * dInharmonicFreq * t;
+
+            // Harmonic amplitude with velocity dependence
+            double dHarmonicAmp = harmonicAmplitude(h, v.dVelocity);
+
+            // Natural string decay characteristics
+            double dHarmonicDecay;
+            if (h == 1) {
+                // Fundamental: slow decay for sustain
+                dHarmonicDecay = std::exp(-t * 0.15);
+            } else if (h <= 4) {
+                // Low harmonics: moderate decay for warmth
+                dHarmonicDecay = std::exp(-t * (0.2 + 0.1 * h));
+            } else {
+                // High harmonics: faster decay but not too fast
+                dHarmonicDecay = std::exp(-t * (0.4 + 0.2 * h));
+            }
+            dHarmonicAmp *= dHarmonicDecay;
+
+            dValue += dHarmonicAmp * std::sin(dPhase);
+        }
+
+        // No noise - pure sine waves only
+
+        // Apply velocity-dependent amplitude scaling
+        dValue *= v.dVelocity * 0.8; // Scale by velocity for realistic dynamics
+
+        out[i - from] += dEnvelope * dValue;
+    }
+}
+
+} // namespace
+
+/**
+ * @brief [AI GENERATED] Length of the rendered audio, including the release tail of the last note.
+ */
+size_t NoteSynth::frameCount(const std::vector<NoteEvent>& events, int sampleRate) {
     // Calculate total duration including release (with sustain pedal)
-    const double kReleaseTime = 0.3;
     double dTotalDuration = 0.0;
     for (const auto& e : events) {
         double dEnd = e.startTime + e.duration + kReleaseTime;
         dTotalDuration = std::max(dTotalDuration, dEnd);
     }
+    return static_cast<size_t>(static_cast<int>(dTotalDuration * sampleRate));
+}
 
-    const int iTotalSamples = static_cast<int>(dTotalDuration * sampleRate);
-    std::vector<double> samples(iTotalSamples, 0.0);
+/**
+ * @brief [AI GENERATED] Mix every note overlapping the requested range into out.
+ */
+void NoteSynth::renderBlock(const std::vector<NoteEvent>& events, int sampleRate, size_t firstFrame,
+                            size_t frames, double* out, double gain) const {
+    BlockRenderer(events, sampleRate).render(firstFrame, frames, out, gain);
+}
 
-    for (const auto& e : events) {
-        const int iStart = static_cast<int>(e.startTime * sampleRate);
-        const int iHold = static_cast<int>(e.duration * sampleRate);
-        const int iRelease = static_cast<int>(kReleaseTime * sampleRate);
-        const int iCount = iHold + iRelease;
-
-        // Envelope timing (ADSR) - natural piano with proper sustain
-        const double kAttackTime = 0.01; // Attack time for test compatibility
-        const double kDecayTime = 0.4;    // Moderate decay for natural sound
-        const double kSustainLevel = 0.35; // Natural sustain level
-        
-        const int iAttackSamples = static_cast<int>(kAttackTime * sampleRate);
-        const int iDecaySamples = static_cast<int>(kDecayTime * sampleRate);
-
-        // Determine number of harmonics based on frequency (natural piano brightness)
-        int iMaxHarmonics;
-        if (e.frequency < 130.0) {
-            iMaxHarmonics = 15; // Bass: rich harmonic content for warmth
-        } else if (e.frequency < 520.0) {
-            iMaxHarmonics = 12; // Mid: good harmonic content for brightness
-        } else {
-            iMaxHarmonics = 8;  // Treble: moderate harmonics for clarity
+/**
+ * @brief [AI GENERATED] Sort the notes by start sample once for all blocks.
+ */
+NoteSynth::BlockRenderer::BlockRenderer(const std::vector<NoteEvent>& events, int sampleRate)
+    : events_(events), sampleRate_(sampleRate) {
+    starts_.reserve(events.size());
+    ends_.reserve(events.size());
+    byStart_.reserve(events.size());
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Voice v = makeVoice(events[i], sampleRate);
+        starts_.push_back(v.iStart);
+        ends_.push_back(static_cast<long long>(v.iStart) + v.iCount);
+        byStart_.push_back(i);
+    }
+    std::stable_sort(byStart_.begin(), byStart_.end(),
+                     [this](size_t a, size_t b) { return starts_[a] < starts_[b]; });
+}
+
+/**
+ * @brief [AI GENERATED] Mix the notes sounding in the requested range into out.
+ */
+void NoteSynth::BlockRenderer::render(size_t firstFrame, size_t frames, double* out, double gain) {
+    std::fill(out, out + frames, 0.0);
+    if (firstFrame < nextFrame_) {
+        nextStart_ = 0;
+        active_.clear();
+    }
+    nextFrame_ = firstFrame + frames;
+    const long long blockStart = static_cast<long long>(firstFrame);
+    const long long blockEnd = blockStart + static_cast<long long>(frames);
+
+    active_.erase(std::remove_if(active_.begin(), active_.end(),
+                                 [this, blockStart](size_t i) { return ends_[i] <= blockStart; }),
+                  active_.end());
+    for (; nextStart_ < byStart_.size() && starts_[byStart_[nextStart_]] < blockEnd; ++nextStart_) {
+        const size_t i = byStart_[nextStart_];
+        if (ends_[i] > blockStart) {
+            active_.insert(std::upper_bound(active_.begin(), active_.end(), i), i);
         }
+    }
 
-        // Minimal inharmonicity for natural sound
-        const double B = 0.0; // Remove inharmonicity to eliminate beating
-
-        // Velocity-dependent brightness (simulate hammer-string interaction)
-        // Use actual velocity from key press event
-        const double dVelocity = std::min(1.0, std::max(0.1, e.velocity)); // Clamp velocity to reasonable range
-        const int iActiveHarmonics = static_cast<int>(iMaxHarmonics * (0.3 + 0.7 * dVelocity));
-
-        // No hammer noise - clean sine waves only
-
-        for (int i = 0; i < iCount; ++i) {
-            const double t = static_cast<double>(i) / sampleRate;
-            
-            // ADSR Envelope
-            double dEnvelope = 1.0;
-            if (i < iAttackSamples) {
-                // Attack
-                dEnvelope = static_cast<double>(i) / iAttackSamples;
-            } else if (i < iAttackSamples + iDecaySamples) {
-                // Decay
-                double dDecayProgress = static_cast<double>(i - iAttackSamples) / iDecaySamples;
-                dEnvelope = 1.0 - (1.0 - kSustainLevel) * dDecayProgress;
-            } else if (i < iHold) {
-                // Sustain
-                dEnvelope = kSustainLevel;
-            } else {
-                // Release
-                double dReleaseProgress = static_cast<double>(i - iHold) / iRelease;
-                dEnvelope = kSustainLevel * std::exp(-3.0 * dReleaseProgress);
-            }
+    // Notes are mixed in event order so every sample sums identically to synthesize()
+    for (size_t i : active_) {
+        const Voice v = makeVoice(events_[i], sampleRate_);
+        const long long from = std::max<long long>(blockStart, starts_[i]);
+        const long long to = std::min<long long>(blockEnd, ends_[i]);
+        if (from < to) {
+            renderVoice(v, static_cast<int>(from - v.iStart), static_cast<int>(to - v.iStart), sampleRate_,
+                        out + (from - blockStart));
+        }
+    }
 
-            double dValue = 0.0;
-            
-            // Generate harmonics with inharmonicity and realistic decay
-            for (int h = 1; h <= iActiveHarmonics; ++h) {
-                // Inharmonic frequency: f_n = f_0 * n * sqrt(1 + B * n^2)
-                const double dInharmonicFreq = e.frequency * h * std::sqrt(1.0 + B * h * h);
-                
-                // Phase for this harmonic
-                const double dPhase = 2.0 * M_PI * dInharmonicFreq * t;
-                
-                // Harmonic amplitude with velocity dependence
-                double dHarmonicAmp = 1.0 / h; // Basic 1/n falloff
-                
-                // Velocity-dependent harmonic amplitude scaling
-                if (h > 1) {
-                    // Higher harmonics affected by velocity (harder strikes = more upper harmonics)
-                    dHarmonicAmp *= (0.4 + 0.6 * dVelocity) * std::exp(-0.15 * (h - 1));
-                }
-                
-                // Natural string decay characteristics
-                double dHarmonicDecay;
-                if (h == 1) {
-                    // Fundamental: slow decay for sustain
-                    dHarmonicDecay = std::exp(-t * 0.15);
-                } else if (h <= 4) {
-                    // Low harmonics: moderate decay for warmth
-                    dHarmonicDecay = std::exp(-t * (0.2 + 0.1 * h));
-                } else {
-                    // High harmonics: faster decay but not too fast
-                    dHarmonicDecay = std::exp(-t * (0.4 + 0.2 * h));
-                }
-                dHarmonicAmp *= dHarmonicDecay;
-                
-                dValue += dHarmonicAmp * std::sin(dPhase);
-            }
+    if (gain != 1.0) {
+        for (size_t i = 0; i < frames; ++i) {
+            out[i] *= gain;
+        }
+    }
+}
 
-            // No noise - pure sine waves only
+/**
+ * @brief [AI GENERATED] Sweep the per-note amplitude bounds to find the loudest possible instant.
+ */
+double NoteSynth::peakBound(const std::vector<NoteEvent>& events, int sampleRate) const {
+    // Each note is bounded by its summed harmonic amplitudes: at full envelope
+    // through attack and decay, and at the sustain level afterwards.
+    std::vector<std::pair<long long, double>> steps;
+    steps.reserve(events.size() * 4);
+    for (const auto& e : events) {
+        const Voice v = makeVoice(e, sampleRate);
+        double amplitude = 0.0;
+        for (int h = 1; h <= v.iActiveHarmonics; ++h) {
+            amplitude += harmonicAmplitude(h, v.dVelocity);
+        }
+        amplitude *= v.dVelocity * 0.8;
 
-            // Apply velocity-dependent amplitude scaling
-            dValue *= dVelocity * 0.8; // Scale by velocity for realistic dynamics
+        const long long start = v.iStart;
+        const long long loudEnd = start + std::min(v.iCount, v.iAttackSamples + v.iDecaySamples);
+        const long long end = start + v.iCount;
+        steps.emplace_back(start, amplitude);
+        steps.emplace_back(loudEnd, -amplitude);
+        if (loudEnd < end) {
+            steps.emplace_back(loudEnd, kSustainLevel * amplitude);
+            steps.emplace_back(end, -kSustainLevel * amplitude);
+        }
+    }
+    std::sort(steps.begin(), steps.end());
 
-            samples[iStart + i] += dEnvelope * dValue;
+    double level = 0.0;
+    double peak = 0.0;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        level += steps[i].second;
+        if (i + 1 == steps.size() || steps[i + 1].first != steps[i].first) {
+            peak = std::max(peak, level);
         }
     }
+    return peak;
+}
+
+/**
+ * @brief [AI GENERATED] Fixed gain that keeps a streamed render within the batch normalization ceiling.
+ */
+double NoteSynth::streamingGain(const std::vector<NoteEvent>& events, int sampleRate) const {
+    const double dBound = peakBound(events, sampleRate);
+    return dBound > 0.95 ? 0.95 / dBound : 1.0;
+}
+
+/**
+ * @brief [AI GENERATED] Generate realistic piano samples with inharmonicity,
+ *        velocity-dependent brightness, and proper harmonic decay.
+ */
+std::vector<double> NoteSynth::synthesize(const std::vector<NoteEvent>& events,
+                                          int sampleRate) const {
+    std::vector<double> samples(frameCount(events, sampleRate), 0.0);
+    renderBlock(events, sampleRate, 0, samples.size(), samples.data());
 
     // Normalize to prevent clipping
     double dMax = 0.0;
@@ -134,4 +290,4 @@ std::vector<double> NoteSynth::synthesize(const std::vector<NoteEvent>& events,
     }
 
     return samples;
-}
\ No newline at end of file
+}
@@ -1,43 +1,124 @@
 #include "../include/OutputHandler.h"
-#include <fstream>
-#include <cstdint>
+#include "../include/MappedWavWriter.h"
+#include "../include/WavStreamWriter.h"
 #include <vector>
 
 /**
- * @brief [AI GENERATED] Helper to write little-endian integers.
+ * @brief [AI GENERATED] Write samples to a WAV file.
+ */
+void OutputHandler::writeWav(const std::vector<double>& samples, const std::string& file, int sampleRate,
+                             bool dither) const {
+    WavFormat format;
+    format.sampleRate = sampleRate;
+    writeWav(samples, file, format, dither);
+}
+
+/**
+ * @brief [AI GENERATED] Write interleaved samples using an explicit format.
  */
-static void writeLE(std::ofstream& stream, uint32_t value, int size) {
-    for (int i = 0; i < size; ++i) {
-        stream.put(static_cast<char>(value & 0xFF));
-        value >>= 8;
+bool OutputHandler::writeWav(const std::vector<double>& samples, const std::string& file,
+                             const WavFormat& format, bool dither) const {
+    if (format.channels < 1) {
+        return false;   // Checked before the frame count below divides by it
+    }
+    WavStreamWriter writer;
+    if (!writer.open(file, format.resolveRf64(samples.size() / format.channels), dither)) {
+        return false;
     }
+    bool ok = writer.append(samples);
+    return writer.finalize() && ok;
 }
 
 /**
- * @brief [AI GENERATED] Write samples to a WAV file.
+ * @brief [AI GENERATED] Write interleaved samples through a memory-mapped file.
+ */
+bool OutputHandler::writeWavMapped(const std::vector<double>& samples, const std::string& file,
+                                   const WavFormat& format, bool dither) const {
+    if (format.channels < 1) {
+        return false;
+    }
+    MappedWavWriter writer;
+    const uint64_t frames = samples.size() / format.channels;
+    if (!writer.open(file, format, frames, dither)) {
+        return false;
+    }
+    bool ok = writer.append(samples.data(), frames);
+    return writer.finalize() && ok;
+}
+
+/**
+ * @brief [AI GENERATED] Write interleaved samples as FLAC.
+ */
+bool OutputHandler::writeFlac(const std::vector<double>& samples, const std::string& file,
+                              const WavFormat& format, const FlacSettings& settings, bool dither) const {
+    FlacWriter writer;
+    if (!writer.open(file, format, settings, dither)) {
+        return false;
+    }
+    bool ok = writer.append(samples);
+    return writer.finalize() && ok;
+}
+
+/**
+ * @brief [AI GENERATED] Open a WAV or FLAC writer for streaming output.
  */
-void OutputHandler::writeWav(const std::vector<double>& samples, const std::string& file, int sampleRate) const {
-    std::ofstream out(file, std::ios::binary);
-    uint32_t dataSize = samples.size() * sizeof(int16_t);
+std::unique_ptr<AudioSink> OutputHandler::openSink(const std::string& file, const WavFormat& format,
+                                                   uint64_t frames, bool dither) const {
+    const std::string flacExtension = ".flac";
+    if (file.size() >= flacExtension.size() &&
+        file.compare(file.size() - flacExtension.size(), flacExtension.size(), flacExtension) == 0) {
+        auto writer = std::make_unique<FlacWriter>();
+        if (!writer->open(file, format, FlacSettings(), dither)) {
+            return nullptr;
+        }
+        return writer;
+    }
 
-    out.write("RIFF", 4);
-    writeLE(out, 36 + dataSize, 4);
-    out.write("WAVE", 4);
+    auto writer = std::make_unique<WavStreamWriter>();
+    if (!writer->open(file, frames ? format.resolveRf64(frames) : format, dither)) {
+        return nullptr;
+    }
+    return writer;
+}
 
-    out.write("fmt ", 4);
-    writeLE(out, 16, 4);
-    writeLE(out, 1, 2);
-    writeLE(out, 1, 2);
-    writeLE(out, sampleRate, 4);
-    writeLE(out, sampleRate * 2, 4);
-    writeLE(out, 2, 2);
-    writeLE(out, 16, 2);
+/**
+ * @brief [AI GENERATED] Open a memory-mapped WAV writer.
+ */
+std::unique_ptr<AudioSink> OutputHandler::openMappedSink(const std::string& file, const WavFormat& format,
+                                                         uint64_t frames, bool dither) const {
+    auto writer = std::make_unique<MappedWavWriter>();
+    if (!writer->open(file, format, frames, dither)) {
+        return nullptr;
+    }
+    return writer;
+}
 
-    out.write("data", 4);
-    writeLE(out, dataSize, 4);
+/**
+ * @brief [AI GENERATED] Open an io_uring/O_DIRECT WAV writer.
+ */
+std::unique_ptr<DirectWavWriter> OutputHandler::openDirectSink(const std::string& file, const WavFormat& format,
+                                                               uint64_t frames, const DirectWriterSettings& settings,
+                                                               bool dither) const {
+    auto writer = std::make_unique<DirectWavWriter>();
+    if (!writer->open(file, format, frames, settings, dither)) {
+        return nullptr;
+    }
+    return writer;
+}
 
-    for (double s : samples) {
-        int16_t v = static_cast<int16_t>(s * 32767);
-        writeLE(out, static_cast<uint16_t>(v), 2);
+/**
+ * @brief [AI GENERATED] Open a streaming writer on a pipe or stdout.
+ */
+std::unique_ptr<AudioSink> OutputHandler::openPipe(int fd, const WavFormat& format, PipeContainer container,
+                                                   uint64_t frames, bool dither) const {
+    // Without a length an unresolved RF64 reservation is useless on a stream
+    WavFormat resolved = frames ? format.resolveRf64(frames) : format;
+    if (!frames && resolved.rf64 == Rf64Mode::Auto) {
+        resolved.rf64 = Rf64Mode::Never;
+    }
+    auto sink = std::make_unique<PipeSink>();
+    if (!sink->open(fd, resolved, container, frames, dither)) {
+        return nullptr;
     }
+    return sink;
 }
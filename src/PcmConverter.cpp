@@ -0,0 +1,302 @@
+#include "../include/PcmConverter.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PCM_CONVERTER_SSE2 1
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define PCM_CONVERTER_BIG_ENDIAN 1
+#endif
+
+namespace {
+
+constexpr double kPcm16Scale = 32767.0;
+constexpr double kPcm16Min = -32768.0;
+constexpr double kPcm16Max = 32767.0;
+constexpr double kPcm24Scale = 8388607.0;
+constexpr double kPcm24Min = -8388608.0;
+constexpr double kPcm24Max = 8388607.0;
+
+/**
+ * @brief [AI GENERATED] Clamp with the same NaN behaviour as _mm_max_pd/_mm_min_pd.
+ */
+inline double saturate(double v, double lo, double hi) {
+    v = v > lo ? v : lo;
+    return v < hi ? v : hi;
+}
+
+inline int32_t quantize24(double v) {
+    return static_cast<int32_t>(std::nearbyint(saturate(v, kPcm24Min, kPcm24Max)));
+}
+
+inline void storePcm24(uint8_t* dst, int32_t q) {
+    const uint32_t u = static_cast<uint32_t>(q);
+    dst[0] = static_cast<uint8_t>(u & 0xFF);
+    dst[1] = static_cast<uint8_t>((u >> 8) & 0xFF);
+    dst[2] = static_cast<uint8_t>((u >> 16) & 0xFF);
+}
+
+} // namespace
+
+void PcmConverter::convert(SampleFormat format, const double* in, uint8_t* out, size_t count,
+                           const double* noise) {
+    switch (format) {
+        case SampleFormat::Pcm16: toPcm16(in, out, count, noise); break;
+        case SampleFormat::Pcm24: toPcm24(in, out, count, noise); break;
+        case SampleFormat::Float32: toFloat32(in, out, count); break;
+    }
+}
+
+void PcmConverter::toDouble(SampleFormat format, const uint8_t* in, double* out, size_t count) {
+    switch (format) {
+        case SampleFormat::Pcm16: fromPcm16(in, out, count); break;
+        case SampleFormat::Pcm24: fromPcm24(in, out, count); break;
+        case SampleFormat::Float32: fromFloat32(in, out, count); break;
+    }
+}
+
+int PcmConverter::bytesPerSample(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::Pcm16: return 2;
+        case SampleFormat::Pcm24: return 3;
+        case SampleFormat::Float32: return 4;
+    }
+    return 0;
+}
+
+TpdfDither::TpdfDither(uint32_t seed) : state_(seed ? seed : 1u) {
+}
+
+void TpdfDither::fill(double* out, size_t count, double lsb) {
+    // xorshift32 is plenty for dither and keeps renders reproducible.
+    constexpr double kInvRange = 1.0 / 4294967296.0;
+    uint32_t s = state_;
+    for (size_t i = 0; i < count; ++i) {
+        s ^= s << 13; s ^= s >> 17; s ^= s << 5;
+        const double a = s * kInvRange;
+        s ^= s << 13; s ^= s >> 17; s ^= s << 5;
+        const double b = s * kInvRange;
+        out[i] = (a + b - 1.0) * lsb;
+    }
+    state_ = s;
+}
+
+void PcmConverter::toPcm16Scalar(const double* in, uint8_t* out, size_t count,
+                                  const double* noise) {
+    for (size_t i = 0; i < count; ++i) {
+        double v = in[i] * kPcm16Scale;
+        if (noise) {
+            v += noise[i];
+        }
+        const int16_t q = static_cast<int16_t>(std::nearbyint(saturate(v, kPcm16Min, kPcm16Max)));
+        const uint16_t u = static_cast<uint16_t>(q);
+        out[2 * i] = static_cast<uint8_t>(u & 0xFF);
+        out[2 * i + 1] = static_cast<uint8_t>(u >> 8);
+    }
+}
+
+void PcmConverter::toPcm16(const double* in, uint8_t* out, size_t count,
+                           const double* noise) {
+#if defined(PCM_CONVERTER_SSE2) && !defined(PCM_CONVERTER_BIG_ENDIAN)
+    const __m128d scale = _mm_set1_pd(kPcm16Scale);
+    const __m128d lo = _mm_set1_pd(kPcm16Min);
+    const __m128d hi = _mm_set1_pd(kPcm16Max);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128d v0 = _mm_mul_pd(_mm_loadu_pd(in + i), scale);
+        __m128d v1 = _mm_mul_pd(_mm_loadu_pd(in + i + 2), scale);
+        __m128d v2 = _mm_mul_pd(_mm_loadu_pd(in + i + 4), scale);
+        __m128d v3 = _mm_mul_pd(_mm_loadu_pd(in + i + 6), scale);
+        if (noise) {
+            v0 = _mm_add_pd(v0, _mm_loadu_pd(noise + i));
+            v1 = _mm_add_pd(v1, _mm_loadu_pd(noise + i + 2));
+            v2 = _mm_add_pd(v2, _mm_loadu_pd(noise + i + 4));
+            v3 = _mm_add_pd(v3, _mm_loadu_pd(noise + i + 6));
+        }
+        v0 = _mm_min_pd(_mm_max_pd(v0, lo), hi);
+        v1 = _mm_min_pd(_mm_max_pd(v1, lo), hi);
+        v2 = _mm_min_pd(_mm_max_pd(v2, lo), hi);
+        v3 = _mm_min_pd(_mm_max_pd(v3, lo), hi);
+        const __m128i a = _mm_unpacklo_epi64(_mm_cvtpd_epi32(v0), _mm_cvtpd_epi32(v1));
+        const __m128i b = _mm_unpacklo_epi64(_mm_cvtpd_epi32(v2), _mm_cvtpd_epi32(v3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_packs_epi32(a, b));
+    }
+    toPcm16Scalar(in + i, out + 2 * i, count - i, noise ? noise + i : nullptr);
+#else
+    toPcm16Scalar(in, out, count, noise);
+#endif
+}
+
+void PcmConverter::toPcm24Scalar(const double* in, uint8_t* out, size_t count,
+                                  const double* noise) {
+    for (size_t i = 0; i < count; ++i) {
+        double v = in[i] * kPcm24Scale;
+        if (noise) {
+            v += noise[i];
+        }
+        storePcm24(out + 3 * i, quantize24(v));
+    }
+}
+
+void PcmConverter::toPcm24(const double* in, uint8_t* out, size_t count,
+                           const double* noise) {
+#if defined(PCM_CONVERTER_SSE2) && !defined(PCM_CONVERTER_BIG_ENDIAN)
+    const __m128d scale = _mm_set1_pd(kPcm24Scale);
+    const __m128d lo = _mm_set1_pd(kPcm24Min);
+    const __m128d hi = _mm_set1_pd(kPcm24Max);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128d v0 = _mm_mul_pd(_mm_loadu_pd(in + i), scale);
+        __m128d v1 = _mm_mul_pd(_mm_loadu_pd(in + i + 2), scale);
+        if (noise) {
+            v0 = _mm_add_pd(v0, _mm_loadu_pd(noise + i));
+            v1 = _mm_add_pd(v1, _mm_loadu_pd(noise + i + 2));
+        }
+        v0 = _mm_min_pd(_mm_max_pd(v0, lo), hi);
+        v1 = _mm_min_pd(_mm_max_pd(v1, lo), hi);
+        alignas(16) uint32_t q[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(q),
+                        _mm_unpacklo_epi64(_mm_cvtpd_epi32(v0), _mm_cvtpd_epi32(v1)));
+
+        // Pack four 24-bit values into 12 bytes with two stores
+        const uint64_t packedLo = (q[0] & 0xFFFFFFull) | (static_cast<uint64_t>(q[1] & 0xFFFFFF) << 24) |
+                                  (static_cast<uint64_t>(q[2] & 0xFFFF) << 48);
+        const uint32_t packedHi = ((q[2] >> 16) & 0xFF) | ((q[3] & 0xFFFFFF) << 8);
+        std::memcpy(out + 3 * i, &packedLo, sizeof(packedLo));
+        std::memcpy(out + 3 * i + 8, &packedHi, sizeof(packedHi));
+    }
+    toPcm24Scalar(in + i, out + 3 * i, count - i, noise ? noise + i : nullptr);
+#else
+    toPcm24Scalar(in, out, count, noise);
+#endif
+}
+
+void PcmConverter::toFloat32Scalar(const double* in, uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const float f = static_cast<float>(in[i]);
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        out[4 * i] = static_cast<uint8_t>(bits & 0xFF);
+        out[4 * i + 1] = static_cast<uint8_t>((bits >> 8) & 0xFF);
+        out[4 * i + 2] = static_cast<uint8_t>((bits >> 16) & 0xFF);
+        out[4 * i + 3] = static_cast<uint8_t>(bits >> 24);
+    }
+}
+
+void PcmConverter::toFloat32(const double* in, uint8_t* out, size_t count) {
+#if defined(PCM_CONVERTER_SSE2) && !defined(PCM_CONVERTER_BIG_ENDIAN)
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 a = _mm_cvtpd_ps(_mm_loadu_pd(in + i));
+        const __m128 b = _mm_cvtpd_ps(_mm_loadu_pd(in + i + 2));
+        _mm_storeu_ps(reinterpret_cast<float*>(out + 4 * i), _mm_movelh_ps(a, b));
+    }
+    toFloat32Scalar(in + i, out + 4 * i, count - i);
+#else
+    toFloat32Scalar(in, out, count);
+#endif
+}
+
+void PcmConverter::toInt32(SampleFormat format, const double* in, int32_t* out, size_t count,
+                           const double* noise) {
+    double scale, lo, hi;
+    switch (format) {
+        case SampleFormat::Pcm16: scale = kPcm16Scale; lo = kPcm16Min; hi = kPcm16Max; break;
+        case SampleFormat::Pcm24: scale = kPcm24Scale; lo = kPcm24Min; hi = kPcm24Max; break;
+        default: return;
+    }
+
+    size_t i = 0;
+#if defined(PCM_CONVERTER_SSE2)
+    const __m128d vScale = _mm_set1_pd(scale);
+    const __m128d vLo = _mm_set1_pd(lo);
+    const __m128d vHi = _mm_set1_pd(hi);
+    for (; i + 4 <= count; i += 4) {
+        __m128d v0 = _mm_mul_pd(_mm_loadu_pd(in + i), vScale);
+        __m128d v1 = _mm_mul_pd(_mm_loadu_pd(in + i + 2), vScale);
+        if (noise) {
+            v0 = _mm_add_pd(v0, _mm_loadu_pd(noise + i));
+            v1 = _mm_add_pd(v1, _mm_loadu_pd(noise + i + 2));
+        }
+        v0 = _mm_min_pd(_mm_max_pd(v0, vLo), vHi);
+        v1 = _mm_min_pd(_mm_max_pd(v1, vLo), vHi);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_unpacklo_epi64(_mm_cvtpd_epi32(v0), _mm_cvtpd_epi32(v1)));
+    }
+#endif
+    for (; i < count; ++i) {
+        double v = in[i] * scale;
+        if (noise) {
+            v += noise[i];
+        }
+        out[i] = static_cast<int32_t>(std::nearbyint(saturate(v, lo, hi)));
+    }
+}
+
+void PcmConverter::fromPcm16Scalar(const uint8_t* in, double* out, size_t count) {
+    constexpr double kInvScale = 1.0 / kPcm16Scale;
+    for (size_t i = 0; i < count; ++i) {
+        const int16_t q = static_cast<int16_t>(in[2 * i] | (in[2 * i + 1] << 8));
+        out[i] = q * kInvScale;
+    }
+}
+
+void PcmConverter::fromPcm16(const uint8_t* in, double* out, size_t count) {
+#if defined(PCM_CONVERTER_SSE2) && !defined(PCM_CONVERTER_BIG_ENDIAN)
+    const __m128d invScale = _mm_set1_pd(1.0 / kPcm16Scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i));
+        // Sign-extend by moving each int16 to the top half of an int32 and shifting back
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_cvtepi32_pd(lo), invScale));
+        _mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(lo, 0x4E)), invScale));
+        _mm_storeu_pd(out + i + 4, _mm_mul_pd(_mm_cvtepi32_pd(hi), invScale));
+        _mm_storeu_pd(out + i + 6, _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(hi, 0x4E)), invScale));
+    }
+    fromPcm16Scalar(in + 2 * i, out + i, count - i);
+#else
+    fromPcm16Scalar(in, out, count);
+#endif
+}
+
+void PcmConverter::fromPcm24(const uint8_t* in, double* out, size_t count) {
+    constexpr double kInvScale = 1.0 / kPcm24Scale;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* p = in + 3 * i;
+        // Place the 24 bits at the top of an int32 so the shift sign-extends
+        const int32_t q = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) |
+                                               (static_cast<uint32_t>(p[1]) << 16) |
+                                               (static_cast<uint32_t>(p[2]) << 24)) >> 8;
+        out[i] = q * kInvScale;
+    }
+}
+
+void PcmConverter::fromFloat32Scalar(const uint8_t* in, double* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t bits = static_cast<uint32_t>(in[4 * i]) | (static_cast<uint32_t>(in[4 * i + 1]) << 8) |
+                              (static_cast<uint32_t>(in[4 * i + 2]) << 16) |
+                              (static_cast<uint32_t>(in[4 * i + 3]) << 24);
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        out[i] = f;
+    }
+}
+
+void PcmConverter::fromFloat32(const uint8_t* in, double* out, size_t count) {
+#if defined(PCM_CONVERTER_SSE2) && !defined(PCM_CONVERTER_BIG_ENDIAN)
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 v = _mm_loadu_ps(reinterpret_cast<const float*>(in + 4 * i));
+        _mm_storeu_pd(out + i, _mm_cvtps_pd(v));
+        _mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+    fromFloat32Scalar(in + 4 * i, out + i, count - i);
+#else
+    fromFloat32Scalar(in, out, count);
+#endif
+}
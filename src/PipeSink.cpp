@@ -0,0 +1,140 @@
+#include "../include/PipeSink.h"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+PipeSink::~PipeSink() {
+    if (isOpen()) {
+        finalize();
+    }
+}
+
+bool PipeSink::open(int fd, const WavFormat& format, PipeContainer container, uint64_t frames, bool dither) {
+    if (isOpen()) {
+        finalize();
+    }
+    if (fd < 0 || format.channels < 1 || format.sampleRate < 1) {
+        return false;
+    }
+
+#ifdef F_SETPIPE_SZ
+    // Larger pipe buffers mean fewer wakeups of the reader; not fatal if refused
+    const int pipeBytes = fcntl(fd, F_GETPIPE_SZ);
+    if (pipeBytes > 0 && pipeBytes < kPipeBufferBytes) {
+        fcntl(fd, F_SETPIPE_SZ, kPipeBufferBytes);
+    }
+#endif
+
+    fd_ = fd;
+    format_ = format;
+    container_ = container;
+    expectedFrames_ = frames;
+    dither_ = dither && !format.isFloat();
+    failed_ = false;
+    samplesWritten_ = 0;
+    stats_ = PipeSinkStats();
+    pcm_.resize(kWriteBlockSamples * format.bytesPerSample());
+    noise_.resize(dither_ ? kWriteBlockSamples : 0);
+
+    if (container_ == PipeContainer::Wav) {
+        // A pipe cannot be rewound, so the header is final from the start
+        const uint64_t dataBytes = frames > 0 ? frames * format_.blockAlign() : WavHeader::kUnknownSize;
+        const auto header = WavHeader::build(format_, dataBytes);
+        if (header.empty() || !writeAll(header.data(), header.size())) {
+            fd_ = -1;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PipeSink::writeAll(const uint8_t* data, size_t size) {
+    while (size > 0 && !failed_) {
+        const ssize_t n = ::write(fd_, data, size);
+        stats_.writeCalls++;
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Non-blocking descriptor is full; wait for the reader to drain it
+                pollfd pfd{fd_, POLLOUT, 0};
+                stats_.pollWaits++;
+                if (::poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+                    failed_ = true;
+                }
+                continue;
+            }
+            failed_ = true; // EPIPE when the reader exited, or a real I/O error
+            break;
+        }
+        if (static_cast<size_t>(n) < size) {
+            stats_.partialWrites++;
+        }
+        stats_.bytesWritten += n;
+        data += n;
+        size -= n;
+    }
+    return !failed_;
+}
+
+bool PipeSink::append(const double* samples, size_t frames) {
+    if (!isOpen() || failed_) {
+        return false;
+    }
+
+    const size_t count = frames * format_.channels;
+    const size_t bytesPerSample = format_.bytesPerSample();
+    for (size_t offset = 0; offset < count; offset += kWriteBlockSamples) {
+        const size_t n = std::min(kWriteBlockSamples, count - offset);
+        if (dither_) {
+            ditherSource_.fill(noise_.data(), n);
+        }
+        PcmConverter::convert(format_.sampleFormat, samples + offset, pcm_.data(), n,
+                              dither_ ? noise_.data() : nullptr);
+        if (!writeAll(pcm_.data(), n * bytesPerSample)) {
+            return false;
+        }
+        samplesWritten_ += n;
+    }
+    return true;
+}
+
+bool PipeSink::finalize() {
+    if (!isOpen()) {
+        return false;
+    }
+
+    bool ok = !failed_;
+    if (container_ == PipeContainer::Wav) {
+        const uint64_t dataSize = samplesWritten_ * format_.bytesPerSample();
+        if (dataSize & 1) {
+            // RIFF chunks are word aligned; odd 24-bit payloads need a pad byte
+            const uint8_t pad = 0;
+            ok = writeAll(&pad, 1) && ok;
+        }
+        if (expectedFrames_ > 0 && framesWritten() != expectedFrames_) {
+            ok = false; // The header announced a different length
+        }
+    }
+    fd_ = -1;
+    return ok;
+}
+
+int PipeSink::channels() const {
+    return format_.channels;
+}
+
+bool PipeSink::isOpen() const {
+    return fd_ >= 0;
+}
+
+uint64_t PipeSink::framesWritten() const {
+    return samplesWritten_ / format_.channels;
+}
+
+PipeSinkStats PipeSink::stats() const {
+    return stats_;
+}
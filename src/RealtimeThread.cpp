@@ -0,0 +1,182 @@
+#include "../include/RealtimeThread.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+void appendError(RealtimeStatus& status, const std::string& message) {
+    if (!status.error.empty()) {
+        status.error += "\n";
+    }
+    status.error += message;
+}
+
+#ifndef _WIN32
+int nativePolicy(RealtimeConfig::Policy policy) {
+    return policy == RealtimeConfig::Policy::RoundRobin ? SCHED_RR : SCHED_FIFO;
+}
+
+const char* policyName(RealtimeConfig::Policy policy) {
+    return policy == RealtimeConfig::Policy::RoundRobin ? "SCHED_RR" : "SCHED_FIFO";
+}
+
+size_t pageSize() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+#endif
+
+} // namespace
+
+bool RealtimeThread::isValid(const RealtimeConfig& config) {
+    if (config.policy != RealtimeConfig::Policy::Default) {
+#ifdef _WIN32
+        if (config.priority < 1 || config.priority > 99) return false;
+#else
+        const int policy = nativePolicy(config.policy);
+        if (config.priority < sched_get_priority_min(policy) || config.priority > sched_get_priority_max(policy) ||
+            config.priority < 1) {
+            return false;
+        }
+#endif
+    }
+    for (int cpu : config.cpus) {
+        if (cpu < 0) return false;
+#ifdef __linux__
+        if (cpu >= CPU_SETSIZE) return false;
+#elif defined(_WIN32)
+        if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) return false;
+#endif
+    }
+    return true;
+}
+
+bool RealtimeThread::configure(std::thread& thread, const RealtimeConfig& config, RealtimeStatus& status) {
+    status.scheduling = true;
+    status.affinity = true;
+    if (!thread.joinable()) {
+        status.scheduling = status.affinity = false;
+        appendError(status, "Realtime setup: thread is not running");
+        return false;
+    }
+
+#ifdef _WIN32
+    HANDLE handle = static_cast<HANDLE>(thread.native_handle());
+    if (config.policy != RealtimeConfig::Policy::Default &&
+        !SetThreadPriority(handle, THREAD_PRIORITY_TIME_CRITICAL)) {
+        status.scheduling = false;
+        appendError(status, "THREAD_PRIORITY_TIME_CRITICAL: error " + std::to_string(GetLastError()) +
+                    "; running with normal priority");
+    }
+    if (!config.cpus.empty()) {
+        DWORD_PTR mask = 0;
+        for (int cpu : config.cpus) {
+            mask |= DWORD_PTR(1) << cpu;
+        }
+        if (SetThreadAffinityMask(handle, mask) == 0) {
+            status.affinity = false;
+            appendError(status, "CPU affinity: error " + std::to_string(GetLastError()) + "; running on any CPU");
+        }
+    }
+#else
+    pthread_t handle = thread.native_handle();
+    if (config.policy != RealtimeConfig::Policy::Default) {
+        sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        param.sched_priority = config.priority;
+        const int result = pthread_setschedparam(handle, nativePolicy(config.policy), &param);
+        if (result != 0) {
+            status.scheduling = false;
+            std::string message = std::string(policyName(config.policy)) + " priority " +
+                                  std::to_string(config.priority) + ": " + std::strerror(result);
+            if (result == EPERM) {
+                message += " (needs root, CAP_SYS_NICE or RLIMIT_RTPRIO >= " + std::to_string(config.priority) +
+                           ", see ulimit -r)";
+            }
+            appendError(status, message + "; running with normal scheduling");
+        }
+    }
+    if (!config.cpus.empty()) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : config.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        const int result = pthread_setaffinity_np(handle, sizeof(set), &set);
+        if (result != 0) {
+            status.affinity = false;
+            appendError(status, std::string("CPU affinity: ") + std::strerror(result) +
+                        (result == EINVAL ? " (no listed CPU is online or allowed for this process)" : "") +
+                        "; running on any CPU");
+        }
+#else
+        status.affinity = false;
+        appendError(status, "CPU affinity is not supported on this platform; running on any CPU");
+#endif
+    }
+#endif
+    return status.scheduling && status.affinity;
+}
+
+bool RealtimeThread::lockMemory(RealtimeStatus& status) {
+#ifdef _WIN32
+    status.memoryLocked = false;
+    appendError(status, "Memory locking is not supported on this platform");
+    return false;
+#else
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        const int error = errno;
+        status.memoryLocked = false;
+        std::string message = std::string("mlockall: ") + std::strerror(error);
+        if (error == EPERM || error == ENOMEM) {
+            message += " (needs root, CAP_IPC_LOCK or an RLIMIT_MEMLOCK covering the process, see ulimit -l)";
+        }
+        appendError(status, message + "; memory may be paged out");
+        return false;
+    }
+    status.memoryLocked = true;
+    return true;
+#endif
+}
+
+bool RealtimeThread::prefault(const void* data, size_t bytes) {
+    if (!data || bytes == 0) {
+        return true;
+    }
+#ifdef _WIN32
+    // Locking a range faults it in; it stays resident in the working set after unlocking
+    void* address = const_cast<void*>(data);
+    if (!VirtualLock(address, bytes)) {
+        return false;
+    }
+    VirtualUnlock(address, bytes);
+    return true;
+#else
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(data) & ~(uintptr_t(pageSize()) - 1);
+    const size_t length = reinterpret_cast<uintptr_t>(data) + bytes - begin;
+    void* address = reinterpret_cast<void*>(begin);
+#ifdef MADV_POPULATE_WRITE
+    // Populates page tables for writing without touching the contents
+    if (madvise(address, length, MADV_POPULATE_WRITE) == 0) {
+        return true;
+    }
+#endif
+    // Kernel older than 5.14: mlock() also faults the range in
+    if (mlock(address, length) != 0) {
+        return false;
+    }
+    munlock(address, length);
+    return true;
+#endif
+}
@@ -0,0 +1,48 @@
+#include "../include/VelocityCurve.h"
+#include <algorithm>
+#include <cmath>
+
+template <typename Function>
+VelocityTable VelocityCurve::build(Function shape) {
+    VelocityTable table;
+    table[0] = 0;
+    for (int velocity = 1; velocity < 128; ++velocity) {
+        double value = shape(velocity / 127.0);
+        if (!(value >= 0.0)) {
+            value = 0.0;   // Also catches NaN
+        }
+        const long scaled = std::lround(std::min(value, 1.0) * 127.0);
+        table[velocity] = static_cast<uint8_t>(std::max(1L, scaled));
+    }
+    return table;
+}
+
+VelocityTable VelocityCurve::fromPreset(Preset preset) {
+    switch (preset) {
+        case Preset::Soft:
+            return build([](double x) { return std::sqrt(x); });
+        case Preset::Hard:
+            return build([](double x) { return x * x; });
+        case Preset::Exponential:
+            return build([](double x) { return std::expm1(4.0 * x) / std::expm1(4.0); });
+        case Preset::Linear:
+        default:
+            return build([](double x) { return x; });
+    }
+}
+
+VelocityTable VelocityCurve::fromPoints(const std::vector<float>& points) {
+    if (points.empty()) {
+        return fromPreset(Preset::Linear);
+    }
+    if (points.size() == 1) {
+        return build([&points](double) { return static_cast<double>(points[0]); });
+    }
+    const double segments = static_cast<double>(points.size() - 1);
+    return build([&points, segments](double x) {
+        const double position = x * segments;
+        const size_t index = std::min(static_cast<size_t>(position), points.size() - 2);
+        const double fraction = position - static_cast<double>(index);
+        return points[index] + (points[index + 1] - points[index]) * fraction;
+    });
+}
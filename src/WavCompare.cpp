@@ -0,0 +1,130 @@
+#include "../include/WavCompare.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define WAV_COMPARE_SSE2 1
+#endif
+
+void WavCompare::accumulateScalar(const double* reference, const double* test, size_t count,
+                                  ErrorAccumulator& acc) {
+    for (size_t i = 0; i < count; ++i) {
+        const double error = test[i] - reference[i];
+        acc.errorEnergy += error * error;
+        acc.referenceEnergy += reference[i] * reference[i];
+        if (std::abs(error) > acc.maxAbsError) {
+            acc.maxAbsError = std::abs(error);
+            acc.maxErrorIndex = acc.count + i;
+        }
+    }
+    acc.count += count;
+}
+
+void WavCompare::accumulate(const double* reference, const double* test, size_t count, ErrorAccumulator& acc) {
+#if defined(WAV_COMPARE_SSE2)
+    // Two independent accumulators per sum hide the add latency
+    const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFll));
+    __m128d error0 = _mm_setzero_pd(), error1 = _mm_setzero_pd();
+    __m128d energy0 = _mm_setzero_pd(), energy1 = _mm_setzero_pd();
+    __m128d peak = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128d r0 = _mm_loadu_pd(reference + i);
+        const __m128d r1 = _mm_loadu_pd(reference + i + 2);
+        const __m128d d0 = _mm_sub_pd(_mm_loadu_pd(test + i), r0);
+        const __m128d d1 = _mm_sub_pd(_mm_loadu_pd(test + i + 2), r1);
+        error0 = _mm_add_pd(error0, _mm_mul_pd(d0, d0));
+        error1 = _mm_add_pd(error1, _mm_mul_pd(d1, d1));
+        energy0 = _mm_add_pd(energy0, _mm_mul_pd(r0, r0));
+        energy1 = _mm_add_pd(energy1, _mm_mul_pd(r1, r1));
+        peak = _mm_max_pd(peak, _mm_max_pd(_mm_and_pd(d0, absMask), _mm_and_pd(d1, absMask)));
+    }
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, _mm_add_pd(error0, error1));
+    acc.errorEnergy += lanes[0] + lanes[1];
+    _mm_store_pd(lanes, _mm_add_pd(energy0, energy1));
+    acc.referenceEnergy += lanes[0] + lanes[1];
+    _mm_store_pd(lanes, peak);
+    const double blockPeak = std::max(lanes[0], lanes[1]);
+
+    // Locating the peak is rare once the running maximum settles, so it is
+    // done with a scalar rescan only when this block raised it
+    if (blockPeak > acc.maxAbsError) {
+        for (size_t j = 0; j < i; ++j) {
+            if (std::abs(test[j] - reference[j]) == blockPeak) {
+                acc.maxAbsError = blockPeak;
+                acc.maxErrorIndex = acc.count + j;
+                break;
+            }
+        }
+    }
+    acc.count += i;
+    accumulateScalar(reference + i, test + i, count - i, acc);
+#else
+    accumulateScalar(reference, test, count, acc);
+#endif
+}
+
+WavDifference WavCompare::compare(const WavReader& reference, const WavReader& test) {
+    WavDifference result;
+    if (!reference.isOpen() || !test.isOpen()) {
+        result.error = "Both files must be open";
+        return result;
+    }
+    const WavFormat& a = reference.format();
+    const WavFormat& b = test.format();
+    if (a.sampleRate != b.sampleRate || a.channels != b.channels) {
+        result.error = "Sample rate or channel count differs";
+        return result;
+    }
+    result.comparable = true;
+    result.frameDifference = static_cast<int64_t>(test.frames()) - static_cast<int64_t>(reference.frames());
+    result.samples = std::min(reference.samples(), test.samples());
+
+    if (a.sampleFormat == b.sampleFormat && reference.dataBytes() == test.dataBytes() &&
+        std::memcmp(reference.data(), test.data(), reference.dataBytes()) == 0) {
+        result.identical = true;
+        result.snrDb = std::numeric_limits<double>::infinity();
+        return result;
+    }
+
+    std::vector<double> refBlock(kBlockSamples);
+    std::vector<double> testBlock(kBlockSamples);
+    ErrorAccumulator acc;
+    for (uint64_t first = 0; first < result.samples; first += kBlockSamples) {
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(kBlockSamples, result.samples - first));
+        reference.read(first, n, refBlock.data());
+        test.read(first, n, testBlock.data());
+        accumulate(refBlock.data(), testBlock.data(), n, acc);
+    }
+
+    result.maxAbsError = acc.maxAbsError;
+    result.maxErrorFrame = acc.maxErrorIndex / a.channels;
+    result.rmsError = acc.count ? std::sqrt(acc.errorEnergy / acc.count) : 0.0;
+    if (acc.errorEnergy == 0.0) {
+        result.snrDb = std::numeric_limits<double>::infinity();
+    } else {
+        result.snrDb = 10.0 * std::log10(acc.referenceEnergy / acc.errorEnergy);
+    }
+    return result;
+}
+
+WavDifference WavCompare::compareFiles(const std::string& reference, const std::string& test) {
+    WavReader a;
+    WavReader b;
+    if (!a.open(reference)) {
+        WavDifference result;
+        result.error = reference + ": " + a.error();
+        return result;
+    }
+    if (!b.open(test)) {
+        WavDifference result;
+        result.error = test + ": " + b.error();
+        return result;
+    }
+    return compare(a, b);
+}
@@ -0,0 +1,149 @@
+#include "../include/WavFormat.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+constexpr uint16_t kFormatPcm = 0x0001;
+constexpr uint16_t kFormatIeeeFloat = 0x0003;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+constexpr uint32_t kDs64Size = 28;
+
+/**
+ * @brief [AI GENERATED] Speaker masks for the usual 1-8 channel layouts (mono .. 7.1).
+ */
+constexpr uint32_t kChannelMasks[] = {0x4, 0x3, 0x7, 0x33, 0x37, 0x3F, 0x13F, 0x63F};
+
+/**
+ * @brief [AI GENERATED] KSDATAFORMAT_SUBTYPE GUID tail shared by PCM and IEEE float.
+ */
+constexpr uint8_t kSubFormatTail[12] = {0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+
+bool isExtensible(const WavFormat& format) {
+    return format.channels > 2 || format.bytesPerSample() > 2;
+}
+
+size_t fmtChunkSize(const WavFormat& format) {
+    return isExtensible(format) ? 40 : 16;
+}
+
+void putTag(std::vector<uint8_t>& out, const char* tag) {
+    out.insert(out.end(), tag, tag + 4);
+}
+
+void putLE(std::vector<uint8_t>& out, uint64_t value, int size) {
+    for (int i = 0; i < size; ++i) {
+        out.push_back(static_cast<uint8_t>(value & 0xFF));
+        value >>= 8;
+    }
+}
+
+} // namespace
+
+int WavFormat::bytesPerSample() const {
+    return PcmConverter::bytesPerSample(sampleFormat);
+}
+
+int WavFormat::blockAlign() const {
+    return channels * bytesPerSample();
+}
+
+uint32_t WavFormat::byteRate() const {
+    return static_cast<uint32_t>(sampleRate) * blockAlign();
+}
+
+bool WavFormat::isFloat() const {
+    return sampleFormat == SampleFormat::Float32;
+}
+
+WavFormat WavFormat::resolveRf64(uint64_t frames) const {
+    WavFormat resolved = *this;
+    if (rf64 == Rf64Mode::Auto) {
+        WavFormat riff = *this;
+        riff.rf64 = Rf64Mode::Never;
+        resolved.rf64 = WavHeader::needsRf64(riff, frames * blockAlign()) ? Rf64Mode::Always : Rf64Mode::Never;
+    }
+    return resolved;
+}
+
+size_t WavHeader::size(const WavFormat& format) {
+    size_t bytes = 12 + 8 + fmtChunkSize(format) + 8;
+    if (format.rf64 != Rf64Mode::Never) {
+        bytes += 8 + kDs64Size;
+    }
+    if (format.isFloat()) {
+        bytes += 12;
+    }
+    return bytes;
+}
+
+bool WavHeader::needsRf64(const WavFormat& format, uint64_t dataBytes) {
+    if (dataBytes == kUnknownSize) {
+        return false;
+    }
+    const uint64_t riffSize = size(format) - 8 + dataBytes + (dataBytes & 1);
+    return riffSize >= kPlaceholderSize;
+}
+
+std::vector<uint8_t> WavHeader::build(const WavFormat& format, uint64_t dataBytes) {
+    const bool known = dataBytes != kUnknownSize;
+    const bool rf64 = format.rf64 == Rf64Mode::Always ||
+                      (format.rf64 == Rf64Mode::Auto && needsRf64(format, dataBytes));
+    if (format.rf64 == Rf64Mode::Never && needsRf64(format, dataBytes)) {
+        return {};
+    }
+
+    const uint64_t riffSize = known ? size(format) - 8 + dataBytes + (dataBytes & 1) : 0;
+    const uint64_t frames = known ? dataBytes / format.blockAlign() : 0;
+    // 32-bit fields carry the real value only in a known-size classic RIFF file
+    const bool exact32 = known && !rf64;
+
+    std::vector<uint8_t> out;
+    out.reserve(size(format));
+
+    putTag(out, rf64 ? "RF64" : "RIFF");
+    putLE(out, exact32 ? riffSize : kPlaceholderSize, 4);
+    putTag(out, "WAVE");
+
+    if (format.rf64 != Rf64Mode::Never) {
+        // ds64 when promoted, otherwise a JUNK chunk of the same size to claim the space
+        putTag(out, rf64 ? "ds64" : "JUNK");
+        putLE(out, kDs64Size, 4);
+        putLE(out, rf64 ? riffSize : 0, 8);
+        putLE(out, rf64 && known ? dataBytes : 0, 8);
+        putLE(out, rf64 ? frames : 0, 8);
+        putLE(out, 0, 4);
+    }
+
+    const uint16_t bits = static_cast<uint16_t>(format.bytesPerSample() * 8);
+    putTag(out, "fmt ");
+    putLE(out, fmtChunkSize(format), 4);
+    if (isExtensible(format)) {
+        putLE(out, kFormatExtensible, 2);
+    } else {
+        putLE(out, format.isFloat() ? kFormatIeeeFloat : kFormatPcm, 2);
+    }
+    putLE(out, format.channels, 2);
+    putLE(out, format.sampleRate, 4);
+    putLE(out, format.byteRate(), 4);
+    putLE(out, format.blockAlign(), 2);
+    putLE(out, bits, 2);
+    if (isExtensible(format)) {
+        const size_t maskIndex = static_cast<size_t>(format.channels - 1);
+        putLE(out, 22, 2);
+        putLE(out, bits, 2);
+        putLE(out, maskIndex < std::size(kChannelMasks) ? kChannelMasks[maskIndex] : 0, 4);
+        putLE(out, format.isFloat() ? kFormatIeeeFloat : kFormatPcm, 4);
+        out.insert(out.end(), std::begin(kSubFormatTail), std::end(kSubFormatTail));
+    }
+
+    if (format.isFloat()) {
+        putTag(out, "fact");
+        putLE(out, 4, 4);
+        putLE(out, exact32 ? frames : kPlaceholderSize, 4);
+    }
+
+    putTag(out, "data");
+    putLE(out, exact32 ? dataBytes : kPlaceholderSize, 4);
+    return out;
+}
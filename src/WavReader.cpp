@@ -0,0 +1,175 @@
+#include "../include/WavReader.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint16_t kFormatPcm = 0x0001;
+constexpr uint16_t kFormatIeeeFloat = 0x0003;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+uint64_t getLE(const uint8_t* src, int size) {
+    uint64_t value = 0;
+    for (int i = size - 1; i >= 0; --i) {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+} // namespace
+
+WavReader::~WavReader() {
+    close();
+}
+
+bool WavReader::fail(const std::string& message) {
+    close();
+    error_ = message;
+    return false;
+}
+
+void WavReader::close() {
+    if (map_) {
+        munmap(map_, mapSize_);
+    }
+    map_ = nullptr;
+    mapSize_ = 0;
+    data_ = nullptr;
+    dataBytes_ = 0;
+}
+
+bool WavReader::open(const std::string& file) {
+    close();
+    error_.clear();
+
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return fail("Cannot open " + file);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < 12) {
+        ::close(fd);
+        return fail("File too short for a RIFF header");
+    }
+    mapSize_ = static_cast<uint64_t>(info.st_size);
+    void* map = mmap(nullptr, mapSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps the file alive
+    if (map == MAP_FAILED) {
+        mapSize_ = 0;
+        return fail("Cannot map " + file);
+    }
+    map_ = static_cast<uint8_t*>(map);
+    madvise(map_, mapSize_, MADV_SEQUENTIAL);
+
+    const bool rf64 = std::memcmp(map_, "RF64", 4) == 0;
+    if ((!rf64 && std::memcmp(map_, "RIFF", 4) != 0) || std::memcmp(map_ + 8, "WAVE", 4) != 0) {
+        return fail("Not a RIFF/RF64 WAVE file");
+    }
+
+    bool haveFormat = false;
+    uint64_t ds64DataSize = 0;
+    uint64_t offset = 12;
+    while (offset + 8 <= mapSize_) {
+        const uint8_t* chunk = map_ + offset;
+        const uint64_t chunkSize = getLE(chunk + 4, 4);
+        const uint8_t* body = chunk + 8;
+        const uint64_t available = mapSize_ - offset - 8;
+
+        if (std::memcmp(chunk, "ds64", 4) == 0 && chunkSize >= 24 && available >= 24) {
+            ds64DataSize = getLE(body + 8, 8);
+        } else if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || available < 16) {
+                return fail("Truncated fmt chunk");
+            }
+            uint16_t tag = static_cast<uint16_t>(getLE(body, 2));
+            const int bits = static_cast<int>(getLE(body + 14, 2));
+            if (tag == kFormatExtensible) {
+                if (chunkSize < 40 || available < 40) {
+                    return fail("Truncated WAVE_FORMAT_EXTENSIBLE chunk");
+                }
+                tag = static_cast<uint16_t>(getLE(body + 24, 2)); // First bytes of the subformat GUID
+            }
+            format_.channels = static_cast<int>(getLE(body + 2, 2));
+            format_.sampleRate = static_cast<int>(getLE(body + 4, 4));
+            if (tag == kFormatPcm && bits == 16) {
+                format_.sampleFormat = SampleFormat::Pcm16;
+            } else if (tag == kFormatPcm && bits == 24) {
+                format_.sampleFormat = SampleFormat::Pcm24;
+            } else if (tag == kFormatIeeeFloat && bits == 32) {
+                format_.sampleFormat = SampleFormat::Float32;
+            } else {
+                return fail("Unsupported sample format");
+            }
+            if (format_.channels < 1 || getLE(body + 12, 2) != static_cast<uint64_t>(format_.blockAlign())) {
+                return fail("Inconsistent fmt chunk");
+            }
+            format_.rf64 = rf64 ? Rf64Mode::Always : Rf64Mode::Never;
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat) {
+                return fail("data chunk before fmt chunk");
+            }
+            uint64_t size = chunkSize;
+            if (rf64 && chunkSize == WavHeader::kPlaceholderSize && ds64DataSize > 0) {
+                size = ds64DataSize;
+            }
+            if (size == WavHeader::kPlaceholderSize || size > available) {
+                size = available; // Streamed or unfinalized: read to end of file
+            }
+            data_ = body;
+            dataBytes_ = size - size % format_.blockAlign();
+            return true;
+        }
+
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+    return fail(haveFormat ? "No data chunk" : "No fmt chunk");
+}
+
+bool WavReader::isOpen() const {
+    return map_ != nullptr;
+}
+
+const WavFormat& WavReader::format() const {
+    return format_;
+}
+
+uint64_t WavReader::frames() const {
+    return isOpen() ? dataBytes_ / format_.blockAlign() : 0;
+}
+
+uint64_t WavReader::samples() const {
+    return isOpen() ? dataBytes_ / format_.bytesPerSample() : 0;
+}
+
+const uint8_t* WavReader::data() const {
+    return data_;
+}
+
+uint64_t WavReader::dataBytes() const {
+    return dataBytes_;
+}
+
+size_t WavReader::read(uint64_t firstSample, size_t count, double* out) const {
+    const uint64_t total = samples();
+    if (firstSample >= total) {
+        return 0;
+    }
+    const size_t n = static_cast<size_t>(std::min<uint64_t>(count, total - firstSample));
+    PcmConverter::toDouble(format_.sampleFormat, data_ + firstSample * format_.bytesPerSample(), out, n);
+    return n;
+}
+
+std::vector<double> WavReader::readAll() const {
+    std::vector<double> out(samples());
+    read(0, out.size(), out.data());
+    return out;
+}
+
+const std::string& WavReader::error() const {
+    return error_;
+}
@@ -0,0 +1,253 @@
+#include "../include/WavStreamWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+constexpr size_t kMinHeaderSize = 44;
+
+/**
+ * @brief [AI GENERATED] Helper to store little-endian integers into a byte buffer.
+ */
+uint8_t* putLE(uint8_t* dst, uint64_t value, int size) {
+    for (int i = 0; i < size; ++i) {
+        *dst++ = static_cast<uint8_t>(value & 0xFF);
+        value >>= 8;
+    }
+    return dst;
+}
+
+uint32_t getLE(const uint8_t* src, int size) {
+    uint32_t value = 0;
+    for (int i = size - 1; i >= 0; --i) {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+bool patchBytes(std::ostream& stream, std::streamoff offset, const void* bytes, size_t size) {
+    stream.seekp(offset);
+    stream.write(static_cast<const char*>(bytes), size);
+    return static_cast<bool>(stream);
+}
+
+bool patchLE(std::ostream& stream, std::streamoff offset, uint64_t value, int size) {
+    uint8_t bytes[8];
+    putLE(bytes, value, size);
+    return patchBytes(stream, offset, bytes, size);
+}
+
+} // namespace
+
+WavStreamWriter::~WavStreamWriter() {
+    if (isOpen()) {
+        finalize();
+    }
+}
+
+bool WavStreamWriter::open(const std::string& file, const WavFormat& format, bool dither) {
+    if (isOpen()) {
+        finalize();
+    }
+    if (format.channels < 1 || format.sampleRate < 1) {
+        return false;
+    }
+
+    out_.open(file, std::ios::binary | std::ios::trunc);
+    if (!out_) {
+        return false;
+    }
+
+    format_ = format;
+    dither_ = dither && !format.isFloat();
+    samplesWritten_ = 0;
+    pcm_.resize(kWriteBlockSamples * format.bytesPerSample());
+    noise_.resize(dither_ ? kWriteBlockSamples : 0);
+    interleaved_.clear();
+
+    const auto header = WavHeader::build(format_, WavHeader::kUnknownSize);
+    out_.write(reinterpret_cast<const char*>(header.data()), header.size());
+    return static_cast<bool>(out_);
+}
+
+bool WavStreamWriter::open(const std::string& file, int sampleRate, bool dither) {
+    WavFormat format;
+    format.sampleRate = sampleRate;
+    return open(file, format, dither);
+}
+
+bool WavStreamWriter::writeSamples(const double* samples, size_t count) {
+    const size_t bytesPerSample = format_.bytesPerSample();
+    for (size_t offset = 0; offset < count; offset += kWriteBlockSamples) {
+        const size_t n = std::min(kWriteBlockSamples, count - offset);
+        if (dither_) {
+            ditherSource_.fill(noise_.data(), n);
+        }
+        PcmConverter::convert(format_.sampleFormat, samples + offset, pcm_.data(), n,
+                              dither_ ? noise_.data() : nullptr);
+        out_.write(reinterpret_cast<const char*>(pcm_.data()), n * bytesPerSample);
+        if (!out_) {
+            return false;
+        }
+        samplesWritten_ += n;
+    }
+    return true;
+}
+
+bool WavStreamWriter::append(const double* samples, size_t frames) {
+    if (!isOpen()) {
+        return false;
+    }
+    return writeSamples(samples, frames * format_.channels);
+}
+
+bool WavStreamWriter::append(const std::vector<double>& block) {
+    if (block.size() % format_.channels != 0) {
+        return false;
+    }
+    return append(block.data(), block.size() / format_.channels);
+}
+
+bool WavStreamWriter::appendPlanar(const double* const* channels, size_t frames) {
+    if (!isOpen()) {
+        return false;
+    }
+
+    const size_t channelCount = format_.channels;
+    const size_t framesPerBlock = std::max<size_t>(1, kWriteBlockSamples / channelCount);
+    interleaved_.resize(framesPerBlock * channelCount);
+
+    for (size_t offset = 0; offset < frames; offset += framesPerBlock) {
+        const size_t n = std::min(framesPerBlock, frames - offset);
+        for (size_t c = 0; c < channelCount; ++c) {
+            const double* src = channels[c] + offset;
+            double* dst = interleaved_.data() + c;
+            for (size_t i = 0; i < n; ++i) {
+                dst[i * channelCount] = src[i];
+            }
+        }
+        if (!writeSamples(interleaved_.data(), n * channelCount)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WavStreamWriter::finalize() {
+    if (!isOpen()) {
+        return false;
+    }
+
+    const uint64_t dataSize = samplesWritten_ * format_.bytesPerSample();
+    bool ok = static_cast<bool>(out_);
+    if (dataSize & 1) {
+        // RIFF chunks are word aligned; odd 24-bit payloads need a pad byte
+        out_.put(0);
+    }
+
+    const auto header = WavHeader::build(format_, dataSize);
+    ok = !header.empty() && patchBytes(out_, 0, header.data(), header.size()) && ok;
+
+    out_.close();
+    return ok && !out_.fail();
+}
+
+int WavStreamWriter::channels() const {
+    return format_.channels;
+}
+
+bool WavStreamWriter::isOpen() const {
+    return out_.is_open();
+}
+
+const WavFormat& WavStreamWriter::format() const {
+    return format_;
+}
+
+uint64_t WavStreamWriter::framesWritten() const {
+    return samplesWritten_ / format_.channels;
+}
+
+uint64_t WavStreamWriter::samplesWritten() const {
+    return samplesWritten_;
+}
+
+bool WavStreamWriter::recover(const std::string& file) {
+    std::error_code ec;
+    const uint64_t fileSize = std::filesystem::file_size(file, ec);
+    if (ec || fileSize < kMinHeaderSize) {
+        return false;
+    }
+
+    std::fstream stream(file, std::ios::in | std::ios::out | std::ios::binary);
+    uint8_t riff[12];
+    if (!stream.read(reinterpret_cast<char*>(riff), sizeof(riff)) ||
+        (std::memcmp(riff, "RIFF", 4) != 0 && std::memcmp(riff, "RF64", 4) != 0) ||
+        std::memcmp(riff + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    // Walk the chunk list to find the size fields and the frame size
+    uint32_t blockAlign = 1;
+    std::streamoff ds64Offset = -1;
+    std::streamoff factOffset = -1;
+    std::streamoff offset = sizeof(riff);
+    while (static_cast<uint64_t>(offset) + 8 <= fileSize) {
+        uint8_t chunk[8];
+        stream.seekg(offset);
+        if (!stream.read(reinterpret_cast<char*>(chunk), sizeof(chunk))) {
+            return false;
+        }
+        const uint32_t chunkSize = getLE(chunk + 4, 4);
+
+        if ((std::memcmp(chunk, "JUNK", 4) == 0 || std::memcmp(chunk, "ds64", 4) == 0) && chunkSize >= 28) {
+            ds64Offset = offset;
+        } else if (std::memcmp(chunk, "fact", 4) == 0 && chunkSize >= 4) {
+            factOffset = offset;
+        } else if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (chunkSize < sizeof(fmt) || !stream.read(reinterpret_cast<char*>(fmt), sizeof(fmt))) {
+                return false;
+            }
+            blockAlign = std::max<uint32_t>(1, getLE(fmt + 12, 2));
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            const uint64_t dataStart = offset + 8;
+            uint64_t dataSize = fileSize - dataStart;
+            dataSize -= dataSize % blockAlign;
+            const uint64_t riffSize = dataStart + dataSize - 8;
+            const uint64_t frames = dataSize / blockAlign;
+
+            if (riffSize < WavHeader::kPlaceholderSize) {
+                bool ok = patchBytes(stream, 0, "RIFF", 4) && patchLE(stream, 4, riffSize, 4) &&
+                          patchLE(stream, offset + 4, dataSize, 4);
+                if (ds64Offset >= 0) {
+                    // Demote a stale ds64 so readers trust the 32-bit sizes again
+                    ok = ok && patchBytes(stream, ds64Offset, "JUNK", 4);
+                }
+                if (factOffset >= 0) {
+                    ok = ok && patchLE(stream, factOffset + 8, frames, 4);
+                }
+                return ok;
+            }
+
+            if (ds64Offset < 0) {
+                return false;
+            }
+            bool ok = patchBytes(stream, 0, "RF64", 4) &&
+                      patchLE(stream, 4, WavHeader::kPlaceholderSize, 4) &&
+                      patchLE(stream, offset + 4, WavHeader::kPlaceholderSize, 4) &&
+                      patchBytes(stream, ds64Offset, "ds64", 4) &&
+                      patchLE(stream, ds64Offset + 8, riffSize, 8) &&
+                      patchLE(stream, ds64Offset + 16, dataSize, 8) &&
+                      patchLE(stream, ds64Offset + 24, frames, 8);
+            if (factOffset >= 0) {
+                ok = ok && patchLE(stream, factOffset + 8, WavHeader::kPlaceholderSize, 4);
+            }
+            return ok;
+        }
+
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+    return false;
+}
@@ -2,8 +2,15 @@
 #include "../include/Abstractor.h"
 #include "../include/NoteSynth.h"
 #include "../include/OutputHandler.h"
+#include "../include/AsyncOutputSink.h"
+#include "../include/WavCompare.h"
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <unistd.h>
 
 /**
  * @file main.cpp
@@ -28,15 +35,194 @@ int main(int argc, char* argv[]) {
         std::cout << "M-Audio Oxygen Pro 61 specific features:\n";
         std::cout << "  --drum-pattern   Drum pattern using 8 velocity-sensitive pads\n";
         std::cout << "  --mixed-performance Piano + drums mixed performance\n";
+        std::cout << "Output options (after the piece):\n";
+        std::cout << "  --format <pcm16|pcm24|float32> Sample encoding (default pcm16)\n";
+        std::cout << "  --flac          Write lossless FLAC instead of WAV (pcm16/pcm24)\n";
+        std::cout << "  --stream        Render block by block while writing (fixed headroom gain)\n";
+        std::cout << "  --io-stats      Print output queue and backpressure statistics\n";
+        std::cout << "  -o <file>       Output path; '-' streams WAV to stdout as it renders\n";
+        std::cout << "  --raw           With -o -, write headerless PCM instead of WAV\n";
+        std::cout << "  --mmap          Write WAV through a preallocated memory-mapped file\n";
+        std::cout << "  --direct        Write WAV with io_uring/O_DIRECT, bypassing the page cache\n";
+        std::cout << "  --queue-depth <n> Writes in flight for --direct (default 8)\n";
+        std::cout << "Regression comparison:\n";
+        std::cout << "  --compare <reference.wav> <test.wav> [--min-snr <dB>]  Print error metrics\n";
         return 1;
     }
 
     std::string option = argv[1];
+    if (option == "--compare") {
+        if (argc < 4) {
+            std::cout << "--compare needs a reference and a test file\n";
+            return 1;
+        }
+        double minSnr = -std::numeric_limits<double>::infinity();
+        if (argc >= 6 && std::string(argv[4]) == "--min-snr") {
+            minSnr = std::atof(argv[5]);
+        }
+        const WavDifference diff = WavCompare::compareFiles(argv[2], argv[3]);
+        if (!diff.comparable) {
+            std::cout << "Cannot compare: " << diff.error << "\n";
+            return 2;
+        }
+        std::cout << "Samples compared: " << diff.samples << " (length difference " << diff.frameDifference
+                  << " frames)\n";
+        if (diff.identical) {
+            std::cout << "Identical\n";
+            return 0;
+        }
+        std::cout << "Max abs error: " << diff.maxAbsError << " at frame " << diff.maxErrorFrame << "\n";
+        std::cout << "RMS error: " << diff.rmsError << "\n";
+        std::cout << "SNR: " << diff.snrDb << " dB\n";
+        return diff.frameDifference == 0 && diff.snrDb >= minSnr ? 0 : 1;
+    }
+    WavFormat format;
+    bool flac = false;
+    bool stream = false;
+    bool ioStats = false;
+    bool raw = false;
+    bool mapped = false;
+    bool direct = false;
+    DirectWriterSettings directSettings;
+    std::string outputPath;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "pcm16") {
+                format.sampleFormat = SampleFormat::Pcm16;
+            } else if (name == "pcm24") {
+                format.sampleFormat = SampleFormat::Pcm24;
+            } else if (name == "float32") {
+                format.sampleFormat = SampleFormat::Float32;
+            } else {
+                std::cout << "Unknown sample format: " << name << "\n";
+                return 1;
+            }
+        } else if (arg == "--flac") {
+            flac = true;
+        } else if (arg == "--stream") {
+            stream = true;
+        } else if (arg == "--io-stats") {
+            ioStats = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "--raw") {
+            raw = true;
+        } else if (arg == "--mmap") {
+            mapped = true;
+        } else if (arg == "--direct") {
+            direct = true;
+        } else if (arg == "--queue-depth" && i + 1 < argc) {
+            directSettings.queueDepth = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else {
+            std::cout << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+    if (flac && format.isFloat()) {
+        std::cout << "FLAC output supports pcm16 and pcm24 only\n";
+        return 1;
+    }
+
+    // Streaming to stdout: audio owns fd 1, so messages go to stderr and a
+    // closed reader is reported as a write error instead of killing us
+    const bool toStdout = outputPath == "-";
+    if ((mapped || direct) && (flac || toStdout || (mapped && direct))) {
+        std::cout << "--mmap and --direct select one WAV file backend\n";
+        return 1;
+    }
+    if (raw && !toStdout) {
+        std::cout << "--raw requires -o -\n";
+        return 1;
+    }
+    if (!outputPath.empty() && option == "--demo") {
+        std::cout << "-o selects the output of a single piece\n";
+        return 1;
+    }
+    if (toStdout) {
+        if (flac) {
+            std::cout << "Streaming to stdout supports WAV or raw PCM only\n";
+            return 1;
+        }
+        std::cout.rdbuf(std::cerr.rdbuf());
+        std::signal(SIGPIPE, SIG_IGN);
+        stream = true; // Emit blocks as they are rendered so the reader can start early
+    }
+
     MidiInput midi;
     Abstractor abs;
     NoteSynth synth;
     OutputHandler out;
 
+    // Render to the requested container. Writing runs on an I/O thread; with
+    // --stream each block is rendered straight into the sink's ring buffers.
+    auto write = [&](const std::vector<NoteEvent>& notes, std::string file) {
+        const size_t frames = NoteSynth::frameCount(notes, format.sampleRate);
+        std::unique_ptr<AudioSink> writer;
+        DirectWavWriter* directWriter = nullptr;
+        if (file == "-") {
+            writer = out.openPipe(STDOUT_FILENO, format, raw ? PipeContainer::Raw : PipeContainer::Wav, frames);
+        } else {
+            if (flac && file.size() > 4 && file.compare(file.size() - 4, 4, ".wav") == 0) {
+                file.replace(file.size() - 4, 4, ".flac");
+                std::cout << "Encoding FLAC to " << file << "\n";
+            }
+            if (direct) {
+                writer = out.openDirectSink(file, format, frames, directSettings);
+                directWriter = static_cast<DirectWavWriter*>(writer.get());
+            } else if (mapped) {
+                writer = out.openMappedSink(file, format, frames);
+            } else {
+                writer = out.openSink(file, format, frames);
+            }
+        }
+        if (!writer) {
+            std::cout << "Cannot write " << file << "\n";
+            return false;
+        }
+
+        AsyncOutputSink sink(std::move(writer));
+        if (stream) {
+            const double gain = synth.streamingGain(notes, format.sampleRate);
+            NoteSynth::BlockRenderer renderer(notes, format.sampleRate);
+            for (size_t first = 0; first < frames; first += sink.blockFrames()) {
+                double* block = sink.acquireBlock();
+                if (!block) {
+                    break;
+                }
+                const size_t count = std::min(sink.blockFrames(), frames - first);
+                renderer.render(first, count, block, gain);
+                sink.submitBlock(count);
+            }
+        } else {
+            auto samples = synth.synthesize(notes, format.sampleRate);
+            sink.append(samples.data(), samples.size());
+        }
+        const bool ok = sink.finalize();
+
+        if (ioStats) {
+            const AsyncSinkStats stats = sink.stats();
+            std::cout << "  I/O: " << stats.blocksWritten << " blocks, queue depth avg " << stats.averageQueueDepth
+                      << " max " << stats.maxQueueDepth << ", backpressure " << stats.backpressureWaits
+                      << " waits (" << stats.backpressureSeconds * 1000.0 << " ms), write "
+                      << stats.writeSeconds * 1000.0 << " ms (max block " << stats.maxWriteSeconds * 1000.0
+                      << " ms)\n";
+            if (directWriter) {
+                const DirectWriterStats disk = directWriter->stats();
+                std::cout << "  Disk: " << (disk.backend == IoBackend::IoUring ? "io_uring" : "pwrite")
+                          << (disk.directIo ? " + O_DIRECT" : " (buffered)") << ", " << disk.writes << " writes, "
+                          << disk.throughput() / (1 << 20) << " MiB/s, latency avg "
+                          << disk.averageLatencySeconds() * 1000.0 << " ms max " << disk.maxLatencySeconds * 1000.0
+                          << " ms, max in flight " << disk.maxInFlight << "\n";
+            }
+        }
+        if (!ok) {
+            std::cout << "Failed writing " << file << "\n";
+        }
+        return ok;
+    };
+
     std::vector<NoteEvent> notes;
     std::string outputFile;
 
@@ -61,8 +247,9 @@ int main(int argc, char* argv[]) {
                 case 4: keyEvents = midi.generateVivaldiSpringKeys(); break;
             }
             auto pieceNotes = abs.convertKeyEvents(keyEvents);
-            auto pieceSamples = synth.synthesize(pieceNotes);
-            out.writeWav(pieceSamples, pieces[i].first);
+            if (!write(pieceNotes, pieces[i].first)) {
+                return 1;
+            }
             std::cout << pieces[i].second << " written to " << pieces[i].first << "\n";
         }
         return 0;
@@ -71,64 +258,64 @@ int main(int argc, char* argv[]) {
     else if (option == "--fur-elise-keys") {
         auto keyEvents = midi.generateFurEliseKeys();
         notes = abs.convertKeyEvents(keyEvents);
-        outputFile = "fur_elise_keys_output.wav";
+        outputFile = outputPath.empty() ? "fur_elise_keys_output.wav" : outputPath;
         std::cout << "Für Elise (key-based) written to " << outputFile << "\n";
     } else if (option == "--rush-e-keys") {
         auto keyEvents = midi.generateRushEKeys();
         notes = abs.convertKeyEvents(keyEvents);
-        outputFile = "rush_e_keys_output.wav";
+        outputFile = outputPath.empty() ? "rush_e_keys_output.wav" : outputPath;
         std::cout << "Rush E (key-based) written to " << outputFile << "\n";
     } else if (option == "--beethoven5-keys") {
         auto keyEvents = midi.generateBeethoven5thKeys();
         notes = abs.convertKeyEvents(keyEvents);
-        outputFile = "beethoven5_keys_output.wav";
+        outputFile = outputPath.empty() ? "beethoven5_keys_output.wav" : outputPath;
         std::cout << "Beethoven's 5th (key-based) written to " << outputFile << "\n";
     } else if (option == "--hall-mountain-keys") {
         auto keyEvents = midi.generateHallOfMountainKingKeys();
         notes = abs.convertKeyEvents(keyEvents);
-        outputFile = "hall_mountain_keys_output.wav";
+        outputFile = outputPath.empty() ? "hall_mountain_keys_output.wav" : outputPath;
         std::cout << "Hall of Mountain King (key-based) written to " << outputFile << "\n";
     } else if (option == "--vivaldi-spring-keys") {
         auto keyEvents = midi.generateVivaldiSpringKeys();
         notes = abs.convertKeyEvents(keyEvents);
-        outputFile = "vivaldi_spring_keys_output.wav";
+        outputFile = outputPath.empty() ? "vivaldi_spring_keys_output.wav" : outputPath;
         std::cout << "Vivaldi Spring (key-based) written to " << outputFile << "\n";
     } else if (option == "--drum-pattern") {
         auto keyEvents = midi.generateDrumPattern();
         notes = abs.convertKeyEvents(keyEvents);
-        outputFile = "drum_pattern_output.wav";
+        outputFile = outputPath.empty() ? "drum_pattern_output.wav" : outputPath;
         std::cout << "Drum pattern written to " << outputFile << "\n";
     } else if (option == "--mixed-performance") {
         auto keyEvents = midi.generateMixedPerformance();
         notes = abs.convertKeyEvents(keyEvents);
-        outputFile = "mixed_performance_output.wav";
+        outputFile = outputPath.empty() ? "mixed_performance_output.wav" : outputPath;
         std::cout << "Mixed performance (piano + drums) written to " << outputFile << "\n";
     }
     // Handle legacy MIDI-based synthesis options
     else if (option == "--rush-e") {
         auto midiData = midi.generateRushE();
         notes = abs.convert(midiData);
-        outputFile = "rush_e_output.wav";
+        outputFile = outputPath.empty() ? "rush_e_output.wav" : outputPath;
         std::cout << "Rush E written to " << outputFile << "\n";
     } else if (option == "--fur-elise") {
         auto midiData = midi.generateFurElise();
         notes = abs.convert(midiData);
-        outputFile = "fur_elise_output.wav";
+        outputFile = outputPath.empty() ? "fur_elise_output.wav" : outputPath;
         std::cout << "Für Elise written to " << outputFile << "\n";
     } else if (option == "--beethoven5") {
         auto midiData = midi.generateBeethoven5th();
         notes = abs.convert(midiData);
-        outputFile = "beethoven5_output.wav";
+        outputFile = outputPath.empty() ? "beethoven5_output.wav" : outputPath;
         std::cout << "Beethoven's 5th written to " << outputFile << "\n";
     } else if (option == "--hall-mountain") {
         auto midiData = midi.generateHallOfMountainKing();
         notes = abs.convert(midiData);
-        outputFile = "hall_mountain_output.wav";
+        outputFile = outputPath.empty() ? "hall_mountain_output.wav" : outputPath;
         std::cout << "Hall of Mountain King written to " << outputFile << "\n";
     } else if (option == "--vivaldi-spring") {
         auto midiData = midi.generateVivaldiSpring();
         notes = abs.convert(midiData);
-        outputFile = "vivaldi_spring_output.wav";
+        outputFile = outputPath.empty() ? "vivaldi_spring_output.wav" : outputPath;
         std::cout << "Vivaldi Spring written to " << outputFile << "\n";
     } else {
         std::cout << "Unknown option: " << option << "\n";
@@ -136,8 +323,5 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    auto samples = synth.synthesize(notes);
-    out.writeWav(samples, outputFile);
-
-    return 0;
+    return write(notes, outputFile) ? 0 : 1;
 }
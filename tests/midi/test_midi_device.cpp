@@ -1,4 +1,12 @@
+#include "../../include/DeviceRegistry.h"
+#include "../../include/LoopbackMidiInterface.h"
+#include "../../include/MidiClock.h"
 #include "../../include/MidiDevice.h"
+#include "../../include/MidiRouter.h"
+#include "../../include/MidiScheduler.h"
+#include "../../include/MidiStatusTable.h"
+#include "../../include/MidiStreamParser.h"
+#include "../../include/VelocityCurve.h"
 #include <cassert>
 #include <iostream>
 #include <thread>
@@ -6,6 +14,130 @@
 #include <vector>
 #include <atomic>
 #include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <queue>
+#include <string>
+
+#ifdef __linux__
+#include <alsa/asoundlib.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Every heap allocation in the test binary is counted, so tests can check
+// that a code path allocates nothing
+static std::atomic<uint64_t> g_heapAllocations{0};
+
+// Both return nullptr on failure; the throwing forms of new turn that into
+// std::bad_alloc. These and the four deletes that free are kept out of line:
+// once GCC inlines malloc() into operator new, or free() into operator delete,
+// it reports the pairing as -Wmismatched-new-delete
+[[gnu::noinline]] static void* countedAllocate(size_t size) noexcept {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+[[gnu::noinline]] static void* countedAllocate(size_t size, std::align_val_t alignment) noexcept {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    const size_t align = static_cast<size_t>(alignment);
+    return std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+}
+
+static void* throwIfNull(void* p) {
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size) { return throwIfNull(countedAllocate(size)); }
+void* operator new[](size_t size) { return throwIfNull(countedAllocate(size)); }
+void* operator new(size_t size, std::align_val_t alignment) { return throwIfNull(countedAllocate(size, alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return throwIfNull(countedAllocate(size, alignment)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, alignment);
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, alignment);
+}
+// One function per form frees; the sized and nothrow variants forward to it
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete[](void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete[](p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { operator delete[](p); }
+void operator delete(void* p, size_t, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+void operator delete[](void* p, size_t, std::align_val_t alignment) noexcept { operator delete[](p, alignment); }
+void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    operator delete(p, alignment);
+}
+void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    operator delete[](p, alignment);
+}
+
+/**
+ * @brief [AI GENERATED] Backend with no devices whose input callback the test drives directly.
+ *
+ * Sent messages are recorded and always succeed, so it also exercises the
+ * default one-at-a-time MidiDeviceInterface::sendMessages().
+ */
+class InjectingMidiInterface : public MidiDeviceInterface {
+public:
+    void deliver(const RealTimeMidiMessage& message) {
+        if (inputCallback_) {
+            inputCallback_(message);
+        }
+    }
+
+    std::vector<MidiDeviceInfo> getAvailableDevices() override { return {}; }
+    MidiDeviceInfo getDeviceInfo(int) override { return MidiDeviceInfo{-1, "Unknown", "Unknown", false, false, false, 0}; }
+    bool isDeviceConnected(int) override { return false; }
+    MidiError openInputDevice(int) override { return MidiError::DeviceNotFound; }
+    MidiError openOutputDevice(int) override { return MidiError::DeviceNotFound; }
+    MidiError closeDevice(int) override { return MidiError::None; }
+    void closeAllDevices() override {}
+    void setInputCallback(MidiInputCallback callback) override { inputCallback_ = callback; }
+    MidiError sendMessage(int, const RealTimeMidiMessage& message) override {
+        sent.push_back(message);
+        return MidiError::None;
+    }
+    MidiError sendRawMessage(int, const uint8_t*, size_t) override { return MidiError::DeviceNotConnected; }
+    void setDeviceConnectionCallback(DeviceConnectionCallback) override {}
+    void startDeviceMonitoring() override {}
+    void stopDeviceMonitoring() override {}
+    std::string getErrorString(MidiError error) override { return error == MidiError::None ? "No error" : "Error"; }
+    MidiMessageType getMessageType(uint8_t status) override { return static_cast<MidiMessageType>(status & 0xF0); }
+    bool isValidMidiMessage(const RealTimeMidiMessage&) override { return true; }
+
+    std::vector<RealTimeMidiMessage> sent;
+
+private:
+    MidiInputCallback inputCallback_;
+};
+
+static double nowSeconds() {
+    return MidiDevice::timestampNow();
+}
+
+static RealTimeMidiMessage noteMessage(int note, double timestamp) {
+    RealTimeMidiMessage message;
+    message.status = 0x90;
+    message.data1 = static_cast<uint8_t>(note & 0x7F);
+    message.data2 = 100;
+    message.channel = 1;
+    message.timestamp = timestamp;
+    message.deviceId = 0;
+    return message;
+}
 
 /**
  * @brief [AI GENERATED] Comprehensive MIDI device tests including device detection,
@@ -42,6 +174,28 @@ public:
         testRealTimeProcessing();
         testInputCallback();
         testMessageQueuing();
+        testSpscRing();
+        testLatencyHistogram();
+        testKeyEventHistory();
+        testMidiStreamParser();
+        testMessageDispatch();
+        testDropAccounting();
+        testInputFanIn();
+        testRealtimeConfig();
+        testListenerDispatch();
+        testStatusTable();
+        testMidiRouter();
+        testVelocityCurve();
+        testErrorLog();
+        testMidiScheduler();
+        testMidiClock();
+        testLoopbackBackend();
+        testSequencerInput();
+        testBatchSend();
+        testSequencerOutput();
+        testSchedulerSequencerQueue();
+        testDeviceRegistry();
+        testSequencerHotplug();
         
         // M-Audio Oxygen Pro specific tests
         testOxygenProDetection();
@@ -63,6 +217,21 @@ public:
         }
     }
 
+    void runBenchmarks() {
+        std::cout << "Running MIDI Device benchmarks...\n";
+        benchmarkDispatchLatency();
+        benchmarkKeyEventHistory();
+        benchmarkMidiStreamParser();
+        benchmarkLoopbackIngestion();
+        benchmarkInputFanIn();
+        benchmarkRealtimeDispatch();
+        benchmarkMidiRouter();
+        benchmarkVelocityCurve();
+        benchmarkErrorReporting();
+        benchmarkSchedulerJitter();
+        benchmarkMidiClock();
+    }
+
 private:
     void assert_test(bool condition, const std::string& testName) {
         testCount_++;
@@ -343,6 +512,1632 @@ private:
         assert_test(recentEvents.empty(), "Key event history cleared");
     }
     
+    static void printLatency(const std::string& label, std::vector<double> micros) {
+        std::sort(micros.begin(), micros.end());
+        auto pct = [&](double p) { return micros[static_cast<size_t>(p * (micros.size() - 1))]; };
+        std::cout << "  " << label << ": p50 " << pct(0.50) << " us, p99 " << pct(0.99)
+                  << " us, p99.9 " << pct(0.999) << " us, max " << micros.back() << " us\n";
+    }
+    
+    void benchmarkDispatchLatency() {
+        // Messages arrive spaced apart like key presses, so each one finds the
+        // consumer idle and the measurement includes the wakeup
+        const int count = 5000;
+        const auto spacing = std::chrono::microseconds(200);
+        
+        std::vector<double> ringLatency(count);
+        {
+            MidiDevice device;
+            auto backend = std::make_unique<InjectingMidiInterface>();
+            InjectingMidiInterface* input = backend.get();
+            device.initialize(std::move(backend));
+            std::atomic<int> seen{0};
+            device.setMidiInputCallback([&](const RealTimeMidiMessage& message) {
+                const int i = seen.load(std::memory_order_relaxed);
+                ringLatency[i] = (nowSeconds() - message.timestamp) * 1e6;
+                seen.store(i + 1, std::memory_order_release);
+            });
+            device.startRealTimeProcessing();
+            for (int i = 0; i < count; ++i) {
+                input->deliver(noteMessage(i, nowSeconds()));
+                std::this_thread::sleep_for(spacing);
+            }
+            while (seen.load(std::memory_order_acquire) < count) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            device.stopRealTimeProcessing();
+        }
+        
+        // The previous design: mutex-protected std::queue drained every 1 ms
+        std::vector<double> pollLatency;
+        pollLatency.reserve(count);
+        {
+            std::mutex queueMutex;
+            std::queue<RealTimeMidiMessage> queue;
+            std::atomic<bool> running{true};
+            std::thread consumer([&] {
+                while (running || pollLatency.size() < static_cast<size_t>(count)) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    while (!queue.empty()) {
+                        pollLatency.push_back((nowSeconds() - queue.front().timestamp) * 1e6);
+                        queue.pop();
+                    }
+                }
+            });
+            for (int i = 0; i < count; ++i) {
+                {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    queue.push(noteMessage(i, nowSeconds()));
+                }
+                std::this_thread::sleep_for(spacing);
+            }
+            running = false;
+            consumer.join();
+        }
+        
+        std::cout << "  Input-to-callback latency over " << count << " messages:\n";
+        printLatency("SPSC ring + wake       ", ringLatency);
+        printLatency("mutex queue + 1 ms poll", pollLatency);
+        
+        LatencyHistogram histogram;
+        const int records = 10000000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < records; ++i) {
+            histogram.record(static_cast<uint64_t>(i) * 37);
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  LatencyHistogram::record: " << seconds / records * 1e9 << " ns per value\n";
+    }
+    
+    void testSpscRing() {
+        SpscRing<int> ring(5);
+        assert_test(ring.capacity() == 8, "Ring capacity rounds up to a power of two");
+        
+        int value = 0;
+        assert_test(!ring.tryPop(value), "Empty ring pop fails");
+        bool pushedAll = true;
+        for (int i = 0; i < 8; ++i) {
+            pushedAll = pushedAll && ring.tryPush(i);
+        }
+        assert_test(pushedAll && !ring.tryPush(8) && ring.size() == 8, "Full ring rejects push");
+        
+        // Wrap the indices several times past the end of the storage
+        bool fifo = true;
+        int expected = 0;
+        for (int i = 8; i < 100; ++i) {
+            fifo = fifo && ring.tryPop(value) && value == expected++;
+            fifo = fifo && ring.tryPush(i);
+        }
+        while (ring.tryPop(value)) {
+            fifo = fifo && value == expected++;
+        }
+        assert_test(fifo && expected == 100 && ring.empty(), "Ring preserves FIFO order across wraparound");
+        
+        // A limit below capacity caps the fill level; popping makes room again
+        bool limited = ring.tryPush(0, 3) && ring.tryPush(1, 3) && ring.tryPush(2, 3);
+        limited = limited && !ring.tryPush(3, 3) && ring.size() == 3;
+        limited = limited && ring.tryPop(value) && value == 0 && ring.tryPush(3, 3) && !ring.tryPush(4, 3);
+        limited = limited && ring.tryPush(4, 100) && ring.size() == 4;
+        while (ring.tryPop(value)) {
+        }
+        assert_test(limited, "Push limit below capacity is exact");
+        
+        // One producer and one consumer thread racing on a small ring
+        SpscRing<uint64_t> shared(64);
+        WakeSignal signal;
+        const uint64_t total = 1000000;
+        std::thread producer([&] {
+            for (uint64_t i = 0; i < total; ++i) {
+                while (!shared.tryPush(i)) {
+                    std::this_thread::yield();
+                }
+                signal.notify();
+            }
+        });
+        uint64_t next = 0;
+        bool ordered = true;
+        uint64_t item = 0;
+        while (next < total) {
+            if (shared.tryPop(item)) {
+                ordered = ordered && item == next;
+                ++next;
+                continue;
+            }
+            const uint32_t epoch = signal.prepareWait();
+            if (!shared.empty()) {
+                signal.cancelWait();
+                continue;
+            }
+            signal.wait(epoch, std::chrono::milliseconds(100));
+        }
+        producer.join();
+        assert_test(ordered && next == total, "Concurrent producer/consumer transfer is complete and ordered");
+    }
+    
+    void testLatencyHistogram() {
+        LatencyHistogram histogram;
+        assert_test(histogram.count() == 0 && histogram.percentile(50.0) == 0, "Empty histogram reports zero");
+        
+        // Small values are exact
+        for (uint64_t v = 1; v <= 100; ++v) {
+            histogram.record(v);
+        }
+        assert_test(histogram.percentile(50.0) == 50 && histogram.percentile(100.0) == 100 &&
+                    histogram.percentile(0.0) == 1, "Exact percentiles below 256 ns");
+        
+        // 1 us .. 10 ms uniformly: percentiles within the bucket precision
+        histogram.reset();
+        const uint64_t n = 100000;
+        for (uint64_t i = 1; i <= n; ++i) {
+            histogram.record(i * 100);
+        }
+        bool withinPrecision = true;
+        for (double p : {50.0, 90.0, 99.0, 99.9}) {
+            const double expected = p / 100.0 * n * 100;
+            const double got = static_cast<double>(histogram.percentile(p));
+            withinPrecision = withinPrecision && got >= expected && got <= expected * (1.0 + 1.0 / LatencyHistogram::kSubBuckets);
+        }
+        assert_test(withinPrecision, "Percentiles within 1/128 relative error");
+        assert_test(histogram.max() == n * 100 && histogram.count() == n, "Max and count exact");
+        assert_test(std::abs(histogram.mean() - (n + 1) * 50.0) < 1e-6, "Mean exact");
+        
+        LatencySummary summary = histogram.summary();
+        assert_test(std::abs(summary.max - 10.0) < 1e-9 && summary.p50 > 4.9 && summary.p50 < 5.1,
+                   "Summary reported in milliseconds");
+        
+        histogram.record(uint64_t(1) << 62);
+        assert_test(histogram.max() == LatencyHistogram::kMaxValue, "Out-of-range values clamped");
+        
+        // Concurrent writers lose nothing
+        histogram.reset();
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 4; ++t) {
+            writers.emplace_back([&histogram, t] {
+                for (int i = 0; i < 100000; ++i) {
+                    histogram.record(static_cast<uint64_t>(1000 + t));
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        assert_test(histogram.count() == 400000 && histogram.max() == 1003, "Concurrent records all counted");
+    }
+    
+    static KeyEvent keyEventAt(int i, double timestamp) {
+        KeyEvent event;
+        event.device = DeviceType::Piano;
+        event.state = KeyState::KeyDown;
+        event.note = i % 128;
+        event.velocity = i % 127 + 1;
+        event.channel = i;
+        event.timestamp = timestamp;
+        return event;
+    }
+    
+    void benchmarkKeyEventHistory() {
+        const int appends = 200000;
+        
+        KeyEventHistory history(MidiDevice::kMessageQueueCapacity);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < appends; ++i) {
+            history.append(keyEventAt(i, i * 1e-3));
+        }
+        const double ringSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        // The previous design: vector trimmed with erase(begin()) once full
+        std::vector<KeyEvent> vector;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < appends; ++i) {
+            vector.push_back(keyEventAt(i, i * 1e-3));
+            if (vector.size() > MidiDevice::kMessageQueueCapacity) {
+                vector.erase(vector.begin());
+            }
+        }
+        const double vectorSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        std::cout << "  Key history append, " << MidiDevice::kMessageQueueCapacity << " events retained:\n";
+        std::cout << "    ring               " << ringSeconds / appends * 1e9 << " ns\n";
+        std::cout << "    vector erase(begin) " << vectorSeconds / appends * 1e9 << " ns\n";
+        
+        // 100 ms window out of the full history: binary search, then copy
+        const int queries = 100000;
+        std::vector<KeyEvent> window;
+        size_t copied = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; ++i) {
+            const double from = (appends - 1000) * 1e-3 + (i % 800) * 1e-3;
+            copied += history.snapshot(from, from + 0.1, window);
+        }
+        const double querySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  Key history 100 ms window: " << querySeconds / queries * 1e9 << " ns per snapshot ("
+                  << copied / queries << " events)\n";
+    }
+    
+    void testKeyEventHistory() {
+        KeyEventHistory history(10);
+        assert_test(history.capacity() == 10 && history.size() == 0 && history.since(0.0).empty(),
+                   "Empty key history");
+        
+        for (int i = 0; i < 25; ++i) {
+            history.append(keyEventAt(i, static_cast<double>(i)));
+        }
+        auto all = history.since(-1.0);
+        bool newest = all.size() == 10 && history.size() == 10;
+        for (size_t i = 0; newest && i < all.size(); ++i) {
+            newest = all[i].channel == static_cast<int>(15 + i) && all[i].timestamp == 15.0 + i;
+        }
+        assert_test(newest, "Key history keeps the newest events across wraparound");
+        
+        std::vector<KeyEvent> window;
+        history.snapshot(17.5, 20.0, window);
+        assert_test(window.size() == 3 && window.front().timestamp == 18.0 && window.back().timestamp == 20.0,
+                   "Key history time-window lookup");
+        assert_test(history.snapshot(30.0, 40.0, window) == 0 && history.snapshot(0.0, 10.0, window) == 0,
+                   "Key history windows outside the retained range are empty");
+        
+        history.append(keyEventAt(25, 3.0));
+        auto latest = history.since(24.0);
+        assert_test(latest.size() == 2 && latest.back().channel == 25 && latest.back().timestamp == 24.0,
+                   "Out-of-order timestamp held at predecessor");
+        
+        history.clear();
+        assert_test(history.size() == 0 && history.since(-1.0).empty(), "Key history clear");
+        history.append(keyEventAt(26, 30.0));
+        assert_test(history.size() == 1 && history.since(0.0).front().channel == 26, "Append after clear");
+        
+        // A reader snapshotting while the writer laps the ring never sees a
+        // torn or out-of-order event
+        KeyEventHistory shared(64);
+        std::atomic<bool> writing{true};
+        std::thread writer([&] {
+            for (int i = 0; i < 1000000; ++i) {
+                shared.append(keyEventAt(i, static_cast<double>(i)));
+            }
+            writing = false;
+        });
+        bool consistent = true;
+        size_t snapshots = 0;
+        std::vector<KeyEvent> events;
+        while (writing || snapshots == 0) {
+            shared.snapshot(0.0, 1e9, events);
+            for (size_t i = 0; i < events.size(); ++i) {
+                const int n = events[i].channel;
+                consistent = consistent && events[i].timestamp == n && events[i].note == n % 128 &&
+                             events[i].velocity == n % 127 + 1;
+                consistent = consistent && (i == 0 || events[i].timestamp > events[i - 1].timestamp);
+            }
+            ++snapshots;
+        }
+        writer.join();
+        assert_test(consistent, "Concurrent key history snapshots are consistent");
+        
+        MidiDevice device;
+        assert_test(device.getKeyEventHistoryCapacity() == 1000, "Default key history capacity");
+        assert_test(device.setKeyEventHistoryCapacity(4096) && device.getKeyEventHistoryCapacity() == 4096,
+                   "Key history capacity configurable");
+        assert_test(!device.setKeyEventHistoryCapacity(0), "Zero key history capacity rejected");
+    }
+    
+    void benchmarkMidiStreamParser() {
+        // A dense performance: running-status notes, controller sweeps,
+        // clock bytes between them and an occasional SysEx dump
+        std::vector<uint8_t> stream;
+        for (int i = 0; stream.size() < (1u << 20); ++i) {
+            stream.push_back(0x90 | (i & 0x0F));
+            for (int n = 0; n < 8; ++n) {
+                stream.push_back((i + n) & 0x7F);
+                stream.push_back(0xF8);
+                stream.push_back((n * 16) & 0x7F);
+            }
+            stream.push_back(0xB0);
+            for (int n = 0; n < 8; ++n) {
+                stream.push_back(1);
+                stream.push_back(n & 0x7F);
+            }
+            if (i % 64 == 0) {
+                stream.push_back(0xF0);
+                for (int n = 0; n < 200; ++n) {
+                    stream.push_back(n & 0x7F);
+                }
+                stream.push_back(0xF7);
+            }
+        }
+        
+        uint64_t checksum = 0;
+        MidiStreamParser parser(
+            [&](const RealTimeMidiMessage& message) { checksum += message.status + message.data1 + message.data2; },
+            [&](const MidiSysExMessage& message) { checksum += message.length; });
+        const int passes = 100;
+        const size_t chunk = 64;
+        auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass) {
+            for (size_t offset = 0; offset < stream.size(); offset += chunk) {
+                parser.feed(stream.data() + offset, std::min(chunk, stream.size() - offset), 0.0);
+            }
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double bytes = static_cast<double>(stream.size()) * passes;
+        std::cout << "  MidiStreamParser: " << bytes / seconds / 1e6 << " MB/s, "
+                  << parser.messageCount() / seconds / 1e6 << " M messages/s in " << chunk
+                  << "-byte chunks (checksum " << checksum % 1000 << ")\n";
+    }
+    
+    void testMidiStreamParser() {
+        std::vector<RealTimeMidiMessage> messages;
+        std::vector<std::vector<uint8_t>> sysEx;
+        std::vector<uint8_t> pending;
+        MidiStreamParser parser(
+            [&](const RealTimeMidiMessage& message) { messages.push_back(message); },
+            [&](const MidiSysExMessage& message) {
+                pending.insert(pending.end(), message.data, message.data + message.length);
+                if (message.complete) {
+                    sysEx.push_back(pending);
+                    pending.clear();
+                }
+            },
+            7, 16);
+        
+        // Running status: one status byte, three notes, split mid-message
+        const uint8_t notes[] = {0x93, 60, 100, 62, 101, 64, 0};
+        parser.feed(notes, 4, 1.0);
+        assert_test(messages.size() == 1, "Parser waits for the rest of a split message");
+        parser.feed(notes + 4, 3, 2.0);
+        bool running = messages.size() == 3;
+        for (size_t i = 0; running && i < 3; ++i) {
+            running = messages[i].status == 0x90 && messages[i].channel == 4 && messages[i].deviceId == 7 &&
+                      messages[i].data1 == notes[1 + 2 * i] && messages[i].data2 == notes[2 + 2 * i];
+        }
+        assert_test(running && messages[0].timestamp == 1.0 && messages[2].timestamp == 2.0,
+                   "Parser applies running status");
+        
+        // Realtime bytes inside a message are emitted without breaking it
+        messages.clear();
+        const uint8_t clocked[] = {0xB0, 0xF8, 7, 0xFE, 127, 0xC5, 0xF8, 12};
+        parser.feed(clocked, sizeof(clocked), 0.0);
+        assert_test(messages.size() == 5 && messages[0].status == 0xF8 && messages[1].status == 0xFE &&
+                    messages[2].status == 0xB0 && messages[2].data1 == 7 && messages[2].data2 == 127 &&
+                    messages[3].status == 0xF8 && messages[4].status == 0xC0 && messages[4].channel == 6 &&
+                    messages[4].data1 == 12, "Parser interleaves realtime bytes");
+        
+        // System common cancels running status; stray data is counted
+        messages.clear();
+        const uint8_t common[] = {0xF2, 0x10, 0x20, 0x30, 0xF6};
+        parser.feed(common, sizeof(common), 0.0);
+        assert_test(messages.size() == 2 && messages[0].status == 0xF2 && messages[0].data2 == 0x20 &&
+                    messages[1].status == 0xF6 && parser.errors() == 1, "Parser handles system common messages");
+        
+        // Oxygen Pro identity reply fed one byte at a time, with a clock inside
+        messages.clear();
+        const uint8_t reply[] = {0xF0, 0x7E, 0x7F, 0x06, 0x02, 0x47, 0x32, 0x00, 0xF8, 0x19, 0x00, 0x01, 0x00, 0x00, 0x00, 0xF7};
+        for (uint8_t byte : reply) {
+            parser.feed(&byte, 1, 0.0);
+        }
+        std::vector<uint8_t> expected(reply, reply + sizeof(reply));
+        expected.erase(expected.begin() + 8);
+        assert_test(sysEx.size() == 1 && sysEx[0] == expected && messages.size() == 1 && messages[0].status == 0xF8,
+                   "Parser reassembles SysEx fed byte by byte");
+        
+        // Longer than the 16-byte buffer: delivered in fragments
+        sysEx.clear();
+        std::vector<uint8_t> dump = {0xF0};
+        for (int i = 0; i < 40; ++i) {
+            dump.push_back(static_cast<uint8_t>(i));
+        }
+        dump.push_back(0xF7);
+        parser.feed(dump.data(), dump.size(), 0.0);
+        assert_test(sysEx.size() == 1 && sysEx[0] == dump && parser.sysExCount() == 2, "Parser fragments long SysEx");
+        
+        // A status byte aborts an unterminated SysEx
+        sysEx.clear();
+        messages.clear();
+        const uint64_t errorsBefore = parser.errors();
+        const uint8_t aborted[] = {0xF0, 0x01, 0x02, 0x80, 60, 0};
+        parser.feed(aborted, sizeof(aborted), 0.0);
+        assert_test(sysEx.empty() && pending.empty() && messages.size() == 1 && messages[0].status == 0x80 &&
+                    parser.errors() == errorsBefore + 1, "Parser drops SysEx cut short by a status byte");
+    }
+    
+    void testMessageDispatch() {
+        MidiDevice device;
+        auto backend = std::make_unique<InjectingMidiInterface>();
+        InjectingMidiInterface* input = backend.get();
+        assert_test(device.initialize(std::move(backend)), "Initialize with injected backend");
+        // Room for every message, so the result does not depend on scheduling
+        device.setBufferSize(MidiDevice::kMessageQueueCapacity);
+        
+        std::mutex mutex;
+        std::condition_variable done;
+        std::vector<int> notes;
+        const int count = 5000;
+        device.setMidiInputCallback([&](const RealTimeMidiMessage& message) {
+            std::lock_guard<std::mutex> lock(mutex);
+            notes.push_back(message.data1);
+            if (notes.size() == count) {
+                done.notify_one();
+            }
+        });
+        device.startRealTimeProcessing();
+        
+        for (int i = 0; i < count; ++i) {
+            input->deliver(noteMessage(i, nowSeconds()));
+            if (i % 64 == 0) {
+                // Let the consumer go to sleep now and then so wakeups are exercised
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        
+        bool complete;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            complete = done.wait_for(lock, std::chrono::seconds(5), [&] { return notes.size() == count; });
+        }
+        device.stopRealTimeProcessing();
+        
+        bool ordered = complete;
+        for (int i = 0; ordered && i < count; ++i) {
+            ordered = notes[i] == (i & 0x7F);
+        }
+        assert_test(complete, "All injected messages dispatched");
+        assert_test(ordered, "Dispatch preserves arrival order");
+        assert_test(device.getMessagesReceived() == count && device.getDroppedMessages() == 0,
+                   "No drops when the consumer keeps up");
+        assert_test(!device.getRecentKeyEvents(60.0).empty(), "Dispatched messages recorded in key history");
+        
+        LatencySummary latency = device.getInputLatencyStats();
+        assert_test(latency.count == count, "Every dispatch recorded in latency histogram");
+        assert_test(latency.p50 > 0.0 && latency.p50 <= latency.p99 && latency.p99 <= latency.p999 &&
+                    latency.p999 <= latency.max, "Latency percentiles ordered");
+        assert_test(std::abs(device.getInputLatency() - latency.mean) < 1e-12, "Input latency is the histogram mean");
+        device.resetStatistics();
+        assert_test(device.getInputLatencyStats().count == 0 && device.getInputLatency() == 0.0,
+                   "Latency histogram reset");
+    }
+    
+    void testDropAccounting() {
+        MidiDevice device;
+        auto backend = std::make_unique<InjectingMidiInterface>();
+        InjectingMidiInterface* input = backend.get();
+        device.initialize(std::move(backend));
+        device.setBufferSize(16);
+        
+        std::atomic<int> dispatched{0};
+        device.setMidiInputCallback([&](const RealTimeMidiMessage&) { dispatched++; });
+        
+        // With no consumer running the ring fills and every further message is dropped
+        for (int i = 0; i < 100; ++i) {
+            input->deliver(noteMessage(i, nowSeconds()));
+        }
+        RealTimeMidiMessage clock;
+        clock.status = 0xF8;
+        clock.data1 = clock.data2 = 0;
+        clock.channel = 1;
+        clock.timestamp = nowSeconds();
+        clock.deviceId = 0;
+        input->deliver(clock); // Filtered, so neither queued nor dropped
+        
+        assert_test(device.getMessagesReceived() == 101, "Every delivered message counted as received");
+        assert_test(device.getDroppedMessages() == 84, "Drops counted exactly once buffer limit is reached");
+        
+        device.startRealTimeProcessing();
+        for (int i = 0; i < 500 && dispatched < 16; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        device.stopRealTimeProcessing();
+        assert_test(dispatched == 16, "Queued messages dispatched after processing starts");
+        
+        device.setBufferSize(1000000);
+        for (int i = 0; i < static_cast<int>(MidiDevice::kMessageQueueCapacity) + 10; ++i) {
+            input->deliver(noteMessage(i, nowSeconds()));
+        }
+        assert_test(device.getDroppedMessages() == 84 + 10, "Buffer size clamped to ring capacity");
+    }
+    
+    static RealTimeMidiMessage deviceNote(int deviceId, int note, double timestamp) {
+        RealTimeMidiMessage message = noteMessage(note, timestamp);
+        message.deviceId = deviceId;
+        return message;
+    }
+    
+    void testInputFanIn() {
+        MidiDevice device;
+        auto backend = std::make_unique<InjectingMidiInterface>();
+        InjectingMidiInterface* input = backend.get();
+        device.initialize(std::move(backend));
+        device.setBufferSize(MidiDevice::kMessageQueueCapacity);
+        
+        std::mutex mutex;
+        std::vector<RealTimeMidiMessage> dispatched;
+        device.setMidiInputCallback([&](const RealTimeMidiMessage& message) {
+            std::lock_guard<std::mutex> lock(mutex);
+            dispatched.push_back(message);
+        });
+        auto dispatchedCount = [&] {
+            std::lock_guard<std::mutex> lock(mutex);
+            return dispatched.size();
+        };
+        auto waitForDispatched = [&](size_t count) {
+            for (int i = 0; i < 2000 && dispatchedCount() < count; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return dispatchedCount() == count;
+        };
+        
+        // Two keyboards and a pad controller, each queued in turn, played interleaved
+        const int devices[] = {10, 20, 30};
+        const int perDevice = 30;
+        const double start = nowSeconds() - 1.0;
+        for (int d = 0; d < 3; ++d) {
+            for (int i = 0; i < perDevice; ++i) {
+                const int slot = i * 3 + d;
+                input->deliver(deviceNote(devices[d], slot, start + slot * 1e-3));
+            }
+        }
+        device.startRealTimeProcessing();
+        bool complete = waitForDispatched(3 * perDevice);
+        bool merged = complete;
+        for (int i = 0; merged && i < 3 * perDevice; ++i) {
+            merged = dispatched[i].data1 == i && dispatched[i].deviceId == devices[i % 3];
+        }
+        assert_test(complete && merged, "Devices merged in timestamp order");
+        
+        MidiInputStats pad = device.getDeviceInputStats(30);
+        assert_test(pad.deviceId == 30 && pad.messagesReceived == perDevice && pad.messagesDispatched == perDevice &&
+                    pad.droppedMessages == 0 && pad.queued == 0 && pad.latency.count == perDevice,
+                   "Per-device input statistics");
+        auto all = device.getAllDeviceInputStats();
+        assert_test(all.size() == 3 && all[0].deviceId == 10 && all[2].deviceId == 30 &&
+                    device.getDeviceInputStats(40).deviceId == -1, "Statistics listed per device");
+        
+        // Every lane taken: a further device is dropped and counted
+        const int spare = static_cast<int>(MidiDevice::kMaxInputDevices) - 3;
+        for (int i = 0; i < spare; ++i) {
+            input->deliver(deviceNote(100 + i, 1, nowSeconds()));
+        }
+        input->deliver(deviceNote(999, 1, nowSeconds()));
+        assert_test(device.getDroppedMessages() == 1 && device.getDeviceInputStats(999).deviceId == -1,
+                   "Input beyond kMaxInputDevices dropped");
+        
+        // A disconnected device's lane goes to the next new device once drained
+        device.disconnectDevice(10);
+        waitForDispatched(3 * perDevice + spare);
+        input->deliver(deviceNote(999, 2, nowSeconds()));
+        complete = waitForDispatched(3 * perDevice + spare + 1);
+        MidiInputStats replacement = device.getDeviceInputStats(999);
+        assert_test(complete && replacement.messagesReceived == 1 && device.getDeviceInputStats(10).deviceId == -1,
+                   "Disconnected device's lane reused");
+        device.stopRealTimeProcessing();
+        
+        // Devices whose input arrives on separate threads keep their own order
+        MidiDevice threaded;
+        auto threadedBackend = std::make_unique<InjectingMidiInterface>();
+        InjectingMidiInterface* threadedInput = threadedBackend.get();
+        threaded.initialize(std::move(threadedBackend));
+        threaded.setBufferSize(MidiDevice::kMessageQueueCapacity);
+        const int perThread = 20000;
+        std::vector<int> lastNote(3, -1);
+        std::atomic<int> total{0};
+        std::atomic<bool> inOrder{true};
+        threaded.setMidiInputCallback([&](const RealTimeMidiMessage& message) {
+            const int d = message.deviceId - 1;
+            const int n = static_cast<int>(message.data2) * 128 + message.data1;
+            if (n != lastNote[d] + 1) inOrder = false;
+            lastNote[d] = n;
+            total++;
+        });
+        threaded.startRealTimeProcessing();
+        std::vector<std::thread> producers;
+        for (int d = 1; d <= 3; ++d) {
+            producers.emplace_back([&, d] {
+                for (int i = 0; i < perThread; ++i) {
+                    RealTimeMidiMessage message = deviceNote(d, i & 0x7F, nowSeconds());
+                    message.data2 = static_cast<uint8_t>(i >> 7);
+                    // Back off when the lane is full so nothing is dropped
+                    while (threaded.getDeviceInputStats(d).queued > MidiDevice::kMessageQueueCapacity / 2) {
+                        std::this_thread::yield();
+                    }
+                    threadedInput->deliver(message);
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        for (int i = 0; i < 5000 && total < 3 * perThread; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        threaded.stopRealTimeProcessing();
+        assert_test(total == 3 * perThread && inOrder && threaded.getDroppedMessages() == 0,
+                   "Concurrent devices each dispatched in order");
+    }
+    
+    void testRealtimeConfig() {
+        MidiDevice device;
+        auto backend = std::make_unique<InjectingMidiInterface>();
+        InjectingMidiInterface* input = backend.get();
+        device.initialize(std::move(backend));
+        
+        RealtimeConfig invalid;
+        invalid.policy = RealtimeConfig::Policy::Fifo;
+        invalid.priority = 0;
+        assert_test(!device.setRealtimeConfig(invalid), "Realtime priority 0 rejected");
+        invalid.priority = 10;
+        invalid.cpus = {-1};
+        assert_test(!device.setRealtimeConfig(invalid), "Negative CPU rejected");
+        
+        RealtimeConfig config;
+        config.policy = RealtimeConfig::Policy::Fifo;
+        config.priority = 10;
+        config.cpus = {0};
+        config.prefault = true;
+        assert_test(device.setRealtimeConfig(config), "Realtime config accepted");
+        
+        std::atomic<int> dispatched{0};
+        std::atomic<int> policy{-1};
+        std::atomic<int> allowedCpus{-1};
+        device.setMidiInputCallback([&](const RealTimeMidiMessage&) {
+#ifdef __linux__
+            int currentPolicy;
+            sched_param param;
+            pthread_getschedparam(pthread_self(), &currentPolicy, &param);
+            policy = currentPolicy;
+            cpu_set_t set;
+            pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+            allowedCpus = CPU_ISSET(0, &set) ? CPU_COUNT(&set) : 0;
+#endif
+            dispatched++;
+        });
+        device.startRealTimeProcessing();
+        assert_test(!device.setRealtimeConfig(RealtimeConfig()), "Realtime config fixed while processing");
+        input->deliver(noteMessage(60, nowSeconds()));
+        for (int i = 0; i < 1000 && dispatched == 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        device.stopRealTimeProcessing();
+        
+        RealtimeStatus status = device.getRealtimeStatus();
+        assert_test(dispatched == 1, "Processing runs with realtime config");
+        assert_test(status.prefaulted, "Input queues prefaulted");
+#ifdef __linux__
+        assert_test(status.affinity && allowedCpus == 1, "Processing thread pinned to CPU 0");
+        if (status.scheduling) {
+            assert_test(policy == SCHED_FIFO && status.error.empty(), "Processing thread runs SCHED_FIFO");
+        } else {
+            // Unprivileged: processing continues with normal scheduling and says why
+            assert_test(policy == SCHED_OTHER && status.error.find("SCHED_FIFO") != std::string::npos &&
+                        device.getLastError() == MidiError::SystemError, "Missing realtime privilege reported");
+        }
+        
+        // A CPU that does not exist cannot be applied; processing still starts
+        device.clearErrors();
+        config.policy = RealtimeConfig::Policy::Default;
+        config.cpus = {CPU_SETSIZE - 1};
+        assert_test(device.setRealtimeConfig(config), "Offline CPU accepted until applied");
+        device.startRealTimeProcessing();
+        input->deliver(noteMessage(61, nowSeconds()));
+        for (int i = 0; i < 1000 && dispatched == 1; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        device.stopRealTimeProcessing();
+        status = device.getRealtimeStatus();
+        assert_test(dispatched == 2 && status.scheduling && !status.affinity &&
+                    status.error.find("CPU affinity") != std::string::npos &&
+                    device.getLastError() == MidiError::SystemError &&
+                    device.getLastErrorString() == status.error, "Affinity failure falls back with error");
+#endif
+    }
+    
+    void testListenerDispatch() {
+        MidiDevice device;
+        auto backend = std::make_unique<InjectingMidiInterface>();
+        InjectingMidiInterface* input = backend.get();
+        device.initialize(std::move(backend));
+        device.setBufferSize(MidiDevice::kMessageQueueCapacity);
+        
+        std::atomic<int> callbackCount{0};
+        std::atomic<int> allCount{0};
+        std::atomic<int> noteOns{0};
+        std::atomic<int> controls{0};
+        std::atomic<bool> typedCorrectly{true};
+        auto all = makeMidiListener([&](const RealTimeMidiMessage&) { allCount++; });
+        auto noteOn = makeMidiListener([&](const RealTimeMidiMessage& message) {
+            if (message.status != 0x90) typedCorrectly = false;
+            noteOns++;
+        });
+        auto control = makeMidiListener([&](const RealTimeMidiMessage& message) {
+            if (message.status != 0xB0) typedCorrectly = false;
+            controls++;
+        });
+        device.setMidiInputCallback([&](const RealTimeMidiMessage&) { callbackCount++; });
+        
+        assert_test(device.addMidiListener(&all) && device.addMidiListener(MidiMessageType::NoteOn, &noteOn) &&
+                    device.addMidiListener(MidiMessageType::ControlChange, &control), "Listeners subscribed");
+        assert_test(!device.addMidiListener(&all) && !device.addMidiListener(nullptr) &&
+                    !device.addMidiListener(MidiMessageType::SystemExclusive, &control),
+                   "Duplicate, null and non-channel subscriptions rejected");
+        
+        auto send = [&](int i) {
+            RealTimeMidiMessage message = noteMessage(i, nowSeconds());
+            if (i % 3 == 1) {
+                message.status = 0xB0;   // Control change
+            } else if (i % 3 == 2) {
+                message.status = 0x80;   // Note off: only the catch-all listener sees it
+            }
+            input->deliver(message);
+        };
+        auto waitFor = [&](int count) {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (allCount < count && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            return allCount == count;
+        };
+        
+        device.startRealTimeProcessing();
+        assert_test(!device.addMidiListener(&noteOn) && !device.removeMidiListener(&all),
+                   "Subscriptions fixed while processing");
+        
+        // The first messages may allocate (thread start-up, first wakeups);
+        // after that the input path, producer to listeners, must not
+        const int warmUp = 300;
+        for (int i = 0; i < warmUp; ++i) {
+            send(i);
+        }
+        bool complete = waitFor(warmUp);
+        const int count = 30000;
+        const uint64_t allocationsBefore = g_heapAllocations.load();
+        for (int i = warmUp; i < warmUp + count; ++i) {
+            // Stay well inside the ring so a slow consumer does not cause drops
+            while (i - allCount > 4096) {
+                std::this_thread::yield();
+            }
+            send(i);
+            if (i % 256 == 0) {
+                // Let the consumer sleep now and then so wakeups are covered too
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        complete = waitFor(warmUp + count) && complete;
+        const uint64_t allocations = g_heapAllocations.load() - allocationsBefore;
+        device.stopRealTimeProcessing();
+        
+        const int total = warmUp + count;
+        assert_test(complete && callbackCount == total && noteOns == (total + 2) / 3 &&
+                    controls == (total + 1) / 3 && typedCorrectly, "Typed listeners receive only their type");
+        std::cout << "  Heap allocations for " << count << " dispatched messages: " << allocations << "\n";
+        assert_test(allocations == 0, "Input path allocation-free after warm-up");
+        
+        assert_test(device.removeMidiListener(&noteOn) && !device.removeMidiListener(&noteOn),
+                   "Listener removed once");
+        std::vector<MidiListenerFunction<std::function<void(const RealTimeMidiMessage&)>>> extra;
+        for (int i = 0; i < 8; ++i) {
+            extra.emplace_back([](const RealTimeMidiMessage&) {});
+        }
+        bool filled = true;
+        for (int i = 0; i < 7; ++i) {
+            filled = device.addMidiListener(&extra[i]) && filled;
+        }
+        assert_test(filled && !device.addMidiListener(&extra[7]), "Listener table capacity enforced");
+    }
+    
+    void testStatusTable() {
+        // The table must agree with the switch statements it replaced, for every byte
+        bool typesMatch = true;
+        bool lengthsMatch = true;
+        for (int status = 0; status < 256; ++status) {
+            MidiMessageType expected;
+            if (status >= 0xF8) expected = MidiMessageType::SystemRealtime;
+            else if (status == 0xF0) expected = MidiMessageType::SystemExclusive;
+            else if (status > 0xF0) expected = MidiMessageType::SystemCommon;
+            else if (status < 0x80) expected = MidiMessageType::Unknown;
+            else expected = static_cast<MidiMessageType>(status & 0xF0);
+            typesMatch = typesMatch && MidiStatusTable::type(static_cast<uint8_t>(status)) == expected;
+            
+            if (status < 0x80) continue;
+            int length = -1;
+            if (status < 0xF0) length = (status & 0xF0) == 0xC0 || (status & 0xF0) == 0xD0 ? 1 : 2;
+            else if (status == 0xF1 || status == 0xF3) length = 1;
+            else if (status == 0xF2) length = 2;
+            else if (status == 0xF6) length = 0;
+            lengthsMatch = lengthsMatch && MidiStreamParser::dataLength(static_cast<uint8_t>(status)) == length;
+        }
+        assert_test(typesMatch, "Status table types match reference for all 256 bytes");
+        assert_test(lengthsMatch, "Status table data lengths match parser reference");
+        assert_test(MidiStatusTable::isNote(0x85) && MidiStatusTable::isNote(0x9F) && !MidiStatusTable::isNote(0xA0) &&
+                    MidiStatusTable::isChannelMessage(0xEF) && !MidiStatusTable::isChannelMessage(0xF0) &&
+                    !MidiStatusTable::isChannelMessage(0x40), "Status table flags");
+        assert_test(MidiStatusTable::lookup(0xFA).dataBytes == 0 && MidiStatusTable::lookup(0xF9).dataBytes == -1 &&
+                    (MidiStatusTable::lookup(0xF7).flags & MidiStatusTable::kSysEx), "System entries");
+        
+        RealTimeMidiMessage pad = noteMessage(40, 0.0);
+        pad.channel = 10;
+        RealTimeMidiMessage fullStatus = pad;
+        fullStatus.status = 0x89;   // Note off with the channel still in the status byte
+        RealTimeMidiMessage highNote = pad;
+        highNote.data1 = 52;
+        assert_test(MidiDevice::isDrumPadMessage(pad) && MidiDevice::isDrumPadMessage(fullStatus) &&
+                    !MidiDevice::isDrumPadMessage(highNote) && MidiDevice::isNoteOffMessage(fullStatus),
+                   "Drum pad classification via table");
+        assert_test(MidiDevice::serializeMidiMessage(pad) == std::vector<uint8_t>({0x99, 40, 100}),
+                   "Serialization uses table data lengths");
+    }
+    
+    /**
+     * @brief [AI GENERATED] Route handler that counts what it receives.
+     */
+    struct CountingHandler : MidiInputListener {
+        int count = 0;
+        uint16_t channels = 0;
+        uint8_t types = 0;
+        void onMidiMessage(const RealTimeMidiMessage& message) override {
+            count++;
+            channels |= MidiRouter::channelBit(message.channel);
+            types |= MidiStatusTable::channelTypeBit(MidiStatusTable::type(message.status));
+        }
+    };
+    
+    void testMidiRouter() {
+        CountingHandler keyboard;
+        CountingHandler percussion;
+        CountingHandler parameters;
+        MidiRouter router;
+        const uint8_t notes = MidiRouter::typeBit(MidiMessageType::NoteOn) | MidiRouter::typeBit(MidiMessageType::NoteOff);
+        const uint16_t drums = MidiRouter::channelBit(10);
+        const int keyboardRoute = router.addRoute(&keyboard, notes, MidiRouter::kAllChannels & ~drums);
+        const int percussionRoute = router.addRoute(&percussion, notes, drums);
+        const int parameterRoute = router.addRoute(&parameters, MidiRouter::typeBit(MidiMessageType::ControlChange));
+        assert_test(keyboardRoute >= 0 && percussionRoute >= 0 && parameterRoute >= 0, "Routes added");
+        assert_test(router.addRoute(&keyboard, 0) == -1 && router.addRoute(nullptr, notes) == -1 &&
+                    router.addRoute(&keyboard, notes, 0) == -1, "Empty routes rejected");
+        
+        for (int channel = 1; channel <= 16; ++channel) {
+            for (uint8_t status : {0x80, 0x90, 0xB0, 0xE0, 0xA0}) {
+                RealTimeMidiMessage message = noteMessage(60, 0.0);
+                message.status = status;
+                message.channel = channel;
+                router.route(message);
+            }
+        }
+        RealTimeMidiMessage clock = noteMessage(0, 0.0);
+        clock.status = 0xF8;
+        router.route(clock);
+        assert_test(keyboard.count == 30 && keyboard.channels == (0xFFFF & ~drums) && keyboard.types == notes,
+                   "Notes off channel 10 routed to keyboard");
+        assert_test(percussion.count == 2 && percussion.channels == drums, "Channel 10 routed to percussion");
+        assert_test(parameters.count == 16 && parameters.types == MidiRouter::typeBit(MidiMessageType::ControlChange),
+                   "Control changes routed to parameters");
+        assert_test(router.routesFor(0x99, 10) == (1u << percussionRoute) && router.routesFor(0xF8, 1) == 0 &&
+                    router.routesFor(0x90, 17) == 0, "Route masks precomputed");
+        assert_test(router.channelMask(MidiMessageType::NoteOn) == 0xFFFF &&
+                    router.channelMask(MidiMessageType::PitchBend) == 0, "Channel mask per type");
+        
+        assert_test(router.removeRoute(percussionRoute) && !router.removeRoute(percussionRoute) &&
+                    router.routesFor(0x90, 10) == 0 && router.channelMask(MidiMessageType::NoteOn) == (0xFFFF & ~drums),
+                   "Route removed");
+        MidiRouter full;
+        int added = 0;
+        while (full.addRoute(&keyboard, notes) >= 0) added++;
+        assert_test(added == static_cast<int>(MidiRouter::kMaxRoutes), "Route capacity enforced");
+        
+        // The device drops traffic no route wants before queueing it
+        MidiDevice device;
+        auto backend = std::make_unique<InjectingMidiInterface>();
+        InjectingMidiInterface* input = backend.get();
+        device.initialize(std::move(backend));
+        device.setInputFilter(router);
+        assert_test(device.getInputFilter(MidiMessageType::NoteOn) == (0xFFFF & ~drums) &&
+                    device.getInputFilter(MidiMessageType::PitchBend) == 0 &&
+                    !device.setInputFilter(MidiMessageType::SystemRealtime, 0xFFFF), "Input filter from routes");
+        keyboard = CountingHandler();
+        parameters = CountingHandler();
+        device.addMidiListener(&router);
+        device.startRealTimeProcessing();
+        for (int channel = 1; channel <= 16; ++channel) {
+            for (uint8_t status : {0x90, 0xB0, 0xE0}) {
+                RealTimeMidiMessage message = noteMessage(60, nowSeconds());
+                message.status = status;
+                message.channel = channel;
+                input->deliver(message);
+            }
+        }
+        for (int i = 0; i < 1000 && device.getDeviceInputStats(0).messagesDispatched < 31; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        device.stopRealTimeProcessing();
+        MidiInputStats stats = device.getDeviceInputStats(0);
+        assert_test(keyboard.count == 15 && parameters.count == 16 && stats.messagesReceived == 48 &&
+                    stats.messagesDispatched == 31 && device.getDroppedMessages() == 0,
+                   "Unrouted traffic filtered before queueing");
+        device.clearInputFilter();
+        assert_test(device.getInputFilter(MidiMessageType::PitchBend) == 0xFFFF, "Input filter cleared");
+    }
+    
+    void benchmarkMidiRouter() {
+        // Mixed traffic on all channels through 4 routes, against the
+        // predicate-per-handler dispatch a router replaces
+        CountingHandler handlers[4];
+        MidiRouter router;
+        const uint8_t notes = MidiRouter::typeBit(MidiMessageType::NoteOn) | MidiRouter::typeBit(MidiMessageType::NoteOff);
+        router.addRoute(&handlers[0], notes, 0xFFFF & ~MidiRouter::channelBit(10));
+        router.addRoute(&handlers[1], notes, MidiRouter::channelBit(10));
+        router.addRoute(&handlers[2], MidiRouter::typeBit(MidiMessageType::ControlChange));
+        router.addRoute(&handlers[3], MidiRouter::typeBit(MidiMessageType::PitchBend));
+        
+        std::vector<RealTimeMidiMessage> traffic(4096);
+        const uint8_t statuses[] = {0x90, 0x80, 0xB0, 0xE0, 0xD0, 0xF8};
+        uint32_t seed = 12345;
+        for (auto& message : traffic) {
+            seed = seed * 1664525 + 1013904223;
+            message = noteMessage(static_cast<int>(seed >> 8) & 0x7F, 0.0);
+            message.status = statuses[(seed >> 16) % 6];
+            message.channel = 1 + static_cast<int>((seed >> 24) % 16);
+        }
+        
+        const int rounds = 2000;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (const auto& message : traffic) {
+                router.route(message);
+            }
+        }
+        const double routed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        
+        // Baseline: each subscriber keeps its masks and every message is
+        // classified with a switch and tested against each subscriber
+        struct Subscriber {
+            MidiInputListener* handler;
+            uint8_t typeMask;
+            uint16_t channelMask;
+        };
+        const Subscriber subscribers[] = {
+            {&handlers[0], notes, static_cast<uint16_t>(0xFFFF & ~MidiRouter::channelBit(10))},
+            {&handlers[1], notes, MidiRouter::channelBit(10)},
+            {&handlers[2], MidiRouter::typeBit(MidiMessageType::ControlChange), 0xFFFF},
+            {&handlers[3], MidiRouter::typeBit(MidiMessageType::PitchBend), 0xFFFF},
+        };
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (const auto& message : traffic) {
+                uint8_t typeBit = 0;
+                switch (message.status & 0xF0) {
+                    case 0x80: typeBit = 0x01; break;
+                    case 0x90: typeBit = 0x02; break;
+                    case 0xA0: typeBit = 0x04; break;
+                    case 0xB0: typeBit = 0x08; break;
+                    case 0xC0: typeBit = 0x10; break;
+                    case 0xD0: typeBit = 0x20; break;
+                    case 0xE0: typeBit = 0x40; break;
+                    default: continue;
+                }
+                for (const Subscriber& subscriber : subscribers) {
+                    if ((subscriber.typeMask & typeBit) && (subscriber.channelMask >> (message.channel - 1) & 1)) {
+                        subscriber.handler->onMidiMessage(message);
+                    }
+                }
+            }
+        }
+        const double branched = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        const double messages = static_cast<double>(rounds) * traffic.size();
+        std::cout << "  MidiRouter dispatch: " << routed / messages << " ns/message (subscriber list: "
+                  << branched / messages << " ns, checksum " << handlers[0].count + handlers[2].count << ")\n";
+    }
+    
+    void testVelocityCurve() {
+        const VelocityTable linear = VelocityCurve::fromPreset(VelocityCurve::Preset::Linear);
+        const VelocityTable soft = VelocityCurve::fromPreset(VelocityCurve::Preset::Soft);
+        const VelocityTable hard = VelocityCurve::fromPreset(VelocityCurve::Preset::Hard);
+        const VelocityTable exponential = VelocityCurve::fromPreset(VelocityCurve::Preset::Exponential);
+        bool shapesValid = true;
+        for (const VelocityTable* table : {&linear, &soft, &hard, &exponential}) {
+            shapesValid = shapesValid && (*table)[0] == 0 && (*table)[1] >= 1 && (*table)[127] == 127;
+            for (int v = 1; v < 128; ++v) {
+                shapesValid = shapesValid && (*table)[v] >= (*table)[v - 1];
+            }
+        }
+        bool ordered = true;
+        for (int v = 0; v < 128; ++v) {
+            ordered = ordered && linear[v] == v && soft[v] >= linear[v] && hard[v] <= linear[v] &&
+                      exponential[v] <= hard[v] + 1;
+        }
+        assert_test(shapesValid, "Velocity presets monotonic, 0 kept, never silence a note");
+        assert_test(ordered && soft[32] > 60 && hard[64] < 40, "Velocity presets shaped");
+        
+        const VelocityTable points = VelocityCurve::fromPoints({0.0f, 1.0f});
+        const VelocityTable stepped = VelocityCurve::fromPoints({0.0f, 0.1f, 0.3f, 0.7f, 1.0f});
+        const VelocityTable clamped = VelocityCurve::fromPoints({-1.0f, 2.0f});
+        const VelocityTable constant = VelocityCurve::fromPoints({0.5f});
+        assert_test(points == linear && VelocityCurve::fromPoints({}) == linear, "Two-point curve is linear");
+        assert_test(stepped[0] == 0 && std::abs(stepped[64] - 38) <= 1 && stepped[127] == 127,
+                   "Curve interpolated between points");
+        assert_test(clamped[1] == 1 && clamped[126] == 127 && constant[1] == 64 && constant[127] == 64,
+                   "Curve points clamped");
+        
+        // Applied on the input thread: callbacks, listeners and history all
+        // see the shaped velocity; note off and velocity 0 pass unchanged
+        MidiDevice device;
+        auto backend = std::make_unique<InjectingMidiInterface>();
+        InjectingMidiInterface* input = backend.get();
+        device.initialize(std::move(backend));
+        assert_test(device.getVelocityTable() == linear, "Velocity curve disabled by default");
+        device.setVelocityCurve(VelocityCurve::Preset::Hard);
+        assert_test(device.getVelocityTable() == hard, "Velocity preset selected");
+        
+        std::vector<RealTimeMidiMessage> received;
+        std::mutex receivedMutex;
+        device.setMidiInputCallback([&](const RealTimeMidiMessage& message) {
+            std::lock_guard<std::mutex> lock(receivedMutex);
+            received.push_back(message);
+        });
+        device.clearKeyEventHistory();
+        device.startRealTimeProcessing();
+        const double start = nowSeconds();
+        RealTimeMidiMessage noteOn = noteMessage(60, start);
+        noteOn.data2 = 64;
+        RealTimeMidiMessage silent = noteMessage(61, start);
+        silent.data2 = 0;
+        RealTimeMidiMessage noteOff = noteMessage(60, start);
+        noteOff.status = 0x80;
+        noteOff.data2 = 64;
+        for (const auto& message : {noteOn, silent, noteOff}) {
+            input->deliver(message);
+        }
+        auto receivedCount = [&]() {
+            std::lock_guard<std::mutex> lock(receivedMutex);
+            return received.size();
+        };
+        for (int i = 0; i < 1000 && receivedCount() < 3; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        {
+            std::lock_guard<std::mutex> lock(receivedMutex);
+            assert_test(received.size() == 3 && received[0].data2 == hard[64] && received[1].data2 == 0 &&
+                        received[2].data2 == 64, "Velocity curve applied to note on only");
+        }
+        std::vector<KeyEvent> events = device.getKeyEventsBetween(start - 1.0, start + 1.0);
+        assert_test(!events.empty() && events.front().velocity == hard[64], "Key history records shaped velocity");
+        
+        // Swapping curves while notes arrive: every note gets one table's
+        // value, never a torn or stale-buffer mix
+        {
+            std::lock_guard<std::mutex> lock(receivedMutex);
+            received.clear();
+        }
+        std::atomic<bool> swapping{true};
+        std::thread swapper([&]() {
+            bool toggle = false;
+            while (swapping.load()) {
+                device.setVelocityCurve(toggle ? VelocityCurve::Preset::Soft : VelocityCurve::Preset::Hard);
+                toggle = !toggle;
+                std::this_thread::yield();
+            }
+        });
+        const int notes = 2000;
+        for (int i = 0; i < notes; ++i) {
+            RealTimeMidiMessage message = noteMessage(i, nowSeconds());
+            message.data2 = static_cast<uint8_t>(1 + i % 127);
+            input->deliver(message);
+            if (i % 256 == 255) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        for (int i = 0; i < 2000 && receivedCount() < static_cast<size_t>(notes); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        swapping = false;
+        swapper.join();
+        device.stopRealTimeProcessing();
+        bool consistent = true;
+        {
+            std::lock_guard<std::mutex> lock(receivedMutex);
+            consistent = received.size() == static_cast<size_t>(notes);
+            for (size_t i = 0; consistent && i < received.size(); ++i) {
+                const int velocity = 1 + static_cast<int>(i % 127);
+                consistent = received[i].data2 == soft[velocity] || received[i].data2 == hard[velocity];
+            }
+        }
+        assert_test(consistent, "Velocity curve swapped without locks or torn tables");
+        
+        device.enableVelocityCurve(false);
+        assert_test(device.getVelocityTable() == linear, "Velocity curve bypassed");
+        device.enableVelocityCurve(true);
+        device.setVelocityCurve(std::vector<float>());
+        assert_test(device.getVelocityTable() == linear, "Empty curve disables");
+        device.setVelocityCurve({0.0f, 1.0f});
+        assert_test(device.getVelocityTable() == points, "Curve points compiled");
+    }
+    
+    void benchmarkVelocityCurve() {
+        // Table lookup per note against evaluating the curve per note
+        const VelocityTable table = VelocityCurve::fromPreset(VelocityCurve::Preset::Exponential);
+        std::vector<uint8_t> velocities(4096);
+        uint32_t seed = 54321;
+        for (auto& velocity : velocities) {
+            seed = seed * 1664525 + 1013904223;
+            velocity = static_cast<uint8_t>(1 + (seed >> 16) % 127);
+        }
+        
+        const int rounds = 2000;
+        uint64_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (uint8_t velocity : velocities) {
+                checksum += table[velocity];
+            }
+        }
+        const double looked = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (uint8_t velocity : velocities) {
+                const double value = std::expm1(4.0 * velocity / 127.0) / std::expm1(4.0);
+                checksum += static_cast<uint64_t>(std::max(1L, std::lround(value * 127.0)));
+            }
+        }
+        const double computed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        const double notes = static_cast<double>(rounds) * velocities.size();
+        std::cout << "  Velocity curve: " << looked / notes << " ns/note (computed per note: "
+                  << computed / notes << " ns, checksum " << checksum << ")\n";
+    }
+    
+    void benchmarkRealtimeDispatch() {
+        // Wakeup latency while every CPU is busy with normal-priority work,
+        // as on a shared host, with and without SCHED_FIFO
+        const int count = 2000;
+        const unsigned hogs = std::max(2u, 2 * std::thread::hardware_concurrency());
+        std::atomic<bool> hogging{true};
+        std::vector<std::thread> hogThreads;
+        for (unsigned i = 0; i < hogs; ++i) {
+            hogThreads.emplace_back([&] {
+                volatile uint64_t spin = 0;
+                while (hogging.load(std::memory_order_relaxed)) {
+                    spin = spin + 1;
+                }
+            });
+        }
+        
+        for (bool realtime : {false, true}) {
+            MidiDevice device;
+            auto backend = std::make_unique<InjectingMidiInterface>();
+            InjectingMidiInterface* input = backend.get();
+            device.initialize(std::move(backend));
+            if (realtime) {
+                RealtimeConfig config;
+                config.policy = RealtimeConfig::Policy::Fifo;
+                config.priority = 50;
+                config.prefault = true;
+                device.setRealtimeConfig(config);
+            }
+            std::vector<double> latency(count);
+            std::atomic<int> seen{0};
+            device.setMidiInputCallback([&](const RealTimeMidiMessage& message) {
+                const int i = seen.load(std::memory_order_relaxed);
+                latency[i] = (nowSeconds() - message.timestamp) * 1e6;
+                seen.store(i + 1, std::memory_order_release);
+            });
+            device.startRealTimeProcessing();
+            if (realtime && !device.getRealtimeStatus().scheduling) {
+                std::cout << "  SCHED_FIFO unavailable: " << device.getRealtimeStatus().error << "\n";
+                continue;
+            }
+            for (int i = 0; i < count; ++i) {
+                input->deliver(noteMessage(i, nowSeconds()));
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+            while (seen.load(std::memory_order_acquire) < count) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            device.stopRealTimeProcessing();
+            printLatency(realtime ? "Busy host, SCHED_FIFO 50 " : "Busy host, default policy", latency);
+        }
+        hogging = false;
+        for (auto& hog : hogThreads) {
+            hog.join();
+        }
+    }
+    
+    void benchmarkInputFanIn() {
+        // Cost of dispatch, merge included, with the lanes full; the callback is empty
+        const size_t perDevice = 8000;
+        for (int devices : {1, 3, 8}) {
+            MidiDevice device;
+            auto backend = std::make_unique<InjectingMidiInterface>();
+            InjectingMidiInterface* input = backend.get();
+            device.initialize(std::move(backend));
+            device.setBufferSize(MidiDevice::kMessageQueueCapacity);
+            std::atomic<size_t> dispatched{0};
+            device.setMidiInputCallback([&](const RealTimeMidiMessage&) {
+                dispatched.fetch_add(1, std::memory_order_relaxed);
+            });
+            
+            const double start = nowSeconds();
+            for (size_t i = 0; i < perDevice; ++i) {
+                for (int d = 0; d < devices; ++d) {
+                    input->deliver(deviceNote(d, static_cast<int>(i), start + (i * devices + d) * 1e-9));
+                }
+            }
+            const size_t total = perDevice * devices;
+            const auto begin = std::chrono::steady_clock::now();
+            device.startRealTimeProcessing();
+            while (dispatched.load(std::memory_order_relaxed) < total) {
+                std::this_thread::yield();
+            }
+            const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+            device.stopRealTimeProcessing();
+            std::cout << "  Fan-in dispatch, " << devices << " device(s): " << elapsed / total << " ns/message\n";
+        }
+    }
+    
+    void testLoopbackBackend() {
+        MidiDevice device;
+        auto backend = std::make_unique<LoopbackMidiInterface>();
+        LoopbackMidiInterface* loopback = backend.get();
+        assert_test(device.initialize(std::move(backend)), "Initialize with loopback backend");
+        device.setBufferSize(MidiDevice::kMessageQueueCapacity);
+        
+        // Input arriving before the device is opened is discarded
+        loopback->startLoad({1e6, 10, 50});
+        assert_test(loopback->waitUntilIdle(std::chrono::seconds(5)) && loopback->getMessagesDiscarded() == 50 &&
+                    device.getMessagesReceived() == 0, "Loopback discards input while closed");
+        
+        std::mutex mutex;
+        std::vector<RealTimeMidiMessage> received;
+        std::vector<uint8_t> sysEx;
+        device.setMidiInputCallback([&](const RealTimeMidiMessage& message) {
+            std::lock_guard<std::mutex> lock(mutex);
+            received.push_back(message);
+        });
+        device.setSysExCallback([&](const MidiSysExMessage& message) {
+            std::lock_guard<std::mutex> lock(mutex);
+            sysEx.assign(message.data, message.data + message.length);
+        });
+        assert_test(device.connectToDevice(LoopbackMidiInterface::kDeviceId), "Connect to loopback device");
+        device.startRealTimeProcessing();
+        
+        // Sent messages come back in order after latency plus jitter
+        loopback->setTiming({0.004, 0.002, 42});
+        std::vector<RealTimeMidiMessage> notes;
+        for (int i = 0; i < 32; ++i) {
+            notes.push_back(noteMessage(i, 0.0));
+        }
+        const double sentAt = nowSeconds();
+        assert_test(device.sendMessages(LoopbackMidiInterface::kDeviceId, notes) == MidiError::None,
+                   "Send burst to loopback");
+        const uint8_t raw[] = {0xF0, 0x47, 0x00, 0x7F, 0x4A, 0x61, 0x00, 0x01, 0xF7, 0xB0, 7, 100, 10, 64};
+        assert_test(loopback->sendRawMessage(LoopbackMidiInterface::kDeviceId, raw, sizeof(raw)) == MidiError::None,
+                   "Send raw bytes to loopback");
+        assert_test(loopback->waitUntilIdle(std::chrono::seconds(5)), "Loopback delay line drains");
+        for (int i = 0; i < 500 && device.getInputLatencyStats().count < 34; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            bool ordered = received.size() == 34;
+            for (size_t i = 0; ordered && i < notes.size(); ++i) {
+                ordered = received[i].data1 == notes[i].data1 && received[i].deviceId == LoopbackMidiInterface::kDeviceId &&
+                          received[i].timestamp >= sentAt;
+            }
+            assert_test(ordered, "Loopback delivers in send order");
+            assert_test(received.size() == 34 && received[32].status == 0xB0 && received[33].data1 == 10 &&
+                        received[33].data2 == 64, "Raw bytes parsed with running status");
+            assert_test(sysEx == std::vector<uint8_t>(raw, raw + 9), "SysEx looped back whole");
+        }
+        LatencySummary latency = device.getInputLatencyStats();
+        assert_test(latency.count == 34 && latency.p50 >= 4.0, "Simulated latency visible in input statistics");
+        device.stopRealTimeProcessing();
+        
+        // With no consumer, exactly the messages beyond the buffer are dropped
+        const uint64_t receivedBefore = device.getMessagesReceived();
+        loopback->setTiming(LoopbackTiming());
+        device.setBufferSize(1000);
+        assert_test(loopback->startLoad({1e6, 100, 5000}), "Start loopback load");
+        assert_test(loopback->waitUntilIdle(std::chrono::seconds(5)), "Loopback load completes");
+        assert_test(loopback->getMessagesGenerated() == 5050 && device.getMessagesReceived() - receivedBefore == 5000 &&
+                    device.getDroppedMessages() == 4000, "Loopback load drop accounting is exact");
+        assert_test(!loopback->startLoad({0.0, 1, 0}) && !loopback->startLoad({1000.0, 0, 0}),
+                   "Invalid load rejected");
+    }
+    
+    void benchmarkLoopbackIngestion() {
+        for (size_t burst : {size_t(1), size_t(64)}) {
+            MidiDevice device;
+            auto backend = std::make_unique<LoopbackMidiInterface>();
+            LoopbackMidiInterface* loopback = backend.get();
+            device.initialize(std::move(backend));
+            device.setBufferSize(MidiDevice::kMessageQueueCapacity);
+            std::atomic<uint64_t> dispatched{0};
+            device.setMidiInputCallback([&](const RealTimeMidiMessage&) {
+                dispatched.fetch_add(1, std::memory_order_relaxed);
+            });
+            device.connectToDevice(LoopbackMidiInterface::kDeviceId);
+            device.startRealTimeProcessing();
+            
+            const uint64_t total = 1000000;
+            const auto start = std::chrono::steady_clock::now();
+            loopback->startLoad({500000.0, burst, total});
+            loopback->waitUntilIdle(std::chrono::seconds(30));
+            while (dispatched + device.getDroppedMessages() < total) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            device.stopRealTimeProcessing();
+            
+            LatencySummary latency = device.getInputLatencyStats();
+            std::cout << "  Loopback ingestion, 500k msg/s target, bursts of " << burst << ": "
+                      << total / seconds / 1000.0 << "k msg/s, dropped " << device.getDroppedMessages()
+                      << ", p50 " << latency.p50 * 1000.0 << " us, p99 " << latency.p99 * 1000.0 << " us\n";
+        }
+    }
+    
+    void testSequencerInput() {
+#ifdef __linux__
+        // A second sequencer client plays the keyboard; needs /dev/snd/seq
+        snd_seq_t* keyboard = nullptr;
+        if (snd_seq_open(&keyboard, "default", SND_SEQ_OPEN_OUTPUT, 0) < 0) {
+            assert_test(true, "Sequencer input skipped (no ALSA sequencer)");
+            return;
+        }
+        snd_seq_set_client_name(keyboard, "PianoSynthTestKeyboard");
+        const int port = snd_seq_create_simple_port(keyboard, "Keys",
+            SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ, SND_SEQ_PORT_TYPE_MIDI_GENERIC);
+        const int deviceId = snd_seq_client_id(keyboard) * 1000 + port;
+        
+        MidiDevice device;
+        device.initialize();
+        std::mutex mutex;
+        std::vector<RealTimeMidiMessage> received;
+        device.setMidiInputCallback([&](const RealTimeMidiMessage& message) {
+            std::lock_guard<std::mutex> lock(mutex);
+            received.push_back(message);
+        });
+        std::vector<uint8_t> sysEx;
+        bool sysExComplete = false;
+        device.setSysExCallback([&](const MidiSysExMessage& message) {
+            std::lock_guard<std::mutex> lock(mutex);
+            sysEx.insert(sysEx.end(), message.data, message.data + message.length);
+            sysExComplete = message.complete && message.deviceId == deviceId;
+        });
+        device.startRealTimeProcessing();
+        device.scanForDevices();
+        assert_test(device.connectToDevice(deviceId), "Subscribe to sequencer client:port");
+        
+        snd_seq_event_t event;
+        snd_seq_ev_clear(&event);
+        snd_seq_ev_set_source(&event, port);
+        snd_seq_ev_set_subs(&event);
+        snd_seq_ev_set_direct(&event);
+        snd_seq_ev_set_noteon(&event, 2, 64, 90);
+        snd_seq_event_output(keyboard, &event);
+        snd_seq_ev_set_controller(&event, 2, 64, 127);
+        snd_seq_event_output(keyboard, &event);
+        snd_seq_ev_set_pitchbend(&event, 2, -8192);
+        snd_seq_event_output(keyboard, &event);
+        // The sequencer splits long SysEx into several events
+        uint8_t reply[] = {0xF0, 0x7E, 0x7F, 0x06, 0x02, 0x47, 0x32, 0x00, 0x19, 0x00, 0x01, 0x00, 0x00, 0x00, 0xF7};
+        snd_seq_ev_set_sysex(&event, 6, reply);
+        snd_seq_event_output(keyboard, &event);
+        snd_seq_ev_set_sysex(&event, sizeof(reply) - 6, reply + 6);
+        snd_seq_event_output(keyboard, &event);
+        snd_seq_drain_output(keyboard);
+        
+        for (int i = 0; i < 1000; ++i) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (received.size() >= 3 && sysExComplete) break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        device.stopRealTimeProcessing();
+        device.shutdown();
+        snd_seq_close(keyboard);
+        
+        assert_test(received.size() == 3, "Sequencer events delivered");
+        if (received.size() == 3) {
+            assert_test(received[0].status == 0x90 && received[0].channel == 3 && received[0].data1 == 64 &&
+                        received[0].data2 == 90 && received[0].deviceId == deviceId, "Note on converted");
+            assert_test(received[1].status == 0xB0 && received[1].data1 == 64 && received[1].data2 == 127,
+                       "Controller converted");
+            assert_test(received[2].status == 0xE0 && received[2].data1 == 0 && received[2].data2 == 0,
+                       "Pitch bend converted");
+        }
+        assert_test(sysExComplete && sysEx == std::vector<uint8_t>(reply, reply + sizeof(reply)),
+                   "SysEx split over sequencer events reassembled");
+#endif
+    }
+    
+    void testBatchSend() {
+        std::vector<RealTimeMidiMessage> chord;
+        for (int note : {60, 64, 67, 72}) {
+            chord.push_back(noteMessage(note, nowSeconds()));
+        }
+        
+        // Default interface implementation forwards each message in order
+        MidiDevice device;
+        auto backend = std::make_unique<InjectingMidiInterface>();
+        InjectingMidiInterface* output = backend.get();
+        device.initialize(std::move(backend));
+        assert_test(device.sendMessages(0, chord) == MidiError::None && output->sent.size() == 4 &&
+                    output->sent[2].data1 == 67 && device.getMessagesSent() == 4, "Batch forwarded message by message");
+        
+        // The platform backend validates the whole batch before sending any of it
+        midiDevice_->resetStatistics();
+        std::vector<RealTimeMidiMessage> invalid = chord;
+        invalid[3].channel = 0;
+        auto devices = midiDevice_->scanForDevices();
+        const int deviceId = devices.empty() ? 0 : devices[0].deviceId;
+        assert_test(midiDevice_->sendMessages(deviceId, invalid) == MidiError::InvalidMessage &&
+                    midiDevice_->getMessagesSent() == 0, "Invalid message rejects whole batch");
+        assert_test(midiDevice_->sendMessages(99999, chord) == MidiError::DeviceNotFound,
+                   "Batch to unknown device fails");
+        assert_test(midiDevice_->sendMessages(deviceId, nullptr, 0) != MidiError::InvalidMessage, "Empty batch passes validation");
+    }
+    
+    void testSequencerOutput() {
+#ifdef __linux__
+        // A second sequencer client plays the synthesizer we send to
+        snd_seq_t* synth = nullptr;
+        if (snd_seq_open(&synth, "default", SND_SEQ_OPEN_INPUT, SND_SEQ_NONBLOCK) < 0) {
+            assert_test(true, "Sequencer output skipped (no ALSA sequencer)");
+            return;
+        }
+        snd_seq_set_client_name(synth, "PianoSynthTestSynth");
+        const int port = snd_seq_create_simple_port(synth, "Synth",
+            SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE, SND_SEQ_PORT_TYPE_MIDI_GENERIC);
+        const int deviceId = snd_seq_client_id(synth) * 1000 + port;
+        
+        MidiDevice device;
+        device.initialize();
+        device.scanForDevices();
+        assert_test(device.connectToDevice(deviceId), "Connect to sequencer synthesizer");
+        
+        std::vector<RealTimeMidiMessage> chord;
+        for (int note : {60, 64, 67, 72}) {
+            chord.push_back(noteMessage(note, nowSeconds()));
+        }
+        chord.back().channel = 5;
+        MidiError error = device.sendMessages(deviceId, chord);
+        assert_test(error == MidiError::None, "Chord sent as one burst");
+        
+        std::vector<snd_seq_event_t> events;
+        for (int i = 0; i < 1000 && events.size() < 4; ++i) {
+            snd_seq_event_t* event = nullptr;
+            while (snd_seq_event_input(synth, &event) >= 0 && event) {
+                events.push_back(*event);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        device.shutdown();
+        snd_seq_close(synth);
+        
+        bool chordReceived = events.size() >= 4;
+        for (size_t i = 0; chordReceived && i < 4; ++i) {
+            chordReceived = events[i].type == SND_SEQ_EVENT_NOTEON && events[i].data.note.note == chord[i].data1 &&
+                            events[i].data.note.velocity == 100;
+        }
+        assert_test(chordReceived && events[3].data.note.channel == 4, "Chord received in order");
+#endif
+    }
+    
+    static MidiDeviceInfo deviceInfo(int id, const std::string& name) {
+        return MidiDeviceInfo{id, name, "Test", true, false, true, 1};
+    }
+    
+    void testDeviceRegistry() {
+        assert_test(DeviceRegistry::normalizeName("Oxygen Pro 61 MIDI-1") == "oxygenpro61midi1",
+                   "Device names normalized");
+        
+        DeviceRegistry registry;
+        assert_test(registry.update(deviceInfo(24000, "Oxygen Pro 61 MIDI 1")) &&
+                    registry.update(deviceInfo(24001, "Oxygen Pro 61 MIDI 2")) &&
+                    !registry.update(deviceInfo(24001, "Oxygen Pro 61 DAW")), "Registry reports new and updated ids");
+        assert_test(registry.find(24001).name == "Oxygen Pro 61 DAW" && registry.find(99).deviceId == -1,
+                   "Registry lookup by id");
+        assert_test(registry.findByName("oxygen pro 61 midi 1").deviceId == 24000 &&
+                    registry.findByName("Oxygen Pro 61 MIDI 2").deviceId == -1 &&
+                    registry.findByName("OXYGEN PRO 61 DAW").deviceId == 24001, "Registry lookup by normalized name");
+        
+        // Duplicate names resolve to the lowest id, falling back when it leaves
+        registry.update(deviceInfo(20000, "Oxygen Pro 61 DAW"));
+        assert_test(registry.findByName("Oxygen Pro 61 DAW").deviceId == 20000, "Duplicate name resolves to lowest id");
+        MidiDeviceInfo removed;
+        assert_test(registry.remove(20000, &removed) && removed.deviceId == 20000 &&
+                    registry.findByName("Oxygen Pro 61 DAW").deviceId == 24001 && !registry.remove(20000),
+                   "Removal falls back to remaining device with the name");
+        
+        auto gone = registry.removeIf([](const MidiDeviceInfo& device) { return device.deviceId / 1000 == 24; });
+        assert_test(gone.size() == 2 && gone[0].deviceId == 24000 && registry.empty() &&
+                    registry.findByName("Oxygen Pro 61 MIDI 1").deviceId == -1, "Client exit removes all its ports");
+        
+        registry.replaceAll({deviceInfo(1, "A"), deviceInfo(2, "B")});
+        std::vector<MidiDeviceInfo> added;
+        std::vector<MidiDeviceInfo> dropped;
+        registry.replaceAll({deviceInfo(3, "C"), deviceInfo(2, "B")}, &added, &dropped);
+        auto all = registry.snapshot();
+        assert_test(added.size() == 1 && added[0].deviceId == 3 && dropped.size() == 1 && dropped[0].deviceId == 1 &&
+                    all.size() == 2 && all[0].deviceId == 2 && all[1].deviceId == 3, "Rescan reports differences");
+        
+        // MidiDevice lookups are served from the cache once scanned
+        MidiDevice device;
+        device.initialize(std::make_unique<LoopbackMidiInterface>());
+        assert_test(device.findDevice("loopback midi").deviceId == LoopbackMidiInterface::kDeviceId &&
+                    device.findDevice("Loop").deviceId == LoopbackMidiInterface::kDeviceId &&
+                    device.findDevice("Nothing").deviceId == -1, "findDevice by normalized name and substring");
+    }
+    
+    void testSequencerHotplug() {
+#ifdef __linux__
+        // A fake Oxygen Pro is plugged in, connected, unplugged and replugged
+        auto plugIn = [](snd_seq_t** keyboard) {
+            if (snd_seq_open(keyboard, "default", SND_SEQ_OPEN_OUTPUT, 0) < 0) {
+                return -1;
+            }
+            snd_seq_set_client_name(*keyboard, "Oxygen Pro 61");
+            const int port = snd_seq_create_simple_port(*keyboard, "Oxygen Pro 61 MIDI 1",
+                SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ, SND_SEQ_PORT_TYPE_MIDI_GENERIC);
+            return snd_seq_client_id(*keyboard) * 1000 + port;
+        };
+        
+        MidiDevice device;
+        device.initialize();
+        std::mutex mutex;
+        std::vector<std::pair<int, bool>> events;
+        device.setDeviceConnectionCallback([&](const MidiDeviceInfo& info, bool connected) {
+            std::lock_guard<std::mutex> lock(mutex);
+            events.emplace_back(info.deviceId, connected);
+        });
+        std::atomic<int> notes{0};
+        device.setMidiInputCallback([&](const RealTimeMidiMessage& message) {
+            if (message.status == 0x90) notes++;
+        });
+        device.startRealTimeProcessing();
+        auto waitFor = [&](const std::function<bool()>& condition) {
+            for (int i = 0; i < 2000 && !condition(); ++i) {
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+            return condition();
+        };
+        auto sawEvent = [&](int id, bool connected) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return std::find(events.begin(), events.end(), std::make_pair(id, connected)) != events.end();
+        };
+        
+        snd_seq_t* keyboard = nullptr;
+        const int firstId = plugIn(&keyboard);
+        if (firstId < 0) {
+            assert_test(true, "Hotplug skipped (no ALSA sequencer)");
+            return;
+        }
+        assert_test(waitFor([&] { return sawEvent(firstId, true); }), "Plugged-in port announced");
+        assert_test(device.findDevice("oxygen pro 61 midi 1").deviceId == firstId, "Announced port found without rescan");
+        assert_test(device.connectToOxygenPro() && device.isOxygenProConnected(), "Connect to announced Oxygen Pro");
+        
+        snd_seq_close(keyboard);
+        assert_test(waitFor([&] { return sawEvent(firstId, false); }) && !device.isOxygenProConnected() &&
+                    device.findDevice("Oxygen Pro 61 MIDI 1").deviceId == -1, "Unplug removes the device");
+        
+        const auto replugged = std::chrono::steady_clock::now();
+        const int secondId = plugIn(&keyboard);
+        const bool reconnected = waitFor([&] { return device.isOxygenProConnected(); });
+        const double reconnectMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - replugged).count();
+        assert_test(reconnected && secondId != firstId, "Replugged Oxygen Pro reconnected automatically");
+        std::cout << "  Replug to reconnect: " << reconnectMs << " ms\n";
+        
+        snd_seq_event_t event;
+        snd_seq_ev_clear(&event);
+        snd_seq_ev_set_source(&event, secondId % 1000);
+        snd_seq_ev_set_subs(&event);
+        snd_seq_ev_set_direct(&event);
+        snd_seq_ev_set_noteon(&event, 0, 60, 100);
+        snd_seq_event_output(keyboard, &event);
+        snd_seq_drain_output(keyboard);
+        assert_test(waitFor([&] { return notes > 0; }), "Input flows from the replugged device");
+        
+        device.stopRealTimeProcessing();
+        device.shutdown();
+        snd_seq_close(keyboard);
+#endif
+    }
+    
     void testOxygenProDetection() {
         auto oxygenPro = midiDevice_->findMAudioOxygenPro();
         
@@ -449,6 +2244,536 @@ private:
         assert_test(!midiDevice_->getLastErrorString().empty(), "Error string set");
     }
     
+    void testErrorLog() {
+        // Without a backend every send fails; recording it must not allocate
+        MidiDevice device;
+        const uint64_t allocationsBefore = g_heapAllocations.load();
+        device.sendNoteOn(3, 1, 60, 100);
+        device.sendNoteOff(4, 1, 60, 0);
+        device.sendControlChange(5, 1, 7, 100);
+        const uint64_t allocations = g_heapAllocations.load() - allocationsBefore;
+        assert_test(allocations == 0, "Failed sends recorded without allocating");
+        
+        std::vector<MidiErrorRecord> errors = device.getRecentErrors();
+        assert_test(device.getErrorCount() == 3 && errors.size() == 3 && errors[0].sequence == 1 &&
+                    errors[2].sequence == 3, "Error records kept in order");
+        assert_test(errors[0].error == MidiError::DeviceNotConnected && errors[0].deviceId == 3 &&
+                    errors[0].status == 0x90 && errors[1].status == 0x80 && errors[2].deviceId == 5 &&
+                    errors[2].status == 0xB0 && errors[2].timestamp >= errors[0].timestamp &&
+                    errors[0].timestamp > 0.0, "Error records describe the failed send");
+        assert_test(device.getLastError() == MidiError::DeviceNotConnected &&
+                    device.getLastErrorString() == "Device not connected", "Error string looked up when queried");
+        assert_test(device.getRecentErrors(2).size() == 2 && device.getRecentErrors(2)[0].sequence == 2,
+                   "Recent errors limited to newest");
+        
+        device.clearErrors();
+        assert_test(device.getLastError() == MidiError::None && device.getLastErrorString().empty() &&
+                    device.getErrorCount() == 3 && device.getRecentErrors().size() == 3, "Clearing keeps the log");
+        
+        for (int i = 0; i < 200; ++i) {
+            device.sendPitchBend(i, 1, 8192);
+        }
+        errors = device.getRecentErrors(1000);
+        bool newestKept = errors.size() == MidiDevice::kErrorLogCapacity;
+        for (size_t i = 0; newestKept && i < errors.size(); ++i) {
+            newestKept = errors[i].sequence == 203 - MidiDevice::kErrorLogCapacity + 1 + i &&
+                         errors[i].deviceId == static_cast<int>(errors[i].sequence) - 4 && errors[i].status == 0xE0;
+        }
+        assert_test(newestKept, "Error log keeps the newest records");
+        
+        // Codes from a backend are described by that backend
+        MidiDevice loopbackDevice;
+        loopbackDevice.initialize(std::make_unique<LoopbackMidiInterface>());
+        loopbackDevice.sendNoteOn(99999, 1, 60, 100);
+        assert_test(loopbackDevice.getLastError() != MidiError::None &&
+                    loopbackDevice.getLastErrorString() == LoopbackMidiInterface().getErrorString(loopbackDevice.getLastError()),
+                   "Backend describes its error codes");
+        
+        // Concurrent senders and a reader: every record read is whole
+        MidiDevice shared;
+        const int senders = 4;
+        const int perSender = 5000;
+        std::atomic<bool> sending{true};
+        std::atomic<int> torn{0};
+        std::atomic<int> checked{0};
+        std::thread reader([&]() {
+            bool more = true;
+            while (more) {
+                more = sending.load();
+                for (const MidiErrorRecord& record : shared.getRecentErrors()) {
+                    const uint8_t expected = static_cast<uint8_t>(0x80 + (record.deviceId % senders) * 0x10);
+                    if (record.status != expected || record.error != MidiError::DeviceNotConnected) {
+                        torn++;
+                    }
+                    checked++;
+                }
+                std::this_thread::yield();
+            }
+        });
+        std::vector<std::thread> threads;
+        for (int t = 0; t < senders; ++t) {
+            threads.emplace_back([&shared, t]() {
+                RealTimeMidiMessage message = noteMessage(60, 0.0);
+                message.status = static_cast<uint8_t>(0x80 + t * 0x10);
+                for (int i = 0; i < perSender; ++i) {
+                    shared.sendMessages(t + i * senders, &message, 1);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        sending = false;
+        reader.join();
+        assert_test(shared.getErrorCount() == static_cast<uint64_t>(senders) * perSender &&
+                    shared.getRecentErrors().size() == MidiDevice::kErrorLogCapacity, "Concurrent errors all counted");
+        assert_test(torn == 0, "Concurrent error records never torn (" + std::to_string(checked.load()) + " read)");
+    }
+    
+    void benchmarkErrorReporting() {
+        // A failing send, against the same send recording its error under a
+        // mutex with the error string copied every time
+        MidiDevice device;
+        const int sends = 1000000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < sends; ++i) {
+            device.sendNoteOn(0, 1, i & 0x7F, 100);
+        }
+        const double recorded = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        
+        std::mutex mutex;
+        MidiError lastError = MidiError::None;
+        std::string lastErrorString;
+        LoopbackMidiInterface strings;
+        start = std::chrono::steady_clock::now();
+        double timestamps = 0.0;
+        for (int i = 0; i < sends; ++i) {
+            timestamps += MidiDevice::timestampNow();
+            std::lock_guard<std::mutex> lock(mutex);
+            lastError = MidiError::DeviceNotConnected;
+            lastErrorString = strings.getErrorString(lastError);
+        }
+        const double locked = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  Failed send: " << recorded / sends << " ns (mutex and string per error: "
+                  << locked / sends << " ns, checksum " << lastErrorString.size() + (timestamps > 0.0) << ")\n";
+    }
+    
+    static bool waitForScheduled(const MidiScheduler& scheduler, uint64_t sent) {
+        for (int i = 0; i < 2000 && scheduler.getStats().sent < sent; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return scheduler.getStats().sent >= sent;
+    }
+    
+    void testMidiScheduler() {
+        MidiDevice device;
+        auto backend = std::make_unique<InjectingMidiInterface>();
+        InjectingMidiInterface* output = backend.get();
+        device.initialize(std::move(backend));
+        
+        MidiScheduler scheduler(device);
+        scheduler.setDelivery(MidiScheduler::Delivery::BackendQueue);
+        assert_test(!device.canScheduleMessages() && !scheduler.start(), "Backend queue refused when there is none");
+        scheduler.setDelivery(MidiScheduler::Delivery::Auto);
+        
+        // Scheduled before start and out of order; the note off for 60 is
+        // due with the note on for 61 and was scheduled first, so goes first
+        const double start = nowSeconds() + 0.02;
+        RealTimeMidiMessage off = noteMessage(60, start + 0.005);
+        off.status = 0x80;
+        off.data2 = 64;
+        scheduler.schedule(7, off);
+        std::vector<RealTimeMidiMessage> notes;
+        for (int i = 9; i >= 0; --i) {
+            notes.push_back(noteMessage(60 + i, start + i * 0.005));
+        }
+        scheduler.schedule(7, notes.data(), notes.size());
+        assert_test(scheduler.pending() == 11, "Messages held until started");
+        
+        assert_test(scheduler.start() && scheduler.isRunning() && !scheduler.usesBackendQueue(),
+                   "Scheduler falls back to its own dispatcher");
+        const bool allSent = waitForScheduled(scheduler, 11);
+        MidiScheduleStats stats = scheduler.getStats();
+        std::cout << "  Dispatcher lateness: p50 " << stats.lateness.p50 << " ms, p99 " << stats.lateness.p99
+                  << " ms, max " << stats.lateness.max << " ms\n";
+        assert_test(allSent && stats.scheduled == 11 && stats.sent == 11 && stats.failed == 0 && stats.pending == 0 &&
+                    stats.lateness.count == 11, "Scheduled messages all sent");
+        assert_test(stats.lateness.p50 < 5.0, "Messages sent close to their timestamps");
+        
+        // A message in the past goes out at once; one far ahead waits
+        RealTimeMidiMessage now = noteMessage(50, nowSeconds() - 1.0);
+        now.channel = 3;
+        scheduler.schedule(7, now);
+        scheduler.schedule(7, noteMessage(90, nowSeconds() + 60.0));
+        assert_test(waitForScheduled(scheduler, 12) && scheduler.pending() == 1, "Overdue message sent immediately");
+        assert_test(!scheduler.setDelivery(MidiScheduler::Delivery::Dispatcher) && !scheduler.setLookahead(0.1) &&
+                    !scheduler.start(), "Scheduler configuration fixed while running");
+        
+        scheduler.stop();
+        stats = scheduler.getStats();
+        assert_test(!scheduler.isRunning() && stats.cancelled == 1 && stats.pending == 0, "Stop drops pending messages");
+        
+        const uint8_t expectedNotes[] = {60, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 50};
+        bool ordered = output->sent.size() == 14;
+        for (size_t i = 0; ordered && i < 12; ++i) {
+            ordered = output->sent[i].data1 == expectedNotes[i] && output->sent[i].deviceId == 7 &&
+                      (output->sent[i].status == 0x80) == (i == 1);
+        }
+        assert_test(ordered, "Messages sent in timestamp order, ties in scheduling order");
+        assert_test(ordered && output->sent[12].status == 0xB0 && output->sent[12].data1 == 123 &&
+                    output->sent[12].channel == 1 && output->sent[13].data1 == 123 && output->sent[13].channel == 3,
+                   "All Notes Off sent on the channels played");
+        
+        // Key events from MidiInput, sped up twenty times
+        std::vector<KeyEvent> keys;
+        for (KeyEvent key : MidiInput().generateMixedPerformance()) {
+            if (key.timestamp < 2.0) {
+                key.timestamp *= 0.05;
+                keys.push_back(key);
+            }
+        }
+        std::vector<KeyEvent> expectedKeys = keys;
+        std::stable_sort(expectedKeys.begin(), expectedKeys.end(),
+                         [](const KeyEvent& a, const KeyEvent& b) { return a.timestamp < b.timestamp; });
+        output->sent.clear();
+        scheduler.resetStats();
+        assert_test(scheduler.start(), "Scheduler restarts after stop");
+        scheduler.schedule(2, keys, nowSeconds() + 0.01);
+        const bool keysSent = waitForScheduled(scheduler, keys.size());
+        scheduler.stop();
+        bool keysPlayed = keysSent && output->sent.size() >= keys.size();
+        for (size_t i = 0; keysPlayed && i < keys.size(); ++i) {
+            const RealTimeMidiMessage expected = MidiDevice::keyEventToMessage(expectedKeys[i], 2);
+            keysPlayed = output->sent[i].status == expected.status && output->sent[i].data1 == expected.data1 &&
+                         output->sent[i].channel == expected.channel && output->sent[i].deviceId == 2;
+        }
+        assert_test(!keys.empty() && keysPlayed, "Key events played in time order");
+        
+        // Delivery allocates nothing, even to more devices than are tracked for silencing
+        output->sent.clear();
+        output->sent.reserve(1024);
+        const double due = nowSeconds() + 0.05;
+        for (int id = 0; id < 40; ++id) {
+            scheduler.schedule(id, noteMessage(60, due));
+        }
+        scheduler.start();
+        // Polling the stats allocates nothing either
+        const uint64_t allocationsBefore = g_heapAllocations.load();
+        const bool delivered = waitForScheduled(scheduler, keys.size() + 40);
+        const uint64_t allocations = g_heapAllocations.load() - allocationsBefore;
+        assert_test(delivered && allocations == 0, "Scheduled delivery does not allocate");
+        scheduler.stop();
+        const size_t silenced = std::count_if(output->sent.begin(), output->sent.end(),
+                                              [](const RealTimeMidiMessage& m) { return m.status == 0xB0; });
+        assert_test(silenced == 32, "All Notes Off sent to every tracked device");
+        
+        scheduler.schedule(2, noteMessage(70, nowSeconds() + 60.0));
+        scheduler.cancel();
+        assert_test(scheduler.pending() == 0 && scheduler.getStats().cancelled == 1, "Cancel drops messages before start");
+    }
+    
+    void testSchedulerSequencerQueue() {
+#ifdef __linux__
+        snd_seq_t* synth = nullptr;
+        if (snd_seq_open(&synth, "default", SND_SEQ_OPEN_INPUT, SND_SEQ_NONBLOCK) < 0) {
+            assert_test(true, "Sequencer queue scheduling skipped (no ALSA sequencer)");
+            return;
+        }
+        snd_seq_set_client_name(synth, "PianoSynthTestSynth");
+        const int port = snd_seq_create_simple_port(synth, "Synth",
+            SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE, SND_SEQ_PORT_TYPE_MIDI_GENERIC);
+        const int deviceId = snd_seq_client_id(synth) * 1000 + port;
+        
+        MidiDevice device;
+        device.initialize();
+        device.scanForDevices();
+        device.connectToDevice(deviceId);
+        
+        // The whole phrase fits in the lookahead, so the kernel times it
+        MidiScheduler scheduler(device);
+        scheduler.setLookahead(0.5);
+        assert_test(scheduler.start() && scheduler.usesBackendQueue(), "Scheduler uses the sequencer queue");
+        const double start = nowSeconds() + 0.05;
+        std::vector<RealTimeMidiMessage> phrase;
+        for (int i = 0; i < 4; ++i) {
+            phrase.push_back(noteMessage(60 + i, start + i * 0.03));
+        }
+        scheduler.schedule(deviceId, phrase.data(), phrase.size());
+        
+        std::vector<std::pair<int, double>> arrivals;
+        for (int i = 0; i < 1000 && arrivals.size() < 4; ++i) {
+            snd_seq_event_t* event = nullptr;
+            while (snd_seq_event_input(synth, &event) >= 0 && event) {
+                if (event->type == SND_SEQ_EVENT_NOTEON) {
+                    arrivals.emplace_back(event->data.note.note, nowSeconds());
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        bool onTime = arrivals.size() == 4;
+        for (size_t i = 0; onTime && i < 4; ++i) {
+            // Not before its time; polling adds up to a millisecond or so
+            onTime = arrivals[i].first == phrase[i].data1 && arrivals[i].second >= phrase[i].timestamp - 0.002;
+        }
+        assert_test(onTime, "Sequencer delivers scheduled notes at their times");
+        
+        // Cancelling removes events already in the kernel queue
+        scheduler.schedule(deviceId, noteMessage(80, nowSeconds() + 0.1));
+        for (int i = 0; i < 100 && scheduler.getStats().sent < 5; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        scheduler.cancel();
+        bool cancelledNote = false;
+        bool allNotesOff = false;
+        for (int i = 0; i < 200; ++i) {
+            snd_seq_event_t* event = nullptr;
+            while (snd_seq_event_input(synth, &event) >= 0 && event) {
+                cancelledNote |= event->type == SND_SEQ_EVENT_NOTEON && event->data.note.note == 80;
+                allNotesOff |= event->type == SND_SEQ_EVENT_CONTROLLER && event->data.control.param == 123;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        scheduler.stop();
+        assert_test(scheduler.getStats().sent == 5 && !cancelledNote && allNotesOff,
+                   "Cancel removes queued notes and silences the synthesizer");
+        
+        // Cancelling one destination leaves another's queued events alone
+        const int otherPort = snd_seq_create_simple_port(synth, "Synth 2",
+            SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE, SND_SEQ_PORT_TYPE_MIDI_GENERIC);
+        const int otherId = snd_seq_client_id(synth) * 1000 + otherPort;
+        device.scanForDevices();
+        device.connectToDevice(otherId);
+        RealTimeMidiMessage first = noteMessage(81, nowSeconds() + 0.05);
+        RealTimeMidiMessage second = noteMessage(82, first.timestamp);
+        device.scheduleMessages(deviceId, &first, 1);
+        device.scheduleMessages(otherId, &second, 1);
+        device.cancelScheduledMessages(deviceId);
+        std::vector<int> played;
+        for (int i = 0; i < 200 && played.empty(); ++i) {
+            snd_seq_event_t* event = nullptr;
+            while (snd_seq_event_input(synth, &event) >= 0 && event) {
+                if (event->type == SND_SEQ_EVENT_NOTEON) {
+                    played.push_back(event->data.note.note);
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        device.shutdown();
+        snd_seq_close(synth);
+        assert_test(played.size() == 1 && played[0] == 82, "Cancelling one device keeps other devices' events");
+#endif
+    }
+    
+    void benchmarkSchedulerJitter() {
+        // Lateness of 500 messages 1 ms apart, against a plain sleep_until loop
+        const int count = 500;
+        MidiDevice device;
+        device.initialize(std::make_unique<InjectingMidiInterface>());
+        MidiScheduler scheduler(device);
+        scheduler.setDelivery(MidiScheduler::Delivery::Dispatcher);
+        scheduler.start();
+        const double start = nowSeconds() + 0.01;
+        for (int i = 0; i < count; ++i) {
+            scheduler.schedule(0, noteMessage(i, start + i * 0.001));
+        }
+        waitForScheduled(scheduler, count);
+        const LatencySummary scheduled = scheduler.getStats().lateness;
+        scheduler.stop();
+        
+        LatencyHistogram slept;
+        const auto sleepStart = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+        for (int i = 0; i < count; ++i) {
+            const auto due = sleepStart + std::chrono::milliseconds(i);
+            std::this_thread::sleep_until(due);
+            slept.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - due).count()));
+        }
+        const LatencySummary baseline = slept.summary();
+        std::cout << "  Scheduler lateness: p50 " << scheduled.p50 << " ms, p99 " << scheduled.p99 << " ms, max "
+                  << scheduled.max << " ms (sleep_until: p50 " << baseline.p50 << " ms, p99 " << baseline.p99
+                  << " ms, max " << baseline.max << " ms)\n";
+    }
+    
+    static RealTimeMidiMessage clockMessage(uint8_t status, double timestamp, int deviceId = 0) {
+        RealTimeMidiMessage message;
+        message.status = status;
+        message.channel = 1;
+        message.timestamp = timestamp;
+        message.deviceId = deviceId;
+        return message;
+    }
+    
+    void testMidiClock() {
+        MidiClock clock;
+        assert_test(clock.snapshot().bpm == 0.0 && !clock.snapshot().running && !clock.process(0x90, 60, 100, 0.0),
+                   "Clock idle until clocks arrive");
+        
+        // 120 BPM with up to 0.5 ms of arrival jitter either way
+        uint32_t seed = 12345;
+        auto jitter = [&seed]() {
+            seed = seed * 1664525u + 1013904223u;
+            return ((seed >> 8) / 16777216.0 - 0.5) * 0.001;
+        };
+        double tick = 60.0 / (120.0 * MidiClock::kClocksPerBeat);
+        double next = 1000.0;
+        clock.process(0xFA, 0, 0, next - 0.001);
+        assert_test(!clock.snapshot().running && clock.snapshot().beat == 0.0, "Start waits for the first clock");
+        double loopError = 0.0;
+        double arrivalError = 0.0;
+        for (int i = 0; i < 96; ++i) {
+            const double arrival = next + jitter();
+            clock.process(0xF8, 0, 0, arrival);
+            if (i >= 48) {
+                loopError = std::max(loopError, std::fabs(clock.snapshot().time - next));
+                arrivalError = std::max(arrivalError, std::fabs(arrival - next));
+            }
+            next += tick;
+        }
+        MidiClockSnapshot snapshot = clock.snapshot();
+        std::cout << "  Phase error: " << loopError * 1e3 << " ms (arrivals " << arrivalError * 1e3 << " ms), "
+                  << snapshot.bpm << " BPM\n";
+        assert_test(snapshot.running && snapshot.locked && std::fabs(snapshot.bpm - 120.0) < 0.5 &&
+                    snapshot.beat == 95.0 / 24.0 && snapshot.clocks == 96, "Tempo and position locked to clock");
+        assert_test(loopError < arrivalError && snapshot.jitter > 0.0 && snapshot.jitter < 0.001,
+                   "Loop phase steadier than clock arrivals");
+        assert_test(std::fabs(snapshot.beatAt(next) - 4.0) < 0.01 && std::fabs(snapshot.timeOfBeat(8.0) - (next + 96 * tick)) < 0.002,
+                   "Beat extrapolated between clocks");
+        
+        // Jump to 140 BPM; the loop reacquires
+        tick = 60.0 / (140.0 * MidiClock::kClocksPerBeat);
+        for (int i = 0; i < 48; ++i) {
+            clock.process(0xF8, 0, 0, next + jitter());
+            next += tick;
+        }
+        snapshot = clock.snapshot();
+        assert_test(snapshot.locked && std::fabs(snapshot.bpm - 140.0) < 0.5, "Tempo change followed");
+        
+        // Transport: Stop holds the position, Song Position moves it, Continue resumes, Start rewinds
+        clock.process(0xFC, 0, 0, next);
+        for (int i = 0; i < 5; ++i) {
+            clock.process(0xF8, 0, 0, next);
+            next += tick;
+        }
+        snapshot = clock.snapshot();
+        assert_test(!snapshot.running && snapshot.beat == 6.0 && snapshot.clocks == 149 && snapshot.beatAt(next + 1.0) == 6.0,
+                   "Stop holds position while clocks continue");
+        clock.process(0xF2, 32, 0, next);
+        assert_test(clock.snapshot().beat == 8.0, "Song position sets the next beat");
+        clock.process(0xFB, 0, 0, next);
+        clock.process(0xF8, 0, 0, next);
+        next += tick;
+        assert_test(clock.snapshot().running && clock.snapshot().beat == 8.0, "Continue resumes at song position");
+        clock.process(0xF2, 0, 1, next);
+        assert_test(clock.snapshot().beat == 8.0, "Song position ignored while running");
+        clock.process(0xFA, 0, 0, next);
+        clock.process(0xF8, 0, 0, next);
+        next += tick;
+        assert_test(clock.snapshot().running && clock.snapshot().beat == 0.0, "Start rewinds to beat 0");
+        
+        next += 1.0;
+        clock.process(0xF8, 0, 0, next);
+        snapshot = clock.snapshot();
+        assert_test(!snapshot.locked && std::fabs(snapshot.bpm - 140.0) < 1.0, "Dropout unlocks but keeps tempo");
+        clock.reset();
+        assert_test(clock.snapshot().bpm == 0.0 && clock.snapshot().clocks == 0, "Clock reset");
+        
+        // Snapshots are never torn: while running from Start, beat * 24 is always clocks - 1
+        MidiClock shared;
+        std::atomic<bool> feeding{true};
+        std::atomic<bool> consistent{true};
+        std::thread reader([&]() {
+            uint64_t lastSequence = 0;
+            while (feeding.load()) {
+                const MidiClockSnapshot read = shared.snapshot();
+                if (read.sequence < lastSequence || (read.running && read.beat * 24.0 != read.clocks - 1.0)) {
+                    consistent = false;
+                }
+                lastSequence = read.sequence;
+            }
+        });
+        shared.process(0xFA, 0, 0, 0.0);
+        for (int i = 0; i < 20000; ++i) {
+            shared.process(0xF8, 0, 0, 1.0 + i * 0.02);
+        }
+        feeding = false;
+        reader.join();
+        assert_test(consistent && shared.snapshot().clocks == 20000, "Clock snapshots consistent under concurrent reads");
+        
+        // Through the device: clock is consumed on the input thread, never queued
+        MidiDevice device;
+        auto backend = std::make_unique<InjectingMidiInterface>();
+        InjectingMidiInterface* input = backend.get();
+        device.initialize(std::move(backend));
+        std::atomic<int> delivered{0};
+        device.setMidiInputCallback([&delivered](const RealTimeMidiMessage&) { delivered++; });
+        device.startRealTimeProcessing();
+        const double start = nowSeconds();
+        input->deliver(clockMessage(0xFA, start, 4));
+        for (int i = 0; i < 48; ++i) {
+            input->deliver(clockMessage(0xF8, start + i * 0.02, 4));
+            input->deliver(clockMessage(0xF8, start + i * 0.01, 5));
+        }
+        RealTimeMidiMessage note = noteMessage(60, nowSeconds());
+        note.deviceId = 4;
+        input->deliver(note);
+        for (int i = 0; i < 1000 && device.getDeviceInputStats(4).messagesDispatched < 1; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        snapshot = device.getClockSnapshot();
+        assert_test(device.getClockSource() == 4 && snapshot.clocks == 48 && snapshot.running &&
+                    std::fabs(snapshot.bpm - 125.0) < 0.5, "Device follows the first clock source");
+        assert_test(delivered == 1 && device.getDeviceInputStats(4).messagesReceived == 50,
+                   "Clock messages not queued");
+        device.setClockSource(5);
+        input->deliver(clockMessage(0xF8, start, 4));
+        input->deliver(clockMessage(0xF8, start, 5));
+        assert_test(device.getClockSource() == 5 && device.getClockSnapshot().clocks == 1, "Clock source selected");
+        device.stopRealTimeProcessing();
+    }
+    
+    void benchmarkMidiClock() {
+        // Cost per clock and per snapshot, and how much arrival jitter
+        // reaches the beat phase
+        MidiClock clock;
+        const int clocks = 1000000;
+        const double tick = 60.0 / (120.0 * MidiClock::kClocksPerBeat);
+        uint32_t seed = 1;
+        std::vector<double> arrivals(clocks);
+        for (int i = 0; i < clocks; ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            arrivals[i] = i * tick + ((seed >> 8) / 16777216.0 - 0.5) * 0.002;
+        }
+        clock.process(0xFA, 0, 0, 0.0);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < clocks; ++i) {
+            clock.process(0xF8, 0, 0, arrivals[i]);
+        }
+        const double processed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        
+        double beats = 0.0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < clocks; ++i) {
+            beats += clock.snapshot().beat;
+        }
+        const double read = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        
+        MidiClock follower;
+        follower.process(0xFA, 0, 0, 0.0);
+        double loopSquared = 0.0;
+        double arrivalSquared = 0.0;
+        for (int i = 0; i < 10000; ++i) {
+            follower.process(0xF8, 0, 0, arrivals[i]);
+            if (i >= 100) {
+                loopSquared += std::pow(follower.snapshot().time - i * tick, 2);
+                arrivalSquared += std::pow(arrivals[i] - i * tick, 2);
+            }
+        }
+        std::cout << "  Clock: " << processed / clocks << " ns per clock, " << read / clocks
+                  << " ns per snapshot; RMS phase error " << std::sqrt(loopSquared / 9900) * 1e3
+                  << " ms from " << std::sqrt(arrivalSquared / 9900) * 1e3 << " ms arrival jitter (checksum "
+                  << (beats > 0.0) << ")\n";
+    }
+    
     void testUtilityFunctions() {
         // Test factory functions
         auto platforms = MidiDeviceFactory::getSupportedPlatforms();
@@ -500,9 +2825,13 @@ private:
     }
 };
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
         MidiDeviceTest test;
+        if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+            test.runBenchmarks();
+            return 0;
+        }
         test.runAllTests();
         std::cout << "All MIDI device tests passed!\n";
         return 0;
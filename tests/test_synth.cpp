@@ -2,12 +2,15 @@
 #include "../include/Abstractor.h"
 #include "../include/NoteSynth.h"
 #include "../include/OutputHandler.h"
+#include "../include/WavCompare.h"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <filesystem>
 #include <iostream>
 #include <cstdlib>
 #include <cstdint>
+#include <vector>
 
 /**
  * @brief [AI GENERATED] Basic integration tests for synthesizer modules.
@@ -59,13 +62,51 @@ int main() {
     }
     assert(maxVal <= 1.0);
 
+    // Block rendering reproduces the batch mix before normalization
+    assert(NoteSynth::frameCount(notes, 8000) == samples.size());
+    std::vector<double> blocks(samples.size());
+    for (size_t first = 0; first < blocks.size(); first += 777) {
+        synth.renderBlock(notes, 8000, first, std::min<size_t>(777, blocks.size() - first), blocks.data() + first);
+    }
+    double blockPeak = 0.0;
+    for (double s : blocks) {
+        blockPeak = std::max(blockPeak, std::abs(s));
+    }
+    const double scale = blockPeak > 0.95 ? 0.95 / blockPeak : 1.0;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        assert(blocks[i] * scale == samples[i]);
+    }
+    // The streaming renderer matches, also when restarted from the beginning
+    NoteSynth::BlockRenderer renderer(notes, 8000);
+    std::vector<double> streamed(blocks.size());
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t first = 0; first < streamed.size(); first += 256) {
+            renderer.render(first, std::min<size_t>(256, streamed.size() - first), streamed.data() + first);
+        }
+        assert(streamed == blocks);
+    }
+    assert(synth.peakBound(notes, 8000) >= blockPeak);
+    assert(synth.streamingGain(notes, 8000) * blockPeak <= 0.95);
+
     OutputHandler out;
     std::string file = "test.wav";
     out.writeWav(samples, file, 8000);
     assert(std::filesystem::exists(file));
-    std::uintmax_t size = std::filesystem::file_size(file);
-    assert(size > 44);
+
+    // Read the render back and check it against the samples within one LSB
+    WavReader reader;
+    bool opened = reader.open(file);
+    assert(opened);
+    assert(reader.format().sampleRate == 8000 && reader.format().channels == 1);
+    assert(reader.frames() == samples.size());
+    std::vector<double> decoded = reader.readAll();
+    ErrorAccumulator acc;
+    WavCompare::accumulate(samples.data(), decoded.data(), samples.size(), acc);
+    assert(acc.maxAbsError <= 0.5 / 32767.0 + 1e-12);
+    assert(WavCompare::compareFiles(file, file).identical);
+    reader.close();
     std::filesystem::remove(file);
+    (void)opened;
 
     std::cout << "All tests passed\n";
     return 0;